@@ -2,17 +2,29 @@
  * Copyright (c) Huawei Technologies Co., Ltd. 2022-2025. All rights reserved.
  */
 
+#define _GNU_SOURCE // For pthread_setaffinity_np()
+
 #include "ucg_context.h"
+#include "ucg_group.h"
 #include "ucg_global.h"
 #include "ucg_request.h"
 #include "ucg_plan.h"
+#include "ucg_plan_tune.h"
 
 #include "planc/ucg_planc.h"
+#include "util/ucg_atomic.h"
 #include "util/ucg_helper.h"
 #include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
 #include "util/ucg_parser.h"
 #include "util/ucg_cpu.h"
 
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Idle polls of the progress thread before it begins to sleep */
+#define UCG_CONTEXT_PROGRESS_THREAD_SPINS 1000
 
 #define UCG_CONTEXT_COPY_REQUIRED_FIELD(_field, _copy, _dst, _src, _err_label) \
     UCG_COPY_REQUIRED_FIELD(UCG_TOKENPASTE(UCG_PARAMS_FIELD_, _field), _copy, _dst, _src, _err_label)
@@ -35,6 +47,50 @@ static ucg_config_field_t ucg_context_config_table[] = {
      " - n    : use spinlock by default",
      ucg_offsetof(ucg_config_t, use_mt_mutex), UCG_CONFIG_TYPE_BOOL},
 
+    {"PROGRESS_THREAD", "n",
+     "Progress the nonblocking collective operations in a background thread, so\n"
+     "that they go on while the application is computing. The context is\n"
+     "initialized in multi-thread mode, which requires building with UCG_ENABLE_MT",
+     ucg_offsetof(ucg_config_t, progress_thread), UCG_CONFIG_TYPE_BOOL},
+
+    {"PROGRESS_THREAD_CORE", "-1",
+     "The core to which the progress thread is pinned, -1 means not pinned",
+     ucg_offsetof(ucg_config_t, progress_thread_core), UCG_CONFIG_TYPE_INT},
+
+    {"PROGRESS_THREAD_MAX_SLEEP", "100",
+     "Maximum time in microseconds the idle progress thread sleeps between two\n"
+     "polls. It doubles from 1us once the thread has been idle for a while, a\n"
+     "larger value costs less CPU but delays the progress of the next collective",
+     ucg_offsetof(ucg_config_t, progress_thread_max_sleep), UCG_CONFIG_TYPE_UINT},
+
+    {"FUSION_WINDOW", "0",
+     "Maximum size of the allreduce fused from the adjacent small allreduces of\n"
+     "a group started together by one ucg_request_startall(), 0 disables the fusion.\n"
+     "Requests started one by one by ucg_request_start() are never fused. The fused\n"
+     "allreduce may run another plan and round differently than the separate ones",
+     ucg_offsetof(ucg_config_t, fusion_window), UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"FUSION_MAX_SIZE", "512",
+     "Maximum size of an allreduce to be fused with the others",
+     ucg_offsetof(ucg_config_t, fusion_max_size), UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"PLAN_TUNE", "n",
+     "Tune the plan selection online instead of following the static policies.\n"
+     "For each blocking collective type and message size bucket of a group, the\n"
+     "candidate plans take turns and are timed, then all the ranks pin the fastest\n"
+     "one. The nonblocking collectives follow the policies",
+     ucg_offsetof(ucg_config_t, plan_tune), UCG_CONFIG_TYPE_BOOL},
+
+    {"PLAN_TUNE_SAMPLES", "8",
+     "Number of timed calls of each candidate plan before the plan is pinned",
+     ucg_offsetof(ucg_config_t, plan_tune_samples), UCG_CONFIG_TYPE_UINT},
+
+    {"PLAN_TUNE_FILE", "",
+     "File of the plan tuning results. The results in it are loaded and pinned\n"
+     "without tuning, and the results of the job are saved to it at the end if\n"
+     "UCG_PLAN_TUNE is enabled",
+     ucg_offsetof(ucg_config_t, plan_tune_file), UCG_CONFIG_TYPE_STRING},
+
     {NULL},
 };
 UCG_CONFIG_REGISTER_TABLE(ucg_context_config_table, "UCG context", NULL,
@@ -156,6 +212,32 @@ err:
     return UCG_ERR_INVALID_PARAM;
 }
 
+static ucg_status_t ucg_context_apply_config(ucg_context_t *context,
+                                             const ucg_config_t *config)
+{
+    context->fusion.window = config->fusion_window;
+    context->fusion.max_size = config->fusion_max_size;
+    if (!config->progress_thread) {
+        return UCG_OK;
+    }
+
+#ifndef UCG_ENABLE_MT
+    ucg_error("UCG is built without multi-thread support, the progress thread is unavailable.");
+    return UCG_ERR_INVALID_PARAM;
+#else
+    if (config->progress_thread_core >= CPU_SETSIZE) {
+        ucg_error("Invalid core %d of the progress thread", config->progress_thread_core);
+        return UCG_ERR_INVALID_PARAM;
+    }
+    /* The application and the progress thread call into UCG concurrently. */
+    context->thread_mode = UCG_THREAD_MODE_MULTI;
+    context->progress_thread.enable = 1;
+    context->progress_thread.core = config->progress_thread_core;
+    context->progress_thread.max_sleep = ucg_max(config->progress_thread_max_sleep, 1);
+    return UCG_OK;
+#endif
+}
+
 static int ucg_context_is_required_planc(ucg_planc_t *planc,
                                          ucg_config_names_array_t required)
 {
@@ -236,6 +318,7 @@ err_free_resource:
 
 static void ucg_context_free_resource_mt(ucg_context_t *context)
 {
+    ucg_lock_destroy(&context->planc_lock);
     ucg_lock_destroy(&context->mt_lock);
     return;
 }
@@ -244,11 +327,14 @@ static ucg_status_t ucg_context_fill_resource_mt(ucg_context_t *context,
                                                  const ucg_config_t *config)
 {
     ucg_lock_type_t lock_type = UCG_LOCK_TYPE_NONE;
+    ucg_lock_type_t planc_lock_type = UCG_LOCK_TYPE_NONE;
+    ucg_status_t status;
     if (context->thread_mode != UCG_THREAD_MODE_MULTI) {
         goto lock_init;
     }
 
-    ucg_status_t status;
+    /* Groups can be created, destroyed and progressed by different threads. */
+    lock_type = config->use_mt_mutex ? UCG_LOCK_TYPE_MUTEX : UCG_LOCK_TYPE_SPINLOCK;
     ucg_planc_context_attr_t attr = {
         .field_mask = UCG_PLANC_CONTEXT_ATTR_FIELD_THREAD_MODE,
     };
@@ -260,14 +346,23 @@ static ucg_status_t ucg_context_fill_resource_mt(ucg_context_t *context,
         attr.thread_mode = UCG_THREAD_MODE_SINGLE;
         status = rsc->planc->context_query(rsc->ctx, &attr);
         if (status != UCG_OK || attr.thread_mode == UCG_THREAD_MODE_SINGLE) {
-            ucg_debug("There's a non-thread-safe planc, using context lock.");
-            lock_type = config->use_mt_mutex ? UCG_LOCK_TYPE_MUTEX : UCG_LOCK_TYPE_SPINLOCK;
+            ucg_debug("There's a non-thread-safe planc, using planc lock.");
+            planc_lock_type = lock_type;
             break;
         }
     }
 
 lock_init:
-    return ucg_lock_init(&context->mt_lock, lock_type);
+    status = ucg_lock_init(&context->mt_lock, lock_type);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    status = ucg_lock_init(&context->planc_lock, planc_lock_type);
+    if (status != UCG_OK) {
+        ucg_lock_destroy(&context->mt_lock);
+    }
+    return status;
 }
 
 static void ucg_context_free_resource(ucg_context_t *context)
@@ -359,6 +454,131 @@ err:
     return NULL;
 }
 
+void ucg_context_progress_plancs(ucg_context_t *context)
+{
+    ucg_context_planc_lock(context);
+    int num_planc_rscs = context->num_planc_rscs;
+    for (int i = 0; i < num_planc_rscs; ++i) {
+        ucg_resource_planc_t *planc_rsc = &context->planc_rscs[i];
+        planc_rsc->planc->context_progress(planc_rsc->ctx);
+    }
+    ucg_context_planc_unlock(context);
+    return;
+}
+
+/* @a idle is set if there's nothing to progress or another thread is doing it. */
+static int ucg_context_progress_inner(ucg_context_t *context, int *idle)
+{
+    int count = 0;
+
+    *idle = 1;
+    /* Another thread is progressing the context, or creating or destroying a
+       group, there's no need to wait for it. */
+    if (!ucg_lock_try_enter(&context->mt_lock)) {
+        return count;
+    }
+
+    ucg_group_t *group = NULL;
+    ucg_list_for_each(group, &context->groups, list) {
+        if (ucg_atomic_load_acquire(&group->num_inflight) != 0) {
+            *idle = 0;
+            break;
+        }
+    }
+    if (*idle) {
+        ucg_context_unlock(context);
+        return count;
+    }
+
+    /* Progress the plancs first, so that the requests woken up by them are
+       progressed in this call. */
+    ucg_context_progress_plancs(context);
+
+    ucg_list_for_each(group, &context->groups, list) {
+        if (ucg_atomic_load_acquire(&group->num_inflight) != 0) {
+            count += ucg_group_progress(group);
+        }
+    }
+    ucg_context_unlock(context);
+
+    return count;
+}
+
+static int ucg_context_progress(ucg_context_h context)
+{
+    int idle;
+    return ucg_context_progress_inner(context, &idle);
+}
+
+/**
+ * The thread polls as fast as it can while there are requests in flight. Once
+ * idle, it yields for a while, then sleeps for doubling periods up to the
+ * configured maximum, and goes back to polling as soon as it finds a request.
+ */
+static void *ucg_context_progress_thread_main(void *arg)
+{
+    ucg_context_t *context = (ucg_context_t*)arg;
+    int core = context->progress_thread.core;
+    if (core >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(core, &cpuset);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (rc != 0) {
+            ucg_warn("Failed to pin the progress thread to core %d, %s", core, strerror(rc));
+        }
+    }
+
+    int idle;
+    uint32_t idle_polls = 0;
+    uint32_t sleep_us = 0;
+    uint32_t max_sleep = context->progress_thread.max_sleep;
+    while (!ucg_atomic_load_acquire(&context->progress_thread.stop)) {
+        ucg_context_progress_inner(context, &idle);
+        if (!idle) {
+            idle_polls = 0;
+            sleep_us = 0;
+            continue;
+        }
+
+        if (idle_polls < UCG_CONTEXT_PROGRESS_THREAD_SPINS) {
+            ++idle_polls;
+            sched_yield();
+            continue;
+        }
+        sleep_us = ucg_min(sleep_us == 0 ? 1 : sleep_us * 2, max_sleep);
+        usleep(sleep_us);
+    }
+    return NULL;
+}
+
+static ucg_status_t ucg_context_start_progress_thread(ucg_context_t *context)
+{
+    if (!context->progress_thread.enable) {
+        return UCG_OK;
+    }
+
+    context->progress_thread.stop = 0;
+    int rc = pthread_create(&context->progress_thread.thread, NULL,
+                            ucg_context_progress_thread_main, context);
+    if (rc != 0) {
+        ucg_error("Failed to create the progress thread, %s", strerror(rc));
+        return UCG_ERR_NO_RESOURCE;
+    }
+    return UCG_OK;
+}
+
+static void ucg_context_stop_progress_thread(ucg_context_t *context)
+{
+    if (!context->progress_thread.enable) {
+        return;
+    }
+
+    ucg_atomic_store_release(&context->progress_thread.stop, 1);
+    pthread_join(context->progress_thread.thread, NULL);
+    return;
+}
+
 static ucg_status_t ucg_context_init_version(uint32_t major_version,
                                              uint32_t minor_version,
                                              const ucg_params_t *params,
@@ -383,14 +603,25 @@ static ucg_status_t ucg_context_init_version(uint32_t major_version,
         goto err_free_ctx;
     }
 
-    status = ucg_context_fill_resource(ctx, config);
+    status = ucg_context_apply_config(ctx, config);
     if (status != UCG_OK) {
         goto err_free_ctx;
     }
 
-    ucg_list_head_init(&ctx->plist);
+    status = ucg_plan_tune_context_init(ctx, config);
+    if (status != UCG_OK) {
+        goto err_free_ctx;
+    }
+
+    status = ucg_context_fill_resource(ctx, config);
+    if (status != UCG_OK) {
+        goto err_cleanup_plan_tune;
+    }
+
+    ucg_list_head_init(&ctx->groups);
 
-    status = ucg_mpool_init(&ctx->meta_op_mp, 0, sizeof(ucg_plan_meta_op_t),
+    /* Requests of different groups may be initialized and discarded concurrently. */
+    status = UCG_MPOOL_INIT(&ctx->meta_op_mp, 0, sizeof(ucg_plan_meta_op_t),
                             0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
                             UINT_MAX, NULL, "meta op mpool");
     if (status != UCG_OK) {
@@ -398,55 +629,46 @@ static ucg_status_t ucg_context_init_version(uint32_t major_version,
         goto err_free_resource;
     }
 
+    status = ucg_rank_map_pool_init(&ctx->rank_map_pool, ctx->mt_lock.type);
+    if (status != UCG_OK) {
+        goto err_cleanup_mpool;
+    }
+
+    status = ucg_context_start_progress_thread(ctx);
+    if (status != UCG_OK) {
+        goto err_cleanup_rank_map_pool;
+    }
+
     ucg_debug("Initialized ucg context %p, oob group size %u, myrank %d, "
-              "thread mode %d", ctx, ctx->oob_group.size,
-              ctx->oob_group.myrank, ctx->thread_mode);
+              "thread mode %d, progress thread %d", ctx, ctx->oob_group.size,
+              ctx->oob_group.myrank, ctx->thread_mode, ctx->progress_thread.enable);
 
     *context = ctx;
     return UCG_OK;
 
+err_cleanup_rank_map_pool:
+    ucg_rank_map_pool_cleanup(ctx->rank_map_pool);
+err_cleanup_mpool:
+    ucg_mpool_cleanup(&ctx->meta_op_mp, 1);
 err_free_resource:
     ucg_context_free_resource(ctx);
+err_cleanup_plan_tune:
+    ucg_plan_tune_context_cleanup(ctx);
 err_free_ctx:
     ucg_free(ctx);
     return status;
 }
 
-static int ucg_context_progress(ucg_context_h context)
-{
-    ucg_context_lock(context);
-    int count = 0;
-
-    if (ucs_list_is_empty(&context->plist)) {
-        ucg_context_unlock(context);
-        return count;
-    }
-
-    ucg_request_t *req = NULL;
-    ucg_request_t *tmp_req = NULL;
-    ucg_list_for_each_safe(req, tmp_req, &context->plist, list) {
-        ucg_status_t status = ucg_request_test(req);
-        if (status != UCG_INPROGRESS) {
-            ++count;
-        }
-    }
-
-    int num_planc_rscs = context->num_planc_rscs;
-    for (int i = 0; i < num_planc_rscs; ++i) {
-        ucg_resource_planc_t *planc_rsc = &context->planc_rscs[i];
-        planc_rsc->planc->context_progress(planc_rsc->ctx);
-    }
-    ucg_context_unlock(context);
-
-    return count;
-}
-
 static void ucg_context_cleanup(ucg_context_h context)
 {
     UCG_CHECK_NULL_VOID(context);
 
+    /* Stop it before releasing anything it touches. */
+    ucg_context_stop_progress_thread(context);
+    ucg_rank_map_pool_cleanup(context->rank_map_pool);
     ucg_mpool_cleanup(&context->meta_op_mp, 1);
     ucg_context_free_resource(context);
+    ucg_plan_tune_context_cleanup(context);
     ucg_free(context);
     return;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_CONTEXT_H_
@@ -14,6 +14,7 @@
 #include "planc/ucg_planc_def.h"
 
 #include "ucg_def.h"
+#include "ucg_rank_map.h"
 
 /** Get address of process */
 #define UCG_PROC_ADDR(_info, _planc_idx) \
@@ -26,6 +27,14 @@ typedef struct ucg_config {
     char *env_prefix;
     ucg_config_names_array_t planc;
     int32_t use_mt_mutex;
+    int32_t progress_thread;
+    int32_t progress_thread_core;
+    uint32_t progress_thread_max_sleep;
+    size_t fusion_window;
+    size_t fusion_max_size;
+    int32_t plan_tune;
+    uint32_t plan_tune_samples;
+    char *plan_tune_file;
     int32_t num_planc_cfg;
     ucg_planc_config_h *planc_cfg;
 } ucg_config_t;
@@ -44,15 +53,40 @@ typedef struct ucg_proc_info_array {
 typedef struct ucg_context {
     int32_t num_planc_rscs;
     ucg_resource_planc_t *planc_rscs;
-    ucg_list_link_t plist; /* progress list */
+    ucg_list_link_t groups; /* list of @ref ucg_group_t, each has its own progress list */
     ucg_oob_group_t oob_group;
     ucg_get_location_cb_t get_location;
     ucg_get_proc_info_cb_t get_proc_info;
     ucg_thread_mode_t thread_mode;
-    /* Ensure thread-safe of all resources in the context. */
+    /* Protect the group list and the creation and destruction of groups. */
     ucg_lock_t mt_lock;
+    /* Serialize the calls into the plancs, none if all plancs are thread-safe. */
+    ucg_lock_t planc_lock;
     /* pool of @ref ucg_plan_meta_op_t */
     ucg_mpool_t meta_op_mp;
+    /* Rank-map arrays shared by the groups of the same members */
+    ucg_rank_map_pool_t *rank_map_pool;
+    /* Asynchronous progress thread, it's just another thread calling
+       ucg_progress(), so it relies on the locks of multi-thread mode. */
+    struct {
+        int enable;
+        int stop;
+        int core; /* -1 for not pinned */
+        uint32_t max_sleep; /* us */
+        pthread_t thread;
+    } progress_thread;
+    /* Fusion of the small allreduces started by ucg_request_startall() */
+    struct {
+        size_t window; /* max bytes of a fused allreduce, 0 to disable */
+        size_t max_size; /* max bytes of an allreduce to be fused */
+    } fusion;
+    /* Online tuning of the plan selection, see ucg_plan_tune.h */
+    struct {
+        int enable;
+        uint32_t samples; /* timed calls of each candidate plan */
+        char *file; /* NULL if the results are neither loaded nor saved */
+        ucg_plan_tune_table_t *table; /* results loaded and of the destroyed groups */
+    } plan_tune;
 } ucg_context_t;
 
 /**
@@ -97,6 +131,13 @@ static inline uint32_t ucg_context_size(ucg_context_t *context)
     return context->oob_group.size;
 }
 
+/**
+ * @brief Progress every planc of the context once.
+ *
+ * @param [in] context      UCG Context.
+ */
+void ucg_context_progress_plancs(ucg_context_t *context);
+
 static inline void ucg_context_lock(ucg_context_t *context)
 {
     return ucg_lock_enter(&context->mt_lock);
@@ -107,4 +148,14 @@ static inline void ucg_context_unlock(ucg_context_t *context)
     return ucg_lock_leave(&context->mt_lock);
 }
 
+static inline void ucg_context_planc_lock(ucg_context_t *context)
+{
+    return ucg_lock_enter(&context->planc_lock);
+}
+
+static inline void ucg_context_planc_unlock(ucg_context_t *context)
+{
+    return ucg_lock_leave(&context->planc_lock);
+}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_DEF_H_
@@ -22,4 +22,10 @@ typedef struct ucg_plan ucg_plan_t;
 
 typedef struct ucg_topo ucg_topo_t;
 
+typedef struct ucg_plan_tune ucg_plan_tune_t;
+
+typedef struct ucg_plan_tune_stat ucg_plan_tune_stat_t;
+
+typedef struct ucg_plan_tune_table ucg_plan_tune_table_t;
+
 #endif
\ No newline at end of file
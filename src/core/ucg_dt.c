@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "ucg_dt.h"
@@ -13,84 +13,20 @@
 #define UCG_DT_PREDEFINED_FLAGS UCG_DT_FLAG_IS_PREDEFINED | UCG_DT_FLAG_IS_CONTIGUOUS
 #define UCG_OP_PREDEFINED_FLAGS UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE | UCG_OP_FLAG_IS_PERSISTENT
 
-#define UCG_OP_FUNC_MAX(_target, _source) (_target) = (_target) > (_source) ? (_target) : (_source)
-#define UCG_OP_FUNC_MIN(_target, _source) (_target) = (_target) < (_source) ? (_target) : (_source)
-#define UCG_OP_FUNC_SUM(_target, _source) (_target) += (_source)
-#define UCG_OP_FUNC_PROD(_target, _source) (_target) *= (_source)
-#define UCG_OP_FUNC(_type, _dt, _func) \
-    static inline ucg_status_t ucg_op_func_##_type##_##_dt(void *op, \
-                                                           const void *source, \
-                                                           void *target, \
-                                                           int32_t count, \
-                                                           void *dt) \
-    { \
-        UCG_UNUSED(op, dt); \
-        _dt *a = (_dt*)source; \
-        _dt *b = (_dt*)target; \
-        for (int i = 0; i < count; ++i) { \
-            _func(*b, *a); \
-            ++a; \
-            ++b; \
-        } \
-        return UCG_OK;\
-    }
-
-#define UCG_OP_FUNC_UNSUPPORTED(_type, _dt) \
-    static inline ucg_status_t ucg_op_func_##_type##_##_dt(void *op, \
-                                                           const void *source, \
-                                                           void *target, \
-                                                           int32_t count, \
-                                                           void *dt) \
-    { \
-        return UCG_ERR_UNSUPPORTED; \
-    }
-
-#ifdef UCG_SUPPORT_FLOAT16
-    #define UCG_OP_FUNC_FP16(_type, _dt, _func) UCG_OP_FUNC(_type, _dt, _func)
-#else
-    #define UCG_OP_FUNC_FP16(_type, _dt, _func) UCG_OP_FUNC_UNSUPPORTED(_type, _dt)
-#endif
-
-#define UCG_OP_PREDEFINED_FUNCS(_type, _TYPE) \
-    UCG_OP_FUNC(_type, int8_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int16_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int32_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int64_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint8_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint16_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint32_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint64_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC_FP16(_type, _Float16, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, float, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, double, UCG_OP_FUNC_##_TYPE)
-
-#define UCG_OP_PREDEFINED_NAME(_type) ucg_op_predefined_##_type
-#define UCG_OP_PREDEFINED(_type, _TYPE) \
-    UCG_OP_PREDEFINED_FUNCS(_type, _TYPE) \
-    static ucg_op_func_t ucg_op_predefined_funcs_##_type[UCG_DT_TYPE_PREDEFINED_LAST] = { \
-        [UCG_DT_TYPE_INT8] = ucg_op_func_##_type##_int8_t, \
-        [UCG_DT_TYPE_INT16] = ucg_op_func_##_type##_int16_t, \
-        [UCG_DT_TYPE_INT32] = ucg_op_func_##_type##_int32_t, \
-        [UCG_DT_TYPE_INT64] = ucg_op_func_##_type##_int64_t, \
-        [UCG_DT_TYPE_UINT8] = ucg_op_func_##_type##_uint8_t, \
-        [UCG_DT_TYPE_UINT16] = ucg_op_func_##_type##_uint16_t, \
-        [UCG_DT_TYPE_UINT32] = ucg_op_func_##_type##_uint32_t, \
-        [UCG_DT_TYPE_UINT64] = ucg_op_func_##_type##_uint64_t, \
-        [UCG_DT_TYPE_FP16] = ucg_op_func_##_type##__Float16, \
-        [UCG_DT_TYPE_FP32] = ucg_op_func_##_type##_float, \
-        [UCG_DT_TYPE_FP64] = ucg_op_func_##_type##_double, \
-    }; \
-    static ucg_status_t UCG_OP_PREDEFINED_NAME(_type)(void *op, \
-                                                      const void *source, \
-                                                      void *target, \
-                                                      int32_t count, \
-                                                      void *dt) \
-    { \
-        ucg_assert(((ucg_op_t*)op)->type == UCG_OP_TYPE_##_TYPE); \
-        ucg_dt_t *ucg_dt = (ucg_dt_t*)dt; \
-        ucg_assert(ucg_dt_is_predefined(ucg_dt)); \
-        return ucg_op_predefined_funcs_##_type[ucg_dt->type](op, source, target, count, dt); \
+/* Predefined ops share it, ucg_op_reduce() calls the kernel directly. */
+static ucg_status_t ucg_op_predefined_reduce(void *op, const void *source,
+                                             void *target, int32_t count,
+                                             void *dt)
+{
+    ucg_dt_t *ucg_dt = (ucg_dt_t*)dt;
+    ucg_assert(ucg_dt_is_predefined(ucg_dt));
+    ucg_op_kernel_t kernel = ucg_op_kernel_get(((ucg_op_t*)op)->type, ucg_dt->type);
+    if (kernel == NULL) {
+        return UCG_ERR_UNSUPPORTED;
     }
+    kernel(source, target, target, count);
+    return UCG_OK;
+}
 
 #define UCG_DT_STATE_INIT(_action, _state, _buffer, _dt, _count) \
     do { \
@@ -166,17 +102,28 @@ static ucg_dt_t ucg_dt_predefined[UCG_DT_TYPE_PREDEFINED_LAST] = {
     {UCG_DT_TYPE_FP16, UCG_DT_PREDEFINED_FLAGS, 2, 2, 0, 2},
     {UCG_DT_TYPE_FP32, UCG_DT_PREDEFINED_FLAGS, 4, 4, 0, 4},
     {UCG_DT_TYPE_FP64, UCG_DT_PREDEFINED_FLAGS, 8, 8, 0, 8},
+    {UCG_DT_TYPE_BF16, UCG_DT_PREDEFINED_FLAGS, 2, 2, 0, 2},
+    /* The padding of value-index pairs is moved as a part of them. */
+    {UCG_DT_TYPE_FP32_INT32, UCG_DT_PREDEFINED_FLAGS, 8, 8, 0, 8},
+    {UCG_DT_TYPE_FP64_INT32, UCG_DT_PREDEFINED_FLAGS, 16, 16, 0, 16},
+    {UCG_DT_TYPE_INT16_INT32, UCG_DT_PREDEFINED_FLAGS, 8, 8, 0, 8},
+    {UCG_DT_TYPE_INT32_INT32, UCG_DT_PREDEFINED_FLAGS, 8, 8, 0, 8},
+    {UCG_DT_TYPE_INT64_INT32, UCG_DT_PREDEFINED_FLAGS, 16, 16, 0, 16},
 };
 
-UCG_OP_PREDEFINED(max, MAX);
-UCG_OP_PREDEFINED(min, MIN);
-UCG_OP_PREDEFINED(sum, SUM);
-UCG_OP_PREDEFINED(prod, PROD);
 static ucg_op_t ucg_op_predefined[UCG_OP_TYPE_PREDEFINED_LAST] = {
-    {UCG_OP_TYPE_MAX, UCG_OP_PREDEFINED_FLAGS, UCG_OP_PREDEFINED_NAME(max)},
-    {UCG_OP_TYPE_MIN, UCG_OP_PREDEFINED_FLAGS, UCG_OP_PREDEFINED_NAME(min)},
-    {UCG_OP_TYPE_SUM, UCG_OP_PREDEFINED_FLAGS, UCG_OP_PREDEFINED_NAME(sum)},
-    {UCG_OP_TYPE_PROD, UCG_OP_PREDEFINED_FLAGS, UCG_OP_PREDEFINED_NAME(prod)},
+    {UCG_OP_TYPE_MAX, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_MIN, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_SUM, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_PROD, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_LAND, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_LOR, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_LXOR, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_BAND, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_BOR, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_BXOR, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_MAXLOC, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
+    {UCG_OP_TYPE_MINLOC, UCG_OP_PREDEFINED_FLAGS, ucg_op_predefined_reduce},
 };
 
 static int ucg_dt_is_predefined_type(ucg_dt_type_t type)
@@ -424,6 +371,11 @@ ucg_dt_t* ucg_dt_get_predefined(ucg_dt_type_t type)
     return &ucg_dt_predefined[type];
 }
 
+ucg_op_t* ucg_op_get_predefined(ucg_op_type_t type)
+{
+    return &ucg_op_predefined[type];
+}
+
 ucg_status_t ucg_dt_memcpy(void *dst, int32_t dcount, ucg_dt_t *dst_dt,
                            const void *src, int32_t scount, ucg_dt_t *src_dt)
 {
@@ -1,11 +1,12 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_DT_H_
 #define UCG_DT_H_
 
 #include "ucg/api/ucg.h"
+#include "ucg_op_kernel.h"
 #include "util/ucg_helper.h"
 
 /* NOTE:  Only support UCG_MEM_TYPE_HOST. */
@@ -127,6 +128,8 @@ static inline void ucg_dt_set_opaque(ucg_dt_t *dt, ucg_dt_opaque_t *opaque)
 
 ucg_dt_t* ucg_dt_get_predefined(ucg_dt_type_t type);
 
+ucg_op_t* ucg_op_get_predefined(ucg_op_type_t type);
+
 /**
  * @brief Copy src to dst
  *
@@ -187,7 +190,13 @@ static inline ucg_status_t ucg_op_reduce(ucg_op_t *op,
     }
 
     if (ucg_op_is_predefined(op)) {
-        return op->func(op, source, target, count, dt);
+        ucg_assert(ucg_dt_is_predefined(dt));
+        ucg_op_kernel_t kernel = ucg_op_kernel_get(op->type, dt->type);
+        if (kernel == NULL) {
+            return UCG_ERR_UNSUPPORTED;
+        }
+        kernel(source, target, target, count);
+        return UCG_OK;
     }
 
     ucg_op_generic_t *gop = ucg_derived_of(op, ucg_op_generic_t);
@@ -196,6 +205,59 @@ static inline ucg_status_t ucg_op_reduce(ucg_op_t *op,
     return op->func(gop->user_op, source, target, count, gdt->user_dt);
 }
 
+/**
+ * @brief Reduce a and b to dst, i.e. dst = a op b.
+ *
+ * It saves the copy of "reduce to a temporary buffer and then copy to dst".
+ * @a dst may be the same buffer as @a a or @a b, but they must not partially
+ * overlap. Predefined ops do it in one pass. Other ops fall back to copy and
+ * reduce, and if @a dst is @a a and the op is not commutative, the content of
+ * @a b is undefined after the call.
+ */
+static inline ucg_status_t ucg_op_reduce3(ucg_op_t *op,
+                                          const void *a,
+                                          void *b,
+                                          void *dst,
+                                          int32_t count,
+                                          ucg_dt_t *dt)
+{
+    if (a == NULL || b == NULL || dst == NULL || count == 0) {
+        return UCG_OK;
+    }
+
+    if (ucg_op_is_predefined(op)) {
+        ucg_assert(ucg_dt_is_predefined(dt));
+        ucg_op_kernel_t kernel = ucg_op_kernel_get(op->type, dt->type);
+        if (kernel == NULL) {
+            return UCG_ERR_UNSUPPORTED;
+        }
+        kernel(a, b, dst, count);
+        return UCG_OK;
+    }
+
+    ucg_status_t status;
+    if (dst == b) {
+        return ucg_op_reduce(op, a, dst, count, dt);
+    }
+
+    if (dst == a) {
+        if (ucg_op_is_commutative(op)) {
+            return ucg_op_reduce(op, b, dst, count, dt);
+        }
+        status = ucg_op_reduce(op, a, b, count, dt);
+        if (status != UCG_OK) {
+            return status;
+        }
+        return ucg_dt_memcpy(dst, count, dt, b, count, dt);
+    }
+
+    status = ucg_dt_memcpy(dst, count, dt, b, count, dt);
+    if (status != UCG_OK) {
+        return status;
+    }
+    return ucg_op_reduce(op, a, dst, count, dt);
+}
+
 static inline void ucg_op_copy(ucg_op_t *dst, ucg_op_t *src)
 {
     if (ucg_op_is_predefined(src)) {
@@ -26,6 +26,12 @@ static ucg_config_field_t ucg_global_config_table[] = {
      ucg_offsetof(ucg_global_config_t, log_level),
      UCG_CONFIG_TYPE_ENUM(ucg_log_level_names)},
 
+    {"REDUCE_KERNEL", "auto",
+     "Instruction set of the predefined reduction kernels, possible values: "
+     "scalar, neon, avx2, avx512, auto",
+     ucg_offsetof(ucg_global_config_t, reduce_kernel),
+     UCG_CONFIG_TYPE_ENUM(ucg_op_kernel_isa_names)},
+
     {NULL},
 };
 UCG_CONFIG_REGISTER_TABLE(ucg_global_config_table, "UCG global", NULL,
@@ -83,6 +89,7 @@ ucg_status_t ucg_global_init(const ucg_global_params_t *params)
         goto out;
     }
     ucg_log_configure(config.log_level, "UCG");
+    ucg_op_kernel_select(config.reduce_kernel);
     ucg_config_parser_release_opts(&config, ucg_global_config_table);
 
 	ucg_config_compatible();
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_GLOBAL_H_
@@ -7,6 +7,8 @@
 
 #include "ucg/api/ucg.h"
 
+#include "ucg_op_kernel.h"
+
 #include "util/ucg_list.h"
 #include "util/ucg_log.h"
 
@@ -14,6 +16,7 @@
 
 typedef struct ucg_global_config {
     ucg_log_level_t log_level;
+    ucg_op_kernel_isa_t reduce_kernel;
 } ucg_global_config_t;
 
 extern ucg_list_link_t ucg_config_global_list;
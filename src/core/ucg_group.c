@@ -6,6 +6,7 @@
 #include "ucg_context.h"
 #include "ucg_rank_map.h"
 #include "ucg_plan.h"
+#include "ucg_plan_tune.h"
 #include "ucg_topo.h"
 
 #include "util/ucg_helper.h"
@@ -21,9 +22,13 @@
     UCG_COPY_OPTIONAL_FIELD(UCG_TOKENPASTE(UCG_GROUP_PARAMS_FIELD_, _field), \
                             _copy, _dst, _src, _default, _err_label)
 
+/* The groups of the same members share the rank-map array. */
+#define UCG_GROUP_COPY_RANK_MAP(_dst, _src) \
+    ucg_rank_map_pool_copy(group->context->rank_map_pool, _dst, _src)
+
 static void ucg_group_free_params(ucg_group_t *group)
 {
-    ucg_rank_map_cleanup(&group->rank_map);
+    ucg_rank_map_pool_release(group->context->rank_map_pool, &group->rank_map);
     return;
 }
 
@@ -41,7 +46,7 @@ static ucg_status_t ucg_group_apply_params(ucg_group_t *group,
     UCG_GROUP_COPY_REQUIRED_FIELD(MYRANK, UCG_COPY_VALUE,
                                   group->myrank, params->myrank,
                                   err);
-    UCG_GROUP_COPY_REQUIRED_FIELD(RANK_MAP, ucg_rank_map_copy,
+    UCG_GROUP_COPY_REQUIRED_FIELD(RANK_MAP, UCG_GROUP_COPY_RANK_MAP,
                                   &group->rank_map, &params->rank_map,
                                   err);
     if (group->size != group->rank_map.size) {
@@ -61,7 +66,7 @@ static ucg_status_t ucg_group_apply_params(ucg_group_t *group,
     return UCG_OK;
 
 err_cleanup_rank_map:
-    ucg_rank_map_cleanup(&group->rank_map);
+    ucg_rank_map_pool_release(group->context->rank_map_pool, &group->rank_map);
 err:
     return UCG_ERR_INVALID_PARAM;
 }
@@ -154,6 +159,7 @@ static ucg_status_t ucg_group_init_topo(ucg_group_t *group)
     params.group = group;
     params.myrank = group->myrank;
     params.rank_map = &group->rank_map;
+    params.rank_map_pool = group->context->rank_map_pool;
     params.get_location = ucg_group_get_location;
     return ucg_topo_init(&params, &group->topo);
 }
@@ -173,12 +179,22 @@ ucg_status_t ucg_group_create(ucg_context_h context, const ucg_group_params_t *p
     }
     grp->context = context;
     grp->unique_req_id = UCG_GROUP_BASE_REQ_ID;
+    ucg_mpsc_queue_init(&grp->pending);
+    ucg_mpsc_queue_init(&grp->ready);
+    ucg_list_head_init(&grp->plist);
+    ucg_list_head_init(&grp->rlist);
 
-    status = ucg_group_apply_params(grp, params);
+    status = ucg_lock_init(&grp->lock, context->mt_lock.type);
     if (status != UCG_OK) {
         goto err_free_grp;
     }
 
+    status = ucg_group_apply_params(grp, params);
+    if (status != UCG_OK) {
+        goto err_destroy_lock;
+    }
+
+    ucg_context_planc_lock(context);
     status = ucg_group_create_planc_group(grp);
     if (status != UCG_OK) {
         goto err_free_params;
@@ -194,14 +210,27 @@ ucg_status_t ucg_group_create(ucg_context_h context, const ucg_group_params_t *p
         goto err_destroy_planc_group;
     }
 
+    status = ucg_plan_tune_group_init(grp);
+    if (status != UCG_OK) {
+        goto err_free_plans;
+    }
+
+    ucg_context_planc_unlock(context);
+    ucg_list_add_tail(&context->groups, &grp->list);
+
     ucg_debug("Group id %d, size %u, myrank %d", grp->id, grp->size, grp->myrank);
     *group = grp;
     goto out;
 
+err_free_plans:
+    ucg_group_free_plans(grp);
 err_destroy_planc_group:
     ucg_group_destroy_planc_group(grp);
 err_free_params:
+    ucg_context_planc_unlock(context);
     ucg_group_free_params(grp);
+err_destroy_lock:
+    ucg_lock_destroy(&grp->lock);
 err_free_grp:
     ucg_free(grp);
 out:
@@ -215,10 +244,17 @@ void ucg_group_destroy(ucg_group_h group)
 
     ucg_context_t *context = group->context;
     ucg_context_lock(context);
+    ucg_list_del(&group->list);
 
+    ucg_context_planc_lock(context);
+    ucg_plan_tune_group_cleanup(group);
     ucg_topo_cleanup(group->topo);
     ucg_group_free_plans(group);
     ucg_group_destroy_planc_group(group);
+    ucg_context_planc_unlock(context);
+
+    ucg_assert(group->num_inflight == 0);
+    ucg_lock_destroy(&group->lock);
     ucg_group_free_params(group);
     ucg_free(group);
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_GROUP_H_
@@ -7,6 +7,10 @@
 
 #include "ucg_context.h"
 #include "ucg_rank_map.h"
+#include "ucg_vgroup.h"
+
+#include "util/ucg_atomic.h"
+#include "util/ucg_mpsc_queue.h"
 
 /**
  * Like ompi/coll, a negative value is used to avoid tag conflicts with
@@ -18,6 +22,7 @@
 typedef struct ucg_group {
     ucg_context_t *context;
     ucg_plans_t *plans;
+    ucg_plan_tune_t *tune; /* NULL if the plans are selected by the policies */
 
     int32_t num_planc_groups;
     ucg_planc_group_h *planc_groups;
@@ -32,6 +37,17 @@ typedef struct ucg_group {
 
     /* collective operation request id */
     int unique_req_id;
+
+    /* The consumer lock of the queues, also protects the lists. */
+    ucg_lock_t lock;
+    /* Started requests, pushed without the lock */
+    ucg_mpsc_queue_t pending;
+    /* Woken requests with UCG_REQUEST_FLAG_WAKEUP, see ucg_request_wakeup() */
+    ucg_mpsc_queue_t ready;
+    ucg_list_link_t plist; /* requests progressed on every call */
+    ucg_list_link_t rlist; /* woken requests taken from the queues */
+    uint32_t num_inflight;
+    ucg_list_link_t list; /* link to group list of the context */
 } ucg_group_t;
 
 /**
@@ -46,6 +62,22 @@ static inline ucg_rank_t ucg_group_get_ctx_rank(ucg_group_t *group, ucg_rank_t r
     return ucg_rank_map_eval(&group->rank_map, rank);
 }
 
+/**
+ * @brief Convert vgroup rank to context rank.
+ *
+ * @param [in] vgroup   Virtual group
+ * @param [in] vrank    Vgroup rank
+ * @return context rank
+ */
+static inline ucg_rank_t ucg_vgroup_get_ctx_rank(ucg_vgroup_t *vgroup, ucg_rank_t vrank)
+{
+    if (ucg_likely(vgroup->ctx_rank_map.size != 0)) {
+        return ucg_rank_map_eval(&vgroup->ctx_rank_map, vrank);
+    }
+    ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
+    return ucg_group_get_ctx_rank(vgroup->group, group_rank);
+}
+
 /**
  * @brief Get process location by group rank.
  *
@@ -62,16 +94,46 @@ static inline ucg_status_t ucg_group_get_location(ucg_group_t *group,
     return ucg_context_get_location(group->context, ctx_rank, location);
 }
 
+static inline void ucg_group_lock(ucg_group_t *group)
+{
+    return ucg_lock_enter(&group->lock);
+}
+
+static inline int ucg_group_try_lock(ucg_group_t *group)
+{
+    return ucg_lock_try_enter(&group->lock);
+}
+
+static inline void ucg_group_unlock(ucg_group_t *group)
+{
+    return ucg_lock_leave(&group->lock);
+}
+
+/**
+ * @brief Progress the requests on the progress list of the group.
+ *
+ * Does nothing if another thread is holding the group lock.
+ *
+ * @param [in] group    UCG Group
+ * @return the number of completed requests.
+ */
+int ucg_group_progress(ucg_group_t *group);
+
 /* In the same communication group, different members must obtain the same request
    ID when executing this function at the same time.*/
 static inline int ucg_group_alloc_req_id(ucg_group_t *ucg_group)
 {
-    int unique_req_id = ++ucg_group->unique_req_id;
-    if (unique_req_id == UCG_GROUP_END_REQ_ID) {
-        unique_req_id = UCG_GROUP_BASE_REQ_ID + 1;
-        ucg_group->unique_req_id = unique_req_id;
-    }
-    return unique_req_id;
+    int unique_req_id;
+    int next_req_id;
+    do {
+        unique_req_id = ucg_group->unique_req_id;
+        next_req_id = unique_req_id + 1;
+        if (next_req_id == UCG_GROUP_END_REQ_ID) {
+            next_req_id = UCG_GROUP_BASE_REQ_ID + 1;
+        }
+    } while (!ucg_atomic_bool_cswap32((uint32_t*)&ucg_group->unique_req_id,
+                                      unique_req_id, next_req_id));
+    return next_req_id;
 }
 
 /* Release the request id returned by ucg_group_alloc_req_id() */
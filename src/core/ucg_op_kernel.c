@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "ucg_op_kernel.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+/* Value-index pairs of MAXLOC and MINLOC */
+#define UCG_OP_KERNEL_PAIR(_value_t, _name) \
+    typedef struct { \
+        _value_t value; \
+        int32_t index; \
+    } ucg_op_kernel_##_name##_t;
+UCG_OP_KERNEL_PAIR(float, fp32_int32)
+UCG_OP_KERNEL_PAIR(double, fp64_int32)
+UCG_OP_KERNEL_PAIR(int16_t, int16_int32)
+UCG_OP_KERNEL_PAIR(int32_t, int32_int32)
+UCG_OP_KERNEL_PAIR(int64_t, int64_int32)
+
+#define UCG_OP_KERNEL_MAX(_target, _source) ((_target) > (_source) ? (_target) : (_source))
+#define UCG_OP_KERNEL_MIN(_target, _source) ((_target) < (_source) ? (_target) : (_source))
+#define UCG_OP_KERNEL_SUM(_target, _source) ((_target) + (_source))
+#define UCG_OP_KERNEL_PROD(_target, _source) ((_target) * (_source))
+#define UCG_OP_KERNEL_LAND(_target, _source) ((_target) && (_source))
+#define UCG_OP_KERNEL_LOR(_target, _source) ((_target) || (_source))
+#define UCG_OP_KERNEL_LXOR(_target, _source) (!(_target) != !(_source))
+#define UCG_OP_KERNEL_BAND(_target, _source) ((_target) & (_source))
+#define UCG_OP_KERNEL_BOR(_target, _source) ((_target) | (_source))
+#define UCG_OP_KERNEL_BXOR(_target, _source) ((_target) ^ (_source))
+/* Whether the pair of target is taken, otherwise the pair of source. */
+#define UCG_OP_KERNEL_MAXLOC(_target, _source) \
+    ((_target).value > (_source).value || \
+     ((_target).value == (_source).value && (_target).index < (_source).index))
+#define UCG_OP_KERNEL_MINLOC(_target, _source) \
+    ((_target).value < (_source).value || \
+     ((_target).value == (_source).value && (_target).index < (_source).index))
+
+/* Vector forms, a comparison of vectors gives a mask of all-ones/all-zeros lanes. */
+#define UCG_OP_KERNEL_VEC_SELECT(_mask_t, _cond, _x, _y) \
+    ((__typeof__(_x))(((_mask_t)(_x) & (_mask_t)(_cond)) | \
+                      ((_mask_t)(_y) & ~(_mask_t)(_cond))))
+#define UCG_OP_KERNEL_VEC_BOOL(_mask_t, _x) ((_mask_t)((_x) != (__typeof__(_x)){0}))
+/* Negating an all-ones lane gives the 1 of logical ops. */
+#define UCG_OP_KERNEL_VEC_LOGICAL(_mask_t, _op, _target, _source) \
+    ((__typeof__(_target))(-(UCG_OP_KERNEL_VEC_BOOL(_mask_t, _target) _op \
+                             UCG_OP_KERNEL_VEC_BOOL(_mask_t, _source))))
+#define UCG_OP_KERNEL_VEC_MAX(_mask_t, _target, _source) \
+    UCG_OP_KERNEL_VEC_SELECT(_mask_t, (_target) > (_source), _target, _source)
+#define UCG_OP_KERNEL_VEC_MIN(_mask_t, _target, _source) \
+    UCG_OP_KERNEL_VEC_SELECT(_mask_t, (_target) < (_source), _target, _source)
+#define UCG_OP_KERNEL_VEC_SUM(_mask_t, _target, _source) ((_target) + (_source))
+#define UCG_OP_KERNEL_VEC_PROD(_mask_t, _target, _source) ((_target) * (_source))
+#define UCG_OP_KERNEL_VEC_LAND(_mask_t, _target, _source) \
+    UCG_OP_KERNEL_VEC_LOGICAL(_mask_t, &, _target, _source)
+#define UCG_OP_KERNEL_VEC_LOR(_mask_t, _target, _source) \
+    UCG_OP_KERNEL_VEC_LOGICAL(_mask_t, |, _target, _source)
+#define UCG_OP_KERNEL_VEC_LXOR(_mask_t, _target, _source) \
+    UCG_OP_KERNEL_VEC_LOGICAL(_mask_t, ^, _target, _source)
+#define UCG_OP_KERNEL_VEC_BAND(_mask_t, _target, _source) ((_target) & (_source))
+#define UCG_OP_KERNEL_VEC_BOR(_mask_t, _target, _source) ((_target) | (_source))
+#define UCG_OP_KERNEL_VEC_BXOR(_mask_t, _target, _source) ((_target) ^ (_source))
+
+#define UCG_OP_KERNEL_NAME(_isa, _type, _dt) ucg_op_kernel_##_isa##_##_type##_##_dt
+
+/* Plain loop, it may be vectorized by the compiler for the baseline target. */
+#define UCG_OP_KERNEL_LOOP(_isa, _attr, _bytes, _type, _TYPE, _dt, _mask) \
+    _attr static void UCG_OP_KERNEL_NAME(_isa, _type, _dt)(const void *a, \
+                                                           const void *b, \
+                                                           void *dst, \
+                                                           int32_t count) \
+    { \
+        const _dt *x = (const _dt*)a; \
+        const _dt *y = (const _dt*)b; \
+        _dt *z = (_dt*)dst; \
+        for (int32_t i = 0; i < count; ++i) { \
+            z[i] = UCG_OP_KERNEL_##_TYPE(y[i], x[i]); \
+        } \
+    }
+
+/**
+ * Explicit vectors of @a _bytes, the remainder is done by the plain loop.
+ * The buffers are not required to be aligned.
+ */
+#define UCG_OP_KERNEL_VEC(_isa, _attr, _bytes, _type, _TYPE, _dt, _mask) \
+    _attr static void UCG_OP_KERNEL_NAME(_isa, _type, _dt)(const void *a, \
+                                                           const void *b, \
+                                                           void *dst, \
+                                                           int32_t count) \
+    { \
+        typedef _dt vec_t __attribute__((vector_size(_bytes), aligned(1), may_alias)); \
+        typedef _mask mask_t __attribute__((vector_size(_bytes), unused)); \
+        const int32_t step = _bytes / sizeof(_dt); \
+        const _dt *x = (const _dt*)a; \
+        const _dt *y = (const _dt*)b; \
+        _dt *z = (_dt*)dst; \
+        int32_t i = 0; \
+        for (; count - i >= step; i += step) { \
+            vec_t vx = *(const vec_t*)(x + i); \
+            vec_t vy = *(const vec_t*)(y + i); \
+            *(vec_t*)(z + i) = UCG_OP_KERNEL_VEC_##_TYPE(mask_t, vy, vx); \
+        } \
+        for (; i < count; ++i) { \
+            z[i] = UCG_OP_KERNEL_##_TYPE(y[i], x[i]); \
+        } \
+    }
+
+/* bfloat16 is the upper half of float. */
+static inline float ucg_op_kernel_bf16_to_float(uint16_t value)
+{
+    union {
+        uint32_t u;
+        float f;
+    } v = {.u = (uint32_t)value << 16};
+    return v.f;
+}
+
+/* Round to nearest even, NaN stays a quiet NaN. */
+static inline uint16_t ucg_op_kernel_float_to_bf16(float value)
+{
+    union {
+        uint32_t u;
+        float f;
+    } v = {.f = value};
+    if (value != value) {
+        return (uint16_t)((v.u >> 16) | 0x40);
+    }
+    return (uint16_t)((v.u + 0x7fff + ((v.u >> 16) & 1)) >> 16);
+}
+
+/* bfloat16 is reduced in float, the result is rounded once. */
+#define UCG_OP_KERNEL_LOOP_BF16(_isa, _attr, _bytes, _type, _TYPE) \
+    _attr static void UCG_OP_KERNEL_NAME(_isa, _type, bf16)(const void *a, \
+                                                            const void *b, \
+                                                            void *dst, \
+                                                            int32_t count) \
+    { \
+        const uint16_t *x = (const uint16_t*)a; \
+        const uint16_t *y = (const uint16_t*)b; \
+        uint16_t *z = (uint16_t*)dst; \
+        for (int32_t i = 0; i < count; ++i) { \
+            float fx = ucg_op_kernel_bf16_to_float(x[i]); \
+            float fy = ucg_op_kernel_bf16_to_float(y[i]); \
+            z[i] = ucg_op_kernel_float_to_bf16(UCG_OP_KERNEL_##_TYPE(fy, fx)); \
+        } \
+    }
+
+/* Widen @a _bytes / 2 of bfloat16 to float vectors, and narrow the result back. */
+#define UCG_OP_KERNEL_VEC_BF16(_isa, _attr, _bytes, _type, _TYPE) \
+    _attr static void UCG_OP_KERNEL_NAME(_isa, _type, bf16)(const void *a, \
+                                                            const void *b, \
+                                                            void *dst, \
+                                                            int32_t count) \
+    { \
+        typedef uint16_t vec_t __attribute__((vector_size(_bytes / 2), aligned(1), may_alias)); \
+        typedef uint32_t uvec_t __attribute__((vector_size(_bytes))); \
+        typedef int32_t mask_t __attribute__((vector_size(_bytes))); \
+        typedef float fvec_t __attribute__((vector_size(_bytes))); \
+        const int32_t step = _bytes / sizeof(float); \
+        const uint16_t *x = (const uint16_t*)a; \
+        const uint16_t *y = (const uint16_t*)b; \
+        uint16_t *z = (uint16_t*)dst; \
+        int32_t i = 0; \
+        for (; count - i >= step; i += step) { \
+            fvec_t fx = (fvec_t)(__builtin_convertvector(*(const vec_t*)(x + i), uvec_t) << 16); \
+            fvec_t fy = (fvec_t)(__builtin_convertvector(*(const vec_t*)(y + i), uvec_t) << 16); \
+            fvec_t fz = UCG_OP_KERNEL_VEC_##_TYPE(mask_t, fy, fx); \
+            uvec_t u = (uvec_t)fz; \
+            mask_t nan = (mask_t)(fz != fz); \
+            mask_t rounded = (mask_t)((u + 0x7fff + ((u >> 16) & 1)) >> 16); \
+            mask_t quiet = (mask_t)((u >> 16) | 0x40); \
+            u = (uvec_t)((quiet & nan) | (rounded & ~nan)); \
+            *(vec_t*)(z + i) = __builtin_convertvector(u, vec_t); \
+        } \
+        for (; i < count; ++i) { \
+            float fx = ucg_op_kernel_bf16_to_float(x[i]); \
+            float fy = ucg_op_kernel_bf16_to_float(y[i]); \
+            z[i] = ucg_op_kernel_float_to_bf16(UCG_OP_KERNEL_##_TYPE(fy, fx)); \
+        } \
+    }
+
+#ifdef UCG_SUPPORT_FLOAT16
+    #define UCG_OP_KERNEL_FP16(...) __VA_ARGS__
+    #define UCG_OP_KERNEL_FP16_NAME(_name) _name
+#else
+    #define UCG_OP_KERNEL_FP16(...)
+    #define UCG_OP_KERNEL_FP16_NAME(_name) NULL
+#endif
+
+#define UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, _type, _TYPE) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, int8_t, int8_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, int16_t, int16_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, int32_t, int32_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, int64_t, int64_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, uint8_t, int8_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, uint16_t, int16_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, uint32_t, int32_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, uint64_t, int64_t)
+
+#define UCG_OP_KERNEL_FLOATS(_gen, _gen_bf16, _isa, _attr, _bytes, _type, _TYPE) \
+    UCG_OP_KERNEL_FP16(_gen(_isa, _attr, _bytes, _type, _TYPE, _Float16, int16_t)) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, float, int32_t) \
+    _gen(_isa, _attr, _bytes, _type, _TYPE, double, int64_t) \
+    _gen_bf16(_isa, _attr, _bytes, _type, _TYPE)
+
+/**
+ * The pairs are not laid out as vectors, the fields are selected separately
+ * without branches so that the compiler can vectorize the loop.
+ */
+#define UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, _dt) \
+    _attr static void UCG_OP_KERNEL_NAME(_isa, _type, _dt)(const void *a, \
+                                                           const void *b, \
+                                                           void *dst, \
+                                                           int32_t count) \
+    { \
+        const _dt *x = (const _dt*)a; \
+        const _dt *y = (const _dt*)b; \
+        _dt *z = (_dt*)dst; \
+        for (int32_t i = 0; i < count; ++i) { \
+            int take = UCG_OP_KERNEL_##_TYPE(y[i], x[i]); \
+            __typeof__(y[i].value) value = take ? y[i].value : x[i].value; \
+            int32_t index = take ? y[i].index : x[i].index; \
+            z[i].value = value; \
+            z[i].index = index; \
+        } \
+    }
+
+#define UCG_OP_KERNEL_PAIRS(_isa, _attr, _type, _TYPE) \
+    UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, ucg_op_kernel_fp32_int32_t) \
+    UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, ucg_op_kernel_fp64_int32_t) \
+    UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, ucg_op_kernel_int16_int32_t) \
+    UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, ucg_op_kernel_int32_int32_t) \
+    UCG_OP_KERNEL_LOOP_PAIR(_isa, _attr, _type, _TYPE, ucg_op_kernel_int64_int32_t)
+
+#define UCG_OP_KERNEL_ARITH(_gen, _gen_bf16, _isa, _attr, _bytes, _type, _TYPE) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, _type, _TYPE) \
+    UCG_OP_KERNEL_FLOATS(_gen, _gen_bf16, _isa, _attr, _bytes, _type, _TYPE)
+
+#define UCG_OP_KERNEL_ROW_INTS(_isa, _type) \
+    [UCG_DT_TYPE_INT8] = UCG_OP_KERNEL_NAME(_isa, _type, int8_t), \
+    [UCG_DT_TYPE_INT16] = UCG_OP_KERNEL_NAME(_isa, _type, int16_t), \
+    [UCG_DT_TYPE_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, int32_t), \
+    [UCG_DT_TYPE_INT64] = UCG_OP_KERNEL_NAME(_isa, _type, int64_t), \
+    [UCG_DT_TYPE_UINT8] = UCG_OP_KERNEL_NAME(_isa, _type, uint8_t), \
+    [UCG_DT_TYPE_UINT16] = UCG_OP_KERNEL_NAME(_isa, _type, uint16_t), \
+    [UCG_DT_TYPE_UINT32] = UCG_OP_KERNEL_NAME(_isa, _type, uint32_t), \
+    [UCG_DT_TYPE_UINT64] = UCG_OP_KERNEL_NAME(_isa, _type, uint64_t),
+
+#define UCG_OP_KERNEL_ROW_FLOATS(_isa, _type) \
+    [UCG_DT_TYPE_FP16] = UCG_OP_KERNEL_FP16_NAME(UCG_OP_KERNEL_NAME(_isa, _type, _Float16)), \
+    [UCG_DT_TYPE_FP32] = UCG_OP_KERNEL_NAME(_isa, _type, float), \
+    [UCG_DT_TYPE_FP64] = UCG_OP_KERNEL_NAME(_isa, _type, double), \
+    [UCG_DT_TYPE_BF16] = UCG_OP_KERNEL_NAME(_isa, _type, bf16),
+
+#define UCG_OP_KERNEL_ROW_PAIRS(_isa, _type) \
+    [UCG_DT_TYPE_FP32_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, ucg_op_kernel_fp32_int32_t), \
+    [UCG_DT_TYPE_FP64_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, ucg_op_kernel_fp64_int32_t), \
+    [UCG_DT_TYPE_INT16_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, ucg_op_kernel_int16_int32_t), \
+    [UCG_DT_TYPE_INT32_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, ucg_op_kernel_int32_int32_t), \
+    [UCG_DT_TYPE_INT64_INT32] = UCG_OP_KERNEL_NAME(_isa, _type, ucg_op_kernel_int64_int32_t),
+
+/**
+ * Define kernels of all predefined ops and the datatypes they accept, and the
+ * table of them. Other combinations are NULL in the table.
+ */
+#define UCG_OP_KERNEL_DEFINE(_gen, _gen_bf16, _isa, _attr, _bytes) \
+    UCG_OP_KERNEL_ARITH(_gen, _gen_bf16, _isa, _attr, _bytes, max, MAX) \
+    UCG_OP_KERNEL_ARITH(_gen, _gen_bf16, _isa, _attr, _bytes, min, MIN) \
+    UCG_OP_KERNEL_ARITH(_gen, _gen_bf16, _isa, _attr, _bytes, sum, SUM) \
+    UCG_OP_KERNEL_ARITH(_gen, _gen_bf16, _isa, _attr, _bytes, prod, PROD) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, land, LAND) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, lor, LOR) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, lxor, LXOR) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, band, BAND) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, bor, BOR) \
+    UCG_OP_KERNEL_INTS(_gen, _isa, _attr, _bytes, bxor, BXOR) \
+    UCG_OP_KERNEL_PAIRS(_isa, _attr, maxloc, MAXLOC) \
+    UCG_OP_KERNEL_PAIRS(_isa, _attr, minloc, MINLOC) \
+    static const ucg_op_kernel_table_t ucg_op_kernel_table_##_isa = { \
+        [UCG_OP_TYPE_MAX] = { \
+            UCG_OP_KERNEL_ROW_INTS(_isa, max) \
+            UCG_OP_KERNEL_ROW_FLOATS(_isa, max) \
+        }, \
+        [UCG_OP_TYPE_MIN] = { \
+            UCG_OP_KERNEL_ROW_INTS(_isa, min) \
+            UCG_OP_KERNEL_ROW_FLOATS(_isa, min) \
+        }, \
+        [UCG_OP_TYPE_SUM] = { \
+            UCG_OP_KERNEL_ROW_INTS(_isa, sum) \
+            UCG_OP_KERNEL_ROW_FLOATS(_isa, sum) \
+        }, \
+        [UCG_OP_TYPE_PROD] = { \
+            UCG_OP_KERNEL_ROW_INTS(_isa, prod) \
+            UCG_OP_KERNEL_ROW_FLOATS(_isa, prod) \
+        }, \
+        [UCG_OP_TYPE_LAND] = {UCG_OP_KERNEL_ROW_INTS(_isa, land)}, \
+        [UCG_OP_TYPE_LOR] = {UCG_OP_KERNEL_ROW_INTS(_isa, lor)}, \
+        [UCG_OP_TYPE_LXOR] = {UCG_OP_KERNEL_ROW_INTS(_isa, lxor)}, \
+        [UCG_OP_TYPE_BAND] = {UCG_OP_KERNEL_ROW_INTS(_isa, band)}, \
+        [UCG_OP_TYPE_BOR] = {UCG_OP_KERNEL_ROW_INTS(_isa, bor)}, \
+        [UCG_OP_TYPE_BXOR] = {UCG_OP_KERNEL_ROW_INTS(_isa, bxor)}, \
+        [UCG_OP_TYPE_MAXLOC] = {UCG_OP_KERNEL_ROW_PAIRS(_isa, maxloc)}, \
+        [UCG_OP_TYPE_MINLOC] = {UCG_OP_KERNEL_ROW_PAIRS(_isa, minloc)}, \
+    };
+
+UCG_OP_KERNEL_DEFINE(UCG_OP_KERNEL_LOOP, UCG_OP_KERNEL_LOOP_BF16, scalar, , 0)
+
+#if defined(__x86_64__)
+UCG_OP_KERNEL_DEFINE(UCG_OP_KERNEL_VEC, UCG_OP_KERNEL_VEC_BF16, avx2,
+                     __attribute__((target("avx2"))), 32)
+UCG_OP_KERNEL_DEFINE(UCG_OP_KERNEL_VEC, UCG_OP_KERNEL_VEC_BF16, avx512,
+                     __attribute__((target("avx512f,avx512bw"))), 64)
+#elif defined(__aarch64__)
+/* Advanced SIMD is mandatory in ARMv8-A, no target attribute is needed. */
+UCG_OP_KERNEL_DEFINE(UCG_OP_KERNEL_VEC, UCG_OP_KERNEL_VEC_BF16, neon, , 16)
+#endif
+
+static const ucg_op_kernel_table_t *ucg_op_kernel_tables[UCG_OP_KERNEL_ISA_AUTO] = {
+    [UCG_OP_KERNEL_ISA_SCALAR] = &ucg_op_kernel_table_scalar,
+#if defined(__x86_64__)
+    [UCG_OP_KERNEL_ISA_AVX2] = &ucg_op_kernel_table_avx2,
+    [UCG_OP_KERNEL_ISA_AVX512] = &ucg_op_kernel_table_avx512,
+#elif defined(__aarch64__)
+    [UCG_OP_KERNEL_ISA_NEON] = &ucg_op_kernel_table_neon,
+#endif
+};
+
+const char *ucg_op_kernel_isa_names[] = {
+    [UCG_OP_KERNEL_ISA_SCALAR] = "scalar",
+    [UCG_OP_KERNEL_ISA_NEON] = "neon",
+    [UCG_OP_KERNEL_ISA_AVX2] = "avx2",
+    [UCG_OP_KERNEL_ISA_AVX512] = "avx512",
+    [UCG_OP_KERNEL_ISA_AUTO] = "auto",
+    [UCG_OP_KERNEL_ISA_LAST] = NULL,
+};
+
+const ucg_op_kernel_table_t *ucg_op_kernels = &ucg_op_kernel_table_scalar;
+
+static int ucg_op_kernel_isa_is_supported(ucg_op_kernel_isa_t isa)
+{
+    switch (isa) {
+        case UCG_OP_KERNEL_ISA_SCALAR:
+            return 1;
+#if defined(__x86_64__)
+        case UCG_OP_KERNEL_ISA_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+        case UCG_OP_KERNEL_ISA_AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#elif defined(__aarch64__)
+        case UCG_OP_KERNEL_ISA_NEON:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+const ucg_op_kernel_table_t* ucg_op_kernel_get_table(ucg_op_kernel_isa_t isa)
+{
+    if (isa >= UCG_OP_KERNEL_ISA_AUTO || !ucg_op_kernel_isa_is_supported(isa)) {
+        return NULL;
+    }
+    return ucg_op_kernel_tables[isa];
+}
+
+ucg_op_kernel_isa_t ucg_op_kernel_select(ucg_op_kernel_isa_t isa)
+{
+    if (isa != UCG_OP_KERNEL_ISA_AUTO && ucg_op_kernel_get_table(isa) == NULL) {
+        ucg_warn("Reduction kernels of %s are not available, use the best one",
+                 ucg_op_kernel_isa_names[isa]);
+        isa = UCG_OP_KERNEL_ISA_AUTO;
+    }
+
+    if (isa == UCG_OP_KERNEL_ISA_AUTO) {
+        /* The later instruction set in the enum is the wider one. */
+        for (isa = UCG_OP_KERNEL_ISA_AUTO - 1; isa > UCG_OP_KERNEL_ISA_SCALAR; --isa) {
+            if (ucg_op_kernel_get_table(isa) != NULL) {
+                break;
+            }
+        }
+    }
+
+    ucg_op_kernels = ucg_op_kernel_get_table(isa);
+    ucg_debug("Use reduction kernels of %s", ucg_op_kernel_isa_names[isa]);
+    return isa;
+}
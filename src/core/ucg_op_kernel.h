@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_OP_KERNEL_H_
+#define UCG_OP_KERNEL_H_
+
+#include "ucg/api/ucg.h"
+
+/* Instruction sets that the reduction kernels can be built for. */
+typedef enum {
+    UCG_OP_KERNEL_ISA_SCALAR,
+    UCG_OP_KERNEL_ISA_NEON,
+    UCG_OP_KERNEL_ISA_AVX2,
+    UCG_OP_KERNEL_ISA_AVX512,
+    /* Select the best one supported by the CPU */
+    UCG_OP_KERNEL_ISA_AUTO,
+    UCG_OP_KERNEL_ISA_LAST,
+} ucg_op_kernel_isa_t;
+
+/**
+ * @brief Reduction kernel of a predefined op and datatype.
+ *
+ * It does dst[i] = a[i] op b[i] for i in [0, count), @a dst may be the same
+ * buffer as @a a or @a b.
+ */
+typedef void (*ucg_op_kernel_t)(const void *a, const void *b, void *dst, int32_t count);
+
+typedef ucg_op_kernel_t ucg_op_kernel_table_t[UCG_OP_TYPE_PREDEFINED_LAST][UCG_DT_TYPE_PREDEFINED_LAST];
+
+/* Names of ucg_op_kernel_isa_t, terminated by NULL */
+extern const char *ucg_op_kernel_isa_names[];
+
+/* Kernels in use, the scalar ones until ucg_op_kernel_select() is called */
+extern const ucg_op_kernel_table_t *ucg_op_kernels;
+
+/**
+ * @brief Get the kernel table of an instruction set.
+ *
+ * @return the table, NULL if the kernels are not built for this architecture
+ *         or the CPU does not support the instruction set.
+ */
+const ucg_op_kernel_table_t* ucg_op_kernel_get_table(ucg_op_kernel_isa_t isa);
+
+/**
+ * @brief Select the kernels used by ucg_op_reduce().
+ *
+ * If @a isa is not available, the best available one is used instead.
+ * @note It should be invoked once before any reduction is in flight.
+ */
+ucg_op_kernel_isa_t ucg_op_kernel_select(ucg_op_kernel_isa_t isa);
+
+/**
+ * @return the kernel of (op, dt), NULL if the datatype is not supported.
+ */
+static inline ucg_op_kernel_t ucg_op_kernel_get(ucg_op_type_t op, ucg_dt_type_t dt)
+{
+    return (*ucg_op_kernels)[op][dt];
+}
+
+#endif
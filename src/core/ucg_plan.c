@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "ucg_plan.h"
@@ -27,6 +27,12 @@ const coll_suffix_map_t coll_suffix_map[] = {
     {UCG_COLL_TYPE_IGATHERV, "igatherv"},
     {UCG_COLL_TYPE_IALLGATHERV, "iallgatherv"},
     {UCG_COLL_TYPE_IREDUCE, "ireduce"},
+    {UCG_COLL_TYPE_IALLTOALLV, "ialltoallv"},
+    {UCG_COLL_TYPE_IREDUCE_SCATTER, "ireduce_scatter"},
+    {UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK, "ireduce_scatter_block"},
+    {UCG_COLL_TYPE_ISCAN, "iscan"},
+    {UCG_COLL_TYPE_IEXSCAN, "iexscan"},
+    {UCG_COLL_TYPE_IALLGATHER, "iallgather"},
 };
 
 static ucg_plan_policy_t invalid_policy = {.id = UCG_PLAN_INVALID_POLICY_ID};
@@ -463,6 +469,48 @@ static void ucg_plan_compact(ucg_plan_t *plan1, const ucg_plan_t *plan2)
     return;
 }
 
+static inline ucg_plan_t* ucg_plan_next(ucg_plan_t *plan, const ucg_list_link_t *head)
+{
+    if (plan->list.next == head) {
+        return NULL;
+    }
+    return ucg_list_next(&plan->list, ucg_plan_t, list);
+}
+
+static void ucg_plans_select_build(ucg_plan_select_t *select, ucg_list_link_t *head)
+{
+    ucg_plan_t *plan = NULL;
+    if (!ucg_list_is_empty(head)) {
+        plan = ucg_list_head(head, ucg_plan_t, list);
+    }
+
+    for (int i = 0; i < UCG_PLAN_SELECT_BUCKETS; ++i) {
+        uint64_t lower = (i == 0) ? 0 : (1ull << (i - 1));
+        while (plan != NULL && plan->attr.range.end <= lower) {
+            plan = ucg_plan_next(plan, head);
+        }
+        select->bucket[i] = plan;
+    }
+    return;
+}
+
+static ucg_plan_t* ucg_plans_select(const ucg_plans_t *plans, ucg_coll_type_t coll_type,
+                                    ucg_mem_type_t mem_type, uint64_t msg_size)
+{
+    const ucg_list_link_t *head = &plans->plans[coll_type][mem_type];
+    const ucg_plan_select_t *select = &plans->select[coll_type][mem_type];
+
+    ucg_plan_t *plan = select->bucket[ucg_plan_select_bucket(msg_size)];
+    while (plan != NULL && msg_size >= plan->attr.range.end) {
+        plan = ucg_plan_next(plan, head);
+    }
+
+    if (plan == NULL || msg_size < plan->attr.range.start) {
+        return NULL;
+    }
+    return plan;
+}
+
 static void ucg_plans_print_one(const ucg_list_link_t *head, FILE *stream)
 {
     ucg_plan_t *plan = NULL;
@@ -660,7 +708,7 @@ ucg_status_t ucg_plans_init(ucg_plans_t **plans)
     ucg_mem_type_t mem_type;
     ucg_plans_t *p = NULL;
 
-    p = ucg_malloc(sizeof(ucg_plans_t), "ucg plans");
+    p = ucg_calloc(1, sizeof(ucg_plans_t), "ucg plans");
     if (p == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
@@ -742,6 +790,7 @@ ucg_status_t ucg_plans_add(ucg_plans_t *plans, const ucg_plan_params_t *params)
     }
 
     ucg_plans_compact_one(head);
+    ucg_plans_select_build(&plans->select[params->coll_type][params->mem_type], head);
     return UCG_OK;
 }
 
@@ -776,6 +825,7 @@ ucg_status_t ucg_plans_merge(ucg_plans_t **dst, const ucg_plans_t *src)
             if (status != UCG_OK) {
                 goto err;
             }
+            ucg_plans_select_build(&new_plans->select[coll_type][mem_type], new_head);
         }
     }
 
@@ -788,45 +838,26 @@ err:
     return status;
 }
 
-static const char *ucg_plan_true_domain(ucg_coll_type_t coll_type, const char *domain)
+/**
+ * The domain of a plan shared by blocking and non-blocking collectives ends
+ * with the blocking name, replace it with the name of the actual collective.
+ */
+static const char *ucg_plan_true_domain(ucg_coll_type_t coll_type, const char *domain,
+                                        char *buf, size_t max)
 {
     const char *last_space = strrchr(domain, ' ');
     if (last_space == NULL) {
-        // If there is no space, return the original domain
         return domain;
     }
 
-    size_t domain_length = last_space - domain + 1;
-    size_t modified_domain_length = domain_length;
-
-    // Look for the suffix string corresponding to coll_type
-    const char *suffix = NULL;
     for (size_t i = 0; i < sizeof(coll_suffix_map) / sizeof(coll_suffix_map[0]); ++i) {
         if (coll_suffix_map[i].coll_type == coll_type) {
-            suffix = coll_suffix_map[i].suffix;
-            modified_domain_length += strlen(suffix);
-            break;
+            snprintf(buf, max, "%.*s%s", (int)(last_space - domain + 1), domain,
+                     coll_suffix_map[i].suffix);
+            return buf;
         }
     }
-
-    char *modified_domain = (char *)malloc(modified_domain_length + 1); // Add 1 for null terminator
-    if (modified_domain == NULL) {
-        return NULL;
-    }
-
-    strncpy(modified_domain, domain, domain_length);
-    modified_domain[domain_length] = '\0';
-
-    // If the suffix string is found, append it to the modified_domain
-    if (suffix != NULL) {
-        strcat(modified_domain, suffix);
-    } else {
-        free(modified_domain);
-        modified_domain = NULL;
-        return domain;
-    }
-
-    return modified_domain;
+    return domain;
 }
 
 static int check_need_reselect(const ucg_coll_args_t *args, uint64_t *msize)
@@ -856,39 +887,23 @@ ucg_status_t ucg_plans_prepare(const ucg_plans_t *plans, const ucg_coll_args_t *
         return status;
     }
     int reselect_flag = 0;
-    int8_t found;
     ucg_plan_t *plan;
-    const ucg_list_link_t *head;
     ucg_plan_t *plan_fb;
 
 reselect:
-    found = 0;
-    plan = NULL;
-    head = &plans->plans[args->type][args->info.mem_type];
-    ucg_list_for_each(plan, head, list) {
-        ucg_plan_range_t *range = &plan->attr.range;
-        if (msg_size < range->start) {
-            break;
-        }
-
-        if (msg_size >= range->start && msg_size < range->end) {
-            found = 1;
-            break;
-        }
-    }
-
-    if (!found) {
+    plan = ucg_plans_select(plans, args->type, args->info.mem_type, msg_size);
+    if (plan == NULL) {
         return UCG_ERR_NOT_FOUND;
     }
 
     status = plan->attr.prepare(plan->attr.vgroup, args, op);
     if (status == UCG_OK) {
-        const char *modified_domain = ucg_plan_true_domain(args->type, plan->attr.domain);
-        if (modified_domain != NULL && modified_domain != plan->attr.domain) {
-            ucg_info("select plan '%s' in '%s'", plan->attr.name, modified_domain);
-            free((void *)modified_domain);
-        } else {
-            ucg_info("select plan '%s' in '%s'", plan->attr.name, plan->attr.domain);
+        /* Selection happens for every request, only build the message when needed. */
+        if (ucg_log_is_enabled(UCS_LOG_LEVEL_INFO)) {
+            char domain[UCG_PLAN_DOMAIN_LEN_MAX];
+            ucg_info("select plan '%s' in '%s'", plan->attr.name,
+                     ucg_plan_true_domain(args->type, plan->attr.domain,
+                                          domain, sizeof(domain)));
         }
         return UCG_OK;
     }
@@ -915,6 +930,29 @@ reselect:
     return UCG_ERR_NOT_FOUND;
 }
 
+int ucg_plans_get_candidates(const ucg_plans_t *plans, const ucg_coll_args_t *args,
+                             uint64_t msg_size, ucg_plan_t **candidates, int max)
+{
+    ucg_plan_t *plan = ucg_plans_select(plans, args->type, args->info.mem_type, msg_size);
+    if (plan == NULL || max <= 0) {
+        return 0;
+    }
+
+    int count = 0;
+    candidates[count++] = plan;
+    ucg_plan_t *plan_fb = NULL;
+    ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+        if (count == max) {
+            break;
+        }
+        /* Same as ucg_plans_prepare(), a plan with the same prepare is not tried. */
+        if (plan_fb->attr.prepare != plan->attr.prepare) {
+            candidates[count++] = plan_fb;
+        }
+    }
+    return count;
+}
+
 ucg_status_t ucg_plan_attr_update(ucg_plan_attr_t *attr, const char *update)
 {
     if (update == NULL || update[0] == '\0') {
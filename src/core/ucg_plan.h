@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_PLAN_H_
@@ -21,6 +21,10 @@
 #define UCG_PLAN_SCORE_MAX (UINT_MAX)
 #define UCG_PLAN_RANGE_MAX (ULONG_MAX)
 #define UCG_PLAN_OPS_MAX 8
+/* Bucket 0 holds message size 0, bucket i holds sizes in [2^(i-1), 2^i). */
+#define UCG_PLAN_SELECT_BUCKETS 65
+/* Enough for "<domain prefix> <coll suffix>" */
+#define UCG_PLAN_DOMAIN_LEN_MAX 128
 
 #define UCG_PLAN_ATTR_DESC \
     "Plan attribute that determines when to use the plan.\n" \
@@ -160,6 +164,8 @@ typedef struct ucg_plan_attr {
     ucg_vgroup_t *vgroup;
     /** Plan score, larger value indicate higher priority. */
     uint32_t score;
+    /** Hint of the peers the plan talks to, defined by the planc, 0 if unknown. */
+    uint32_t peers;
 } ucg_plan_attr_t;
 
 /**
@@ -180,11 +186,30 @@ typedef struct ucg_plan {
     ucg_list_link_t fallback;
 } ucg_plan_t;
 
+/**
+ * @brief Plan selection table
+ *
+ * For each message size bucket, it points to the first first-class plan whose
+ * range ends after the lower bound of the bucket, so selecting a plan usually
+ * takes one comparison instead of walking the whole list. It is rebuilt every
+ * time the plan list changes.
+ */
+typedef struct ucg_plan_select {
+    ucg_plan_t *bucket[UCG_PLAN_SELECT_BUCKETS];
+} ucg_plan_select_t;
+
+/* Index of the selection bucket holding the message size */
+static inline int ucg_plan_select_bucket(uint64_t msg_size)
+{
+    return msg_size == 0 ? 0 : 64 - __builtin_clzll(msg_size);
+}
+
 /**
  * @brief Plan container
  */
 typedef struct ucg_plans {
     ucg_list_link_t plans[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+    ucg_plan_select_t select[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
 } ucg_plans_t;
 
 /**
@@ -263,6 +288,22 @@ ucg_status_t ucg_plans_prepare(const ucg_plans_t *plans,
                                const uint32_t size,
                                ucg_plan_op_t **op);
 
+/**
+ * @brief Get the plans that can perform the collective operation.
+ *
+ * The first one is the plan selected by @ref ucg_plans_prepare, the others are
+ * its fallbacks in descending order of score.
+ *
+ * @param [in]  plans       Plan container.
+ * @param [in]  args        Arguments of collective operation.
+ * @param [in]  msg_size    Message size, @ref ucg_request_msg_size.
+ * @param [out] candidates  Candidate plans.
+ * @param [in]  max         Maximum number of candidates.
+ * @return the number of candidates.
+ */
+int ucg_plans_get_candidates(const ucg_plans_t *plans, const ucg_coll_args_t *args,
+                             uint64_t msg_size, ucg_plan_t **candidates, int max);
+
 /**
  * @brief Update the plan attribute
  *
@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "ucg_plan_tune.h"
+#include "ucg_base.h"
+#include "ucg_context.h"
+#include "ucg_group.h"
+#include "ucg_request.h"
+
+#include "util/ucg_hash.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
+
+#include <errno.h>
+#include <float.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Calls of each candidate before it's timed, the first one connects the peers. */
+#define UCG_PLAN_TUNE_WARMUP 1
+#define UCG_PLAN_TUNE_LINE_MAX 512
+
+/* The plan is identified by its domain and id, which are the same in all jobs. */
+typedef struct ucg_plan_tune_result {
+    int32_t id;
+    char domain[UCG_PLAN_DOMAIN_LEN_MAX];
+} ucg_plan_tune_result_t;
+
+UCG_HASH_MAP_INIT_INT64(plan_tune_result, ucg_plan_tune_result_t)
+
+struct ucg_plan_tune_table {
+    /* key is ucg_plan_tune_result_key() */
+    ucg_hash_t(plan_tune_result) results;
+};
+
+typedef struct ucg_plan_tune_bucket {
+    uint32_t calls;
+    int8_t num_candidates;
+    int8_t winner; /* index of the pinned candidate, -1 while tuning */
+    uint8_t save; /* the winner goes to the results */
+    ucg_plan_t *candidates[UCG_PLAN_TUNE_CANDIDATES_MAX];
+    ucg_plan_tune_stat_t stats[UCG_PLAN_TUNE_CANDIDATES_MAX];
+} ucg_plan_tune_bucket_t;
+
+UCG_HASH_MAP_INIT_INT(plan_tune_bucket, ucg_plan_tune_bucket_t*)
+
+/**
+ * The collectives of a group are initialized by one thread at a time and in the
+ * same order on all the ranks, so the buckets are not locked. Only the timing
+ * is updated by the completion in any thread.
+ */
+struct ucg_plan_tune {
+    /* The allreduce of the agreement uses the plans as they are. */
+    int agreeing;
+    /* key is ucg_plan_tune_bucket_key() */
+    ucg_hash_t(plan_tune_bucket) buckets;
+};
+
+static inline uint32_t ucg_plan_tune_bucket_key(ucg_coll_type_t coll_type,
+                                                ucg_mem_type_t mem_type,
+                                                uint64_t msg_size)
+{
+    return ((uint32_t)coll_type << 16) | ((uint32_t)mem_type << 8) |
+           (uint32_t)ucg_plan_select_bucket(msg_size);
+}
+
+static inline uint64_t ucg_plan_tune_result_key(uint32_t bucket_key, uint32_t group_size)
+{
+    return ((uint64_t)group_size << 32) | bucket_key;
+}
+
+/**
+ * The message size must be the same on all the ranks to agree on a plan. Only
+ * the blocking collectives are tuned, because the completion of a nonblocking
+ * one is seen when the application tests it, which would time the application
+ * instead of the plan. Agreeing on the plan of a nonblocking collective would
+ * also block its initialization.
+ */
+static int ucg_plan_tune_is_supported(ucg_coll_type_t coll_type)
+{
+    return coll_type < UCG_COLL_TYPE_IBCAST &&
+           coll_type != UCG_COLL_TYPE_ALLTOALLV;
+}
+
+static ucg_status_t ucg_plan_tune_table_put(ucg_plan_tune_table_t *table, uint64_t key,
+                                            int32_t id, const char *domain)
+{
+    if (strlen(domain) >= UCG_PLAN_DOMAIN_LEN_MAX) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    int ret;
+    ucg_hiter_t iter = ucg_hash_put(plan_tune_result, &table->results, key, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_plan_tune_result_t *result = &ucg_hash_value(&table->results, iter);
+    result->id = id;
+    strcpy(result->domain, domain);
+    return UCG_OK;
+}
+
+static const ucg_plan_tune_result_t *ucg_plan_tune_table_get(ucg_plan_tune_table_t *table,
+                                                             uint64_t key)
+{
+    ucg_hiter_t iter = ucg_hash_get(plan_tune_result, &table->results, key);
+    if (iter == ucg_hash_end(&table->results)) {
+        return NULL;
+    }
+    return &ucg_hash_value(&table->results, iter);
+}
+
+/* <coll type> <mem type> <group size> <message size> <plan id> <plan domain> */
+static ucg_status_t ucg_plan_tune_parse_line(ucg_plan_tune_table_t *table, char *line)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+    line += strspn(line, " \t");
+    if (line[0] == '\0' || line[0] == '#') {
+        return UCG_OK;
+    }
+
+    char coll_name[32];
+    char mem_name[32];
+    uint32_t group_size;
+    uint64_t msg_size;
+    int32_t id;
+    int offset = 0;
+    if (sscanf(line, "%31s %31s %" SCNu32 " %" SCNu64 " %" SCNd32 " %n",
+               coll_name, mem_name, &group_size, &msg_size, &id, &offset) != 5 ||
+        line[offset] == '\0') {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    int coll_type = 0;
+    while (coll_type < UCG_COLL_TYPE_LAST &&
+           strcmp(ucg_coll_type_string(coll_type), coll_name)) {
+        ++coll_type;
+    }
+    int mem_type = 0;
+    while (mem_type < UCG_MEM_TYPE_LAST &&
+           strcmp(ucg_mem_type_string(mem_type), mem_name)) {
+        ++mem_type;
+    }
+    if (coll_type == UCG_COLL_TYPE_LAST || mem_type == UCG_MEM_TYPE_LAST) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    uint32_t bucket_key = ucg_plan_tune_bucket_key(coll_type, mem_type, msg_size);
+    return ucg_plan_tune_table_put(table, ucg_plan_tune_result_key(bucket_key, group_size),
+                                   id, line + offset);
+}
+
+static ucg_status_t ucg_plan_tune_load(ucg_plan_tune_table_t *table, const char *file)
+{
+    FILE *stream = fopen(file, "r");
+    if (stream == NULL) {
+        if (errno == ENOENT) {
+            /* The first job, the results are saved to it at the end. */
+            ucg_debug("No plan tuning results in %s", file);
+            return UCG_OK;
+        }
+        ucg_error("Failed to open plan tuning results %s, %s", file, strerror(errno));
+        return UCG_ERR_IO_ERROR;
+    }
+
+    char line[UCG_PLAN_TUNE_LINE_MAX];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), stream) != NULL) {
+        ++line_no;
+        if (ucg_plan_tune_parse_line(table, line) != UCG_OK) {
+            ucg_warn("Ignore invalid line %d of plan tuning results %s", line_no, file);
+        }
+    }
+    fclose(stream);
+
+    ucg_debug("Loaded %u plan tuning results from %s",
+              (uint32_t)ucg_hash_size(&table->results), file);
+    return UCG_OK;
+}
+
+static void ucg_plan_tune_save(ucg_plan_tune_table_t *table, const char *file)
+{
+    FILE *stream = fopen(file, "w");
+    if (stream == NULL) {
+        ucg_warn("Failed to save plan tuning results to %s, %s", file, strerror(errno));
+        return;
+    }
+
+    fprintf(stream, "# UCG plan tuning results\n");
+    fprintf(stream, "# <coll type> <mem type> <group size> <message size> <plan id> <plan domain>\n");
+    uint64_t key;
+    ucg_plan_tune_result_t result;
+    ucg_hash_foreach(&table->results, key, result, {
+        int bucket = key & UCG_MASK(8);
+        fprintf(stream, "%s %s %" PRIu32 " %" PRIu64 " %" PRId32 " %s\n",
+                ucg_coll_type_string((key >> 16) & UCG_MASK(8)),
+                ucg_mem_type_string((key >> 8) & UCG_MASK(8)),
+                (uint32_t)(key >> 32),
+                (uint64_t)(bucket == 0 ? 0 : (1ull << (bucket - 1))),
+                result.id, result.domain);
+    });
+    fclose(stream);
+    return;
+}
+
+ucg_status_t ucg_plan_tune_context_init(ucg_context_t *context, const ucg_config_t *config)
+{
+    context->plan_tune.enable = config->plan_tune;
+    context->plan_tune.samples = ucg_max(config->plan_tune_samples, 1);
+    context->plan_tune.file = NULL;
+
+    ucg_plan_tune_table_t *table = ucg_malloc(sizeof(ucg_plan_tune_table_t),
+                                              "ucg plan tune table");
+    if (table == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_hash_init_inplace(plan_tune_result, &table->results);
+
+    ucg_status_t status = UCG_OK;
+    if (config->plan_tune_file[0] == '\0') {
+        goto out;
+    }
+
+    context->plan_tune.file = ucg_strdup(config->plan_tune_file, "ucg plan tune file");
+    if (context->plan_tune.file == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto err_free_table;
+    }
+
+    status = ucg_plan_tune_load(table, context->plan_tune.file);
+    if (status != UCG_OK) {
+        goto err_free_file;
+    }
+out:
+    context->plan_tune.table = table;
+    return UCG_OK;
+
+err_free_file:
+    ucg_free(context->plan_tune.file);
+err_free_table:
+    ucg_hash_cleanup_inplace(plan_tune_result, &table->results);
+    ucg_free(table);
+    return status;
+}
+
+void ucg_plan_tune_context_cleanup(ucg_context_t *context)
+{
+    ucg_plan_tune_table_t *table = context->plan_tune.table;
+    /* Every rank has the same results, which are agreed on. */
+    if (context->plan_tune.enable && context->plan_tune.file != NULL &&
+        ucg_context_myrank(context) == 0 && ucg_hash_size(&table->results) > 0) {
+        ucg_plan_tune_save(table, context->plan_tune.file);
+    }
+
+    ucg_free(context->plan_tune.file);
+    ucg_hash_cleanup_inplace(plan_tune_result, &table->results);
+    ucg_free(table);
+    return;
+}
+
+ucg_status_t ucg_plan_tune_group_init(ucg_group_t *group)
+{
+    ucg_context_t *context = group->context;
+    group->tune = NULL;
+    if (!context->plan_tune.enable &&
+        ucg_hash_size(&context->plan_tune.table->results) == 0) {
+        return UCG_OK;
+    }
+
+    ucg_plan_tune_t *tune = ucg_malloc(sizeof(ucg_plan_tune_t), "ucg plan tune");
+    if (tune == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    tune->agreeing = 0;
+    ucg_hash_init_inplace(plan_tune_bucket, &tune->buckets);
+    group->tune = tune;
+    return UCG_OK;
+}
+
+void ucg_plan_tune_group_cleanup(ucg_group_t *group)
+{
+    ucg_plan_tune_t *tune = group->tune;
+    if (tune == NULL) {
+        return;
+    }
+
+    ucg_plan_tune_table_t *table = group->context->plan_tune.table;
+    uint32_t key;
+    ucg_plan_tune_bucket_t *bucket;
+    ucg_hash_foreach(&tune->buckets, key, bucket, {
+        if (bucket->save) {
+            ucg_plan_attr_t *attr = &bucket->candidates[bucket->winner]->attr;
+            if (ucg_plan_tune_table_put(table, ucg_plan_tune_result_key(key, group->size),
+                                        attr->id, attr->domain) != UCG_OK) {
+                ucg_warn("Failed to keep the tuned plan '%s'", attr->name);
+            }
+        }
+        ucg_free(bucket);
+    });
+    ucg_hash_cleanup_inplace(plan_tune_bucket, &tune->buckets);
+    ucg_free(tune);
+    group->tune = NULL;
+    return;
+}
+
+static ucg_plan_tune_bucket_t *ucg_plan_tune_get_bucket(ucg_plan_tune_t *tune, uint32_t key)
+{
+    ucg_hiter_t iter = ucg_hash_get(plan_tune_bucket, &tune->buckets, key);
+    if (iter == ucg_hash_end(&tune->buckets)) {
+        return NULL;
+    }
+    return ucg_hash_value(&tune->buckets, iter);
+}
+
+static ucg_plan_tune_bucket_t *ucg_plan_tune_add_bucket(ucg_group_t *group, uint32_t key,
+                                                        const ucg_coll_args_t *args,
+                                                        uint64_t msg_size)
+{
+    ucg_context_t *context = group->context;
+    ucg_plan_tune_bucket_t *bucket = ucg_calloc(1, sizeof(ucg_plan_tune_bucket_t),
+                                                "ucg plan tune bucket");
+    if (bucket == NULL) {
+        return NULL;
+    }
+    bucket->winner = -1;
+    bucket->num_candidates = ucg_plans_get_candidates(group->plans, args, msg_size,
+                                                      bucket->candidates,
+                                                      UCG_PLAN_TUNE_CANDIDATES_MAX);
+
+    const ucg_plan_tune_result_t *result;
+    result = ucg_plan_tune_table_get(context->plan_tune.table,
+                                     ucg_plan_tune_result_key(key, group->size));
+    for (int i = 0; result != NULL && i < bucket->num_candidates; ++i) {
+        ucg_plan_attr_t *attr = &bucket->candidates[i]->attr;
+        if (attr->id == result->id && !strcmp(attr->domain, result->domain)) {
+            bucket->winner = i;
+            bucket->save = 1;
+            break;
+        }
+    }
+    /* Nothing to tune, go with the policy. */
+    if (bucket->winner == -1 &&
+        (!context->plan_tune.enable || bucket->num_candidates < 2)) {
+        bucket->winner = 0;
+    }
+
+    int ret;
+    ucg_hiter_t iter = ucg_hash_put(plan_tune_bucket, &group->tune->buckets, key, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        ucg_free(bucket);
+        return NULL;
+    }
+    ucg_hash_value(&group->tune->buckets, iter) = bucket;
+    return bucket;
+}
+
+static ucg_status_t ucg_plan_tune_allreduce_max(ucg_group_t *group, double *values,
+                                                int32_t count)
+{
+    double sendbuf[UCG_PLAN_TUNE_CANDIDATES_MAX];
+    memcpy(sendbuf, values, count * sizeof(double));
+
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    ucg_request_h request;
+    ucg_status_t status;
+    status = ucg_request_allreduce_init(sendbuf, values, count,
+                                        ucg_dt_get_predefined(UCG_DT_TYPE_FP64),
+                                        ucg_op_get_predefined(UCG_OP_TYPE_MAX),
+                                        group, &info, UCG_REQUEST_BLOCKING, &request);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    status = ucg_request_start(request);
+    if (status == UCG_OK) {
+        do {
+            status = ucg_request_test(request);
+        } while (status == UCG_INPROGRESS);
+    }
+    ucg_request_cleanup(request);
+    return status;
+}
+
+/**
+ * Every candidate is prepared once before the first turn, and the ones failed
+ * on any rank are dropped by all. Otherwise a rank failing a candidate in its
+ * turn would run another plan than the others.
+ */
+static void ucg_plan_tune_probe(ucg_group_t *group, ucg_plan_tune_bucket_t *bucket,
+                                const ucg_coll_args_t *args)
+{
+    ucg_plan_tune_t *tune = group->tune;
+    int8_t num_candidates = bucket->num_candidates;
+    double failed[UCG_PLAN_TUNE_CANDIDATES_MAX];
+
+    ucg_context_planc_lock(group->context);
+    for (int i = 0; i < num_candidates; ++i) {
+        ucg_plan_t *plan = bucket->candidates[i];
+        ucg_plan_op_t *op;
+        failed[i] = 1;
+        if (plan->attr.prepare(plan->attr.vgroup, args, &op) == UCG_OK) {
+            op->discard(op);
+            failed[i] = 0;
+        }
+    }
+    ucg_context_planc_unlock(group->context);
+
+    tune->agreeing = 1;
+    ucg_status_t status = ucg_plan_tune_allreduce_max(group, failed, num_candidates);
+    tune->agreeing = 0;
+    if (status != UCG_OK) {
+        ucg_warn("Failed to agree on the candidates of %s, %s",
+                 ucg_coll_type_string(args->type), ucg_status_string(status));
+        bucket->winner = 0;
+        return;
+    }
+
+    int8_t count = 0;
+    for (int i = 0; i < num_candidates; ++i) {
+        if (failed[i] == 0) {
+            bucket->candidates[count++] = bucket->candidates[i];
+        }
+    }
+    bucket->num_candidates = count;
+    if (count < 2) {
+        bucket->winner = 0;
+    }
+    return;
+}
+
+void ucg_plan_tune_agree(ucg_group_t *group, const ucg_coll_args_t *args)
+{
+    ucg_plan_tune_t *tune = group->tune;
+    uint64_t msg_size;
+    if (tune->agreeing || !ucg_plan_tune_is_supported(args->type) ||
+        ucg_request_msg_size(args, group->size, &msg_size) != UCG_OK) {
+        return;
+    }
+
+    uint32_t key = ucg_plan_tune_bucket_key(args->type, args->info.mem_type, msg_size);
+    ucg_plan_tune_bucket_t *bucket = ucg_plan_tune_get_bucket(tune, key);
+    if (bucket == NULL) {
+        bucket = ucg_plan_tune_add_bucket(group, key, args, msg_size);
+        if (bucket != NULL && bucket->winner == -1) {
+            ucg_plan_tune_probe(group, bucket, args);
+        }
+        return;
+    }
+    if (bucket->winner != -1) {
+        return;
+    }
+    int8_t num_candidates = bucket->num_candidates;
+    uint32_t samples = group->context->plan_tune.samples;
+    if (bucket->calls < (UCG_PLAN_TUNE_WARMUP + samples) * num_candidates) {
+        return;
+    }
+
+    /* The requests still in flight are left out. */
+    double time[UCG_PLAN_TUNE_CANDIDATES_MAX];
+    for (int i = 0; i < num_candidates; ++i) {
+        uint64_t count = ucg_atomic_load_acquire(&bucket->stats[i].count);
+        if (count == 0) {
+            time[i] = DBL_MAX;
+        } else {
+            time[i] = (double)ucg_atomic_load_acquire(&bucket->stats[i].time) / count;
+        }
+    }
+
+    tune->agreeing = 1;
+    ucg_status_t status = ucg_plan_tune_allreduce_max(group, time, num_candidates);
+    tune->agreeing = 0;
+    if (status != UCG_OK) {
+        ucg_warn("Failed to agree on the plan of %s, %s",
+                 ucg_coll_type_string(args->type), ucg_status_string(status));
+        bucket->winner = 0;
+        return;
+    }
+
+    int8_t winner = 0;
+    for (int i = 1; i < num_candidates; ++i) {
+        if (time[i] < time[winner]) {
+            winner = i;
+        }
+    }
+    bucket->winner = winner;
+    bucket->save = time[winner] != DBL_MAX;
+    ucg_info("Tuned plan '%s' of group %u for %s of %" PRIu64 " bytes, %.2f us",
+             bucket->candidates[winner]->attr.name, group->id,
+             ucg_coll_type_string(args->type), msg_size, time[winner] / 1000);
+    return;
+}
+
+ucg_status_t ucg_plan_tune_prepare(ucg_group_t *group, const ucg_coll_args_t *args,
+                                   ucg_plan_op_t **op)
+{
+    ucg_plan_tune_t *tune = group->tune;
+    uint64_t msg_size;
+    if (tune->agreeing || !ucg_plan_tune_is_supported(args->type) ||
+        ucg_request_msg_size(args, group->size, &msg_size) != UCG_OK) {
+        goto out_prepare;
+    }
+
+    uint32_t key = ucg_plan_tune_bucket_key(args->type, args->info.mem_type, msg_size);
+    ucg_plan_tune_bucket_t *bucket = ucg_plan_tune_get_bucket(tune, key);
+    if (bucket == NULL) {
+        /* Added by ucg_plan_tune_agree() unless it's out of memory. */
+        return UCG_ERR_NO_MEMORY;
+    }
+    if (bucket->num_candidates == 0) {
+        goto out_prepare;
+    }
+
+    /**
+     * The candidates take turns, which is the same on all the ranks. A plan
+     * failed to prepare here fails the collective instead of falling back to
+     * another plan, which the other ranks would not run.
+     */
+    ucg_plan_tune_stat_t *stat = NULL;
+    int idx = bucket->winner;
+    if (idx == -1) {
+        idx = bucket->calls % bucket->num_candidates;
+        if (bucket->calls / bucket->num_candidates >= UCG_PLAN_TUNE_WARMUP) {
+            stat = &bucket->stats[idx];
+        }
+        ++bucket->calls;
+    }
+    ucg_plan_t *plan = bucket->candidates[idx];
+    ucg_status_t status = plan->attr.prepare(plan->attr.vgroup, args, op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to prepare the plan '%s' of %s, %s", plan->attr.name,
+                  ucg_coll_type_string(args->type), ucg_status_string(status));
+        return status;
+    }
+    (*op)->super.tune_stat = stat;
+    return UCG_OK;
+
+out_prepare:
+    return ucg_plans_prepare(group->plans, args, group->size, op);
+}
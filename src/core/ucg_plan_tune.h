@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLAN_TUNE_H_
+#define UCG_PLAN_TUNE_H_
+
+#include "ucg_def.h"
+#include "ucg_plan.h"
+
+#include "util/ucg_atomic.h"
+
+/**
+ * Online tuning of the plan selection
+ *
+ * The static policies of the plancs choose a plan by the message size and a
+ * coarse description of the topology, which may not fit the fabric. With
+ * tuning enabled, each (collective type, memory type, message size bucket) of
+ * a group is tuned on its own. The candidates are the plan selected by the
+ * policy and its fallbacks. Each of them is prepared once at the first call, and
+ * the ones failed on any rank are dropped by an allreduce. The others take turns
+ * in the calls. After one warm-up call, every candidate is timed from start to
+ * completion for the configured number of calls. Then the ranks agree on the
+ * candidate with the lowest average time of the slowest rank by an allreduce,
+ * so they all pin the same plan. Only the blocking collectives are tuned, whose
+ * completion is seen right away by the caller.
+ *
+ * The results are keyed by the group size as well and gathered by the context
+ * when the groups are destroyed. They can be saved to a file, which is loaded
+ * by the next job to pin the plans without tuning again.
+ */
+
+/* Maximum number of candidate plans of a bucket */
+#define UCG_PLAN_TUNE_CANDIDATES_MAX 8
+
+/* Timing of a candidate plan, updated by the completion of its requests */
+typedef struct ucg_plan_tune_stat {
+    uint64_t time; /* ns */
+    uint64_t count;
+} ucg_plan_tune_stat_t;
+
+/**
+ * @brief Initialize the tuning of the context.
+ *
+ * The results in the configured file are loaded, a missing file is fine.
+ */
+ucg_status_t ucg_plan_tune_context_init(ucg_context_t *context, const ucg_config_t *config);
+
+/**
+ * @brief Cleanup the tuning of the context, the results are saved by rank 0.
+ */
+void ucg_plan_tune_context_cleanup(ucg_context_t *context);
+
+/**
+ * @brief Initialize the tuning of the group.
+ *
+ * Nothing is done unless tuning is enabled or there are results loaded for
+ * groups of the same size, then group->tune is left NULL.
+ */
+ucg_status_t ucg_plan_tune_group_init(ucg_group_t *group);
+
+/**
+ * @brief Cleanup the tuning of the group, the results go to the context.
+ */
+void ucg_plan_tune_group_cleanup(ucg_group_t *group);
+
+/**
+ * @brief Agree on the candidates of a new bucket, or on the plan if the bucket
+ * of the collective has been tuned.
+ *
+ * It runs a blocking allreduce of the group, so it must be called without any
+ * lock held, and by all the ranks in the same order as the collectives.
+ */
+void ucg_plan_tune_agree(ucg_group_t *group, const ucg_coll_args_t *args);
+
+/**
+ * @brief Prepare the operation by the tuned plan or the candidate in turn.
+ *
+ * It's called instead of @ref ucg_plans_prepare with the planc lock held. The
+ * plan failed to prepare is not replaced by another one, which would differ
+ * from the plan of the other ranks, so the error is returned.
+ */
+ucg_status_t ucg_plan_tune_prepare(ucg_group_t *group, const ucg_coll_args_t *args,
+                                   ucg_plan_op_t **op);
+
+/* Add the time of a completed request of a candidate */
+static inline void ucg_plan_tune_stat_add(ucg_plan_tune_stat_t *stat, uint64_t time)
+{
+    ucg_atomic_add64(&stat->time, time);
+    ucg_atomic_add64(&stat->count, 1);
+    return;
+}
+
+#endif
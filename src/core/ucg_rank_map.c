@@ -1,13 +1,46 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "ucg_rank_map.h"
 
 #include "util/ucg_malloc.h"
 #include "util/ucg_helper.h"
+#include "util/ucg_hash.h"
 #include "util/ucg_log.h"
 
+/* Shared array, the arrays of the same hash are chained. */
+typedef struct ucg_rank_map_pool_elem {
+    struct ucg_rank_map_pool_elem *next;
+    uint32_t refcount;
+    uint32_t size;
+    ucg_rank_t *array;
+} ucg_rank_map_pool_elem_t;
+
+UCG_HASH_MAP_INIT_INT64(rank_map_pool, ucg_rank_map_pool_elem_t*)
+
+/* Shared object, the objects of the same key are chained. */
+typedef struct ucg_rank_map_pool_obj {
+    struct ucg_rank_map_pool_obj *next;
+    uint32_t refcount;
+    const ucg_rank_map_pool_obj_ops_t *ops;
+    /* Copy from the pool, to compare with the rank-maps to look up. */
+    ucg_rank_map_t map;
+    void *obj;
+} ucg_rank_map_pool_obj_t;
+
+UCG_HASH_MAP_INIT_INT64(rank_map_pool_obj, ucg_rank_map_pool_obj_t*)
+
+struct ucg_rank_map_pool {
+    ucg_lock_t lock;
+    /* key is ucg_rank_map_pool_hash() */
+    ucg_hash_t(rank_map_pool) elems;
+    /* key is ucg_rank_map_pool_obj_key() */
+    ucg_hash_t(rank_map_pool_obj) objs;
+    /* Bytes of the arrays in elems */
+    size_t bytes;
+};
+
 ucg_status_t ucg_rank_map_init_by_array(ucg_rank_map_t *map, ucg_rank_t **ranks,
                                         uint32_t size, int take_over)
 {
@@ -45,11 +78,82 @@ ucg_status_t ucg_rank_map_init_by_array(ucg_rank_map_t *map, ucg_rank_t **ranks,
     return UCG_OK;
 }
 
+/* Runs-type costs 2 ranks per run and a binary search, so it's used only when
+   the runs are long enough. */
+#define UCG_RANK_MAP_RUNS_MIN_RATIO 4
+
+/* dst_rank = start + (src_rank / block) * block_stride + (src_rank % block) * stride */
+static int ucg_rank_map_optimize_block_stride(ucg_rank_map_t *map)
+{
+    const ucg_rank_t *ranks = map->array;
+    uint32_t size = map->size;
+    int32_t stride = ranks[1] - ranks[0];
+    uint32_t block = 2;
+    while (block < size && ranks[block] - ranks[block - 1] == stride) {
+        ++block;
+    }
+    /* All the same stride has been checked. */
+    ucg_assert(block < size);
+
+    int32_t block_stride = ranks[block] - ranks[0];
+    for (uint32_t i = block; i < size; ++i) {
+        if (ranks[i] != ranks[0] + (ucg_rank_t)(i / block) * block_stride +
+                       (ucg_rank_t)(i % block) * stride) {
+            return 0;
+        }
+    }
+
+    map->type = UCG_RANK_MAP_TYPE_BLOCK_STRIDE;
+    map->blocked.start = ranks[0];
+    map->blocked.stride = stride;
+    map->blocked.block = block;
+    map->blocked.block_stride = block_stride;
+    return 1;
+}
+
+static int ucg_rank_map_optimize_runs(ucg_rank_map_t *map)
+{
+    const ucg_rank_t *ranks = map->array;
+    uint32_t size = map->size;
+    uint32_t num_runs = 1;
+    for (uint32_t i = 1; i < size; ++i) {
+        if (ranks[i] != ranks[i - 1] + 1) {
+            ++num_runs;
+        }
+    }
+    if (num_runs * UCG_RANK_MAP_RUNS_MIN_RATIO > size) {
+        return 0;
+    }
+
+    ucg_rank_map_run_t *runs = ucg_malloc(num_runs * sizeof(ucg_rank_map_run_t),
+                                          "ucg rank-map runs");
+    if (runs == NULL) {
+        /* It's still a valid array-type. */
+        return 0;
+    }
+    runs[0].src_rank = 0;
+    runs[0].dst_rank = ranks[0];
+    uint32_t n = 1;
+    for (uint32_t i = 1; i < size; ++i) {
+        if (ranks[i] != ranks[i - 1] + 1) {
+            runs[n].src_rank = i;
+            runs[n].dst_rank = ranks[i];
+            ++n;
+        }
+    }
+
+    map->type = UCG_RANK_MAP_TYPE_RUNS;
+    map->runs.runs = runs;
+    map->runs.num_runs = num_runs;
+    return 1;
+}
+
 void ucg_rank_map_optimize(ucg_rank_map_t *map, ucg_rank_t **array)
 {
     UCG_CHECK_NULL_VOID(map, array);
 
-    if (map->type == UCG_RANK_MAP_TYPE_FULL || map->type == UCG_RANK_MAP_TYPE_CB) {
+    if (map->type == UCG_RANK_MAP_TYPE_FULL || map->type == UCG_RANK_MAP_TYPE_CB ||
+        map->type == UCG_RANK_MAP_TYPE_BLOCK_STRIDE || map->type == UCG_RANK_MAP_TYPE_RUNS) {
         return;
     }
 
@@ -76,6 +180,9 @@ void ucg_rank_map_optimize(ucg_rank_map_t *map, ucg_rank_t **array)
     }
 
     if (!is_same_stride) {
+        if (ucg_rank_map_optimize_block_stride(map) || ucg_rank_map_optimize_runs(map)) {
+            *array = original_array;
+        }
         return;
     }
 
@@ -97,6 +204,16 @@ ucg_status_t ucg_rank_map_copy(ucg_rank_map_t *dst, const ucg_rank_map_t *src)
     // shallow copy
     ucg_rank_t *ranks = NULL;
     memcpy(dst, src, sizeof(ucg_rank_map_t));
+    if (dst->type == UCG_RANK_MAP_TYPE_RUNS) {
+        // deep copy runs
+        size_t length = src->runs.num_runs * sizeof(ucg_rank_map_run_t);
+        dst->runs.runs = ucg_malloc(length, "ucg rank-map runs");
+        if (dst->runs.runs == NULL) {
+            return UCG_ERR_NO_MEMORY;
+        }
+        memcpy(dst->runs.runs, src->runs.runs, length);
+        return UCG_OK;
+    }
     if (dst->type != UCG_RANK_MAP_TYPE_ARRAY) {
         ucg_rank_map_optimize(dst, &ranks);
         return UCG_OK;
@@ -113,35 +230,442 @@ void ucg_rank_map_cleanup(ucg_rank_map_t *map)
     if (map->type == UCG_RANK_MAP_TYPE_ARRAY) {
         ucg_free(map->array);
         map->array = NULL;
+    } else if (map->type == UCG_RANK_MAP_TYPE_RUNS) {
+        ucg_free(map->runs.runs);
+        map->runs.runs = NULL;
+    }
+
+    map->size = 0;
+    return;
+}
+
+/* FNV-1a over the ranks */
+static uint64_t ucg_rank_map_pool_hash(const ucg_rank_t *ranks, uint32_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t i = 0; i < size; ++i) {
+        hash ^= (uint32_t)ranks[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+ucg_status_t ucg_rank_map_pool_init(ucg_rank_map_pool_t **pool, ucg_lock_type_t lock_type)
+{
+    UCG_CHECK_NULL_INVALID(pool);
+
+    ucg_rank_map_pool_t *new_pool = ucg_malloc(sizeof(ucg_rank_map_pool_t), "ucg rank-map pool");
+    if (new_pool == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_status_t status = ucg_lock_init(&new_pool->lock, lock_type);
+    if (status != UCG_OK) {
+        ucg_free(new_pool);
+        return status;
+    }
+    ucg_hash_init_inplace(rank_map_pool, &new_pool->elems);
+    ucg_hash_init_inplace(rank_map_pool_obj, &new_pool->objs);
+    new_pool->bytes = 0;
+    *pool = new_pool;
+    return UCG_OK;
+}
+
+static void ucg_rank_map_pool_free_chain(ucg_rank_map_pool_elem_t *elem)
+{
+    while (elem != NULL) {
+        ucg_rank_map_pool_elem_t *next = elem->next;
+        ucg_debug("Rank-map array %p is not released, refcount %u", elem->array,
+                  elem->refcount);
+        ucg_free(elem->array);
+        ucg_free(elem);
+        elem = next;
+    }
+    return;
+}
+
+static void ucg_rank_map_pool_free_obj_chain(ucg_rank_map_pool_obj_t *elem)
+{
+    while (elem != NULL) {
+        ucg_rank_map_pool_obj_t *next = elem->next;
+        ucg_debug("Rank-map object %p is not put, refcount %u", elem->obj,
+                  elem->refcount);
+        elem->ops->cleanup(elem->obj);
+        /* The shared arrays are freed with the array chains. */
+        if (elem->map.type != UCG_RANK_MAP_TYPE_ARRAY) {
+            ucg_rank_map_cleanup(&elem->map);
+        }
+        ucg_free(elem);
+        elem = next;
+    }
+    return;
+}
+
+void ucg_rank_map_pool_cleanup(ucg_rank_map_pool_t *pool)
+{
+    UCG_CHECK_NULL_VOID(pool);
+
+    /* The groups not destroyed before the context */
+    ucg_rank_map_pool_obj_t *obj_head;
+    ucg_hash_foreach_value(&pool->objs, obj_head, {
+        ucg_rank_map_pool_free_obj_chain(obj_head);
+    });
+    ucg_hash_cleanup_inplace(rank_map_pool_obj, &pool->objs);
+
+    ucg_rank_map_pool_elem_t *head;
+    ucg_hash_foreach_value(&pool->elems, head, {
+        ucg_rank_map_pool_free_chain(head);
+    });
+    ucg_hash_cleanup_inplace(rank_map_pool, &pool->elems);
+    ucg_lock_destroy(&pool->lock);
+    ucg_free(pool);
+    return;
+}
+
+ucg_status_t ucg_rank_map_pool_init_by_array(ucg_rank_map_pool_t *pool,
+                                             ucg_rank_map_t *map, ucg_rank_t **ranks,
+                                             uint32_t size, int take_over)
+{
+    if (pool == NULL) {
+        return ucg_rank_map_init_by_array(map, ranks, size, take_over);
+    }
+    UCG_CHECK_NULL_INVALID(map, ranks, *ranks);
+
+    map->type = UCG_RANK_MAP_TYPE_ARRAY;
+    map->size = size;
+    map->array = *ranks;
+
+    ucg_rank_t *array = NULL;
+    ucg_rank_map_optimize(map, &array);
+    if (array != NULL) {
+        /* optimize successfully, nothing to share. */
+        if (take_over) {
+            ucg_free(array);
+            *ranks = NULL;
+        }
+        return UCG_OK;
+    }
+
+    ucg_status_t status = UCG_OK;
+    uint64_t key = ucg_rank_map_pool_hash(*ranks, size);
+    ucg_lock_enter(&pool->lock);
+    ucg_rank_map_pool_elem_t *head = NULL;
+    ucg_hiter_t iter = ucg_hash_get(rank_map_pool, &pool->elems, key);
+    if (iter != ucg_hash_end(&pool->elems)) {
+        head = ucg_hash_value(&pool->elems, iter);
+    }
+    for (ucg_rank_map_pool_elem_t *elem = head; elem != NULL; elem = elem->next) {
+        if (elem->size == size &&
+            !memcmp(elem->array, *ranks, size * sizeof(ucg_rank_t))) {
+            ++elem->refcount;
+            map->array = elem->array;
+            if (take_over) {
+                ucg_free(*ranks);
+                *ranks = NULL;
+            }
+            goto out;
+        }
+    }
+
+    ucg_rank_map_pool_elem_t *elem = ucg_malloc(sizeof(ucg_rank_map_pool_elem_t),
+                                                "ucg rank-map pool elem");
+    if (elem == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto out;
+    }
+    if (take_over) {
+        elem->array = *ranks;
+    } else {
+        elem->array = ucg_malloc(size * sizeof(ucg_rank_t), "ucg rank-map array");
+        if (elem->array == NULL) {
+            status = UCG_ERR_NO_MEMORY;
+            goto err_free_elem;
+        }
+        memcpy(elem->array, *ranks, size * sizeof(ucg_rank_t));
+    }
+
+    int ret;
+    iter = ucg_hash_put(rank_map_pool, &pool->elems, key, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        status = UCG_ERR_NO_MEMORY;
+        goto err_free_array;
+    }
+    elem->next = head;
+    elem->refcount = 1;
+    elem->size = size;
+    ucg_hash_value(&pool->elems, iter) = elem;
+    pool->bytes += size * sizeof(ucg_rank_t);
+    map->array = elem->array;
+    if (take_over) {
+        *ranks = NULL;
+    }
+    goto out;
+
+err_free_array:
+    if (!take_over) {
+        ucg_free(elem->array);
+    }
+err_free_elem:
+    ucg_free(elem);
+out:
+    ucg_lock_leave(&pool->lock);
+    return status;
+}
+
+ucg_status_t ucg_rank_map_pool_copy(ucg_rank_map_pool_t *pool, ucg_rank_map_t *dst,
+                                    const ucg_rank_map_t *src)
+{
+    UCG_CHECK_NULL_INVALID(dst, src);
+
+    if (src->type != UCG_RANK_MAP_TYPE_ARRAY) {
+        return ucg_rank_map_copy(dst, src);
+    }
+    ucg_rank_t *ranks = src->array;
+    return ucg_rank_map_pool_init_by_array(pool, dst, &ranks, src->size, 0);
+}
+
+ucg_status_t ucg_rank_map_pool_compose(ucg_rank_map_pool_t *pool, ucg_rank_map_t *dst,
+                                       const ucg_rank_map_t *map,
+                                       const ucg_rank_map_t *then)
+{
+    UCG_CHECK_NULL_INVALID(dst, map, then);
+
+    if (then->type == UCG_RANK_MAP_TYPE_FULL) {
+        return ucg_rank_map_pool_copy(pool, dst, map);
+    }
+    if (map->type == UCG_RANK_MAP_TYPE_FULL && map->size == then->size) {
+        return ucg_rank_map_pool_copy(pool, dst, then);
+    }
+    if (map->type == UCG_RANK_MAP_TYPE_CB || then->type == UCG_RANK_MAP_TYPE_CB) {
+        /* The callback may be used to avoid the array of a large group. */
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    uint32_t size = map->size;
+    ucg_rank_t *ranks = ucg_malloc(size * sizeof(ucg_rank_t), "ucg rank-map compose");
+    if (ranks == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        ranks[i] = ucg_rank_map_eval(then, ucg_rank_map_eval(map, i));
+    }
+    ucg_status_t status = ucg_rank_map_pool_init_by_array(pool, dst, &ranks, size, 1);
+    if (ranks != NULL) {
+        /* not taken over on failure */
+        ucg_free(ranks);
+    }
+    return status;
+}
+
+void ucg_rank_map_pool_release(ucg_rank_map_pool_t *pool, ucg_rank_map_t *map)
+{
+    UCG_CHECK_NULL_VOID(map);
+
+    if (pool == NULL || map->type != UCG_RANK_MAP_TYPE_ARRAY) {
+        ucg_rank_map_cleanup(map);
+        return;
     }
 
+    uint64_t key = ucg_rank_map_pool_hash(map->array, map->size);
+    ucg_lock_enter(&pool->lock);
+    ucg_hiter_t iter = ucg_hash_get(rank_map_pool, &pool->elems, key);
+    ucg_assert(iter != ucg_hash_end(&pool->elems));
+    ucg_rank_map_pool_elem_t **link = &ucg_hash_value(&pool->elems, iter);
+    while ((*link)->array != map->array) {
+        link = &(*link)->next;
+        ucg_assert(*link != NULL);
+    }
+
+    ucg_rank_map_pool_elem_t *elem = *link;
+    if (--elem->refcount == 0) {
+        *link = elem->next;
+        if (ucg_hash_value(&pool->elems, iter) == NULL) {
+            ucg_hash_del(rank_map_pool, &pool->elems, iter);
+        }
+        pool->bytes -= elem->size * sizeof(ucg_rank_t);
+        ucg_free(elem->array);
+        ucg_free(elem);
+    }
+    ucg_lock_leave(&pool->lock);
+
+    map->array = NULL;
     map->size = 0;
     return;
 }
 
-ucg_rank_t ucg_rank_map_eval(const ucg_rank_map_t *map, ucg_rank_t src_rank)
-{
-    UCG_CHECK_NULL(UCG_INVALID_RANK, map);
-    UCG_CHECK_OUT_RANGE(UCG_INVALID_RANK, src_rank, 0, (ucg_rank_t)map->size);
-
-    ucg_rank_t dest_rank = UCG_INVALID_RANK;
-    switch (map->type) {
-        case UCG_RANK_MAP_TYPE_FULL:
-            dest_rank = src_rank;
-            break;
-        case UCG_RANK_MAP_TYPE_ARRAY:
-            dest_rank = map->array[src_rank];
-            break;
-        case UCG_RANK_MAP_TYPE_STRIDE:
-            dest_rank = map->strided.start + src_rank * map->strided.stride;
-            break;
-        case UCG_RANK_MAP_TYPE_CB:
-            dest_rank = map->cb.mapping(map->cb.arg, src_rank);
-            break;
-        default:
-            ucg_error("Unknown rank-map type %d", map->type);
-            break;
-    }
-
-    return dest_rank;
-}
\ No newline at end of file
+size_t ucg_rank_map_pool_bytes(ucg_rank_map_pool_t *pool)
+{
+    UCG_CHECK_NULL(0, pool);
+
+    ucg_lock_enter(&pool->lock);
+    size_t bytes = pool->bytes;
+    ucg_lock_leave(&pool->lock);
+    return bytes;
+}
+
+#define UCG_RANK_MAP_POOL_OBJ_KEY_SAMPLES 64
+
+/**
+ * The key samples the ranks to be cheap for the large rank-maps, the rank-maps
+ * of the same key are compared in full.
+ */
+static uint64_t ucg_rank_map_pool_obj_key(const ucg_rank_map_t *map)
+{
+    uint64_t hash = 14695981039346656037ull ^ map->size;
+    uint32_t step = map->size / UCG_RANK_MAP_POOL_OBJ_KEY_SAMPLES + 1;
+    for (uint32_t i = 0; i < map->size; i += step) {
+        hash ^= (uint32_t)ucg_rank_map_eval(map, i);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static int ucg_rank_map_pool_is_same_ranks(const ucg_rank_map_t *map1,
+                                           const ucg_rank_map_t *map2)
+{
+    if (map1->size != map2->size) {
+        return 0;
+    }
+    if (map1->type == UCG_RANK_MAP_TYPE_ARRAY && map2->type == UCG_RANK_MAP_TYPE_ARRAY &&
+        map1->array == map2->array) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < map1->size; ++i) {
+        if (ucg_rank_map_eval(map1, i) != ucg_rank_map_eval(map2, i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Should be called with the lock held. */
+static ucg_rank_map_pool_obj_t* ucg_rank_map_pool_find_obj(ucg_rank_map_pool_t *pool,
+                                                           uint64_t key,
+                                                           const ucg_rank_map_t *map,
+                                                           const ucg_rank_map_pool_obj_ops_t *ops)
+{
+    ucg_hiter_t iter = ucg_hash_get(rank_map_pool_obj, &pool->objs, key);
+    if (iter == ucg_hash_end(&pool->objs)) {
+        return NULL;
+    }
+    ucg_rank_map_pool_obj_t *elem = ucg_hash_value(&pool->objs, iter);
+    for (; elem != NULL; elem = elem->next) {
+        if (elem->ops == ops && ucg_rank_map_pool_is_same_ranks(&elem->map, map)) {
+            return elem;
+        }
+    }
+    return NULL;
+}
+
+static void ucg_rank_map_pool_destroy_obj(ucg_rank_map_pool_t *pool,
+                                          ucg_rank_map_pool_obj_t *elem)
+{
+    elem->ops->cleanup(elem->obj);
+    ucg_rank_map_pool_release(pool, &elem->map);
+    ucg_free(elem);
+    return;
+}
+
+ucg_status_t ucg_rank_map_pool_get_obj(ucg_rank_map_pool_t *pool,
+                                       const ucg_rank_map_t *map,
+                                       const ucg_rank_map_pool_obj_ops_t *ops,
+                                       void *arg, void **obj)
+{
+    UCG_CHECK_NULL_INVALID(map, ops, obj);
+
+    if (pool == NULL || map->type == UCG_RANK_MAP_TYPE_CB) {
+        return ops->init(map, arg, obj);
+    }
+
+    uint64_t key = ucg_rank_map_pool_obj_key(map);
+    ucg_lock_enter(&pool->lock);
+    ucg_rank_map_pool_obj_t *elem = ucg_rank_map_pool_find_obj(pool, key, map, ops);
+    if (elem != NULL) {
+        ++elem->refcount;
+        *obj = elem->obj;
+        ucg_lock_leave(&pool->lock);
+        return UCG_OK;
+    }
+    ucg_lock_leave(&pool->lock);
+
+    /* The object is created without the lock, init may be costly. */
+    elem = ucg_malloc(sizeof(ucg_rank_map_pool_obj_t), "ucg rank-map pool obj");
+    if (elem == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_status_t status = ucg_rank_map_pool_copy(pool, &elem->map, map);
+    if (status != UCG_OK) {
+        goto err_free_elem;
+    }
+    status = ops->init(map, arg, &elem->obj);
+    if (status != UCG_OK) {
+        goto err_release_map;
+    }
+    elem->ops = ops;
+    elem->refcount = 1;
+
+    ucg_lock_enter(&pool->lock);
+    ucg_rank_map_pool_obj_t *exist = ucg_rank_map_pool_find_obj(pool, key, map, ops);
+    if (exist != NULL) {
+        /* Created by others in the meantime */
+        ++exist->refcount;
+        *obj = exist->obj;
+        ucg_lock_leave(&pool->lock);
+        ucg_rank_map_pool_destroy_obj(pool, elem);
+        return UCG_OK;
+    }
+
+    int ret;
+    ucg_hiter_t iter = ucg_hash_put(rank_map_pool_obj, &pool->objs, key, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        ucg_lock_leave(&pool->lock);
+        ucg_rank_map_pool_destroy_obj(pool, elem);
+        return UCG_ERR_NO_MEMORY;
+    }
+    elem->next = (ret == UCG_HASH_PUT_KEY_PRESENT) ? ucg_hash_value(&pool->objs, iter) : NULL;
+    ucg_hash_value(&pool->objs, iter) = elem;
+    *obj = elem->obj;
+    ucg_lock_leave(&pool->lock);
+    return UCG_OK;
+
+err_release_map:
+    ucg_rank_map_pool_release(pool, &elem->map);
+err_free_elem:
+    ucg_free(elem);
+    return status;
+}
+
+void ucg_rank_map_pool_put_obj(ucg_rank_map_pool_t *pool, const ucg_rank_map_t *map,
+                               const ucg_rank_map_pool_obj_ops_t *ops, void *obj)
+{
+    UCG_CHECK_NULL_VOID(map, ops, obj);
+
+    if (pool == NULL || map->type == UCG_RANK_MAP_TYPE_CB) {
+        ops->cleanup(obj);
+        return;
+    }
+
+    uint64_t key = ucg_rank_map_pool_obj_key(map);
+    ucg_lock_enter(&pool->lock);
+    ucg_hiter_t iter = ucg_hash_get(rank_map_pool_obj, &pool->objs, key);
+    ucg_assert(iter != ucg_hash_end(&pool->objs));
+    ucg_rank_map_pool_obj_t **link = &ucg_hash_value(&pool->objs, iter);
+    while ((*link)->obj != obj) {
+        link = &(*link)->next;
+        ucg_assert(*link != NULL);
+    }
+
+    ucg_rank_map_pool_obj_t *elem = *link;
+    if (--elem->refcount > 0) {
+        ucg_lock_leave(&pool->lock);
+        return;
+    }
+    *link = elem->next;
+    if (ucg_hash_value(&pool->objs, iter) == NULL) {
+        ucg_hash_del(rank_map_pool_obj, &pool->objs, iter);
+    }
+    ucg_lock_leave(&pool->lock);
+
+    ucg_rank_map_pool_destroy_obj(pool, elem);
+    return;
+}
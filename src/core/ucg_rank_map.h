@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_RANK_MAP_H_
@@ -7,6 +7,20 @@
 
 #include "ucg/api/ucg.h"
 
+#include "util/ucg_helper.h"
+#include "util/ucg_lock.h"
+#include "util/ucg_log.h"
+
+/**
+ * @brief Pool of rank-map arrays
+ *
+ * Groups of the same members are common, e.g. the duplicated communicators,
+ * so the array-type rank-maps of the same ranks from the pool share one array,
+ * and the rank-maps of the same ranks share the objects derived from the ranks.
+ * The pool is protected by its own lock.
+ */
+typedef struct ucg_rank_map_pool ucg_rank_map_pool_t;
+
 /**
  * @brief Initialize rank-map
  *
@@ -25,10 +39,11 @@ ucg_status_t ucg_rank_map_init_by_array(ucg_rank_map_t *map, ucg_rank_t **ranks,
 /**
  * @brief Optimize rank-map.
  *
- * When the condition is met, the array-type can be optimized to full-type or
- * stride-type, which reduces the space occupation and fetch overhead. Also,
- * stride-type can be optimized to full-type when stride is 1, which reduces the
- * compute overhead.
+ * When the condition is met, the array-type can be optimized to full-type,
+ * stride-type, block-stride-type (e.g. some ranks of every node in node-major
+ * layout) or runs-type (e.g. nodes of different sizes), which reduces the space
+ * occupation and fetch overhead. Also, stride-type can be optimized to full-type
+ * when stride is 1, which reduces the compute overhead.
  *
  * @param [inout] map       Rank map.
  * @param [out]   array     Ingored if not array-type. Otherwise when array-type
@@ -51,14 +66,158 @@ ucg_status_t ucg_rank_map_copy(ucg_rank_map_t *dst, const ucg_rank_map_t *src);
  */
 void ucg_rank_map_cleanup(ucg_rank_map_t *map);
 
+/* The last run that starts at or before the source rank */
+static inline ucg_rank_t ucg_rank_map_eval_runs(const ucg_rank_map_t *map, ucg_rank_t src_rank)
+{
+    const ucg_rank_map_run_t *runs = map->runs.runs;
+    uint32_t low = 0;
+    uint32_t high = map->runs.num_runs;
+    while (high - low > 1) {
+        uint32_t mid = (low + high) / 2;
+        if (runs[mid].src_rank <= src_rank) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return runs[low].dst_rank + (src_rank - runs[low].src_rank);
+}
+
 /**
  * @brief Map src-rank to dest-rank.
  *
+ * It's inlined since it's on the path of every point-to-point operation.
+ *
  * @param [in] map          the rank map
  * @param [in] src_rank     the source rank
  *
  * @return UCG_INVALID_RANK for failed, other for success.
  */
-ucg_rank_t ucg_rank_map_eval(const ucg_rank_map_t *map, ucg_rank_t src_rank);
+static inline ucg_rank_t ucg_rank_map_eval(const ucg_rank_map_t *map, ucg_rank_t src_rank)
+{
+    UCG_CHECK_NULL(UCG_INVALID_RANK, map);
+    UCG_CHECK_OUT_RANGE(UCG_INVALID_RANK, src_rank, 0, (ucg_rank_t)map->size);
+
+    switch (map->type) {
+        case UCG_RANK_MAP_TYPE_FULL:
+            return src_rank;
+        case UCG_RANK_MAP_TYPE_ARRAY:
+            return map->array[src_rank];
+        case UCG_RANK_MAP_TYPE_STRIDE:
+            return map->strided.start + src_rank * map->strided.stride;
+        case UCG_RANK_MAP_TYPE_BLOCK_STRIDE:
+            return map->blocked.start +
+                   (src_rank / map->blocked.block) * map->blocked.block_stride +
+                   (src_rank % map->blocked.block) * map->blocked.stride;
+        case UCG_RANK_MAP_TYPE_RUNS:
+            return ucg_rank_map_eval_runs(map, src_rank);
+        case UCG_RANK_MAP_TYPE_CB:
+            return map->cb.mapping(map->cb.arg, src_rank);
+        default:
+            ucg_error("Unknown rank-map type %d", map->type);
+            return UCG_INVALID_RANK;
+    }
+}
+
+/**
+ * @brief Initialize the pool of rank-map arrays.
+ *
+ * @param [out] pool        Rank-map pool.
+ * @param [in]  lock_type   Lock type of the pool.
+ */
+ucg_status_t ucg_rank_map_pool_init(ucg_rank_map_pool_t **pool, ucg_lock_type_t lock_type);
+
+/**
+ * @brief Cleanup the pool, the arrays not released are freed as well.
+ */
+void ucg_rank_map_pool_cleanup(ucg_rank_map_pool_t *pool);
+
+/**
+ * @brief Initialize rank-map by array from the pool.
+ *
+ * It's the same as @ref ucg_rank_map_init_by_array, except that the array is
+ * shared with the rank-maps of the same ranks. If @b pool is NULL, the array is
+ * not shared.
+ */
+ucg_status_t ucg_rank_map_pool_init_by_array(ucg_rank_map_pool_t *pool,
+                                             ucg_rank_map_t *map, ucg_rank_t **ranks,
+                                             uint32_t size, int take_over);
+
+/**
+ * @brief Copy rank-map from the pool.
+ *
+ * It's the same as @ref ucg_rank_map_copy, except that the array is shared.
+ */
+ucg_status_t ucg_rank_map_pool_copy(ucg_rank_map_pool_t *pool, ucg_rank_map_t *dst,
+                                    const ucg_rank_map_t *src);
+
+/**
+ * @brief Compose two rank-maps from the pool.
+ *
+ * The @b dst rank-map converts rank @b r to @b then(map(r)), so the ranks that
+ * are converted by two rank-maps are converted by one evaluation. The result is
+ * optimized, and the array is shared like @ref ucg_rank_map_pool_init_by_array.
+ * The callback-type is not composed unless the other one is full-type.
+ *
+ * @param [in]  pool        Rank-map pool, may be NULL.
+ * @param [out] dst         Composed rank-map.
+ * @param [in]  map         Rank-map applied first.
+ * @param [in]  then        Rank-map applied to the result of @b map.
+ */
+ucg_status_t ucg_rank_map_pool_compose(ucg_rank_map_pool_t *pool, ucg_rank_map_t *dst,
+                                       const ucg_rank_map_t *map,
+                                       const ucg_rank_map_t *then);
+
+/**
+ * @brief Release rank-map to the pool.
+ *
+ * This routine is used to cleanup the rank-map from @ref ucg_rank_map_pool_init_by_array,
+ * @ref ucg_rank_map_pool_copy and @ref ucg_rank_map_pool_compose with the same pool.
+ */
+void ucg_rank_map_pool_release(ucg_rank_map_pool_t *pool, ucg_rank_map_t *map);
+
+/**
+ * @brief Get the bytes of the arrays held by the pool.
+ */
+size_t ucg_rank_map_pool_bytes(ucg_rank_map_pool_t *pool);
+
+/**
+ * @brief Operations of the objects derived from the ranks of a rank-map
+ */
+typedef struct ucg_rank_map_pool_obj_ops {
+    /** Create the object of the ranks of @b map. */
+    ucg_status_t (*init)(const ucg_rank_map_t *map, void *arg, void **obj);
+    /** Destroy the object. */
+    void (*cleanup)(void *obj);
+} ucg_rank_map_pool_obj_ops_t;
+
+/**
+ * @brief Get the object of the ranks of the rank-map from the pool.
+ *
+ * The objects that only depend on the ranks, e.g. the locations of the ranks,
+ * are shared by the rank-maps of the same ranks whatever their types, so that
+ * the duplicated groups neither create them again nor hold their own copies.
+ * The object is created by @b ops->init if there is none, and @b ops identifies
+ * the kind of the object. If @b pool is NULL or @b map is callback-type, the
+ * object is not shared.
+ *
+ * @param [in]  pool        Rank-map pool.
+ * @param [in]  map         Rank map.
+ * @param [in]  ops         Operations of the object.
+ * @param [in]  arg         Argument of @b ops->init.
+ * @param [out] obj         The object.
+ */
+ucg_status_t ucg_rank_map_pool_get_obj(ucg_rank_map_pool_t *pool,
+                                       const ucg_rank_map_t *map,
+                                       const ucg_rank_map_pool_obj_ops_t *ops,
+                                       void *arg, void **obj);
+
+/**
+ * @brief Put the object from @ref ucg_rank_map_pool_get_obj.
+ *
+ * The object is destroyed by the last put.
+ */
+void ucg_rank_map_pool_put_obj(ucg_rank_map_pool_t *pool, const ucg_rank_map_t *map,
+                               const ucg_rank_map_pool_obj_ops_t *ops, void *obj);
 
 #endif
\ No newline at end of file
@@ -4,10 +4,19 @@
 
 #include "ucg_group.h"
 #include "ucg_plan.h"
+#include "ucg_plan_tune.h"
 #include "util/ucg_log.h"
 #include "util/ucg_helper.h"
+#include "util/ucg_atomic.h"
 #include "util/ucg_profile.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
+#include "util/ucg_time.h"
 
+#include <string.h>
+
+/* Alignment of the staging buffers of a fusion, enough for any predefined dt */
+#define UCG_REQUEST_FUSION_ALIGN 64
 
 #define UCG_REQUEST_COPY_REQUIRED_FIELD(_field, _copy, _dst, _src, _err_label) \
     UCG_COPY_REQUIRED_FIELD(UCG_TOKENPASTE(UCG_REQUEST_INFO_FIELD_, _field), \
@@ -91,18 +100,58 @@ out:
     return;
 }
 
+/* Copy the op into the request if the user may destroy it before the request. */
+static inline void ucg_request_keep_op(ucg_op_t **op, ucg_op_generic_t *gop)
+{
+    if (*op != NULL && !ucg_op_is_persistent(*op)) {
+        ucg_op_copy(&gop->super, *op);
+        *op = &gop->super;
+    }
+    return;
+}
+
 static ucg_status_t ucg_request_ctor(ucg_request_t *self, const ucg_coll_args_t *args)
 {
     self->status = UCG_OK;
     self->args = *args;
     self->id = UCG_GROUP_BASE_REQ_ID;
+    self->flags = 0;
+    self->woken = 1;
+    self->carrier = NULL;
+    self->fusion = NULL;
+    self->tune_stat = NULL;
+    self->tune_start = 0;
+    ucg_list_head_init(&self->list);
     /** trade-off, get more information from comments of @ref ucg_op_init */
-    if ((args->type == UCG_COLL_TYPE_ALLREDUCE || args->type == UCG_COLL_TYPE_IALLREDUCE) &&
-        args->allreduce.op != NULL) {
-        if (!ucg_op_is_persistent(args->allreduce.op)) {
-            self->args.allreduce.op = &self->args.allreduce.gop.super;
-            ucg_op_copy(self->args.allreduce.op, args->allreduce.op);
-        }
+    switch (args->type) {
+        case UCG_COLL_TYPE_ALLREDUCE:
+        case UCG_COLL_TYPE_IALLREDUCE:
+            ucg_request_keep_op(&self->args.allreduce.op, &self->args.allreduce.gop);
+            break;
+        case UCG_COLL_TYPE_REDUCE:
+        case UCG_COLL_TYPE_IREDUCE:
+            ucg_request_keep_op(&self->args.reduce.op, &self->args.reduce.gop);
+            break;
+        case UCG_COLL_TYPE_REDUCE_SCATTER:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER:
+            ucg_request_keep_op(&self->args.reduce_scatter.op,
+                                &self->args.reduce_scatter.gop);
+            break;
+        case UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK:
+            ucg_request_keep_op(&self->args.reduce_scatter_block.op,
+                                &self->args.reduce_scatter_block.gop);
+            break;
+        case UCG_COLL_TYPE_SCAN:
+        case UCG_COLL_TYPE_ISCAN:
+            ucg_request_keep_op(&self->args.scan.op, &self->args.scan.gop);
+            break;
+        case UCG_COLL_TYPE_EXSCAN:
+        case UCG_COLL_TYPE_IEXSCAN:
+            ucg_request_keep_op(&self->args.exscan.op, &self->args.exscan.gop);
+            break;
+        default:
+            break;
     }
     return UCG_OK;
 }
@@ -115,10 +164,20 @@ static void ucg_request_dtor(ucg_request_t *self)
 static inline ucg_status_t ucg_request_init(ucg_group_t *group, ucg_coll_args_t *args,
                                             ucg_request_t **request)
 {
-    ucg_context_lock(group->context);
+    if (group->tune != NULL) {
+        /* It may run a collective of the group, so it goes before the lock. */
+        ucg_plan_tune_agree(group, args);
+    }
+
+    ucg_context_planc_lock(group->context);
 
     ucg_plan_op_t *op;
-    ucg_status_t status = ucg_plans_prepare(group->plans, args, group->size, &op);
+    ucg_status_t status;
+    if (group->tune != NULL) {
+        status = ucg_plan_tune_prepare(group, args, &op);
+    } else {
+        status = ucg_plans_prepare(group->plans, args, group->size, &op);
+    }
     if (status != UCG_OK) {
         ucg_debug("Failed to prepare op(%d), %s", args->type, ucg_status_string(status));
         goto out;
@@ -127,14 +186,25 @@ static inline ucg_status_t ucg_request_init(ucg_group_t *group, ucg_coll_args_t
     *request = &op->super;
     ucg_assert((*request)->status == UCG_OK);
 out:
-    ucg_context_unlock(group->context);
+    ucg_context_planc_unlock(group->context);
     return status;
 }
 
+/**
+ * Resetting the id is what makes the request observable as completed by
+ * ucg_request_test() without any lock, so the release store orders it after
+ * the results and the status of the request.
+ */
 static inline void ucg_request_complete(ucg_request_t *request, ucg_status_t status)
 {
+    if (request->tune_start != 0) {
+        if (status == UCG_OK) {
+            ucg_plan_tune_stat_add(request->tune_stat, ucg_get_time_ns() - request->tune_start);
+        }
+        request->tune_start = 0;
+    }
     ucg_group_free_req_id(request->group, request->id);
-    request->id = UCG_GROUP_BASE_REQ_ID;
+    ucg_atomic_store_release(&request->id, UCG_GROUP_BASE_REQ_ID);
     ucg_request_info_t *info = &request->args.info;
     if (info->field_mask & UCG_REQUEST_INFO_FIELD_CB) {
         info->complete_cb.cb(info->complete_cb.arg, status);
@@ -142,6 +212,78 @@ static inline void ucg_request_complete(ucg_request_t *request, ucg_status_t sta
     return;
 }
 
+static inline void ucg_request_unlink(ucg_request_t *request)
+{
+    ucg_list_del(&request->list);
+    ucg_list_head_init(&request->list);
+    return;
+}
+
+/* Called with the group lock held, move the queued requests to the lists. */
+static void ucg_group_drain(ucg_group_t *group)
+{
+    ucg_request_t *req;
+    ucg_mpsc_elem_t *elem = ucg_mpsc_queue_pull_all(&group->pending);
+    while (elem != NULL) {
+        req = ucg_container_of(elem, ucg_request_t, elem);
+        elem = elem->next;
+        if (req->flags & UCG_REQUEST_FLAG_WAKEUP) {
+            ucg_list_add_tail(&group->rlist, &req->list);
+        } else {
+            ucg_list_add_tail(&group->plist, &req->list);
+        }
+    }
+
+    elem = ucg_mpsc_queue_pull_all(&group->ready);
+    while (elem != NULL) {
+        req = ucg_container_of(elem, ucg_request_t, elem);
+        elem = elem->next;
+        ucg_list_add_tail(&group->rlist, &req->list);
+    }
+    return;
+}
+
+/**
+ * Called with the group lock held and the request is not in the queues,
+ * completes the request if it's done.
+ */
+static ucg_status_t ucg_request_progress(ucg_request_t *request)
+{
+    ucg_group_t *group = request->group;
+    ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
+
+    if (request->flags & UCG_REQUEST_FLAG_WAKEUP) {
+        /* Wake-ups from now on are for this progress or the later ones, the
+           request goes back to the ready queue through them. */
+        ucg_request_unlink(request);
+        ucg_atomic_bool_cswap8(&request->woken, 1, 0);
+    }
+
+    ucg_context_planc_lock(group->context);
+    ucg_status_t status = op->progress(op);
+    ucg_context_planc_unlock(group->context);
+    ucg_assert(status == op->super.status);
+    if (status == UCG_INPROGRESS) {
+        return status;
+    }
+
+    /* The request may be still in a queue, take it out before completion. */
+    ucg_group_drain(group);
+    ucg_request_unlink(request);
+    request->woken = 1;
+    ucg_atomic_sub32(&group->num_inflight, 1);
+    ucg_request_complete(request, status);
+    return status;
+}
+
+void ucg_request_wakeup(ucg_request_t *request)
+{
+    if (ucg_atomic_bool_cswap8(&request->woken, 0, 1)) {
+        ucg_mpsc_queue_push(&request->group->ready, &request->elem);
+    }
+    return;
+}
+
 ucg_status_t ucg_request_bcast_init(void *buffer, int32_t count, ucg_dt_t *dt,
                                     ucg_rank_t root, ucg_group_h group,
                                     const ucg_request_info_t *info,
@@ -192,6 +334,49 @@ ucg_status_t ucg_request_allreduce_init(const void *sendbuf, void *recvbuf,
     return ucg_request_init(group, &args, request);
 }
 
+ucg_status_t ucg_request_reduce_init(const void *sendbuf, void *recvbuf,
+                                     int32_t count, ucg_dt_t *dt,
+                                     ucg_op_t *op, ucg_rank_t root,
+                                     ucg_group_h group,
+                                     const ucg_request_info_t *info,
+                                     ucg_request_type_t nb,
+                                     ucg_request_h *request)
+{
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    UCG_CHECK_NULL_INVALID(group, request);
+    if (group->myrank == root) {
+        UCG_CHECK_NULL_INVALID(sendbuf, recvbuf, dt, op);
+    } else {
+        /* recvbuf is not significant for non-root process */
+        UCG_CHECK_NULL_INVALID(sendbuf, dt, op);
+    }
+#endif
+
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_IREDUCE :
+                           UCG_COLL_TYPE_REDUCE;
+    ucg_coll_args_t args = {
+        .type = type,
+        .reduce.sendbuf = sendbuf,
+        .reduce.recvbuf = recvbuf,
+        .reduce.count = count,
+        .reduce.dt = dt,
+        .reduce.op = op,
+        .reduce.root = root,
+    };
+
+    if (group->myrank != root) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf);
+    } else if (sendbuf == UCG_IN_PLACE) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, recvbuf);
+    } else {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf, recvbuf);
+    }
+
+    return ucg_request_init(group, &args, request);
+}
+
 ucg_status_t ucg_request_barrier_init(ucg_group_h group,
                                       const ucg_request_info_t *info,
                                       ucg_request_type_t nb,
@@ -380,73 +565,718 @@ ucg_status_t ucg_request_allgatherv_init(const void *sendbuf, int sendcount,
     return ucg_request_init(group, &args, request);
 }
 
-UCG_PROFILE_FUNC(ucg_status_t, ucg_request_start, (request), ucg_request_h request)
+ucg_status_t ucg_request_allgather_init(const void *sendbuf, int32_t sendcount,
+                                        ucg_dt_t *sendtype, void *recvbuf,
+                                        int32_t recvcount, ucg_dt_t *recvtype,
+                                        ucg_group_h group, const ucg_request_info_t *info,
+                                        ucg_request_type_t nb, ucg_request_h *request)
 {
-    UCG_CHECK_NULL_INVALID(request);
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    UCG_CHECK_NULL_INVALID(sendbuf, sendtype, recvbuf, recvtype, group, request);
+#endif
 
-    ucg_context_lock(request->group->context);
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_IALLGATHER :
+                           UCG_COLL_TYPE_ALLGATHER;
+    ucg_coll_args_t args = {
+        .type = type,
+        .allgather.sendbuf = sendbuf,
+        .allgather.sendcount = sendcount,
+        .allgather.sendtype = sendtype,
+        .allgather.recvbuf = recvbuf,
+        .allgather.recvcount = recvcount,
+        .allgather.recvtype = recvtype,
+    };
+
+    if (sendbuf == UCG_IN_PLACE) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, recvbuf);
+    } else {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf, recvbuf);
+    }
 
+    return ucg_request_init(group, &args, request);
+}
+
+ucg_status_t ucg_request_reduce_scatter_init(const void *sendbuf, void *recvbuf,
+                                             const int32_t *recvcounts, ucg_dt_t *dt,
+                                             ucg_op_t *op, ucg_group_h group,
+                                             const ucg_request_info_t *info,
+                                             ucg_request_type_t nb,
+                                             ucg_request_h *request)
+{
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    UCG_CHECK_NULL_INVALID(sendbuf, recvbuf, recvcounts, dt, op, group, request);
+#endif
+
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_IREDUCE_SCATTER :
+                           UCG_COLL_TYPE_REDUCE_SCATTER;
+    ucg_coll_args_t args = {
+        .type = type,
+        .reduce_scatter.sendbuf = sendbuf,
+        .reduce_scatter.recvbuf = recvbuf,
+        .reduce_scatter.recvcounts = recvcounts,
+        .reduce_scatter.dt = dt,
+        .reduce_scatter.op = op,
+    };
+
+    if (sendbuf == UCG_IN_PLACE) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, recvbuf);
+    } else {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf, recvbuf);
+    }
+
+    return ucg_request_init(group, &args, request);
+}
+
+ucg_status_t ucg_request_reduce_scatter_block_init(const void *sendbuf, void *recvbuf,
+                                                   int32_t recvcount, ucg_dt_t *dt,
+                                                   ucg_op_t *op, ucg_group_h group,
+                                                   const ucg_request_info_t *info,
+                                                   ucg_request_type_t nb,
+                                                   ucg_request_h *request)
+{
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    UCG_CHECK_NULL_INVALID(sendbuf, recvbuf, dt, op, group, request);
+#endif
+
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK :
+                           UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK;
+    ucg_coll_args_t args = {
+        .type = type,
+        .reduce_scatter_block.sendbuf = sendbuf,
+        .reduce_scatter_block.recvbuf = recvbuf,
+        .reduce_scatter_block.recvcount = recvcount,
+        .reduce_scatter_block.dt = dt,
+        .reduce_scatter_block.op = op,
+    };
+
+    if (sendbuf == UCG_IN_PLACE) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, recvbuf);
+    } else {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf, recvbuf);
+    }
+
+    return ucg_request_init(group, &args, request);
+}
+
+static ucg_status_t ucg_request_scan_common_init(ucg_coll_type_t type, const void *sendbuf,
+                                                 void *recvbuf, int32_t count, ucg_dt_t *dt,
+                                                 ucg_op_t *op, ucg_group_h group,
+                                                 const ucg_request_info_t *info,
+                                                 ucg_request_h *request)
+{
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    UCG_CHECK_NULL_INVALID(sendbuf, recvbuf, dt, op, group, request);
+#endif
+
+    ucg_coll_args_t args = {
+        .type = type,
+        .scan.sendbuf = sendbuf,
+        .scan.recvbuf = recvbuf,
+        .scan.count = count,
+        .scan.dt = dt,
+        .scan.op = op,
+    };
+
+    if (sendbuf == UCG_IN_PLACE) {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, recvbuf);
+    } else {
+        UCG_REQUEST_APPLY_INFO_RETURN(&args.info, info, sendbuf, recvbuf);
+    }
+
+    return ucg_request_init(group, &args, request);
+}
+
+ucg_status_t ucg_request_scan_init(const void *sendbuf, void *recvbuf, int32_t count,
+                                   ucg_dt_t *dt, ucg_op_t *op, ucg_group_h group,
+                                   const ucg_request_info_t *info,
+                                   ucg_request_type_t nb, ucg_request_h *request)
+{
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_ISCAN :
+                           UCG_COLL_TYPE_SCAN;
+    return ucg_request_scan_common_init(type, sendbuf, recvbuf, count, dt, op,
+                                        group, info, request);
+}
+
+ucg_status_t ucg_request_exscan_init(const void *sendbuf, void *recvbuf, int32_t count,
+                                     ucg_dt_t *dt, ucg_op_t *op, ucg_group_h group,
+                                     const ucg_request_info_t *info,
+                                     ucg_request_type_t nb, ucg_request_h *request)
+{
+    /* Treat ucg_coll as blocking and non-blocking based on parameter nb */
+    ucg_coll_type_t type = (nb == UCG_REQUEST_NONBLOCKING) ?
+                           UCG_COLL_TYPE_IEXSCAN :
+                           UCG_COLL_TYPE_EXSCAN;
+    return ucg_request_scan_common_init(type, sendbuf, recvbuf, count, dt, op,
+                                        group, info, request);
+}
+
+/**
+ * Called with the planc lock held, the request is done if it's completed by
+ * the trigger, the caller completes it after releasing the lock.
+ */
+static ucg_status_t ucg_request_start_nolock(ucg_request_t *request, int *done)
+{
+    *done = 0;
     if (ucg_unlikely(request->status != UCG_OK)) {
         ucg_error("Attempt to start a request with status %d", request->status);
-        ucg_context_unlock(request->group->context);
         return request->status;
     }
 
     /* Requests with the same ID are combined into a complete collection op. */
+    ucg_group_t *group = request->group;
     ucg_assert(request->id == UCG_GROUP_BASE_REQ_ID);
-    request->id = ucg_group_alloc_req_id(request->group);
+    request->id = ucg_group_alloc_req_id(group);
+    /* It's progressed once it's taken out of the pending queue anyway. */
+    request->woken = 1;
+    if (request->tune_stat != NULL) {
+        request->tune_start = ucg_get_time_ns();
+    }
 
     ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
     ucg_status_t status = op->trigger(op);
     if (status == UCG_OK) {
         if (op->super.status == UCG_INPROGRESS) {
-            ucg_list_add_tail(&op->super.group->context->plist, &op->super.list);
+            ucg_atomic_fadd32(&group->num_inflight, 1);
+            ucg_mpsc_queue_push(&group->pending, &op->super.elem);
         } else {
-            ucg_request_complete(&op->super, op->super.status);
+            *done = 1;
         }
     }
-    ucg_context_unlock(request->group->context);
 
     return status;
 }
 
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_start, (request), ucg_request_h request)
+{
+    UCG_CHECK_NULL_INVALID(request);
+
+    int done;
+    ucg_context_t *context = request->group->context;
+    ucg_context_planc_lock(context);
+    ucg_status_t status = ucg_request_start_nolock(request, &done);
+    ucg_context_planc_unlock(context);
+    if (done) {
+        ucg_request_complete(request, request->status);
+    }
+
+    return status;
+}
+
+/**
+ * Small allreduces started together and carried by one allreduce. It's kept
+ * by the members for their next start together, so persistent requests pay
+ * for the carrier only once. It's released when the members are fused in
+ * another way or one of them is cleaned up.
+ */
+struct ucg_request_fusion {
+    ucg_request_t *carrier;
+    uint32_t count;
+    ucg_request_t **members;
+    uint8_t *sendbuf;
+    uint8_t *recvbuf;
+};
+
+/* Return the size of the allreduce if it can be fused, otherwise 0. */
+static uint64_t ucg_request_fusible_size(const ucg_request_t *request)
+{
+    const ucg_coll_args_t *args = &request->args;
+    if (request->status != UCG_OK ||
+        (args->type != UCG_COLL_TYPE_ALLREDUCE &&
+         args->type != UCG_COLL_TYPE_IALLREDUCE)) {
+        return 0;
+    }
+
+    /* Only the host memory can be packed by memcpy() */
+    if (!(args->info.field_mask & UCG_REQUEST_INFO_FIELD_MEM_TYPE) ||
+        args->info.mem_type != UCG_MEM_TYPE_HOST) {
+        return 0;
+    }
+
+    const ucg_coll_allreduce_args_t *allreduce = &args->allreduce;
+    if (allreduce->count <= 0 || !ucg_dt_is_predefined(allreduce->dt) ||
+        !ucg_op_is_predefined(allreduce->op)) {
+        return 0;
+    }
+
+    uint64_t size = ucg_dt_size(allreduce->dt) * allreduce->count;
+    return size <= request->group->context->fusion.max_size ? size : 0;
+}
+
+static int ucg_request_is_fusible_with(const ucg_request_t *request,
+                                       const ucg_request_t *first)
+{
+    const ucg_coll_allreduce_args_t *allreduce = &request->args.allreduce;
+    const ucg_coll_allreduce_args_t *first_allreduce = &first->args.allreduce;
+    return request->group == first->group &&
+           request->args.type == first->args.type &&
+           ucg_dt_type(allreduce->dt) == ucg_dt_type(first_allreduce->dt) &&
+           ucg_op_type(allreduce->op) == ucg_op_type(first_allreduce->op);
+}
+
+/**
+ * Return the number of the requests from the first one that are fused into
+ * one allreduce. The boundaries only depend on the arguments of the requests
+ * and the configuration, so every rank fuses the same requests.
+ */
+static uint32_t ucg_request_fusible_run(uint32_t count, ucg_request_h *requests,
+                                        uint64_t *total_size)
+{
+    ucg_request_t *first = requests[0];
+    uint64_t window = first->group->context->fusion.window;
+    uint64_t size = ucg_request_fusible_size(first);
+    if (size == 0 || size > window) {
+        return 1;
+    }
+
+    uint32_t n = 1;
+    *total_size = size;
+    for (; n < count; ++n) {
+        ucg_request_t *request = requests[n];
+        if (!ucg_request_is_fusible_with(request, first)) {
+            break;
+        }
+        size = ucg_request_fusible_size(request);
+        if (size == 0 || *total_size + size > window) {
+            break;
+        }
+        *total_size += size;
+    }
+    return n;
+}
+
+/* Called when the carrier is completed, the members are completed likewise. */
+static void ucg_request_fusion_complete(void *arg, ucg_status_t status)
+{
+    ucg_request_fusion_t *fusion = (ucg_request_fusion_t*)arg;
+
+    uint8_t *recvbuf = fusion->recvbuf;
+    for (uint32_t i = 0; i < fusion->count; ++i) {
+        ucg_request_t *member = fusion->members[i];
+        ucg_coll_allreduce_args_t *allreduce = &member->args.allreduce;
+        uint64_t size = ucg_dt_size(allreduce->dt) * allreduce->count;
+        if (status == UCG_OK) {
+            memcpy(allreduce->recvbuf, recvbuf, size);
+        }
+        recvbuf += size;
+        member->carrier = NULL;
+        member->status = status;
+    }
+
+    for (uint32_t i = 0; i < fusion->count; ++i) {
+        ucg_request_complete(fusion->members[i], status);
+    }
+    return;
+}
+
+/* Called with the members and the carrier not in flight. */
+static void ucg_request_fusion_release(ucg_request_fusion_t *fusion)
+{
+    for (uint32_t i = 0; i < fusion->count; ++i) {
+        fusion->members[i]->fusion = NULL;
+    }
+
+    ucg_plan_op_t *op = ucg_derived_of(fusion->carrier, ucg_plan_op_t);
+    ucg_context_t *context = fusion->carrier->group->context;
+    ucg_context_planc_lock(context);
+    op->discard(op);
+    ucg_context_planc_unlock(context);
+    ucg_free(fusion);
+    return;
+}
+
+static int ucg_request_fusion_match(const ucg_request_fusion_t *fusion,
+                                    uint32_t count, ucg_request_h *requests)
+{
+    if (fusion == NULL || fusion->count != count) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (fusion->members[i] != requests[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Create the carrier of the requests, called without the planc lock. */
+static ucg_status_t ucg_request_fusion_create(uint32_t count, ucg_request_h *requests,
+                                              uint64_t total_size,
+                                              ucg_request_fusion_t **fusion_p)
+{
+    size_t members_size = ucg_align_up(count * sizeof(ucg_request_t*), UCG_REQUEST_FUSION_ALIGN);
+    size_t staging_size = ucg_align_up(total_size, UCG_REQUEST_FUSION_ALIGN);
+    size_t header_size = ucg_align_up(sizeof(ucg_request_fusion_t), UCG_REQUEST_FUSION_ALIGN);
+    ucg_request_fusion_t *fusion = ucg_malloc(header_size + members_size + 2 * staging_size,
+                                              "ucg request fusion");
+    if (fusion == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    fusion->count = count;
+    fusion->members = (ucg_request_t**)((uint8_t*)fusion + header_size);
+    fusion->sendbuf = (uint8_t*)fusion->members + members_size;
+    fusion->recvbuf = fusion->sendbuf + staging_size;
+    for (uint32_t i = 0; i < count; ++i) {
+        fusion->members[i] = requests[i];
+    }
+
+    ucg_request_t *first = requests[0];
+    ucg_dt_t *dt = first->args.allreduce.dt;
+    /* Nonblocking, so it's not tuned and its init doesn't run a collective. */
+    ucg_coll_args_t args = {
+        .type = UCG_COLL_TYPE_IALLREDUCE,
+        .info.field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE | UCG_REQUEST_INFO_FIELD_CB,
+        .info.mem_type = UCG_MEM_TYPE_HOST,
+        .info.complete_cb = {
+            .cb = ucg_request_fusion_complete,
+            .arg = fusion,
+        },
+        .allreduce.sendbuf = fusion->sendbuf,
+        .allreduce.recvbuf = fusion->recvbuf,
+        .allreduce.count = total_size / ucg_dt_size(dt),
+        .allreduce.dt = dt,
+        .allreduce.op = first->args.allreduce.op,
+    };
+    ucg_status_t status = ucg_request_init(first->group, &args, &fusion->carrier);
+    if (status != UCG_OK) {
+        ucg_free(fusion);
+        return status;
+    }
+
+    /* A request is the member of one fusion at most. */
+    for (uint32_t i = 0; i < count; ++i) {
+        if (requests[i]->fusion != NULL) {
+            ucg_request_fusion_release(requests[i]->fusion);
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        requests[i]->fusion = fusion;
+    }
+    *fusion_p = fusion;
+    return UCG_OK;
+}
+
+/**
+ * Pack the requests into one allreduce and start it as the carrier of them,
+ * it's done like ucg_request_start_nolock(). The carrier of the last start
+ * of the same requests is reused. Called without the planc lock.
+ */
+static ucg_status_t ucg_request_fuse(uint32_t count, ucg_request_h *requests,
+                                     uint64_t total_size, ucg_request_t **carrier,
+                                     int *done)
+{
+    *done = 0;
+    ucg_request_t *first = requests[0];
+    ucg_request_fusion_t *fusion = first->fusion;
+    ucg_status_t status;
+    if (!ucg_request_fusion_match(fusion, count, requests)) {
+        status = ucg_request_fusion_create(count, requests, total_size, &fusion);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+
+    uint8_t *sendbuf = fusion->sendbuf;
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_coll_allreduce_args_t *allreduce = &requests[i]->args.allreduce;
+        uint64_t size = ucg_dt_size(allreduce->dt) * allreduce->count;
+        const void *src = allreduce->sendbuf == UCG_IN_PLACE ?
+                          allreduce->recvbuf : allreduce->sendbuf;
+        memcpy(sendbuf, src, size);
+        sendbuf += size;
+    }
+
+    ucg_context_t *context = first->group->context;
+    ucg_context_planc_lock(context);
+    /* The members are in flight until the carrier is completed. */
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_request_t *member = requests[i];
+        ucg_assert(member->id == UCG_GROUP_BASE_REQ_ID);
+        member->status = UCG_INPROGRESS;
+        member->carrier = fusion->carrier;
+        ucg_atomic_store_release(&member->id, UCG_GROUP_END_REQ_ID);
+    }
+
+    status = ucg_request_start_nolock(fusion->carrier, done);
+    if (status != UCG_OK) {
+        goto err_revert_members;
+    }
+    ucg_context_planc_unlock(context);
+    *carrier = fusion->carrier;
+    return UCG_OK;
+
+err_revert_members:
+    /* Unlike a failed start, the members can be started again. */
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_request_t *member = requests[i];
+        member->carrier = NULL;
+        member->status = UCG_OK;
+        ucg_atomic_store_release(&member->id, UCG_GROUP_BASE_REQ_ID);
+    }
+    ucg_context_planc_unlock(context);
+    /* The carrier failed to start, don't keep it. */
+    ucg_request_fusion_release(fusion);
+    return status;
+}
+
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_startall, (count, requests),
+                 uint32_t count, ucg_request_h *requests)
+{
+    UCG_CHECK_NULL_INVALID(requests);
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    for (uint32_t i = 0; i < count; ++i) {
+        UCG_CHECK_NULL_INVALID(requests[i]);
+    }
+#endif
+
+    ucg_status_t status = UCG_OK;
+    ucg_context_t *context = NULL;
+    uint32_t i = 0;
+    while (i < count) {
+        int done;
+        uint64_t total_size;
+        ucg_request_t *request = requests[i];
+        uint32_t n = ucg_request_fusible_run(count - i, &requests[i], &total_size);
+        if (n > 1) {
+            if (context != NULL) {
+                ucg_context_planc_unlock(context);
+                context = NULL;
+            }
+            status = ucg_request_fuse(n, &requests[i], total_size, &request, &done);
+        } else {
+            /* Usually all the requests are of one context, so is the lock. */
+            if (request->group->context != context) {
+                if (context != NULL) {
+                    ucg_context_planc_unlock(context);
+                }
+                context = request->group->context;
+                ucg_context_planc_lock(context);
+            }
+            status = ucg_request_start_nolock(request, &done);
+        }
+        if (status != UCG_OK) {
+            break;
+        }
+        i += n;
+
+        if (done) {
+            /* The complete callback may take the group lock. */
+            if (context != NULL) {
+                ucg_context_planc_unlock(context);
+                context = NULL;
+            }
+            ucg_request_complete(request, request->status);
+        }
+    }
+    if (context != NULL) {
+        ucg_context_planc_unlock(context);
+    }
+
+    return status;
+}
+
+int ucg_group_progress(ucg_group_t *group)
+{
+    int count = 0;
+
+    /* The lock owner is testing a request of this group, which makes progress
+       as well. */
+    if (!ucg_group_try_lock(group)) {
+        return count;
+    }
+
+    ucg_group_drain(group);
+
+    ucg_request_t *req = NULL;
+    ucg_request_t *tmp_req = NULL;
+    ucg_list_for_each_safe(req, tmp_req, &group->plist, list) {
+        if (ucg_request_progress(req) != UCG_INPROGRESS) {
+            ++count;
+        }
+    }
+
+    /* Requests woken up during the loop are left to the next call. */
+    while (!ucg_list_is_empty(&group->rlist)) {
+        req = ucg_list_head(&group->rlist, ucg_request_t, list);
+        if (ucg_request_progress(req) != UCG_INPROGRESS) {
+            ++count;
+        }
+    }
+    ucg_group_unlock(group);
+
+    return count;
+}
+
 UCG_PROFILE_FUNC(ucg_status_t, ucg_request_test, (request), ucg_request_h request)
 {
     UCG_CHECK_NULL_INVALID(request);
 
-    ucg_context_lock(request->group->context);
+    /* Not started or already completed, nothing to synchronize with. */
+    if (ucg_atomic_load_acquire(&request->id) == UCG_GROUP_BASE_REQ_ID) {
+        return request->status;
+    }
+
+    ucg_group_t *group = request->group;
+    ucg_group_lock(group);
+    /* Started but failed to trigger, or completed by ucg_group_progress(). */
     if (ucg_unlikely(request->status != UCG_INPROGRESS)) {
-        ucg_context_unlock(request->group->context);
+        ucg_group_unlock(group);
         return request->status;
     }
 
-    ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
-    ucg_status_t status = op->progress(op);
-    ucg_assert(status == op->super.status);
-    if (status != UCG_INPROGRESS) {
-        ucg_list_del(&op->super.list);
-        ucg_request_complete(&op->super, status);
+    /* The request may be in the pending queue. */
+    ucg_group_drain(group);
+    if (request->carrier != NULL) {
+        /* The carrier completes the request along with itself. */
+        ucg_request_progress(request->carrier);
+    } else {
+        ucg_request_progress(request);
+    }
+    ucg_status_t status = request->status;
+    ucg_group_unlock(group);
+
+    return status;
+}
+
+static __thread int ucg_request_batch_depth = 0;
+
+int ucg_request_in_batch(void)
+{
+    return ucg_request_batch_depth > 0;
+}
+
+static inline int ucg_request_is_inflight(ucg_request_t *request)
+{
+    return request != NULL &&
+           ucg_atomic_load_acquire(&request->id) != UCG_GROUP_BASE_REQ_ID;
+}
+
+/**
+ * Progress the in-flight requests of the batch once. The plancs of a context
+ * are progressed once before its requests, and a group is locked and drained
+ * once for each run of its requests, so the requests should be sorted by
+ * group to get the most out of it.
+ */
+static void ucg_request_batch_progress(uint32_t count, ucg_request_h *requests)
+{
+    ucg_context_t *context = NULL;
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_request_t *request = requests[i];
+        if (ucg_request_is_inflight(request) && request->group->context != context) {
+            context = request->group->context;
+            ucg_context_progress_plancs(context);
+        }
+    }
+
+    ++ucg_request_batch_depth;
+    ucg_group_t *group = NULL;
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_request_t *request = requests[i];
+        if (!ucg_request_is_inflight(request)) {
+            continue;
+        }
+        if (request->group != group) {
+            if (group != NULL) {
+                ucg_group_unlock(group);
+            }
+            group = request->group;
+            ucg_group_lock(group);
+            /* The requests may be in the pending queue. */
+            ucg_group_drain(group);
+        }
+        /* Started but failed to trigger, or completed by ucg_group_progress(). */
+        if (request->status == UCG_INPROGRESS) {
+            ucg_request_progress(request->carrier != NULL ? request->carrier : request);
+        }
+    }
+    if (group != NULL) {
+        ucg_group_unlock(group);
     }
-    ucg_context_unlock(request->group->context);
+    --ucg_request_batch_depth;
+    return;
+}
+
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_testall, (count, requests),
+                 uint32_t count, ucg_request_h *requests)
+{
+    UCG_CHECK_NULL_INVALID(requests);
+
+    ucg_request_batch_progress(count, requests);
 
+    ucg_status_t status = UCG_OK;
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_request_t *request = requests[i];
+        if (request == NULL) {
+            continue;
+        }
+        if (ucg_request_is_inflight(request)) {
+            status = UCG_INPROGRESS;
+            continue;
+        }
+        if (request->status != UCG_OK) {
+            return request->status;
+        }
+    }
     return status;
 }
 
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_waitany, (count, requests, index),
+                 uint32_t count, ucg_request_h *requests, int32_t *index)
+{
+    UCG_CHECK_NULL_INVALID(requests, index);
+
+    *index = -1;
+    while (1) {
+        int inflight = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            ucg_request_t *request = requests[i];
+            if (request == NULL) {
+                continue;
+            }
+            if (!ucg_request_is_inflight(request)) {
+                *index = i;
+                return request->status;
+            }
+            inflight = 1;
+        }
+        if (!inflight) {
+            return UCG_OK;
+        }
+        ucg_request_batch_progress(count, requests);
+    }
+}
+
 UCG_PROFILE_FUNC(ucg_status_t, ucg_request_cleanup, (request), ucg_request_h request)
 {
     UCG_CHECK_NULL_INVALID(request);
 
-    ucg_context_lock(request->group->context);
+    ucg_group_t *group = request->group;
+    /* Wait for ucg_group_progress() that may be still completing the request. */
+    ucg_group_lock(group);
 
     if (ucg_unlikely(request->status == UCG_INPROGRESS)) {
         ucg_error("Attempt to cleanup a in-progress request");
-        ucg_context_unlock(request->group->context);
+        ucg_group_unlock(group);
         return UCG_INPROGRESS;
     }
 
+    if (request->fusion != NULL) {
+        ucg_request_fusion_release(request->fusion);
+    }
+
     ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
+    ucg_context_t *context = group->context;
+    ucg_context_planc_lock(context);
     ucg_status_t status = op->discard(op);
-    ucg_context_unlock(request->group->context);
+    ucg_context_planc_unlock(context);
+    ucg_group_unlock(group);
     return status;
 }
 
@@ -500,6 +1330,31 @@ ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t si
         case UCG_COLL_TYPE_IREDUCE:
             *msize = ucg_dt_size(args->reduce.dt) * args->reduce.count;
             break;
+        case UCG_COLL_TYPE_REDUCE_SCATTER:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER:
+            /* The counts are the same on all processes, so is the total size. */
+            total_size = 0;
+            for (uint32_t i = 0; i < size; ++i) {
+                total_size += args->reduce_scatter.recvcounts[i];
+            }
+            *msize = ucg_dt_size(args->reduce_scatter.dt) * total_size;
+            break;
+        case UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK:
+            *msize = ucg_dt_size(args->reduce_scatter_block.dt) *
+                     args->reduce_scatter_block.recvcount * size;
+            break;
+        case UCG_COLL_TYPE_SCAN:
+        case UCG_COLL_TYPE_ISCAN:
+        case UCG_COLL_TYPE_EXSCAN:
+        case UCG_COLL_TYPE_IEXSCAN:
+            *msize = ucg_dt_size(args->scan.dt) * args->scan.count;
+            break;
+        case UCG_COLL_TYPE_ALLGATHER:
+        case UCG_COLL_TYPE_IALLGATHER:
+            /* The size of a block, so it's comparable with allgatherv. */
+            *msize = ucg_dt_size(args->allgather.recvtype) * args->allgather.recvcount;
+            break;
         default:
             return UCG_ERR_INVALID_PARAM;
     }
@@ -526,6 +1381,16 @@ const char* ucg_coll_type_string(ucg_coll_type_t coll_type)
             return "allgatherv";
         case UCG_COLL_TYPE_REDUCE:
             return "reduce";
+        case UCG_COLL_TYPE_REDUCE_SCATTER:
+            return "reduce_scatter";
+        case UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK:
+            return "reduce_scatter_block";
+        case UCG_COLL_TYPE_SCAN:
+            return "scan";
+        case UCG_COLL_TYPE_EXSCAN:
+            return "exscan";
+        case UCG_COLL_TYPE_ALLGATHER:
+            return "allgather";
         case UCG_COLL_TYPE_IBCAST:
             return "ibcast";
         case UCG_COLL_TYPE_IALLREDUCE:
@@ -542,6 +1407,16 @@ const char* ucg_coll_type_string(ucg_coll_type_t coll_type)
             return "iallgatherv";
         case UCG_COLL_TYPE_IREDUCE:
             return "ireduce";
+        case UCG_COLL_TYPE_IREDUCE_SCATTER:
+            return "ireduce_scatter";
+        case UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK:
+            return "ireduce_scatter_block";
+        case UCG_COLL_TYPE_ISCAN:
+            return "iscan";
+        case UCG_COLL_TYPE_IEXSCAN:
+            return "iexscan";
+        case UCG_COLL_TYPE_IALLGATHER:
+            return "iallgather";
         default:
             return "unknown";
     }
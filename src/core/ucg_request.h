@@ -12,6 +12,7 @@
 
 #include "util/ucg_class.h"
 #include "util/ucg_list.h"
+#include "util/ucg_mpsc_queue.h"
 
 /**
  * UCG P2P Request tag structure:
@@ -50,6 +51,11 @@ typedef enum {
     UCG_COLL_TYPE_GATHERV,
     UCG_COLL_TYPE_ALLGATHERV,
     UCG_COLL_TYPE_REDUCE,
+    UCG_COLL_TYPE_REDUCE_SCATTER,
+    UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK,
+    UCG_COLL_TYPE_SCAN,
+    UCG_COLL_TYPE_EXSCAN,
+    UCG_COLL_TYPE_ALLGATHER,
     UCG_COLL_TYPE_IBCAST,
     UCG_COLL_TYPE_IALLREDUCE,
     UCG_COLL_TYPE_IBARRIER,
@@ -58,6 +64,11 @@ typedef enum {
     UCG_COLL_TYPE_IGATHERV,
     UCG_COLL_TYPE_IALLGATHERV,
     UCG_COLL_TYPE_IREDUCE,
+    UCG_COLL_TYPE_IREDUCE_SCATTER,
+    UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK,
+    UCG_COLL_TYPE_ISCAN,
+    UCG_COLL_TYPE_IEXSCAN,
+    UCG_COLL_TYPE_IALLGATHER,
     UCG_COLL_TYPE_LAST,
 } ucg_coll_type_t;
 
@@ -121,6 +132,15 @@ typedef struct ucg_coll_allgatherv_args {
     ucg_dt_t *recvtype;
 } ucg_coll_allgatherv_args_t;
 
+typedef struct ucg_coll_allgather_args {
+    const void *sendbuf;
+    int32_t sendcount;
+    ucg_dt_t *sendtype;
+    void *recvbuf;
+    int32_t recvcount;
+    ucg_dt_t *recvtype;
+} ucg_coll_allgather_args_t;
+
 typedef struct ucg_coll_reduce_args {
     const void *sendbuf;
     void *recvbuf;
@@ -128,8 +148,41 @@ typedef struct ucg_coll_reduce_args {
     ucg_dt_t *dt;
     ucg_op_t *op;
     ucg_rank_t root;
+    /* Use only at the ucg_request_reduce_init(), not elsewhere. */
+    ucg_op_generic_t gop;
 } ucg_coll_reduce_args_t;
 
+typedef struct ucg_coll_reduce_scatter_args {
+    const void *sendbuf;
+    void *recvbuf;
+    const int32_t *recvcounts;
+    ucg_dt_t *dt;
+    ucg_op_t *op;
+    /* Use only at the ucg_request_reduce_scatter_init(), not elsewhere. */
+    ucg_op_generic_t gop;
+} ucg_coll_reduce_scatter_args_t;
+
+typedef struct ucg_coll_reduce_scatter_block_args {
+    const void *sendbuf;
+    void *recvbuf;
+    int32_t recvcount;
+    ucg_dt_t *dt;
+    ucg_op_t *op;
+    /* Use only at the ucg_request_reduce_scatter_block_init(), not elsewhere. */
+    ucg_op_generic_t gop;
+} ucg_coll_reduce_scatter_block_args_t;
+
+/* Scan and exscan have the same arguments. */
+typedef struct ucg_coll_scan_args {
+    const void *sendbuf;
+    void *recvbuf;
+    int32_t count;
+    ucg_dt_t *dt;
+    ucg_op_t *op;
+    /* Use only at the ucg_request_(ex)scan_init(), not elsewhere. */
+    ucg_op_generic_t gop;
+} ucg_coll_scan_args_t;
+
 typedef struct ucg_coll_args {
     ucg_coll_type_t type;
     ucg_request_info_t info;
@@ -141,20 +194,66 @@ typedef struct ucg_coll_args {
         ucg_coll_gatherv_args_t gatherv;
         ucg_coll_allgatherv_args_t allgatherv;
         ucg_coll_reduce_args_t reduce;
+        ucg_coll_reduce_scatter_args_t reduce_scatter;
+        ucg_coll_reduce_scatter_block_args_t reduce_scatter_block;
+        ucg_coll_scan_args_t scan;
+        ucg_coll_scan_args_t exscan;
+        ucg_coll_allgather_args_t allgather;
     };
 } ucg_coll_args_t;
 
+enum {
+    /** The request only makes progress after ucg_request_wakeup(), so it's
+        not progressed by ucg_progress() until then. Set by the planc. */
+    UCG_REQUEST_FLAG_WAKEUP = UCG_BIT(0),
+};
+
+typedef struct ucg_request_fusion ucg_request_fusion_t;
+
 typedef struct ucg_request {
     ucg_status_t status;
     ucg_coll_args_t args;
     ucg_group_t *group;
     ucg_list_link_t list; /* link to progress list */
+    ucg_mpsc_elem_t elem; /* link to pending or ready queue of the group */
+    /* The fused request carrying this one, see ucg_request_startall(). */
+    struct ucg_request *carrier;
+    /* The fusion kept for the next start, see ucg_request_startall(). */
+    ucg_request_fusion_t *fusion;
+    /* Timing of the candidate plan being tuned, see ucg_plan_tune.h */
+    ucg_plan_tune_stat_t *tune_stat;
+    uint64_t tune_start; /* ns, 0 if not started */
     int id;
-    char pending[16]; /* cacheline pending, `ucg_info -t` check struct size*/
+    uint8_t flags;
+    uint8_t woken; /* 0 only while waiting for ucg_request_wakeup() */
+    char pending[10]; /* fills the tail up to 8-byte alignment, `ucg_info -t` checks the size */
 } ucg_request_t;
 UCG_CLASS_DECLARE(ucg_request_t,
                   UCG_CLASS_CTOR_ARGS(const ucg_coll_args_t *arg));
 
+/**
+ * @brief Mark that the request can make progress.
+ *
+ * Requests with @ref UCG_REQUEST_FLAG_WAKEUP are progressed by ucg_progress()
+ * only after being woken up. It's cheap to call it more than needed, but a
+ * missing call hangs the request, so call it whenever the planc sees an event
+ * of the request, e.g. completion of a p2p operation.
+ *
+ * @note It must not run concurrently with the progress of the request, which
+ *       is guaranteed by the planc lock for non-thread-safe plancs.
+ */
+void ucg_request_wakeup(ucg_request_t *request);
+
+/**
+ * @brief Whether the calling thread is progressing a batch of requests.
+ *
+ * ucg_request_testall() and ucg_request_waitany() progress the plancs once
+ * for the whole batch before progressing the requests, so the progress of a
+ * request only needs to check its completions instead of polling the
+ * transport again.
+ */
+int ucg_request_in_batch(void);
+
 ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t size,
                                   uint64_t *msize);
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "ucg_topo.h"
@@ -28,21 +28,103 @@ static int32_t ucg_topo_is_self(const ucg_topo_t *topo,
     return group_rank == topo->myrank;
 }
 
+static void ucg_topo_snapshot_get(const ucg_topo_snapshot_t *snapshot,
+                                  ucg_rank_t group_rank, ucg_location_t *location)
+{
+    location->field_mask = snapshot->field_mask;
+    location->subnet_id = snapshot->subnet_id[group_rank];
+    location->node_id = snapshot->node_id[group_rank];
+    location->socket_id = snapshot->socket_id[group_rank];
+    return;
+}
+
 /* The rank_map is a vgroup rank to group rank mapping table. */
-static ucg_status_t ucg_topo_get_location(const ucg_topo_t *topo,
-                                          const ucg_rank_map_t *rank_map,
-                                          ucg_rank_t rank,
-                                          ucg_location_t *location)
+static void ucg_topo_get_location(const ucg_topo_t *topo,
+                                  const ucg_rank_map_t *rank_map,
+                                  ucg_rank_t rank,
+                                  ucg_location_t *location)
 {
     ucg_rank_t group_rank = ucg_rank_map_eval(rank_map, rank);
     ucg_assert(group_rank != UCG_INVALID_RANK);
+    ucg_topo_snapshot_get(topo->snapshot, group_rank, location);
+    return;
+}
 
-    ucg_status_t status = topo->get_location(topo->group, group_rank, location);
-    if (status != UCG_OK) {
-        ucg_error("Failed to get location of group rank %d", group_rank);
+typedef struct ucg_topo_snapshot_arg {
+    ucg_group_t *group;
+    ucg_topo_get_location_cb_t get_location;
+} ucg_topo_snapshot_arg_t;
+
+static ucg_status_t ucg_topo_snapshot_init(const ucg_rank_map_t *map, void *arg, void **obj)
+{
+    ucg_topo_snapshot_arg_t *snapshot_arg = (ucg_topo_snapshot_arg_t*)arg;
+    uint32_t size = map->size;
+    /* One allocation for the snapshot and all the arrays, the int16_t one is the last. */
+    size_t id_size = size * sizeof(int32_t);
+    uint8_t *ids = ucg_malloc(sizeof(ucg_topo_snapshot_t) + 2 * id_size +
+                              size * sizeof(int16_t), "topo snapshot");
+    if (ids == NULL) {
+        return UCG_ERR_NO_MEMORY;
     }
+    ucg_topo_snapshot_t *snapshot = (ucg_topo_snapshot_t*)ids;
+    ids += sizeof(ucg_topo_snapshot_t);
+    snapshot->subnet_id = (int32_t*)ids;
+    snapshot->node_id = (int32_t*)(ids + id_size);
+    snapshot->socket_id = (int16_t*)(ids + 2 * id_size);
+    snapshot->field_mask = UCG_LOCATION_FIELD_SUBNET_ID |
+                           UCG_LOCATION_FIELD_NODE_ID |
+                           UCG_LOCATION_FIELD_SOCKET_ID;
 
-    return status;
+    for (uint32_t i = 0; i < size; ++i) {
+        ucg_location_t location;
+        ucg_status_t status = snapshot_arg->get_location(snapshot_arg->group, i, &location);
+        if (status != UCG_OK) {
+            ucg_error("Failed to get location of group rank %d", i);
+            ucg_free(snapshot);
+            return status;
+        }
+        snapshot->field_mask &= location.field_mask;
+        snapshot->subnet_id[i] = location.subnet_id;
+        snapshot->node_id[i] = location.node_id;
+        snapshot->socket_id[i] = location.socket_id;
+    }
+    *obj = snapshot;
+    return UCG_OK;
+}
+
+static void ucg_topo_snapshot_cleanup(void *obj)
+{
+    ucg_free(obj);
+    return;
+}
+
+/**
+ * The locations only depend on the context ranks of the group, so the snapshot
+ * is shared by the topologies of the same rank-map through the pool.
+ */
+static const ucg_rank_map_pool_obj_ops_t ucg_topo_snapshot_ops = {
+    .init = ucg_topo_snapshot_init,
+    .cleanup = ucg_topo_snapshot_cleanup,
+};
+
+static ucg_status_t ucg_topo_init_snapshot(ucg_topo_t *topo,
+                                           ucg_topo_get_location_cb_t get_location)
+{
+    ucg_topo_snapshot_arg_t arg = {
+        .group = topo->group,
+        .get_location = get_location,
+    };
+    return ucg_rank_map_pool_get_obj(topo->rank_map_pool, &topo->rank_map,
+                                     &ucg_topo_snapshot_ops, &arg,
+                                     (void**)&topo->snapshot);
+}
+
+static void ucg_topo_cleanup_snapshot(ucg_topo_t *topo)
+{
+    ucg_rank_map_pool_put_obj(topo->rank_map_pool, &topo->rank_map,
+                              &ucg_topo_snapshot_ops, (void*)topo->snapshot);
+    topo->snapshot = NULL;
+    return;
 }
 
 static ucg_status_t ucg_topo_group_aux_init_empty(void **aux)
@@ -264,7 +346,7 @@ static ucg_topo_group_aux_t ucg_topo_group_aid[] = {
     },
     [UCG_TOPO_GROUP_TYPE_SUBNET_LEADER] = {
         .init = ucg_topo_group_aux_init_leader_filter,
-        .cleanup = ucg_topo_group_aux_cleanup_empty,
+        .cleanup = ucg_topo_group_aux_cleanup_leader_filter,
         .check = ucg_topo_group_aux_check_subnet_id,
         .is_member = ucg_topo_group_aux_is_subnet_leader,
         .add_member = ucg_topo_group_aux_add_subnet_leader,
@@ -331,10 +413,7 @@ static ucg_status_t ucg_topo_create_group(ucg_topo_t *topo,
     uint32_t group_size = rank_map->size;
     for (uint32_t i = 0; i < group_size; ++i) {
         ucg_location_t location;
-        status = ucg_topo_get_location(topo, rank_map, i, &location);
-        if (ucg_unlikely(status != UCG_OK)) {
-            goto err_group;
-        }
+        ucg_topo_get_location(topo, rank_map, i, &location);
         // check prerequisites
         status = aid->check(&aux, &location);
         if (ucg_unlikely(status != UCG_OK)) {
@@ -373,10 +452,12 @@ static ucg_status_t ucg_topo_create_group(ucg_topo_t *topo,
         ucg_free(ranks);
     } else {
         group->state = UCG_TOPO_GROUP_STATE_ENABLE;
-        status = ucg_rank_map_init_by_array(&group->super.rank_map, &ranks, vrank, 1);
+        status = ucg_rank_map_pool_init_by_array(topo->rank_map_pool, &group->super.rank_map,
+                                                 &ranks, vrank, 1);
         if (status != UCG_OK) {
             goto err_cleanup_aux;
         }
+        ucg_vgroup_init_ctx_rank_map(&group->super, topo->rank_map_pool, &topo->rank_map);
     }
 
     aid->cleanup(&aux);
@@ -392,10 +473,11 @@ err_free_ranks:
     return status;
 }
 
-static void ucg_topo_group_cleanup(ucg_topo_group_t *group)
+static void ucg_topo_group_cleanup(ucg_topo_t *topo, ucg_topo_group_t *group)
 {
     if (group->state == UCG_TOPO_GROUP_STATE_ENABLE) {
-        ucg_rank_map_cleanup(&group->super.rank_map);
+        ucg_vgroup_cleanup_ctx_rank_map(&group->super, topo->rank_map_pool);
+        ucg_rank_map_pool_release(topo->rank_map_pool, &group->super.rank_map);
     }
     return;
 }
@@ -454,34 +536,19 @@ static ucg_status_t ucg_topo_create_socket_leader_group(ucg_topo_t *topo)
     return ucg_topo_create_group(topo, &node_group->super.rank_map, UCG_TOPO_GROUP_TYPE_SOCKET_LEADER);
 }
 
-static ucg_status_t ucg_topo_fill_id_hash(ucg_topo_t *topo,
-                                          ucg_hash_t(ID) *hash,
-                                          ucg_topo_loc_flag_t flags)
+/* The ids start from 0 in order of the first appearance. */
+static int32_t ucg_topo_normalize_id(ucg_hash_t(ID) *hash, int key, int *is_new)
 {
-    ucg_status_t status;
-    uint32_t size = topo->group->size;
-    for (int i = 0; i < size; ++i) {
-        ucg_location_t location;
-        status = topo->get_location(topo->group, i, &location);
-        if (status != UCG_OK) {
-            return status;
-        }
-        int ret;
-        int key;
-        if (flags & UCG_TOPO_LOC_NODE_ID && location.field_mask & UCG_LOCATION_FIELD_NODE_ID) {
-            key = location.node_id;
-        } else if (flags & UCG_TOPO_LOC_SOCKET_ID && location.field_mask & UCG_LOCATION_FIELD_SOCKET_ID) {
-            key = location.socket_id;
-        } else {
-            continue;
-        }
-        ucg_hiter_t iter = ucg_hash_put(ID, hash, key, &ret);
-        if (ret == UCG_HASH_PUT_BUCKET_EMPTY || ret == UCG_HASH_PUT_BUCKET_CLEAR) {
-            /* do not override previous values */
-            ucg_hash_value(hash, iter) = ucg_hash_size(hash) - 1;
-        }
+    int ret;
+    ucg_hiter_t iter = ucg_hash_put(ID, hash, key, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        return -1;
     }
-    return UCG_OK;
+    *is_new = ret == UCG_HASH_PUT_BUCKET_EMPTY || ret == UCG_HASH_PUT_BUCKET_CLEAR;
+    if (*is_new) {
+        ucg_hash_value(hash, iter) = ucg_hash_size(hash) - 1;
+    }
+    return ucg_hash_value(hash, iter);
 }
 
 static ucg_status_t ucg_topo_init_detail(ucg_topo_t *topo)
@@ -490,74 +557,61 @@ static ucg_status_t ucg_topo_init_detail(ucg_topo_t *topo)
     ucg_group_t *group = topo->group;
     ucg_assert(group != NULL);
     ucg_topo_detail_t *detail = &topo->detail;
-
-    ucg_hash_t(ID) *node_hash = ucg_hash_init(ID);
-    status = ucg_topo_fill_id_hash(topo, node_hash, UCG_TOPO_LOC_NODE_ID);
-    if (status != UCG_OK) {
-        return status;
-    }
-    detail->nnode = ucg_hash_size(node_hash);
-
-    ucg_hash_t(ID) *socket_hash = ucg_hash_init(ID);
-    status = ucg_topo_fill_id_hash(topo, socket_hash, UCG_TOPO_LOC_SOCKET_ID);
-    if (status != UCG_OK) {
-        return status;
-    }
-    detail->nsocket = ucg_hash_size(socket_hash);
-    ucg_debug("total number of node is %d, total number of socket in a node is %d",
-              detail->nnode, detail->nsocket);
+    const ucg_topo_snapshot_t *snapshot = topo->snapshot;
+    int has_node_id = snapshot->field_mask & UCG_LOCATION_FIELD_NODE_ID;
+    int has_socket_id = snapshot->field_mask & UCG_LOCATION_FIELD_SOCKET_ID;
 
     int32_t group_size = group->size;
     ucg_topo_location_t *locations;
-    locations = ucg_malloc(group_size * sizeof(ucg_topo_location_t), "topo detail locations");
+    locations = ucg_calloc(group_size, sizeof(ucg_topo_location_t), "topo detail locations");
     if (locations == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
-    ucg_hiter_t iter;
-    for (int i = 0; i < group_size; ++i) {
-        ucg_location_t location;
-        status = topo->get_location(group, i, &location);
-        if (status != UCG_OK) {
-            goto err_free_locations;
-        }
-        if (location.field_mask & UCG_LOCATION_FIELD_NODE_ID) {
-            iter = ucg_hash_get(ID, node_hash, location.node_id);
-            locations[i].node_id = ucg_hash_value(node_hash, iter);
-        }
-        if (location.field_mask & UCG_LOCATION_FIELD_SOCKET_ID) {
-            iter = ucg_hash_get(ID, socket_hash, location.socket_id);
-            locations[i].socket_id = ucg_hash_value(socket_hash, iter);
-        }
-    }
-    detail->locations = locations;
 
-    ucg_hash_t(ID) *tmp_node_hash = ucg_hash_init(ID);
-    int last_node_id = -1;
+    ucg_hash_t(ID) node_hash;
+    ucg_hash_t(ID) socket_hash;
+    ucg_hash_init_inplace(ID, &node_hash);
+    ucg_hash_init_inplace(ID, &socket_hash);
+    /* The ranks of a node are continuous if no node is left and then back. */
+    int32_t last_node_id = -1;
     detail->nrank_continuous = 1;
     for (int i = 0; i < group_size; ++i) {
-        ucg_location_t location;
-        status = topo->get_location(group, i, &location);
-        if (status != UCG_OK) {
-            goto err_free_locations;
+        int is_new;
+        if (has_node_id) {
+            int32_t node_id = ucg_topo_normalize_id(&node_hash, snapshot->node_id[i], &is_new);
+            if (node_id < 0) {
+                status = UCG_ERR_NO_MEMORY;
+                goto err_free_locations;
+            }
+            if (!is_new && node_id != last_node_id) {
+                detail->nrank_continuous = 0;
+            }
+            locations[i].node_id = node_id;
+            last_node_id = node_id;
         }
-        int ret;
-        int key = location.node_id;
-        iter = ucg_hash_get(ID, tmp_node_hash, key);
-        if (iter == ucg_hash_end(tmp_node_hash)) {
-            iter = ucg_hash_put(ID, tmp_node_hash, key, &ret);
-        } else if (key != last_node_id) {
-            detail->nrank_continuous = 0;
-            break;
+        if (has_socket_id) {
+            locations[i].socket_id = ucg_topo_normalize_id(&socket_hash,
+                                                           snapshot->socket_id[i],
+                                                           &is_new);
+            if (locations[i].socket_id < 0) {
+                status = UCG_ERR_NO_MEMORY;
+                goto err_free_locations;
+            }
         }
-        last_node_id = key;
     }
+    detail->nnode = ucg_hash_size(&node_hash);
+    detail->nsocket = ucg_hash_size(&socket_hash);
+    ucg_debug("total number of node is %d, total number of socket in a node is %d",
+              detail->nnode, detail->nsocket);
+    detail->locations = locations;
 
-    ucg_hash_cleanup(ID, tmp_node_hash);
-    ucg_hash_cleanup(ID, node_hash);
-    ucg_hash_cleanup(ID, socket_hash);
+    ucg_hash_cleanup_inplace(ID, &node_hash);
+    ucg_hash_cleanup_inplace(ID, &socket_hash);
     return UCG_OK;
 
 err_free_locations:
+    ucg_hash_cleanup_inplace(ID, &node_hash);
+    ucg_hash_cleanup_inplace(ID, &socket_hash);
     ucg_free(locations);
     return status;
 }
@@ -615,7 +669,8 @@ static ucg_status_t ucg_topo_calc_pps(ucg_topo_t *topo)
     int32_t nnode = detail->nnode;
     int32_t nsocket = detail->nsocket;
 
-    if (nsocket == 0) {
+    /* The sockets are counted per node. */
+    if (nnode == 0 || nsocket == 0) {
         topo->pps = UCG_TOPO_PPX_UNKNOWN;
         return UCG_OK;
     }
@@ -680,32 +735,39 @@ ucg_status_t ucg_topo_init(const ucg_topo_params_t *params, ucg_topo_t **topo)
     }
     new_topo->group = group;
     new_topo->myrank = params->myrank;
-    status = ucg_rank_map_copy(&new_topo->rank_map, params->rank_map);
+    new_topo->rank_map_pool = params->rank_map_pool;
+    status = ucg_rank_map_pool_copy(new_topo->rank_map_pool, &new_topo->rank_map,
+                                    params->rank_map);
     if (status != UCG_OK) {
         goto err_free_topo;
     }
 
-    new_topo->get_location = params->get_location;
-    status = new_topo->get_location(new_topo->group, new_topo->myrank, &new_topo->myloc);
+    /* Fetch all the locations once, the callback may be costly. */
+    status = ucg_topo_init_snapshot(new_topo, params->get_location);
     if (status != UCG_OK) {
         goto err_free_rank_map;
     }
+    ucg_topo_snapshot_get(new_topo->snapshot, new_topo->myrank, &new_topo->myloc);
 
     status = ucg_topo_init_detail(new_topo);
     if (status != UCG_OK) {
-        goto err_free_rank_map;
+        goto err_cleanup_snapshot;
     }
 
     status = ucg_topo_calc_ppx(new_topo);
     if (status != UCG_OK) {
-        goto err_free_rank_map;
+        goto err_cleanup_detail;
     }
 
     *topo = new_topo;
     return UCG_OK;
 
+err_cleanup_detail:
+    ucg_topo_cleanup_detail(new_topo);
+err_cleanup_snapshot:
+    ucg_topo_cleanup_snapshot(new_topo);
 err_free_rank_map:
-    ucg_rank_map_cleanup(&new_topo->rank_map);
+    ucg_rank_map_pool_release(new_topo->rank_map_pool, &new_topo->rank_map);
 err_free_topo:
     ucg_free(new_topo);
     return status;
@@ -716,9 +778,11 @@ void ucg_topo_cleanup(ucg_topo_t *topo)
     UCG_CHECK_NULL_VOID(topo);
 
     ucg_topo_cleanup_detail(topo);
+    ucg_topo_cleanup_snapshot(topo);
     for (int i = 0; i < UCG_TOPO_GROUP_TYPE_LAST; ++i) {
-        ucg_topo_group_cleanup(&topo->groups[i]);
+        ucg_topo_group_cleanup(topo, &topo->groups[i]);
     }
+    ucg_rank_map_pool_release(topo->rank_map_pool, &topo->rank_map);
     ucg_free(topo);
     return;
 }
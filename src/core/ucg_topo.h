@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_TOPO_H_
@@ -8,6 +8,7 @@
 #include "ucg/api/ucg.h"
 
 #include "ucg_vgroup.h"
+#include "ucg_rank_map.h"
 #include "util/ucg_hash.h"
 
 /**
@@ -65,6 +66,8 @@ typedef struct ucg_topo_params {
     ucg_rank_t myrank;
     /** Convert group rank to context rank. */
     const ucg_rank_map_t *rank_map;
+    /** Pool of the rank-maps, NULL for not sharing them. */
+    ucg_rank_map_pool_t *rank_map_pool;
     /** Get location callback */
     ucg_topo_get_location_cb_t get_location;
 } ucg_topo_params_t;
@@ -83,6 +86,22 @@ typedef struct ucg_topo_location {
     int32_t socket_id;
 } ucg_topo_location_t;
 
+/**
+ * @brief Locations of all the group ranks
+ *
+ * It's fetched by one pass of the get location callback when the topology is
+ * initialized, then the topo-groups and the details are derived from it. It's
+ * read-only and shared by the topologies of the same ranks.
+ */
+typedef struct ucg_topo_snapshot {
+    /** Fields that all the ranks have, using bits from @ref ucg_location_field_t */
+    uint64_t field_mask;
+    /* The length of the arrays is the size of the group */
+    int32_t *subnet_id;
+    int32_t *node_id;
+    int16_t *socket_id;
+} ucg_topo_snapshot_t;
+
 typedef struct ucg_topo_detail {
     int32_t nnode;
     int32_t nsocket;
@@ -103,8 +122,10 @@ typedef struct ucg_topo {
     ucg_rank_t myrank;
     /** Convert group rank to context rank. */
     ucg_rank_map_t rank_map;
-    /** Get location callback. */
-    ucg_topo_get_location_cb_t get_location;
+    /** Pool of the rank-maps of the topology and the topo-groups. */
+    ucg_rank_map_pool_t *rank_map_pool;
+    /** Locations of all the ranks, shared through @ref ucg_topo_t::rank_map_pool. */
+    const ucg_topo_snapshot_t *snapshot;
     /** My location. */
     ucg_location_t myloc;
     /** Detail topo info. */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "ucg_vgroup.h"
+
+#include "util/ucg_log.h"
+
+void ucg_vgroup_init_ctx_rank_map(ucg_vgroup_t *vgroup, ucg_rank_map_pool_t *pool,
+                                  const ucg_rank_map_t *group_map)
+{
+    ucg_status_t status = ucg_rank_map_pool_compose(pool, &vgroup->ctx_rank_map,
+                                                    &vgroup->rank_map, group_map);
+    if (status != UCG_OK) {
+        ucg_debug("Failed to compose the context rank-map, %s", ucg_status_string(status));
+        vgroup->ctx_rank_map.type = UCG_RANK_MAP_TYPE_FULL;
+        vgroup->ctx_rank_map.size = 0;
+    }
+    return;
+}
+
+void ucg_vgroup_cleanup_ctx_rank_map(ucg_vgroup_t *vgroup, ucg_rank_map_pool_t *pool)
+{
+    if (vgroup->ctx_rank_map.size != 0) {
+        ucg_rank_map_pool_release(pool, &vgroup->ctx_rank_map);
+    }
+    vgroup->ctx_rank_map.type = UCG_RANK_MAP_TYPE_FULL;
+    vgroup->ctx_rank_map.size = 0;
+    return;
+}
@@ -1,11 +1,12 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_VGROUP_H_
 #define UCG_VGROUP_H_
 
 #include "ucg_def.h"
+#include "ucg_rank_map.h"
 
 /**
  * @brief Virtual group
@@ -19,8 +20,33 @@ typedef struct ucg_vgroup {
     uint32_t size;
     /** Convert vgroup rank to group rank. */
     ucg_rank_map_t rank_map;
+    /**
+     * Convert vgroup rank to context rank, which is @ref rank_map composed with
+     * the rank-map of the group. Its size is 0 if it's not built, then both of
+     * the rank-maps are evaluated.
+     */
+    ucg_rank_map_t ctx_rank_map;
     /** Original group. */
     ucg_group_t *group;
 } ucg_vgroup_t;
 
+/**
+ * @brief Build the rank-map from vgroup rank to context rank.
+ *
+ * It's called after @ref ucg_vgroup_t::rank_map is initialized, so that the
+ * conversion to the context rank, e.g. to find the endpoint of a peer, costs
+ * one rank-map evaluation. It's an optimization, nothing is built if it fails.
+ *
+ * @param [in] vgroup       Virtual group.
+ * @param [in] pool         Rank-map pool, may be NULL.
+ * @param [in] group_map    Rank-map from group rank to context rank.
+ */
+void ucg_vgroup_init_ctx_rank_map(ucg_vgroup_t *vgroup, ucg_rank_map_pool_t *pool,
+                                  const ucg_rank_map_t *group_map);
+
+/**
+ * @brief Cleanup the rank-map from @ref ucg_vgroup_init_ctx_rank_map.
+ */
+void ucg_vgroup_cleanup_ctx_rank_map(ucg_vgroup_t *vgroup, ucg_rank_map_pool_t *pool);
+
 #endif
\ No newline at end of file
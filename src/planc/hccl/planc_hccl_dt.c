@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "planc_hccl_dt.h"
@@ -17,6 +17,12 @@ HcclDataType ucg_planc_hccl_dt_table[UCG_DT_TYPE_PREDEFINED_LAST] = {
     [UCG_DT_TYPE_FP16] = HCCL_DATA_TYPE_FP16,
     [UCG_DT_TYPE_FP32] = HCCL_DATA_TYPE_FP32,
     [UCG_DT_TYPE_FP64] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_BF16] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_FP32_INT32] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_FP64_INT32] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_INT16_INT32] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_INT32_INT32] = HCCL_DATA_TYPE_RESERVED,
+    [UCG_DT_TYPE_INT64_INT32] = HCCL_DATA_TYPE_RESERVED,
 };
 
 HcclReduceOp ucg_planc_hccl_op_table[UCG_OP_TYPE_PREDEFINED_LAST] = {
@@ -24,6 +30,14 @@ HcclReduceOp ucg_planc_hccl_op_table[UCG_OP_TYPE_PREDEFINED_LAST] = {
     [UCG_OP_TYPE_MIN] = HCCL_REDUCE_MIN,
     [UCG_OP_TYPE_SUM] = HCCL_REDUCE_SUM,
     [UCG_OP_TYPE_PROD] = HCCL_REDUCE_PROD,
+    [UCG_OP_TYPE_LAND] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_LOR] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_LXOR] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_BAND] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_BOR] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_BXOR] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_MAXLOC] = HCCL_REDUCE_RESERVED,
+    [UCG_OP_TYPE_MINLOC] = HCCL_REDUCE_RESERVED,
 };
 
 int ucg_planc_hccl_dt_size_table[HCCL_DATA_TYPE_RESERVED] = {
@@ -80,11 +80,15 @@ static ucg_status_t ucg_planc_group_ctor(ucg_planc_group_t *self, ucg_group_t *g
     self->super.rank_map.type = UCG_RANK_MAP_TYPE_FULL;
     self->super.rank_map.size = group->size;
     self->super.group = group;
+    ucg_vgroup_init_ctx_rank_map(&self->super, group->context->rank_map_pool,
+                                 &group->rank_map);
     return UCG_OK;
 }
 
 static void ucg_planc_group_dtor(ucg_planc_group_t *self)
 {
+    ucg_group_t *group = self->super.group;
+    ucg_vgroup_cleanup_ctx_rank_map(&self->super, group->context->rank_map_pool);
     return;
 }
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allgather.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_global.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+#define PLAN_DOMAIN "planc ucx allgather"
+
+static ucg_plan_attr_t ucg_planc_ucx_allgather_plan_attr[] = {
+    {ucg_planc_ucx_allgather_rd_prepare,
+     1, "Recursive doubling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {ucg_planc_ucx_allgather_bruck_prepare,
+     2, "Bruck", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_BRUCK},
+
+    {ucg_planc_ucx_allgather_na_prepare,
+     3, "Node-aware leader", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {ucg_planc_ucx_allgather_ring_prepare,
+     4, "Ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
+
+    {NULL},
+};
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_ALLGATHER,
+                             ucg_planc_ucx_allgather_plan_attr);
+
+static ucg_config_field_t allgather_config_table[] = {
+    {"ALLGATHER_NA_BCAST_DEGREE", "4",
+     "Configure the k value of the tree broadcasting the gathered data of a node "
+     "in node-aware algo for allgather",
+     ucg_offsetof(ucg_planc_ucx_allgather_config_t, na_bcast_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_ALLGATHER, allgather_config_table,
+                                    sizeof(ucg_planc_ucx_allgather_config_t))
+
+/**
+ * The message size is the size of a block. Small blocks are bound by latency,
+ * recursive doubling only supports power of two groups and Bruck is the
+ * fallback. Large blocks go around the ring, which is bandwidth optimal.
+ */
+static ucg_plan_policy_t allgather_default[] = {
+    {1,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {4,  {4096, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {2,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+
+    {4,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t allgather_na[] = {
+    {3,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {4,  {4096, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {1,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+
+    {2,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_allgather_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                 ucg_planc_ucx_ppn_level_t ppn_level)
+{
+    UCG_UNUSED(node_level);
+    ucg_plan_policy_t *policy = (ppn_level == PPN_LEVEL_1) ? allgather_default : allgather_na;
+    return policy;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_check(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                           int32_t max_blocks)
+{
+    const ucg_coll_allgather_args_t *allgather = &args->allgather;
+    if (allgather->recvcount < 0 ||
+        (allgather->sendbuf != UCG_IN_PLACE && allgather->sendcount < 0)) {
+        ucg_error("Invalid sendcount %d or recvcount %d",
+                  allgather->sendcount, allgather->recvcount);
+        return UCG_ERR_INVALID_PARAM;
+    }
+    /* A message carries up to max_blocks blocks of recvcount elements. */
+    if ((int64_t)allgather->recvcount * ucg_min(max_blocks, (int32_t)vgroup->size) > INT32_MAX) {
+        ucg_info("Allgather of %d blocks of %d elements is too large",
+                 max_blocks, allgather->recvcount);
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+void ucg_planc_ucx_allgather_op_init(ucg_planc_ucx_op_t *op)
+{
+    const ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    op->allgather.block_extent = (int64_t)args->recvcount * ucg_dt_extent(args->recvtype);
+    return;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_copy_own(ucg_planc_ucx_op_t *op)
+{
+    const ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    if (args->sendbuf == UCG_IN_PLACE) {
+        return UCG_OK;
+    }
+    void *block = ucg_planc_ucx_allgather_block(args, op->allgather.block_extent,
+                                                op->super.vgroup->myrank);
+    return ucg_dt_memcpy(block, args->recvcount, args->recvtype,
+                         args->sendbuf, args->sendcount, args->sendtype);
+}
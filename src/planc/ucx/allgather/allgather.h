@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_ALLGATHER_H_
+#define UCG_PLANC_UCX_ALLGATHER_H_
+
+#include "planc/ucx/planc_ucx_def.h"
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_dt.h"
+#include "util/algo/ucg_ring.h"
+#include "util/algo/ucg_kntree.h"
+
+typedef struct ucg_planc_ucx_allgather_config {
+    /* k value of the tree broadcasting the gathered data in a node */
+    int na_bcast_degree;
+} ucg_planc_ucx_allgather_config_t;
+
+/**
+ * @brief Allgather op auxiliary information
+ *
+ * All blocks have the same size, the block of rank i starts at i * block_extent
+ * of recvbuf, so a range of blocks is a single message of recvtype and no count
+ * or displacement array is needed.
+ */
+typedef struct ucg_planc_ucx_allgather {
+    int64_t block_extent;
+    union {
+        /* Recursive doubling and Bruck, 2^k of step k */
+        int32_t distance;
+        ucg_algo_ring_iter_t ring_iter;
+        struct {
+            /* Broadcast the gathered data from the leader in my node. */
+            ucg_algo_kntree_iter_t bcast;
+            /* The first rank of every node and the group size at the end. */
+            ucg_rank_t *node_start;
+            int32_t nnode;
+            int32_t mynode;
+            int32_t nlocal;
+        } na;
+    };
+} ucg_planc_ucx_allgather_t;
+
+static inline void *ucg_planc_ucx_allgather_block(const ucg_coll_allgather_args_t *args,
+                                                  int64_t block_extent, ucg_rank_t rank)
+{
+    return (uint8_t*)args->recvbuf + rank * block_extent;
+}
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_allgather_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                 ucg_planc_ucx_ppn_level_t ppn_level);
+
+/* Common routines of the allgather algorithms */
+ucg_status_t ucg_planc_ucx_allgather_check(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                           int32_t max_blocks);
+void ucg_planc_ucx_allgather_op_init(ucg_planc_ucx_op_t *op);
+ucg_status_t ucg_planc_ucx_allgather_copy_own(ucg_planc_ucx_op_t *op);
+
+/* xxx_prepare routines are provided for core layer to creat collective request */
+ucg_status_t ucg_planc_ucx_allgather_rd_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_allgather_bruck_prepare(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_args_t *args,
+                                                   ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_allgather_na_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_allgather_ring_prepare(ucg_vgroup_t *vgroup,
+                                                  const ucg_coll_args_t *args,
+                                                  ucg_plan_op_t **op);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allgather.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Bruck allgather
+ *
+ * The blocks are gathered in the staging area in the order of the distance to
+ * me, my block is at 0. At step k, a rank sends its first min(2^k, n - 2^k)
+ * blocks to (rank - 2^k) and receives the same number of blocks from
+ * (rank + 2^k) right after them, so there are ceil(log2(n)) steps of one
+ * message for any group size. At the end, the blocks are rotated into recvbuf
+ * by two copies.
+ */
+
+enum {
+    UCG_ALLGATHER_BRUCK_POST = UCG_BIT(0),
+    UCG_ALLGATHER_BRUCK_ROTATE = UCG_BIT(1),
+};
+
+#define UCG_ALLGATHER_BRUCK_FLAGS UCG_ALLGATHER_BRUCK_POST | UCG_ALLGATHER_BRUCK_ROTATE
+
+static inline uint8_t *ucg_planc_ucx_allgather_bruck_tmp(ucg_planc_ucx_op_t *op)
+{
+    return (uint8_t*)op->staging_area - op->super.super.args.allgather.recvtype->true_lb;
+}
+
+/* Block j of the staging area is the block of rank (myrank + j) % n. */
+static ucg_status_t ucg_planc_ucx_allgather_bruck_rotate(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status;
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+    uint32_t group_size = op->super.vgroup->size;
+    int64_t block_extent = op->allgather.block_extent;
+    uint8_t *tmp = ucg_planc_ucx_allgather_bruck_tmp(op);
+
+    int32_t count = (group_size - myrank) * args->recvcount;
+    status = ucg_dt_memcpy(ucg_planc_ucx_allgather_block(args, block_extent, myrank),
+                           count, args->recvtype, tmp, count, args->recvtype);
+    if (status != UCG_OK || myrank == 0) {
+        return status;
+    }
+    tmp += (group_size - myrank) * block_extent;
+    count = myrank * args->recvcount;
+    return ucg_dt_memcpy(args->recvbuf, count, args->recvtype, tmp, count, args->recvtype);
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_bruck_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t group_size = vgroup->size;
+    uint8_t *tmp = ucg_planc_ucx_allgather_bruck_tmp(op);
+    int32_t *distance = &op->allgather.distance;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (*distance < group_size) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_BRUCK_POST)) {
+            ucg_rank_t sendto = (myrank - *distance + group_size) % group_size;
+            ucg_rank_t recvfrom = (myrank + *distance) % group_size;
+            int32_t count = ucg_min(*distance, group_size - *distance) * args->recvcount;
+            status = ucg_planc_ucx_p2p_isend(tmp, count, args->recvtype, sendto,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            status = ucg_planc_ucx_p2p_irecv(tmp + *distance * op->allgather.block_extent,
+                                             count, args->recvtype, recvfrom,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        *distance <<= 1;
+        op->flags |= UCG_ALLGATHER_BRUCK_POST;
+    }
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_BRUCK_ROTATE)) {
+        status = ucg_planc_ucx_allgather_bruck_rotate(op);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_bruck_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+
+    ucg_planc_ucx_op_reset(op);
+    if (args->recvcount == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    /* My block is the first one of the staging area. */
+    uint8_t *tmp = ucg_planc_ucx_allgather_bruck_tmp(op);
+    if (args->sendbuf == UCG_IN_PLACE) {
+        void *block = ucg_planc_ucx_allgather_block(args, op->allgather.block_extent,
+                                                    op->super.vgroup->myrank);
+        status = ucg_dt_memcpy(tmp, args->recvcount, args->recvtype,
+                               block, args->recvcount, args->recvtype);
+    } else {
+        status = ucg_dt_memcpy(tmp, args->recvcount, args->recvtype,
+                               args->sendbuf, args->sendcount, args->sendtype);
+    }
+    if (status != UCG_OK) {
+        return status;
+    }
+    op->flags = UCG_ALLGATHER_BRUCK_FLAGS;
+    op->allgather.distance = 1;
+
+    status = ucg_planc_ucx_allgather_bruck_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_bruck_op_init(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_dt_t *dt = args->recvtype;
+    int64_t count = (int64_t)args->recvcount * op->super.vgroup->size;
+
+    ucg_planc_ucx_allgather_op_init(op);
+    if (count == 0) {
+        return UCG_OK;
+    }
+    /* Bytes spanned by the blocks of all ranks */
+    int64_t span = dt->true_extent + dt->extent * (count - 1);
+    return ucg_planc_ucx_op_get_staging(op, span, 0, NULL);
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_allgather_bruck_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                                ucg_vgroup_t *vgroup,
+                                                                const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_allgather_bruck_op_trigger,
+                                 ucg_planc_ucx_allgather_bruck_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_allgather_bruck_op_init(ucx_op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize allgather bruck ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_bruck_prepare(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_args_t *args,
+                                                   ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    /* The rotation copies all the blocks but mine at once. */
+    ucg_status_t status = ucg_planc_ucx_allgather_check(vgroup, args, vgroup->size);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allgather_bruck_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allgather.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Node-aware leader allgather
+ *
+ * 1. The first rank of every node is the leader, the other ranks of the node
+ *    send their blocks to it. The blocks of a node are contiguous in recvbuf,
+ *    so the leader holds the blocks of its node as one message then.
+ * 2. Every leader exchanges the blocks of its node with all other leaders at
+ *    once, only one message per pair of nodes goes through the network.
+ * 3. The leader broadcasts recvbuf to the ranks of its node by a k-nomial tree.
+ *
+ * Every node must hold a range of ranks.
+ */
+
+/* op flags needed by node-aware allgather. */
+enum {
+    UCG_ALLGATHER_NA_GATHER = UCG_BIT(0),
+    UCG_ALLGATHER_NA_GATHER_POST = UCG_BIT(1),
+    UCG_ALLGATHER_NA_INTER = UCG_BIT(2),
+    UCG_ALLGATHER_NA_INTER_POST = UCG_BIT(3),
+    UCG_ALLGATHER_NA_BCAST_RECV = UCG_BIT(4),
+    UCG_ALLGATHER_NA_BCAST_RECV_POST = UCG_BIT(5),
+    UCG_ALLGATHER_NA_BCAST_SEND = UCG_BIT(6),
+    UCG_ALLGATHER_NA_BCAST_SEND_POST = UCG_BIT(7),
+};
+
+#define UCG_ALLGATHER_NA_GATHER_FLAGS UCG_ALLGATHER_NA_GATHER | \
+                                      UCG_ALLGATHER_NA_GATHER_POST
+
+#define UCG_ALLGATHER_NA_INTER_FLAGS UCG_ALLGATHER_NA_INTER | \
+                                     UCG_ALLGATHER_NA_INTER_POST
+
+#define UCG_ALLGATHER_NA_BCAST_RECV_FLAGS UCG_ALLGATHER_NA_BCAST_RECV | \
+                                          UCG_ALLGATHER_NA_BCAST_RECV_POST
+
+#define UCG_ALLGATHER_NA_BCAST_SEND_FLAGS UCG_ALLGATHER_NA_BCAST_SEND | \
+                                          UCG_ALLGATHER_NA_BCAST_SEND_POST
+
+static ucg_status_t ucg_planc_ucx_allgather_na_check(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args)
+{
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Allgather node-aware don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Allgather node-aware don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (!topo->detail.nrank_continuous) {
+        ucg_info("Allgather node-aware don't support discontinuous ranks of node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    /* The broadcast in the node carries all the blocks. */
+    return ucg_planc_ucx_allgather_check(vgroup, args, vgroup->size);
+}
+
+static inline ucg_rank_t ucg_planc_ucx_allgather_na_leader(ucg_planc_ucx_op_t *op)
+{
+    return op->allgather.na.node_start[op->allgather.na.mynode];
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_gather(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    ucg_rank_t leader = ucg_planc_ucx_allgather_na_leader(op);
+    int64_t block_extent = op->allgather.block_extent;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_NA_GATHER_POST)) {
+        if (myrank == leader) {
+            for (int32_t i = 1; i < op->allgather.na.nlocal; ++i) {
+                status = ucg_planc_ucx_p2p_irecv(ucg_planc_ucx_allgather_block(args, block_extent,
+                                                                               leader + i),
+                                                 args->recvcount, args->recvtype, leader + i,
+                                                 op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        } else if (args->sendbuf == UCG_IN_PLACE) {
+            status = ucg_planc_ucx_p2p_isend(ucg_planc_ucx_allgather_block(args, block_extent,
+                                                                           myrank),
+                                             args->recvcount, args->recvtype, leader,
+                                             op->tag, vgroup, &params);
+        } else {
+            status = ucg_planc_ucx_p2p_isend(args->sendbuf, args->sendcount, args->sendtype,
+                                             leader, op->tag, vgroup, &params);
+        }
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_inter(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    const ucg_rank_t *node_start = op->allgather.na.node_start;
+    int32_t mynode = op->allgather.na.mynode;
+    int64_t block_extent = op->allgather.block_extent;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_NA_INTER_POST)) {
+        void *mybuf = ucg_planc_ucx_allgather_block(args, block_extent, node_start[mynode]);
+        int32_t mycount = op->allgather.na.nlocal * args->recvcount;
+        /* Start from the next node, so the leaders don't all send to the same one. */
+        for (int32_t i = 1; i < op->allgather.na.nnode; ++i) {
+            int32_t node = (mynode + i) % op->allgather.na.nnode;
+            ucg_rank_t leader = node_start[node];
+            status = ucg_planc_ucx_p2p_isend(mybuf, mycount, args->recvtype, leader,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            status = ucg_planc_ucx_p2p_irecv(ucg_planc_ucx_allgather_block(args, block_extent,
+                                                                           leader),
+                                             (node_start[node + 1] - leader) * args->recvcount,
+                                             args->recvtype, leader, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_bcast(ucg_planc_ucx_op_t *op, int is_recv)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_algo_kntree_iter_t *iter = &op->allgather.na.bcast;
+    ucg_rank_t leader = ucg_planc_ucx_allgather_na_leader(op);
+    int32_t count = vgroup->size * args->recvcount;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t peer;
+
+    if (is_recv) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_NA_BCAST_RECV_POST)) {
+            peer = ucg_algo_kntree_iter_parent_value(iter);
+            status = ucg_planc_ucx_p2p_irecv(args->recvbuf, count, args->recvtype,
+                                             leader + peer, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    } else if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_NA_BCAST_SEND_POST)) {
+        while ((peer = ucg_algo_kntree_iter_child_value(iter)) != UCG_INVALID_RANK) {
+            status = ucg_planc_ucx_p2p_isend(args->recvbuf, count, args->recvtype,
+                                             leader + peer, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            ucg_algo_kntree_iter_child_inc(iter);
+        }
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    /* 1. gather the blocks of my node to the leader */
+    if (ucg_test_flags(op->flags, UCG_ALLGATHER_NA_GATHER)) {
+        status = ucg_planc_ucx_allgather_na_gather(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_ALLGATHER_NA_GATHER);
+    }
+
+    /* 2. exchange the blocks of the nodes among the leaders */
+    if (ucg_test_flags(op->flags, UCG_ALLGATHER_NA_INTER)) {
+        status = ucg_planc_ucx_allgather_na_inter(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_ALLGATHER_NA_INTER);
+    }
+
+    /* 3. broadcast all the blocks in my node */
+    if (ucg_test_flags(op->flags, UCG_ALLGATHER_NA_BCAST_RECV)) {
+        status = ucg_planc_ucx_allgather_na_bcast(op, 1);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_ALLGATHER_NA_BCAST_RECV);
+    }
+    if (ucg_test_flags(op->flags, UCG_ALLGATHER_NA_BCAST_SEND)) {
+        status = ucg_planc_ucx_allgather_na_bcast(op, 0);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_ALLGATHER_NA_BCAST_SEND);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    int is_leader = (op->super.vgroup->myrank == ucg_planc_ucx_allgather_na_leader(op));
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_op->super.args.allgather.recvcount == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    if (is_leader) {
+        /* The other ranks send their blocks to the leader directly. */
+        status = ucg_planc_ucx_allgather_copy_own(op);
+        if (status != UCG_OK) {
+            return status;
+        }
+        op->flags = UCG_ALLGATHER_NA_INTER_FLAGS;
+    } else {
+        op->flags = UCG_ALLGATHER_NA_BCAST_RECV_FLAGS;
+    }
+    if (op->allgather.na.nlocal > 1) {
+        op->flags |= UCG_ALLGATHER_NA_GATHER_FLAGS | UCG_ALLGATHER_NA_BCAST_SEND_FLAGS;
+        ucg_algo_kntree_iter_reset(&op->allgather.na.bcast);
+    }
+
+    status = ucg_planc_ucx_allgather_na_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_na_op_init(ucg_planc_ucx_op_t *op,
+                                                       ucg_planc_ucx_allgather_config_t *config)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+
+    ucg_planc_ucx_allgather_op_init(op);
+
+    /* Ranks of a node are a block, the first rank of every block is the leader. */
+    int32_t nnode = 0;
+    int32_t last_node = -1;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (node != last_node) {
+            ++nnode;
+            last_node = node;
+        }
+    }
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, sizeof(ucg_rank_t) * (nnode + 1),
+                                                       0, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_rank_t *node_start = (ucg_rank_t*)op->staging_area;
+    int32_t mynode = 0;
+    nnode = 0;
+    last_node = -1;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (node != last_node) {
+            node_start[nnode++] = rank;
+            last_node = node;
+        }
+        if (rank == myrank) {
+            mynode = nnode - 1;
+        }
+    }
+    node_start[nnode] = group_size;
+
+    op->allgather.na.node_start = node_start;
+    op->allgather.na.nnode = nnode;
+    op->allgather.na.mynode = mynode;
+    op->allgather.na.nlocal = node_start[mynode + 1] - node_start[mynode];
+    if (op->allgather.na.nlocal > 1) {
+        ucg_algo_kntree_iter_init(&op->allgather.na.bcast, op->allgather.na.nlocal,
+                                  ucg_max(config->na_bcast_degree, 1), 0,
+                                  myrank - node_start[mynode], 1);
+    }
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_allgather_na_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                             ucg_vgroup_t *vgroup,
+                                                             const ucg_coll_args_t *args,
+                                                             ucg_planc_ucx_allgather_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_allgather_na_op_trigger,
+                                 ucg_planc_ucx_allgather_na_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_allgather_na_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize allgather node-aware ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_na_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_allgather_na_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_allgather_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, allgather,
+                                                         UCG_COLL_TYPE_ALLGATHER);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allgather_na_op_new(ucx_group, vgroup,
+                                                                   args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allgather.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Recursive doubling allgather
+ *
+ * At step k, a rank holds the blocks of its subcube of 2^k ranks, they are
+ * contiguous in recvbuf. It exchanges them with the rank that differs in bit
+ * k, so every step is one message straight from and into recvbuf and there
+ * are log2(n) steps. Only power of two groups are supported.
+ */
+
+enum {
+    UCG_ALLGATHER_RD_POST = UCG_BIT(0),
+};
+
+static ucg_status_t ucg_planc_ucx_allgather_rd_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int64_t block_extent = op->allgather.block_extent;
+    int32_t *distance = &op->allgather.distance;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (*distance < (int32_t)vgroup->size) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_RD_POST)) {
+            ucg_rank_t peer = myrank ^ *distance;
+            ucg_rank_t mask = ~(ucg_rank_t)(*distance - 1);
+            int32_t count = *distance * args->recvcount;
+            void *sendbuf = ucg_planc_ucx_allgather_block(args, block_extent, myrank & mask);
+            void *recvbuf = ucg_planc_ucx_allgather_block(args, block_extent, peer & mask);
+            status = ucg_planc_ucx_p2p_isend(sendbuf, count, args->recvtype, peer,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            status = ucg_planc_ucx_p2p_irecv(recvbuf, count, args->recvtype, peer,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        *distance <<= 1;
+        op->flags |= UCG_ALLGATHER_RD_POST;
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_rd_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_op->super.args.allgather.recvcount == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    status = ucg_planc_ucx_allgather_copy_own(op);
+    if (status != UCG_OK) {
+        return status;
+    }
+    op->flags = UCG_ALLGATHER_RD_POST;
+    op->allgather.distance = 1;
+
+    status = ucg_planc_ucx_allgather_rd_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_allgather_rd_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                             ucg_vgroup_t *vgroup,
+                                                             const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_allgather_rd_op_trigger,
+                                 ucg_planc_ucx_allgather_rd_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucg_planc_ucx_allgather_op_init(ucx_op);
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_rd_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    if (!ucg_is_pow2(vgroup->size)) {
+        ucg_info("Allgather recursive doubling don't support non power of two group");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    /* The last step carries half of the blocks. */
+    ucg_status_t status = ucg_planc_ucx_allgather_check(vgroup, args, vgroup->size / 2);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allgather_rd_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
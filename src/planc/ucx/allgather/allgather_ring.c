@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allgather.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+/**
+ * Ring allgather
+ *
+ * At step i, a rank sends block (myrank - i) to its right and receives block
+ * (myrank - i - 1) from its left, there are n - 1 steps and every rank sends
+ * and receives n - 1 blocks, which is bandwidth optimal for large blocks.
+ */
+
+enum {
+    UCG_ALLGATHER_RING_SEND = UCG_BIT(0),
+    UCG_ALLGATHER_RING_RECV = UCG_BIT(1),
+};
+
+#define UCG_ALLGATHER_RING_FLAGS UCG_ALLGATHER_RING_SEND | UCG_ALLGATHER_RING_RECV
+
+static ucg_status_t ucg_planc_ucx_allgather_ring_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_allgather_args_t *args = &op->super.super.args.allgather;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int64_t block_extent = op->allgather.block_extent;
+    ucg_algo_ring_iter_t *iter = &op->allgather.ring_iter;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (!ucg_algo_ring_iter_end(iter)) {
+        int step_idx = ucg_algo_ring_iter_idx(iter);
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_RING_SEND)) {
+            ucg_rank_t block_idx = (myrank - step_idx + group_size) % group_size;
+            status = ucg_planc_ucx_p2p_isend(ucg_planc_ucx_allgather_block(args, block_extent,
+                                                                           block_idx),
+                                             args->recvcount, args->recvtype,
+                                             ucg_algo_ring_iter_right_value(iter),
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLGATHER_RING_RECV)) {
+            ucg_rank_t block_idx = (myrank - step_idx - 1 + group_size) % group_size;
+            status = ucg_planc_ucx_p2p_irecv(ucg_planc_ucx_allgather_block(args, block_extent,
+                                                                           block_idx),
+                                             args->recvcount, args->recvtype,
+                                             ucg_algo_ring_iter_left_value(iter),
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        ucg_algo_ring_iter_inc(iter);
+        op->flags |= UCG_ALLGATHER_RING_FLAGS;
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allgather_ring_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_op->super.args.allgather.recvcount == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    status = ucg_planc_ucx_allgather_copy_own(op);
+    if (status != UCG_OK) {
+        return status;
+    }
+    op->flags = UCG_ALLGATHER_RING_FLAGS;
+    ucg_algo_ring_iter_reset(&op->allgather.ring_iter);
+
+    status = ucg_planc_ucx_allgather_ring_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_allgather_ring_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                               ucg_vgroup_t *vgroup,
+                                                               const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_allgather_ring_op_trigger,
+                                 ucg_planc_ucx_allgather_ring_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucg_planc_ucx_allgather_op_init(ucx_op);
+    ucg_algo_ring_iter_init(&ucx_op->allgather.ring_iter, vgroup->size, vgroup->myrank);
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_allgather_ring_prepare(ucg_vgroup_t *vgroup,
+                                                  const ucg_coll_args_t *args,
+                                                  ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_allgather_check(vgroup, args, 1);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allgather_ring_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
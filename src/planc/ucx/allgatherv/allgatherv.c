@@ -10,22 +10,27 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_allgatherv_plan_attr[] = {
     {ucg_planc_ucx_allgatherv_neighbor_prepare,
-     1, "Neighbor exchange", PLAN_DOMAIN},
+     1, "Neighbor exchange", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_allgatherv_ring_prepare,
-     2, "Ring", PLAN_DOMAIN},
+     2, "Ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_allgatherv_ring_hpl_prepare,
-     3, "Ring-HPL", PLAN_DOMAIN},
+     3, "Ring-HPL", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_allgatherv_linear_prepare,
      4, "Linear", PLAN_DOMAIN},
 
     {ucg_planc_ucx_allgatherv_bruck_prepare,
-     5, "Bruck", PLAN_DOMAIN},
+     5, "Bruck", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_BRUCK},
 
     {ucg_planc_ucx_allgatherv_na_rolling_prepare,
-     6, "Node-aware rolling", PLAN_DOMAIN},
+     6, "Node-aware rolling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {NULL},
 };
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allgatherv.h"
@@ -176,35 +176,16 @@ static ucg_status_t ucg_planc_ucx_allgatherv_bruck_op_init(ucg_planc_ucx_op_t *u
     ucg_vgroup_t *vgroup = ucg_op->super.vgroup;
     uint32_t group_size = vgroup->size;
 
-    ucg_op->allgatherv.bruck.new_cnt_displs = ucg_calloc(4 * group_size, sizeof(int32_t),
-                                                         "alloc new count displs");
-    if (ucg_op->allgatherv.bruck.new_cnt_displs == NULL) {
-        goto err;
-    }
-    ucg_op->allgatherv.bruck.merged_cnt_displs = ucg_calloc(4 * group_size, sizeof(int32_t),
-                                                            "alloc merged count displs");
-    if (ucg_op->allgatherv.bruck.merged_cnt_displs == NULL) {
-        goto err_free_new;
-    }
-    return UCG_OK;
-
-err_free_new:
-    ucg_free(ucg_op->allgatherv.bruck.new_cnt_displs);
-err:
-    return UCG_ERR_NO_MEMORY;
-}
-
-static ucg_status_t ucg_planc_ucx_allgatherv_bruck_op_discard(ucg_plan_op_t *ucg_op)
-{
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    if (op->allgatherv.bruck.new_cnt_displs != NULL) {
-        ucg_free(op->allgatherv.bruck.new_cnt_displs);
-    }
-    if (op->allgatherv.bruck.merged_cnt_displs != NULL) {
-        ucg_free(op->allgatherv.bruck.merged_cnt_displs);
+    /* The new and merged counts and displs are in the staging area. */
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(ucg_op,
+                                                       8 * group_size * sizeof(int32_t),
+                                                       0, NULL);
+    if (status != UCG_OK) {
+        return status;
     }
-    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
-    ucg_mpool_put(op);
+    ucg_op->allgatherv.bruck.new_cnt_displs = (int32_t*)ucg_op->staging_area;
+    ucg_op->allgatherv.bruck.merged_cnt_displs = ucg_op->allgatherv.bruck.new_cnt_displs +
+                                                 4 * group_size;
     return UCG_OK;
 }
 
@@ -222,7 +203,7 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_allgatherv_bruck_op_new(ucg_planc_ucx_group_t
     status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
                                  ucg_planc_ucx_allgatherv_bruck_op_trigger,
                                  ucg_planc_ucx_allgatherv_bruck_op_progress,
-                                 ucg_planc_ucx_allgatherv_bruck_op_discard,
+                                 ucg_planc_ucx_op_discard,
                                  args);
     if (status != UCG_OK) {
         ucg_error("Failed to initialize super of ucx op");
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allreduce.h"
@@ -10,47 +10,64 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_allreduce_plan_attr[] = {
     {ucg_planc_ucx_allreduce_rd_prepare,
-     1, "Recursive doubling", PLAN_DOMAIN},
+     1, "Recursive doubling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_na_rd_and_bntree_prepare,
-     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_sa_rd_and_bntree_prepare,
-     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_ring_prepare,
-     4, "Ring", PLAN_DOMAIN},
+     4, "Ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_allreduce_na_rd_and_kntree_prepare,
-     5, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     5, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_sa_rd_and_kntree_prepare,
-     6, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     6, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_na_kntree_prepare,
-     7, "Node-aware k-nomial tree", PLAN_DOMAIN},
+     7, "Node-aware k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_allreduce_sa_kntree_prepare,
-     8, "Socket-aware k-nomial tree", PLAN_DOMAIN},
+     8, "Socket-aware k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_allreduce_na_inc_prepare,
-     9, "Node-aware in-network-computing", PLAN_DOMAIN},
+     9, "Node-aware in-network-computing", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE},
 
     {ucg_planc_ucx_allreduce_sa_inc_prepare,
-     10, "Socket-aware in-network-computing", PLAN_DOMAIN},
+     10, "Socket-aware in-network-computing", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE},
 
     {ucg_planc_ucx_allreduce_rabenseifner_prepare,
-     12, "Rabenseifner", PLAN_DOMAIN},
+     12, "Rabenseifner", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_na_rabenseifner_prepare,
-     13, "Node-aware rabenseifner", PLAN_DOMAIN},
+     13, "Node-aware rabenseifner", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_allreduce_sa_rabenseifner_prepare,
-     14, "Socket-aware rabenseifner", PLAN_DOMAIN},
+     14, "Socket-aware rabenseifner", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     // {ucg_planc_ucx_allreduce_nta_kntree_prepare,
     //  15, "Net-topo-aware k-nomial tree", PLAN_DOMAIN},
 
+    {ucg_planc_ucx_allreduce_ring_pipeline_prepare,
+     16, "Pipelined ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
+
     {NULL},
 };
 UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_ALLREDUCE,
@@ -87,6 +104,18 @@ static ucg_config_field_t allreduce_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_allreduce_config_t, nta_kntree_intra_degree),
      UCG_CONFIG_TYPE_INT},
 
+    {"ALLREDUCE_RING_PIPELINE_SEGSIZE", "64k",
+     "Configure the segment size in pipelined ring algo for allreduce, a block\n"
+     "of ring is sent and reduced in segments of this size",
+     ucg_offsetof(ucg_planc_ucx_allreduce_config_t, ring_pipeline_segsize),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"ALLREDUCE_RING_PIPELINE_DEPTH", "2",
+     "Configure the number of segments received ahead in pipelined ring algo for\n"
+     "allreduce, each of them takes a staging buffer of segment size, minimum is 2",
+     ucg_offsetof(ucg_planc_ucx_allreduce_config_t, ring_pipeline_depth),
+     UCG_CONFIG_TYPE_INT},
+
     {"ALLREDUCE_DEFAULT_POLICY", "y",
      "Enable default policy\n"
      " - y : use default policy\n"
@@ -8,6 +8,7 @@
 #include "planc/ucx/planc_ucx_def.h"
 #include "planc/ucx/planc_ucx_context.h"
 #include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
 #include "core/ucg_plan.h"
 #include "util/algo/ucg_kntree.h"
 #include "util/algo/ucg_rd.h"
@@ -22,6 +23,9 @@ typedef struct ucg_planc_ucx_allreduce_config {
     int fanout_intra_degree;
     int nta_kntree_inter_degree;
     int nta_kntree_intra_degree;
+    /* for pipelined ring */
+    size_t ring_pipeline_segsize;
+    int ring_pipeline_depth;
     /* for close default policy */
     int policy_default;
 } ucg_planc_ucx_allreduce_config_t;
@@ -48,8 +52,8 @@ typedef struct ucg_planc_ucx_allreduce {
     union {
         struct {
             ucg_algo_rd_iter_t iter;
-            void *staging_area_stored;
-            void *recvbuf_stored;
+            /* My partial result, it is in sendbuf until the first reduction. */
+            const void *data;
         } rd;
         struct {
             ucg_algo_ring_iter_t iter;
@@ -60,6 +64,25 @@ typedef struct ucg_planc_ucx_allreduce {
             int32_t large_blkcount;
             int32_t small_blkcount;
         } ring;
+        struct {
+            ucg_algo_ring_iter_t iter;
+            /* Blocks are the same as ring, they are cut into segments. */
+            int32_t spilt_rank;
+            int32_t large_blkcount;
+            int32_t small_blkcount;
+            int32_t segcount;
+            int32_t nsegs;
+            /* Number of staging areas, also the max number of inflight receives. */
+            int32_t depth;
+            /* A unit is a segment of a step, it is numbered step * nsegs + seg. */
+            int32_t nunits;
+            int32_t sent;
+            int32_t posted;
+            int32_t completed;
+            int64_t seg_size;
+            /* One receive request per staging area */
+            ucg_planc_ucx_p2p_req_t **requests;
+        } ring_pipeline;
         ucg_planc_ucx_allreduce_rabenseifner_args_t rabenseifner;
     };
 } ucg_planc_ucx_allreduce_t;
@@ -92,6 +115,9 @@ ucg_status_t ucg_planc_ucx_allreduce_sa_rd_and_bntree_prepare(ucg_vgroup_t *vgro
 ucg_status_t ucg_planc_ucx_allreduce_ring_prepare(ucg_vgroup_t *vgroup,
                                                   const ucg_coll_args_t *args,
                                                   ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_prepare(ucg_vgroup_t *vgroup,
+                                                           const ucg_coll_args_t *args,
+                                                           ucg_plan_op_t **op);
 ucg_status_t ucg_planc_ucx_allreduce_na_rd_and_kntree_prepare(ucg_vgroup_t *vgroup,
                                                               const ucg_coll_args_t *args,
                                                               ucg_plan_op_t **op);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allreduce.h"
@@ -215,7 +215,6 @@ ucg_status_t ucg_planc_ucx_allreduce_get_rd_args(ucg_vgroup_t *vgroup,
                                                  ucg_topo_group_type_t topo_type,
                                                  int64_t *offset, int32_t *count)
 {
-    ucg_status_t status = UCG_OK;
     ucg_topo_group_t *topo_group;
     topo_group = ucg_topo_get_group(vgroup->group->topo, topo_type);
     if (topo_group == NULL || topo_group->state == UCG_TOPO_GROUP_STATE_ERROR ||
@@ -230,7 +229,6 @@ ucg_status_t ucg_planc_ucx_allreduce_get_rd_args(ucg_vgroup_t *vgroup,
     int32_t nprocs_pof2 = UCG_BIT(nstep);
     int32_t nprocs_rem = size - nprocs_pof2;
     int32_t mask = 1;
-    int32_t step = 0;
     ucg_rank_t new_rank;
     if (myrank < 2 * nprocs_rem) {
         if (myrank % 2 == 0) {
@@ -241,62 +239,26 @@ ucg_status_t ucg_planc_ucx_allreduce_get_rd_args(ucg_vgroup_t *vgroup,
     } else {
         new_rank = myrank - nprocs_rem;
     }
+    /* Only my part of the last step is needed, so keep the current step only. */
     int32_t wsize = args->allreduce.count;
-    int32_t *sindex = ucg_malloc(nstep * sizeof(int32_t), "allreduce send index");
-    if (sindex == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-        goto err;
-    }
-    int32_t *rindex = ucg_malloc(nstep * sizeof(int32_t), "allreduce recv index");
-    if (rindex == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-        goto err_free_sindex;
-    }
-    int32_t *scount = ucg_malloc(nstep * sizeof(int32_t), "allreduce send count");
-    if (scount == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-        goto err_free_rindex;
-    }
-    int32_t *rcount = ucg_malloc(nstep * sizeof(int32_t), "allreduce recv count");
-    if (rcount == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-        goto err_free_scount;
-    }
-    sindex[0] = rindex[0] = rcount[0] = 0;
-
+    int32_t rindex = 0;
+    int32_t rcount = 0;
     while (mask < nprocs_pof2) {
         ucg_rank_t new_peer = new_rank ^ mask;
         ucg_rank_t peer = (new_peer < nprocs_rem) ? new_peer * 2 : new_peer + nprocs_rem;
         if (myrank < peer) {
-            rcount[step] = wsize / 2;
-            scount[step] = wsize - rcount[step];
-            sindex[step] = rindex[step] + rcount[step];
+            rcount = wsize / 2;
         } else {
-            scount[step] = wsize / 2;
-            rcount[step] = wsize - scount[step];
-            rindex[step] = sindex[step] + scount[step];
-        }
-
-        if (step + 1 < nstep) {
-            rindex[step + 1] = rindex[step];
-            sindex[step + 1] = rindex[step];
-            wsize = rcount[step];
-            ++step;
+            int32_t scount = wsize / 2;
+            rcount = wsize - scount;
+            rindex += scount;
         }
+        wsize = rcount;
         mask <<= 1;
     }
-    *offset = rindex[step] * ucg_dt_extent(args->allreduce.dt);
-    *count = rcount[step];
-
-    ucg_free(rcount);
-err_free_scount:
-    ucg_free(scount);
-err_free_rindex:
-    ucg_free(rindex);
-err_free_sindex:
-    ucg_free(sindex);
-err:
-    return status;
+    *offset = rindex * ucg_dt_extent(args->allreduce.dt);
+    *count = rcount;
+    return UCG_OK;
 }
 
 ucg_status_t ucg_planc_ucx_allreduce_add_allreduce_op(ucg_plan_meta_op_t *meta_op,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allreduce.h"
@@ -71,6 +71,12 @@ static ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_check(ucg_vgroup_t *vgr
     return UCG_OK;
 }
 
+/* Data not reduced yet is read from sendbuf directly, it is not copied to recvbuf. */
+static inline void* ucg_planc_ucx_allreduce_rabenseifner_sendbuf(ucg_coll_allreduce_args_t *args)
+{
+    return (args->sendbuf != UCG_IN_PLACE) ? (void*)args->sendbuf : args->recvbuf;
+}
+
 static
 ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_base_progress(ucg_planc_ucx_op_t *op)
 {
@@ -96,6 +102,8 @@ ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_base_progress(ucg_planc_u
     int32_t *rindex = op->allreduce.rabenseifner.recv_index;
     int32_t *scount = op->allreduce.rabenseifner.send_count;
     int32_t *rcount = op->allreduce.rabenseifner.recv_count;
+    /* The proxy has reduced all its data to recvbuf before. */
+    int is_base = op->allreduce.rabenseifner.rank_type == UCG_RABENSEIFNER_RANK_BASE;
 
     while (*mask < nprocs_pof2) {
         ucg_rank_t new_peer = new_rank ^ *mask;
@@ -111,9 +119,11 @@ ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_base_progress(ucg_planc_u
             rcount[step] = wsize - scount[step];
             rindex[step] = sindex[step] + scount[step];
         }
+        void *data = (is_base && step == 0) ? ucg_planc_ucx_allreduce_rabenseifner_sendbuf(args)
+                                            : recvbuf;
 
         if (ucg_test_and_clear_flags(&op->flags, UCG_BASE_REDUCE_SCATTER_SEND)) {
-            status = ucg_planc_ucx_p2p_isend(recvbuf + sindex[step] * extent,
+            status = ucg_planc_ucx_p2p_isend(data + sindex[step] * extent,
                                              scount[step], args->dt, peer,
                                              op->tag, vgroup, &params);
             UCG_CHECK_GOTO(status, out);
@@ -128,9 +138,10 @@ ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_base_progress(ucg_planc_u
 
         status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
         UCG_CHECK_GOTO(status, out);
-        status = ucg_op_reduce(args->op, staging_area + rindex[step] * extent,
-                               recvbuf + rindex[step] * extent, rcount[step],
-                               args->dt);
+        status = ucg_op_reduce3(args->op, staging_area + rindex[step] * extent,
+                                data + rindex[step] * extent,
+                                recvbuf + rindex[step] * extent, rcount[step],
+                                args->dt);
         UCG_CHECK_GOTO(status, out);
 
         if (step + 1 < nstep) {
@@ -176,11 +187,12 @@ static ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_proxy(ucg_planc_uc
     ucg_planc_ucx_p2p_params_t params;
     ucg_planc_ucx_op_set_p2p_params(op, &params);
 
+    void *sendbuf = ucg_planc_ucx_allreduce_rabenseifner_sendbuf(args);
     ucg_rank_t peer = myrank + 1;
     int count_lhalf = count / 2;
     int count_rhalf = count - count_lhalf;
     if (ucg_test_and_clear_flags(&op->flags, UCG_PROXY_SEND)) {
-        status = ucg_planc_ucx_p2p_isend(recvbuf + count_lhalf * extent,
+        status = ucg_planc_ucx_p2p_isend(sendbuf + count_lhalf * extent,
                                          count_rhalf, args->dt, peer,
                                          op->tag, vgroup, &params);
         UCG_CHECK_GOTO(status, out);
@@ -193,7 +205,8 @@ static ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_proxy(ucg_planc_uc
     status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
     UCG_CHECK_GOTO(status, out);
     if (ucg_test_and_clear_flags(&op->flags, UCG_PROXY_REDUCE)) {
-        status = ucg_op_reduce(args->op, staging_area, recvbuf, count_lhalf, args->dt);
+        status = ucg_op_reduce3(args->op, staging_area, sendbuf, recvbuf,
+                                count_lhalf, args->dt);
         UCG_CHECK_GOTO(status, out);
     }
     if (ucg_test_and_clear_flags(&op->flags, UCG_PROXY_RECV_RESULT)) {
@@ -228,11 +241,12 @@ static ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_extra(ucg_planc_uc
     ucg_planc_ucx_p2p_params_t params;
     ucg_planc_ucx_op_set_p2p_params(op, &params);
 
+    void *sendbuf = ucg_planc_ucx_allreduce_rabenseifner_sendbuf(args);
     ucg_rank_t peer = myrank - 1;
     int count_lhalf = count / 2;
     int count_rhalf = count - count_lhalf;
     if (ucg_test_and_clear_flags(&op->flags, UCG_EXTRA_SEND)) {
-        status = ucg_planc_ucx_p2p_isend(recvbuf, count_lhalf, args->dt, peer,
+        status = ucg_planc_ucx_p2p_isend(sendbuf, count_lhalf, args->dt, peer,
                                          op->tag, vgroup, &params);
         UCG_CHECK_GOTO(status, out);
     }
@@ -245,8 +259,9 @@ static ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_extra(ucg_planc_uc
     status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
     UCG_CHECK_GOTO(status, out);
     if (ucg_test_and_clear_flags(&op->flags, UCG_EXTRA_REDUCE)) {
-        status = ucg_op_reduce(args->op, staging_area + count_lhalf * extent,
-                               recvbuf + count_lhalf * extent, count_rhalf, args->dt);
+        status = ucg_op_reduce3(args->op, staging_area + count_lhalf * extent,
+                                sendbuf + count_lhalf * extent,
+                                recvbuf + count_lhalf * extent, count_rhalf, args->dt);
         UCG_CHECK_GOTO(status, out);
     }
     if (ucg_test_and_clear_flags(&op->flags, UCG_EXTRA_SEND_RESULT)) {
@@ -314,8 +329,10 @@ static ucg_status_t ucg_planc_ucx_allreduce_reduce_scatter_op_trigger(ucg_plan_o
             break;
     }
 
+    /* Only a single rank needs the copy, otherwise the reductions read sendbuf
+     * and write recvbuf directly. */
     ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
-    if (args->sendbuf != UCG_IN_PLACE) {
+    if (args->sendbuf != UCG_IN_PLACE && op->super.vgroup->size == 1) {
         status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
                                args->sendbuf, args->count, args->dt);
         if (status != UCG_OK) {
@@ -331,21 +348,8 @@ static ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_common_op_discard(ucg_p
 {
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
 
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
-    if (op->allreduce.rabenseifner.recv_count != NULL) {
-        ucg_free(op->allreduce.rabenseifner.recv_count);
-    }
-    if (op->allreduce.rabenseifner.send_count != NULL) {
-        ucg_free(op->allreduce.rabenseifner.send_count);
-    }
-    if (op->allreduce.rabenseifner.recv_index != NULL) {
-        ucg_free(op->allreduce.rabenseifner.recv_index);
-    }
-    if (op->allreduce.rabenseifner.send_index != NULL) {
-        ucg_free(op->allreduce.rabenseifner.send_index);
-    }
+    /* The index arrays live in the scratch area of the staging area. */
+    ucg_planc_ucx_op_put_staging(op);
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
     return UCG_OK;
@@ -380,49 +384,27 @@ static ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_common_op_init(ucg_plan
     ucg_op->allreduce.rabenseifner.rank_type = rank_type;
     ucg_op->allreduce.rabenseifner.new_rank = new_rank;
 
-    int32_t *send_index = ucg_malloc(nstep * sizeof(int32_t), "allreduce send index");
-    if (send_index == NULL) {
-        goto err;
-    }
-    int32_t *recv_index = ucg_malloc(nstep * sizeof(int32_t), "allreduce recv index");
-    if (recv_index == NULL) {
-        goto err_free_send_index;
-    }
-    int32_t *send_count = ucg_malloc(nstep * sizeof(int32_t), "allreduce send count");
-    if (send_count == NULL) {
-        goto err_free_recv_index;
-    }
-    int32_t *recv_count = ucg_malloc(nstep * sizeof(int32_t), "allreduce recv count");
-    if (recv_count == NULL) {
-        goto err_free_send_count;
-    }
-    send_index[0] = recv_index[0] = 0;
-    ucg_op->allreduce.rabenseifner.send_index = send_index;
-    ucg_op->allreduce.rabenseifner.recv_index = recv_index;
-    ucg_op->allreduce.rabenseifner.send_count = send_count;
-    ucg_op->allreduce.rabenseifner.recv_count = recv_count;
-
     const ucg_coll_allreduce_args_t *coll_args = &ucg_op->super.super.args.allreduce;
     ucg_op->allreduce.rabenseifner.window_size = coll_args->count;
 
+    /* One staging area with the send/recv index and count arrays in its scratch area. */
     int64_t data_size = coll_args->dt->true_extent + coll_args->dt->extent * (coll_args->count - 1);
-    ucg_op->staging_area = ucg_malloc(data_size, "allreduce staging area");
-    if (ucg_op->staging_area == NULL) {
-        goto err_free_recv_count;
+    int32_t *scratch = NULL;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(ucg_op, data_size,
+                                                       4 * nstep * sizeof(int32_t),
+                                                       (void**)&scratch);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_op->allreduce.rabenseifner.send_index = scratch;
+    ucg_op->allreduce.rabenseifner.recv_index = scratch + nstep;
+    ucg_op->allreduce.rabenseifner.send_count = scratch + 2 * nstep;
+    ucg_op->allreduce.rabenseifner.recv_count = scratch + 3 * nstep;
+    if (nstep > 0) {
+        ucg_op->allreduce.rabenseifner.send_index[0] = 0;
+        ucg_op->allreduce.rabenseifner.recv_index[0] = 0;
     }
-
     return UCG_OK;
-
-err_free_recv_count:
-    ucg_free(recv_count);
-err_free_send_count:
-    ucg_free(send_count);
-err_free_recv_index:
-    ucg_free(recv_index);
-err_free_send_index:
-    ucg_free(send_index);
-err:
-    return UCG_ERR_NO_MEMORY;
 }
 
 ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_reduce_scatter_op_new(ucg_planc_ucx_group_t *ucx_group,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allreduce.h"
@@ -33,8 +33,8 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_base(ucg_planc_ucx_op_t *op)
     ucg_status_t status = UCG_OK;
     ucg_vgroup_t *vgroup = op->super.vgroup;
     ucg_coll_allreduce_args_t *args = &op->super.super.args.allreduce;
-    void *temp_staging_area = op->allreduce.rd.staging_area_stored;
-    void *temp_recvbuf = op->allreduce.rd.recvbuf_stored;
+    void *staging_area = op->staging_area - args->dt->true_lb;
+    void *recvbuf = args->recvbuf;
     ucg_planc_ucx_p2p_params_t params;
     ucg_planc_ucx_op_set_p2p_params(op, &params);
     ucg_algo_rd_iter_t *iter = &op->allreduce.rd.iter;
@@ -43,37 +43,38 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_base(ucg_planc_ucx_op_t *op)
 
     while ((peer = ucg_algo_rd_iter_base_value(iter)) != UCG_INVALID_RANK) {
         if (ucg_test_and_clear_flags(&op->flags, UCG_RD_BASE_SEND)) {
-            status = ucg_planc_ucx_p2p_isend(temp_recvbuf, args->count, args->dt,
+            status = ucg_planc_ucx_p2p_isend(op->allreduce.rd.data, args->count, args->dt,
                                              peer, op->tag, vgroup, &params);
             UCG_CHECK_GOTO(status, out);
         }
 
         if (ucg_test_and_clear_flags(&op->flags, UCG_RD_BASE_RECV)) {
-            status = ucg_planc_ucx_p2p_irecv(temp_staging_area, args->count, args->dt,
+            status = ucg_planc_ucx_p2p_irecv(staging_area, args->count, args->dt,
                                              peer, op->tag, vgroup, &params);
             UCG_CHECK_GOTO(status, out);
         }
         status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
         UCG_CHECK_GOTO(status, out);
 
+        /* The lower rank is the left operand, the result goes to recvbuf directly. */
         if (my_rank < peer) {
-            status = ucg_op_reduce(args->op, temp_recvbuf, temp_staging_area, args->count, args->dt);
-            op->allreduce.rd.staging_area_stored = temp_recvbuf;
-            op->allreduce.rd.recvbuf_stored = temp_staging_area;
-            void *temp = temp_recvbuf;
-            temp_recvbuf = temp_staging_area;
-            temp_staging_area = temp;
+            status = ucg_op_reduce3(args->op, op->allreduce.rd.data, staging_area,
+                                    recvbuf, args->count, args->dt);
         } else {
-            status = ucg_op_reduce(args->op, temp_staging_area, temp_recvbuf, args->count, args->dt);
+            status = ucg_op_reduce3(args->op, staging_area, (void*)op->allreduce.rd.data,
+                                    recvbuf, args->count, args->dt);
         }
-
         UCG_CHECK_GOTO(status, out);
+        op->allreduce.rd.data = recvbuf;
         /* increase iterator to enter next loop */
         ucg_algo_rd_iter_inc(iter);
         op->flags |= UCG_RD_BASE_SEND | UCG_RD_BASE_RECV;
     }
-    if (temp_recvbuf != args->recvbuf){
-        ucg_dt_memcpy(args->recvbuf, args->count, args->dt, temp_recvbuf, args->count, args->dt);
+    if (op->allreduce.rd.data != recvbuf) {
+        /* No peer to reduce with. */
+        status = ucg_dt_memcpy(recvbuf, args->count, args->dt,
+                               op->allreduce.rd.data, args->count, args->dt);
+        op->allreduce.rd.data = recvbuf;
     }
 out:
     return status;
@@ -84,7 +85,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_proxy(ucg_planc_ucx_op_t *op)
     ucg_status_t status = UCG_OK;
     ucg_vgroup_t *vgroup = op->super.vgroup;
     ucg_coll_allreduce_args_t *args = &op->super.super.args.allreduce;
-    void *temp_staging_area = op->allreduce.rd.staging_area_stored;
+    void *staging_area = op->staging_area - args->dt->true_lb;
     void *recvbuf = args->recvbuf;
     ucg_planc_ucx_p2p_params_t params;
     ucg_planc_ucx_op_set_p2p_params(op, &params);
@@ -93,7 +94,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_proxy(ucg_planc_ucx_op_t *op)
 
     if (ucg_test_and_clear_flags(&op->flags, UCG_RD_PROXY_RECV)) {
         peer = ucg_algo_rd_iter_value_inc(iter);
-        status = ucg_planc_ucx_p2p_irecv(temp_staging_area, args->count, args->dt,
+        status = ucg_planc_ucx_p2p_irecv(staging_area, args->count, args->dt,
                                          peer, op->tag, vgroup, &params);
         UCG_CHECK_GOTO(status, out);
     }
@@ -101,8 +102,10 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_proxy(ucg_planc_ucx_op_t *op)
     UCG_CHECK_GOTO(status, out);
 
     if (ucg_test_and_clear_flags(&op->flags, UCG_RD_PROXY_REDUCE)) {
-        status = ucg_op_reduce(args->op, temp_staging_area, recvbuf, args->count, args->dt);
+        status = ucg_op_reduce3(args->op, staging_area, (void*)op->allreduce.rd.data,
+                                recvbuf, args->count, args->dt);
         UCG_CHECK_GOTO(status, out);
+        op->allreduce.rd.data = recvbuf;
     }
 
     if (ucg_test_flags(op->flags, UCG_RD_PROXY_BASE)) {
@@ -182,16 +185,9 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_trigger(ucg_plan_op_t *ucg_op)
         if (type == UCG_ALGO_RD_ITER_PROXY) {
             op->flags |= UCG_RD_PROXY_FLAGS;
         }
+        /* The first reduction reads sendbuf, so it is not copied to recvbuf. */
         ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
-        op->allreduce.rd.staging_area_stored = op->staging_area - args->dt->true_lb;
-        op->allreduce.rd.recvbuf_stored = args->recvbuf;
-        if (args->sendbuf != UCG_IN_PLACE) {
-            status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
-                                   args->sendbuf, args->count, args->dt);
-            if (status != UCG_OK) {
-                return status;
-            }
-        }
+        op->allreduce.rd.data = (args->sendbuf != UCG_IN_PLACE) ? args->sendbuf : args->recvbuf;
     } else {
         op->flags = UCG_RD_EXTRA_FLAGS;
     }
@@ -203,9 +199,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_trigger(ucg_plan_op_t *ucg_op)
 static ucg_status_t ucg_planc_ucx_allreduce_rd_op_discard(ucg_plan_op_t *ucg_op)
 {
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
+    ucg_planc_ucx_op_put_staging(op);
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
     return UCG_OK;
@@ -240,9 +234,8 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_rd_op_new(ucg_planc_ucx_group_t *ucx
         ucg_dt_t *dt = args->allreduce.dt;
         int32_t count = args->allreduce.count;
         int64_t data_size = dt->true_extent + dt->extent * (count - 1);
-        ucg_assert(op->staging_area == NULL);
-        op->staging_area = ucg_malloc(data_size, "allreduce rd op staging area");
-        if (op->staging_area == NULL) {
+        status = ucg_planc_ucx_op_get_staging(op, data_size, 0, NULL);
+        if (status != UCG_OK) {
             goto err_destruct;
         }
     }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "allreduce.h"
@@ -70,6 +70,8 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_reduce_scatter(ucg_plan_op_t
     int32_t max_blkcount = large_blkcount;
     int32_t spilt_rank = op->allreduce.ring.spilt_rank;
     void *temp_staging_area = op->staging_area - args->dt->true_lb;
+    /* Blocks not reduced yet are read from sendbuf, it is not copied to recvbuf. */
+    void *sendbuf = (args->sendbuf != UCG_IN_PLACE) ? (void*)args->sendbuf : args->recvbuf;
     while (!ucg_algo_ring_iter_end(iter)) {
         int32_t step_idx = ucg_algo_ring_iter_idx(iter);
         if (ucg_test_and_clear_flags(&op->flags, UCG_RING_REDUCE_SCATTER_RECV)) {
@@ -84,7 +86,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_reduce_scatter(ucg_plan_op_t
                                     (sendblock * small_blkcount + spilt_rank));
             int32_t blockcount = ((sendblock < spilt_rank) ?
                                     large_blkcount : small_blkcount);
-            void *tmpsend = args->recvbuf + blockoffset * dt_ext;
+            void *tmpsend = (step_idx == 0 ? sendbuf : args->recvbuf) + blockoffset * dt_ext;
             status = ucg_planc_ucx_p2p_isend(tmpsend, blockcount, args->dt,
                                                 right_peer, op->tag, vgroup, &params);
             UCG_CHECK_GOTO(status, out);
@@ -96,7 +98,8 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_reduce_scatter(ucg_plan_op_t
                                 (recvblock * small_blkcount + spilt_rank));
         int32_t blockcount = ((recvblock < spilt_rank) ? large_blkcount : small_blkcount);
         void *tmprecv = args->recvbuf + blockoffset * dt_ext;
-        status = ucg_op_reduce(args->op, temp_staging_area, tmprecv, blockcount, args->dt);
+        status = ucg_op_reduce3(args->op, temp_staging_area, sendbuf + blockoffset * dt_ext,
+                                tmprecv, blockcount, args->dt);
         UCG_CHECK_GOTO(status, out);
         ucg_algo_ring_iter_inc(iter);
         op->flags |= (UCG_RING_REDUCE_SCATTER_RECV | UCG_RING_REDUCE_SCATTER_SEND);
@@ -249,14 +252,15 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_trigger(ucg_plan_op_t *ucg_o
     op->flags = UCG_RING_FLAGS;
     ucg_algo_ring_iter_reset(&op->allreduce.ring.iter);
 
-    if (args->sendbuf != UCG_IN_PLACE) {
-        status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
-                               args->sendbuf, args->count, args->dt);
-        /* Special case for group size == 1*/
-        if (op->super.vgroup->size == 1) {
-            op->super.super.status = UCG_OK;
-            return UCG_OK;
+    /* Special case for group size == 1 */
+    if (op->super.vgroup->size == 1) {
+        status = UCG_OK;
+        if (args->sendbuf != UCG_IN_PLACE) {
+            status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                                   args->sendbuf, args->count, args->dt);
         }
+        op->super.super.status = status;
+        return status;
     }
 
     status = ucg_planc_ucx_allreduce_ring_op_progress(ucg_op);
@@ -284,9 +288,9 @@ ucg_status_t ucg_planc_ucx_allreduce_ring_op_init(ucg_planc_ucx_op_t *ucg_op)
     ucg_op->allreduce.ring.small_blkcount = small_blkcount;
     ucg_dt_t *dt = args->dt;
     int64_t data_size = dt->true_extent + dt->extent * (large_blkcount - 1);
-    ucg_op->staging_area = ucg_malloc(data_size, "alloc staging area");
-    if (!ucg_op->staging_area) {
-        return UCG_ERR_NO_MEMORY;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(ucg_op, data_size, 0, NULL);
+    if (status != UCG_OK) {
+        return status;
     }
     ucg_algo_ring_iter_init(&ucg_op->allreduce.ring.iter, group_size, my_rank);
     return UCG_OK;
@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "allreduce.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+#include "util/algo/ucg_ring.h"
+
+#define UCG_RING_PIPELINE_MIN_DEPTH 2
+
+/* op flags needed by allreduce pipelined ring. */
+enum {
+    UCG_RING_PIPELINE_REDUCE_SCATTER = UCG_BIT(0),
+    UCG_RING_PIPELINE_ALLGATHERV = UCG_BIT(1),
+};
+
+#define UCG_RING_PIPELINE_FLAGS UCG_RING_PIPELINE_REDUCE_SCATTER | \
+                                UCG_RING_PIPELINE_ALLGATHERV
+
+static ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_check(ucg_vgroup_t *vgroup,
+                                                                const ucg_coll_args_t *args)
+{
+    uint32_t group_size = vgroup->size;
+    int32_t count = args->allreduce.count;
+    if (count < group_size) {
+        ucg_info("Allreduce pipelined ring don't support count < group_size");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_op_flag_t flags = args->allreduce.op->flags;
+    if (!(flags & UCG_OP_FLAG_IS_COMMUTATIVE)) {
+        ucg_info("Allreduce pipelined ring don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_planc_ucx_group_t* ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    if (ucx_group->context->config.reduce_consistency == 1) {
+        ucg_info("Allreduce pipelined ring don't support reduce calculation results consistency");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+/**
+ * @brief Get the element offset and count of a segment of a block.
+ *
+ * The last segments of a small block may be empty, both sides skip them.
+ */
+static inline void ucg_planc_ucx_allreduce_ring_pipeline_seg(ucg_planc_ucx_op_t *op,
+                                                             int32_t block, int32_t seg,
+                                                             int32_t *offset, int32_t *count)
+{
+    int32_t large_blkcount = op->allreduce.ring_pipeline.large_blkcount;
+    int32_t small_blkcount = op->allreduce.ring_pipeline.small_blkcount;
+    int32_t spilt_rank = op->allreduce.ring_pipeline.spilt_rank;
+    int32_t segcount = op->allreduce.ring_pipeline.segcount;
+    int32_t blkoffset = (block < spilt_rank) ? (block * large_blkcount) :
+                                               (block * small_blkcount + spilt_rank);
+    int32_t blkcount = (block < spilt_rank) ? large_blkcount : small_blkcount;
+    int32_t segoffset = seg * segcount;
+
+    *offset = blkoffset + segoffset;
+    *count = (segoffset >= blkcount) ? 0 : ucg_min(segcount, blkcount - segoffset);
+    return;
+}
+
+/**
+ * @brief Progress one phase of the pipelined ring.
+ *
+ * Every step of ring sends one block to the right and receives one block from
+ * the left, here the blocks are cut into segments and a unit is a segment of
+ * a step. The unit u of step s > 0 forwards what the unit u - nsegs received,
+ * so it is sent as soon as that one is completed instead of waiting for the
+ * whole step. Up to depth receives are posted ahead, in reduce-scatter they
+ * land in separate staging areas and one is reduced while the next ones are
+ * arriving.
+ *
+ * Units are sent and received in order with the same tag, so the order of
+ * matching is the order of units.
+ */
+static ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_phase(ucg_planc_ucx_op_t *op,
+                                                                int reduce)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_allreduce_args_t *args = &op->super.super.args.allreduce;
+    ucg_rank_t my_rank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_algo_ring_iter_t *iter = &op->allreduce.ring_pipeline.iter;
+    ucg_rank_t left_peer = ucg_algo_ring_iter_left_value(iter);
+    ucg_rank_t right_peer = ucg_algo_ring_iter_right_value(iter);
+    int32_t nsegs = op->allreduce.ring_pipeline.nsegs;
+    int32_t depth = op->allreduce.ring_pipeline.depth;
+    int32_t nunits = op->allreduce.ring_pipeline.nunits;
+    int32_t *sent = &op->allreduce.ring_pipeline.sent;
+    int32_t *posted = &op->allreduce.ring_pipeline.posted;
+    int32_t *completed = &op->allreduce.ring_pipeline.completed;
+    ucg_planc_ucx_p2p_req_t **requests = op->allreduce.ring_pipeline.requests;
+    void *staging_area = op->staging_area - args->dt->true_lb;
+    int64_t seg_size = op->allreduce.ring_pipeline.seg_size;
+    /* Blocks not reduced yet are read from sendbuf, it is not copied to recvbuf. */
+    void *sendbuf = (args->sendbuf != UCG_IN_PLACE) ? (void*)args->sendbuf : args->recvbuf;
+    /* The allgatherv phase sends the block reduced by me at first. */
+    int32_t shift = reduce ? 0 : 1;
+    int32_t offset;
+    int32_t count;
+
+    while (*completed < nunits) {
+        /* Send units whose data is ready. */
+        while (*sent < nunits && (*sent < nsegs || *sent - nsegs < *completed)) {
+            int32_t step_idx = *sent / nsegs;
+            int32_t sendblock = (my_rank + group_size - step_idx + shift) % group_size;
+            ucg_planc_ucx_allreduce_ring_pipeline_seg(op, sendblock, *sent % nsegs,
+                                                      &offset, &count);
+            if (count > 0) {
+                void *tmpsend = (reduce && step_idx == 0 ? sendbuf : args->recvbuf) +
+                                offset * dt_ext;
+                params.request = NULL;
+                status = ucg_planc_ucx_p2p_isend(tmpsend, count, args->dt,
+                                                 right_peer, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            ++*sent;
+        }
+
+        /* Receive ahead while there are free staging areas. */
+        while (*posted < nunits && *posted - *completed < depth) {
+            int32_t step_idx = *posted / nsegs;
+            int32_t slot = *posted % depth;
+            int32_t recvblock = (my_rank + group_size - step_idx - 1 + shift) % group_size;
+            ucg_planc_ucx_allreduce_ring_pipeline_seg(op, recvblock, *posted % nsegs,
+                                                      &offset, &count);
+            requests[slot] = NULL;
+            if (count > 0) {
+                void *tmprecv = reduce ? staging_area + slot * seg_size :
+                                         args->recvbuf + offset * dt_ext;
+                params.request = &requests[slot];
+                status = ucg_planc_ucx_p2p_irecv(tmprecv, count, args->dt,
+                                                 left_peer, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            ++*posted;
+        }
+
+        /* Complete units in order. */
+        int32_t slot = *completed % depth;
+        status = ucg_planc_ucx_p2p_test(op->ucx_group, &requests[slot]);
+        UCG_CHECK_GOTO(status, out);
+        if (reduce) {
+            int32_t step_idx = *completed / nsegs;
+            int32_t recvblock = (my_rank + group_size - step_idx - 1) % group_size;
+            ucg_planc_ucx_allreduce_ring_pipeline_seg(op, recvblock, *completed % nsegs,
+                                                      &offset, &count);
+            if (count > 0) {
+                status = ucg_op_reduce3(args->op, staging_area + slot * seg_size,
+                                        sendbuf + offset * dt_ext,
+                                        args->recvbuf + offset * dt_ext,
+                                        count, args->dt);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        ++*completed;
+    }
+
+    /* Blocks being sent may be overwritten by the next phase. */
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+    UCG_CHECK_GOTO(status, out);
+    *sent = *posted = *completed = 0;
+
+out:
+    return status;
+}
+
+/**
+ * @brief Pipelined ring algorithm for allreduce operation.
+ *
+ * Same as ring, but every step works on segments of its block, see
+ * @ref ucg_planc_ucx_allreduce_ring_pipeline_phase. Transfers of the next
+ * segments overlap the reduction of the current one, and a segment is
+ * forwarded once it is ready instead of waiting for the whole block.
+ *
+ * @note Limitations are the same as ring.
+ */
+static ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    if (ucg_test_flags(op->flags, UCG_RING_PIPELINE_REDUCE_SCATTER)) {
+        status = ucg_planc_ucx_allreduce_ring_pipeline_phase(op, 1);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_RING_PIPELINE_REDUCE_SCATTER);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_RING_PIPELINE_ALLGATHERV)) {
+        status = ucg_planc_ucx_allreduce_ring_pipeline_phase(op, 0);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_RING_PIPELINE_ALLGATHERV);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
+
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_RING_PIPELINE_FLAGS;
+    ucg_algo_ring_iter_reset(&op->allreduce.ring_pipeline.iter);
+    op->allreduce.ring_pipeline.sent = 0;
+    op->allreduce.ring_pipeline.posted = 0;
+    op->allreduce.ring_pipeline.completed = 0;
+
+    /* Special case for group size == 1 */
+    if (op->super.vgroup->size == 1) {
+        status = UCG_OK;
+        if (args->sendbuf != UCG_IN_PLACE) {
+            status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                                   args->sendbuf, args->count, args->dt);
+        }
+        op->super.super.status = status;
+        return status;
+    }
+
+    status = ucg_planc_ucx_allreduce_ring_pipeline_op_progress(ucg_op);
+    if (status == UCG_INPROGRESS) {
+        /* op is progressing and request start successfully */
+        status = UCG_OK;
+    }
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_op_init(ucg_planc_ucx_op_t *ucg_op,
+                                                                  ucg_planc_ucx_allreduce_config_t *config)
+{
+    ucg_coll_allreduce_args_t *args = &ucg_op->super.super.args.allreduce;
+    int32_t count = args->count;
+    uint32_t group_size = ucg_op->super.vgroup->size;
+    ucg_rank_t my_rank = ucg_op->super.vgroup->myrank;
+    ucg_dt_t *dt = args->dt;
+    int32_t large_blkcount = count / group_size;
+    int32_t small_blkcount = large_blkcount;
+    ucg_rank_t spilt_rank = count % group_size;
+    if (spilt_rank != 0) {
+        large_blkcount += 1;
+    }
+
+    int64_t segcount = config->ring_pipeline_segsize / ucg_dt_extent(dt);
+    if (segcount <= 0) {
+        segcount = 1;
+    } else if (segcount > large_blkcount) {
+        segcount = large_blkcount;
+    }
+    int32_t nsegs = (large_blkcount + segcount - 1) / segcount;
+    int32_t depth = ucg_max(config->ring_pipeline_depth, UCG_RING_PIPELINE_MIN_DEPTH);
+    int64_t seg_size = dt->true_extent + dt->extent * (segcount - 1);
+
+    ucg_op->allreduce.ring_pipeline.spilt_rank = spilt_rank;
+    ucg_op->allreduce.ring_pipeline.large_blkcount = large_blkcount;
+    ucg_op->allreduce.ring_pipeline.small_blkcount = small_blkcount;
+    ucg_op->allreduce.ring_pipeline.segcount = segcount;
+    ucg_op->allreduce.ring_pipeline.nsegs = nsegs;
+    ucg_op->allreduce.ring_pipeline.depth = depth;
+    ucg_op->allreduce.ring_pipeline.nunits = (group_size - 1) * nsegs;
+    ucg_op->allreduce.ring_pipeline.seg_size = seg_size;
+
+    void *scratch = NULL;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(ucg_op, seg_size * depth,
+                                                       sizeof(ucg_planc_ucx_p2p_req_t*) * depth,
+                                                       &scratch);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_op->allreduce.ring_pipeline.requests = (ucg_planc_ucx_p2p_req_t**)scratch;
+    ucg_algo_ring_iter_init(&ucg_op->allreduce.ring_pipeline.iter, group_size, my_rank);
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_allreduce_ring_pipeline_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                             ucg_vgroup_t *vgroup,
+                                             const ucg_coll_args_t *args,
+                                             ucg_planc_ucx_allreduce_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_allreduce_ring_pipeline_op_trigger,
+                                 ucg_planc_ucx_allreduce_ring_pipeline_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_allreduce_ring_pipeline_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize allreduce pipelined ring ucx op");
+        goto err_destruct;
+    }
+
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_allreduce_ring_pipeline_prepare(ucg_vgroup_t *vgroup,
+                                                           const ucg_coll_args_t *args,
+                                                           ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status;
+    status = ucg_planc_ucx_allreduce_ring_pipeline_check(vgroup, args);
+    if (status != UCG_OK) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_allreduce_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, allreduce,
+                                                         UCG_COLL_TYPE_ALLREDUCE);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allreduce_ring_pipeline_op_new(ucx_group, vgroup,
+                                                                              args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
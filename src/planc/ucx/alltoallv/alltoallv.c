@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_global.h"
+#include "util/ucg_log.h"
+
+#define PLAN_DOMAIN "planc ucx alltoallv"
+
+static ucg_plan_attr_t ucg_planc_ucx_alltoallv_plan_attr[] = {
+    {ucg_planc_ucx_alltoallv_pairwise_prepare,
+     1, "Pairwise", PLAN_DOMAIN},
+
+    {ucg_planc_ucx_alltoallv_bruck_prepare,
+     2, "Bruck", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_BRUCK},
+
+    {ucg_planc_ucx_alltoallv_na_prepare,
+     3, "Node-aware", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE},
+
+    {NULL},
+};
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_ALLTOALLV,
+                             ucg_planc_ucx_alltoallv_plan_attr);
+
+static ucg_config_field_t alltoallv_config_table[] = {
+    {"ALLTOALLV_PAIRWISE_BATCH", "1",
+     "Configure the number of steps in flight in pairwise algo for alltoallv",
+     ucg_offsetof(ucg_planc_ucx_alltoallv_config_t, pairwise_batch),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_ALLTOALLV, alltoallv_config_table,
+                                    sizeof(ucg_planc_ucx_alltoallv_config_t))
+
+/**
+ * The message size of alltoallv is the average block size of the rank, which
+ * is computed locally and differs across the ranks of an irregular exchange,
+ * so it can't be used to select a plan. Pairwise is the default everywhere:
+ * the leader of node-aware serializes the inter-node traffic of its node and
+ * Bruck forwards every block log(P) times, both only pay off for small and
+ * balanced messages, so they are enabled by ALLTOALLV_ATTR.
+ */
+static ucg_plan_policy_t alltoallv_plan_policy[] = {
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    UCG_PLAN_LAST_POLICY,
+};
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_alltoallv_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                 ucg_planc_ucx_ppn_level_t ppn_level)
+{
+    UCG_UNUSED(node_level, ppn_level);
+    ucg_plan_policy_t *policy = alltoallv_plan_policy;
+    return policy;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_self_copy(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+
+    if (args->sendbuf == UCG_IN_PLACE || args->recvcounts[myrank] == 0) {
+        return UCG_OK;
+    }
+    void *rbuf = (char*)args->recvbuf + args->rdispls[myrank] * ucg_dt_extent(args->recvtype);
+    const void *sbuf = (const char*)args->sendbuf +
+                       args->sdispls[myrank] * ucg_dt_extent(args->sendtype);
+    return ucg_dt_memcpy(rbuf, args->recvcounts[myrank], args->recvtype,
+                         sbuf, args->sendcounts[myrank], args->sendtype);
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_pool_reserve(ucg_planc_ucx_op_t *op, int64_t size)
+{
+    ucg_planc_ucx_alltoallv_t *alltoallv = &op->alltoallv;
+    if (size <= alltoallv->pool_size) {
+        return UCG_OK;
+    }
+
+    /**
+     * The pool may move, the caller makes sure that no p2p is using it. It's
+     * taken from the staging cache, so that the next op of the group reuses it.
+     */
+    int64_t new_size = ucg_max(size, alltoallv->pool_size * 2);
+    uint8_t *pool = ucg_bufcache_get(&op->ucx_group->staging_cache, new_size);
+    if (pool == NULL) {
+        ucg_error("Failed to grow alltoallv pool to %ld bytes", new_size);
+        return UCG_ERR_NO_MEMORY;
+    }
+    if (alltoallv->pool != NULL) {
+        memcpy(pool, alltoallv->pool, alltoallv->pool_size);
+        ucg_bufcache_put(alltoallv->pool);
+    }
+    alltoallv->pool = pool;
+    alltoallv->pool_size = new_size;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    if (op->alltoallv.pool != NULL) {
+        ucg_bufcache_put(op->alltoallv.pool);
+        op->alltoallv.pool = NULL;
+        op->alltoallv.pool_size = 0;
+    }
+    return ucg_planc_ucx_op_discard(ucg_op);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_ALLTOALLV_H_
+#define UCG_PLANC_UCX_ALLTOALLV_H_
+
+#include "planc/ucx/planc_ucx_def.h"
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_dt.h"
+
+typedef struct ucg_planc_ucx_alltoallv_config {
+    /* Max number of pairwise steps in flight */
+    int pairwise_batch;
+} ucg_planc_ucx_alltoallv_config_t;
+
+/**
+ * @brief Alltoallv op auxiliary information
+ *
+ * Bruck and node-aware forward packed blocks whose sizes are only known at
+ * run time, the packed blocks live in the pool which is kept across triggers.
+ */
+typedef struct ucg_planc_ucx_alltoallv {
+    uint8_t *pool;
+    int64_t pool_size;
+    union {
+        struct {
+            int32_t batch;
+            /* The next step to post, step i sends to myrank + i. */
+            int32_t step;
+        } pairwise;
+        struct {
+            /* Blocks of the positions with this bit set are exchanged. */
+            int32_t distance;
+            /**
+             * Position j starts with the block to (myrank + j) and ends with
+             * the block from (myrank - j), blocks keep their positions.
+             */
+            int64_t *lens;
+            int64_t *offsets;
+            /* Lengths of the exchanged positions, sent before the blocks. */
+            int64_t *send_lens;
+            int64_t *recv_lens;
+            int64_t pool_used;
+            int64_t recv_offset;
+        } bruck;
+        struct {
+            int32_t nnode;
+            int32_t mynode;
+            int32_t nlocal;
+            /* Ranks grouped by node in ascending order, the first one of a node is its leader. */
+            ucg_rank_t *members;
+            /* Members of node n are members[node_start[n], node_start[n + 1]) */
+            int32_t *node_start;
+            int32_t *node_of;
+            /**
+             * Bytes to send to and receive from the ranks of other nodes,
+             * the leader keeps one row per local rank, 2 * size each.
+             */
+            int64_t *lens;
+            /* Offsets of the per-node regions in the pool and the cursors in them. */
+            int64_t *send_offsets;
+            int64_t *recv_offsets;
+            int64_t *cursors;
+            /* Offsets of the payload of the local ranks in the pool of the leader. */
+            int64_t *local_offsets;
+        } na;
+    };
+} ucg_planc_ucx_alltoallv_t;
+
+/**
+ * @brief Get the number of bytes of the block to @a peer.
+ */
+static inline int64_t ucg_planc_ucx_alltoallv_send_bytes(const ucg_coll_alltoallv_args_t *args,
+                                                         ucg_rank_t peer)
+{
+    return args->sendcounts[peer] * (int64_t)ucg_dt_size(args->sendtype);
+}
+
+/**
+ * @brief Get the number of bytes of the block from @a peer.
+ */
+static inline int64_t ucg_planc_ucx_alltoallv_recv_bytes(const ucg_coll_alltoallv_args_t *args,
+                                                         ucg_rank_t peer)
+{
+    return args->recvcounts[peer] * (int64_t)ucg_dt_size(args->recvtype);
+}
+
+/**
+ * @brief Pack the block to @a peer into @a buffer.
+ */
+static inline ucg_status_t ucg_planc_ucx_alltoallv_pack(const ucg_coll_alltoallv_args_t *args,
+                                                        ucg_rank_t peer, void *buffer)
+{
+    const void *sbuf = (const char*)args->sendbuf +
+                       args->sdispls[peer] * ucg_dt_extent(args->sendtype);
+    return ucg_dt_memcpy(buffer, ucg_planc_ucx_alltoallv_send_bytes(args, peer),
+                         ucg_dt_get_predefined(UCG_DT_TYPE_UINT8),
+                         sbuf, args->sendcounts[peer], args->sendtype);
+}
+
+/**
+ * @brief Unpack the block from @a peer of @a len bytes.
+ */
+static inline ucg_status_t ucg_planc_ucx_alltoallv_unpack(const ucg_coll_alltoallv_args_t *args,
+                                                          ucg_rank_t peer, const void *buffer,
+                                                          int64_t len)
+{
+    void *rbuf = (char*)args->recvbuf + args->rdispls[peer] * ucg_dt_extent(args->recvtype);
+    return ucg_dt_memcpy(rbuf, args->recvcounts[peer], args->recvtype,
+                         buffer, len, ucg_dt_get_predefined(UCG_DT_TYPE_UINT8));
+}
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_alltoallv_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                 ucg_planc_ucx_ppn_level_t ppn_level);
+
+/* Common routines of the alltoallv algorithms */
+ucg_status_t ucg_planc_ucx_alltoallv_self_copy(ucg_planc_ucx_op_t *op);
+ucg_status_t ucg_planc_ucx_alltoallv_pool_reserve(ucg_planc_ucx_op_t *op, int64_t size);
+ucg_status_t ucg_planc_ucx_alltoallv_op_discard(ucg_plan_op_t *ucg_op);
+
+/* xxx_prepare routines are provided for core layer to creat collective request */
+ucg_status_t ucg_planc_ucx_alltoallv_pairwise_prepare(ucg_vgroup_t *vgroup,
+                                                      const ucg_coll_args_t *args,
+                                                      ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_alltoallv_bruck_prepare(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_args_t *args,
+                                                   ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_alltoallv_na_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op);
+
+#endif
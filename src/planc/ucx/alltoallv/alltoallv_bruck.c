@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+/* op flags needed by alltoallv bruck, both are set again for every distance. */
+enum {
+    UCG_ALLTOALLV_BRUCK_HEADER = UCG_BIT(0),
+    UCG_ALLTOALLV_BRUCK_PAYLOAD = UCG_BIT(1),
+};
+
+#define UCG_ALLTOALLV_BRUCK_FLAGS UCG_ALLTOALLV_BRUCK_HEADER | \
+                                  UCG_ALLTOALLV_BRUCK_PAYLOAD
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_check(ucg_vgroup_t *vgroup,
+                                                        const ucg_coll_args_t *args)
+{
+    UCG_UNUSED(vgroup);
+    if (args->alltoallv.sendbuf == UCG_IN_PLACE) {
+        ucg_info("Alltoallv bruck don't support in-place");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+/**
+ * @brief Exchange the lengths of the positions with the bit of distance set.
+ *
+ * The receiver learns the sizes of the blocks, which are variable, before
+ * posting the receive of them.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_header(ucg_planc_ucx_op_t *op,
+                                                         ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int32_t distance = op->alltoallv.bruck.distance;
+    int64_t *lens = op->alltoallv.bruck.lens;
+    int64_t *send_lens = op->alltoallv.bruck.send_lens;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_INT64);
+
+    int32_t nblocks = 0;
+    for (int32_t j = distance; j < group_size; ++j) {
+        if (j & distance) {
+            send_lens[nblocks++] = lens[j];
+        }
+    }
+    ucg_rank_t recv_peer = (myrank + group_size - distance) % group_size;
+    ucg_rank_t send_peer = (myrank + distance) % group_size;
+    status = ucg_planc_ucx_p2p_irecv(op->alltoallv.bruck.recv_lens, nblocks, dt,
+                                     recv_peer, op->tag, vgroup, params);
+    UCG_CHECK_GOTO(status, out);
+    status = ucg_planc_ucx_p2p_isend(send_lens, nblocks, dt,
+                                     send_peer, op->tag, vgroup, params);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_payload(ucg_planc_ucx_op_t *op,
+                                                          ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int32_t distance = op->alltoallv.bruck.distance;
+    int64_t *lens = op->alltoallv.bruck.lens;
+    int64_t *offsets = op->alltoallv.bruck.offsets;
+    int64_t *recv_lens = op->alltoallv.bruck.recv_lens;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+
+    int64_t send_total = 0;
+    int64_t recv_total = 0;
+    int32_t nblocks = 0;
+    for (int32_t j = distance; j < group_size; ++j) {
+        if (j & distance) {
+            send_total += lens[j];
+            recv_total += recv_lens[nblocks++];
+        }
+    }
+    /* Nothing is in flight, the pool is free to move. */
+    int64_t send_offset = op->alltoallv.bruck.pool_used;
+    int64_t recv_offset = send_offset + send_total;
+    status = ucg_planc_ucx_alltoallv_pool_reserve(op, recv_offset + recv_total);
+    UCG_CHECK_GOTO(status, out);
+    op->alltoallv.bruck.pool_used = recv_offset + recv_total;
+    op->alltoallv.bruck.recv_offset = recv_offset;
+
+    uint8_t *pool = op->alltoallv.pool;
+    uint8_t *packed = pool + send_offset;
+    for (int32_t j = distance; j < group_size; ++j) {
+        if (j & distance) {
+            memcpy(packed, pool + offsets[j], lens[j]);
+            packed += lens[j];
+        }
+    }
+
+    if (recv_total != 0) {
+        ucg_rank_t recv_peer = (myrank + group_size - distance) % group_size;
+        status = ucg_planc_ucx_p2p_irecv(pool + recv_offset, recv_total, dt,
+                                         recv_peer, op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    if (send_total != 0) {
+        ucg_rank_t send_peer = (myrank + distance) % group_size;
+        status = ucg_planc_ucx_p2p_isend(pool + send_offset, send_total, dt,
+                                         send_peer, op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief The received blocks take the places of the sent ones.
+ */
+static void ucg_planc_ucx_alltoallv_bruck_update(ucg_planc_ucx_op_t *op)
+{
+    uint32_t group_size = op->super.vgroup->size;
+    int32_t distance = op->alltoallv.bruck.distance;
+    int64_t *lens = op->alltoallv.bruck.lens;
+    int64_t *offsets = op->alltoallv.bruck.offsets;
+    int64_t *recv_lens = op->alltoallv.bruck.recv_lens;
+    int64_t offset = op->alltoallv.bruck.recv_offset;
+
+    int32_t nblocks = 0;
+    for (int32_t j = distance; j < group_size; ++j) {
+        if (j & distance) {
+            lens[j] = recv_lens[nblocks++];
+            offsets[j] = offset;
+            offset += lens[j];
+        }
+    }
+    return;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_unpack(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+    uint32_t group_size = op->super.vgroup->size;
+    int64_t *lens = op->alltoallv.bruck.lens;
+    int64_t *offsets = op->alltoallv.bruck.offsets;
+
+    for (int32_t j = 1; j < group_size; ++j) {
+        ucg_rank_t peer = (myrank + group_size - j) % group_size;
+        if (lens[j] == 0 && args->recvcounts[peer] == 0) {
+            continue;
+        }
+        status = ucg_planc_ucx_alltoallv_unpack(args, peer, op->alltoallv.pool + offsets[j],
+                                                lens[j]);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    uint32_t group_size = op->super.vgroup->size;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (op->alltoallv.bruck.distance < group_size) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_BRUCK_HEADER)) {
+            status = ucg_planc_ucx_alltoallv_bruck_header(op, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_BRUCK_PAYLOAD)) {
+            status = ucg_planc_ucx_alltoallv_bruck_payload(op, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        ucg_planc_ucx_alltoallv_bruck_update(op);
+        op->alltoallv.bruck.distance <<= 1;
+        op->flags |= UCG_ALLTOALLV_BRUCK_FLAGS;
+    }
+    status = ucg_planc_ucx_alltoallv_bruck_unpack(op);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_alltoallv_args_t *args = &ucg_op->super.args.alltoallv;
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+    uint32_t group_size = op->super.vgroup->size;
+    int64_t *lens = op->alltoallv.bruck.lens;
+    int64_t *offsets = op->alltoallv.bruck.offsets;
+
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_ALLTOALLV_BRUCK_FLAGS;
+    op->alltoallv.bruck.distance = 1;
+
+    status = ucg_planc_ucx_alltoallv_self_copy(op);
+    UCG_CHECK_GOTO(status, out);
+
+    /* Rotate the blocks into the pool, position 0 is my own block. */
+    int64_t total = 0;
+    for (int32_t j = 1; j < group_size; ++j) {
+        ucg_rank_t peer = (myrank + j) % group_size;
+        lens[j] = ucg_planc_ucx_alltoallv_send_bytes(args, peer);
+        offsets[j] = total;
+        total += lens[j];
+    }
+    status = ucg_planc_ucx_alltoallv_pool_reserve(op, total);
+    UCG_CHECK_GOTO(status, out);
+    op->alltoallv.bruck.pool_used = total;
+    for (int32_t j = 1; j < group_size; ++j) {
+        if (lens[j] == 0) {
+            continue;
+        }
+        ucg_rank_t peer = (myrank + j) % group_size;
+        status = ucg_planc_ucx_alltoallv_pack(args, peer, op->alltoallv.pool + offsets[j]);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+    status = ucg_planc_ucx_alltoallv_bruck_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_bruck_op_init(ucg_planc_ucx_op_t *op)
+{
+    uint32_t group_size = op->super.vgroup->size;
+    /* No more than half of the positions are exchanged for a distance. */
+    int32_t max_blocks = group_size / 2 + 1;
+    size_t size = sizeof(int64_t) * (2 * group_size + 2 * max_blocks);
+
+    op->alltoallv.pool = NULL;
+    op->alltoallv.pool_size = 0;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, size, 0, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    int64_t *lens = (int64_t*)op->staging_area;
+    op->alltoallv.bruck.lens = lens;
+    op->alltoallv.bruck.offsets = lens + group_size;
+    op->alltoallv.bruck.send_lens = lens + 2 * group_size;
+    op->alltoallv.bruck.recv_lens = lens + 2 * group_size + max_blocks;
+    /* Position 0 stays in place. */
+    lens[0] = 0;
+    op->alltoallv.bruck.offsets[0] = 0;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_alltoallv_bruck_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                     ucg_vgroup_t *vgroup,
+                                     const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_alltoallv_bruck_op_trigger,
+                                 ucg_planc_ucx_alltoallv_bruck_op_progress,
+                                 ucg_planc_ucx_alltoallv_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_alltoallv_bruck_op_init(ucx_op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize alltoallv bruck ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_bruck_prepare(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_args_t *args,
+                                                   ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status;
+    status = ucg_planc_ucx_alltoallv_bruck_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_alltoallv_bruck_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
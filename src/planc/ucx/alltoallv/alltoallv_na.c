@@ -0,0 +1,717 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+
+/**
+ * Node-aware alltoallv
+ *
+ * The blocks between the ranks of a node are exchanged directly. The blocks
+ * to other nodes are gathered on the leader of the node, the leaders exchange
+ * one message per pair of nodes and scatter what they receive to the ranks of
+ * their node. Every rank tells its leader the bytes it sends to and receives
+ * from the ranks of other nodes, so that all receives are posted with the
+ * exact size.
+ *
+ * The region sent from node A to node B is ordered by the rank of B first and
+ * then by the rank of A, so the part of the region for a rank of B is
+ * contiguous and is scattered without copy.
+ */
+
+/* op flags needed by node-aware alltoallv. */
+enum {
+    UCG_ALLTOALLV_NA_INTRA = UCG_BIT(0),
+    UCG_ALLTOALLV_NA_GATHER = UCG_BIT(1),
+    UCG_ALLTOALLV_NA_EXCHANGE = UCG_BIT(2),
+    UCG_ALLTOALLV_NA_SCATTER = UCG_BIT(3),
+    UCG_ALLTOALLV_NA_UNPACK = UCG_BIT(4),
+};
+
+#define UCG_ALLTOALLV_NA_LEADER_FLAGS UCG_ALLTOALLV_NA_INTRA | \
+                                      UCG_ALLTOALLV_NA_GATHER | \
+                                      UCG_ALLTOALLV_NA_EXCHANGE | \
+                                      UCG_ALLTOALLV_NA_SCATTER
+
+#define UCG_ALLTOALLV_NA_MEMBER_FLAGS UCG_ALLTOALLV_NA_INTRA | \
+                                      UCG_ALLTOALLV_NA_UNPACK
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_check(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args)
+{
+    if (args->alltoallv.sendbuf == UCG_IN_PLACE) {
+        ucg_info("Alltoallv node-aware don't support in-place");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Alltoallv node-aware don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Alltoallv node-aware don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+static inline ucg_rank_t ucg_planc_ucx_alltoallv_na_leader(ucg_planc_ucx_op_t *op, int32_t node)
+{
+    return op->alltoallv.na.members[op->alltoallv.na.node_start[node]];
+}
+
+static inline int ucg_planc_ucx_alltoallv_na_is_leader(ucg_planc_ucx_op_t *op)
+{
+    int32_t mynode = op->alltoallv.na.mynode;
+    return op->super.vgroup->myrank == ucg_planc_ucx_alltoallv_na_leader(op, mynode);
+}
+
+/**
+ * @brief Get the bytes that the local rank of the row receives from node @a node.
+ */
+static int64_t ucg_planc_ucx_alltoallv_na_node_recv_bytes(ucg_planc_ucx_op_t *op,
+                                                          const int64_t *row, int32_t node)
+{
+    const int64_t *recv_lens = row + op->super.vgroup->size;
+    const ucg_rank_t *members = op->alltoallv.na.members;
+    int64_t total = 0;
+    for (int32_t i = op->alltoallv.na.node_start[node];
+         i < op->alltoallv.na.node_start[node + 1]; ++i) {
+        total += recv_lens[members[i]];
+    }
+    return total;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_intra(ucg_planc_ucx_op_t *op,
+                                                     ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t mynode = op->alltoallv.na.mynode;
+    const ucg_rank_t *members = op->alltoallv.na.members;
+    int64_t rextent = ucg_dt_extent(args->recvtype);
+    int64_t sextent = ucg_dt_extent(args->sendtype);
+
+    for (int32_t i = op->alltoallv.na.node_start[mynode];
+         i < op->alltoallv.na.node_start[mynode + 1]; ++i) {
+        ucg_rank_t peer = members[i];
+        if (peer == myrank) {
+            continue;
+        }
+        if (args->recvcounts[peer] != 0) {
+            void *rbuf = (char*)args->recvbuf + args->rdispls[peer] * rextent;
+            status = ucg_planc_ucx_p2p_irecv(rbuf, args->recvcounts[peer], args->recvtype,
+                                             peer, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        if (args->sendcounts[peer] != 0) {
+            const void *sbuf = (const char*)args->sendbuf + args->sdispls[peer] * sextent;
+            status = ucg_planc_ucx_p2p_isend(sbuf, args->sendcounts[peer], args->sendtype,
+                                             peer, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Fill my row: bytes to the ranks of other nodes, then bytes from them.
+ *
+ * @return the bytes to other nodes.
+ */
+static int64_t ucg_planc_ucx_alltoallv_na_fill_row(ucg_planc_ucx_op_t *op, int64_t *row)
+{
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    uint32_t group_size = op->super.vgroup->size;
+    int32_t mynode = op->alltoallv.na.mynode;
+    const int32_t *node_of = op->alltoallv.na.node_of;
+
+    int64_t total = 0;
+    for (ucg_rank_t peer = 0; peer < group_size; ++peer) {
+        if (node_of[peer] == mynode) {
+            row[peer] = 0;
+            row[group_size + peer] = 0;
+            continue;
+        }
+        row[peer] = ucg_planc_ucx_alltoallv_send_bytes(args, peer);
+        row[group_size + peer] = ucg_planc_ucx_alltoallv_recv_bytes(args, peer);
+        total += row[peer];
+    }
+    return total;
+}
+
+/**
+ * @brief Pack my blocks to other nodes in the order of the destination rank.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_pack(ucg_planc_ucx_op_t *op, const int64_t *row,
+                                                    uint8_t *buffer)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    uint32_t group_size = op->super.vgroup->size;
+
+    for (ucg_rank_t peer = 0; peer < group_size; ++peer) {
+        if (row[peer] == 0) {
+            continue;
+        }
+        status = ucg_planc_ucx_alltoallv_pack(args, peer, buffer);
+        UCG_CHECK_GOTO(status, out);
+        buffer += row[peer];
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Unpack the blocks from node @a node of @a row which start at @a buffer.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_unpack(ucg_planc_ucx_op_t *op, const int64_t *row,
+                                                      int32_t node, const uint8_t *buffer)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    const int64_t *recv_lens = row + op->super.vgroup->size;
+    const ucg_rank_t *members = op->alltoallv.na.members;
+
+    for (int32_t i = op->alltoallv.na.node_start[node];
+         i < op->alltoallv.na.node_start[node + 1]; ++i) {
+        ucg_rank_t peer = members[i];
+        if (recv_lens[peer] == 0 && args->recvcounts[peer] == 0) {
+            continue;
+        }
+        status = ucg_planc_ucx_alltoallv_unpack(args, peer, buffer, recv_lens[peer]);
+        UCG_CHECK_GOTO(status, out);
+        buffer += recv_lens[peer];
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Non-leader posts everything at once.
+ *
+ * The messages to and from the leader are matched in posting order: the
+ * direct block, then the lengths and the payload to the leader, then one
+ * message per other node from the leader.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_member_post(ucg_planc_ucx_op_t *op,
+                                                           ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t nnode = op->alltoallv.na.nnode;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int64_t *row = op->alltoallv.na.lens;
+    int64_t *recv_offsets = op->alltoallv.na.recv_offsets;
+    ucg_rank_t leader = ucg_planc_ucx_alltoallv_na_leader(op, mynode);
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+
+    status = ucg_planc_ucx_alltoallv_na_intra(op, params);
+    UCG_CHECK_GOTO(status, out);
+
+    int64_t send_total = ucg_planc_ucx_alltoallv_na_fill_row(op, row);
+    int64_t offset = send_total;
+    for (int32_t node = 0; node < nnode; ++node) {
+        recv_offsets[node] = offset;
+        if (node != mynode) {
+            offset += ucg_planc_ucx_alltoallv_na_node_recv_bytes(op, row, node);
+        }
+    }
+    recv_offsets[nnode] = offset;
+    status = ucg_planc_ucx_alltoallv_pool_reserve(op, offset);
+    UCG_CHECK_GOTO(status, out);
+
+    uint8_t *pool = op->alltoallv.pool;
+    status = ucg_planc_ucx_alltoallv_na_pack(op, row, pool);
+    UCG_CHECK_GOTO(status, out);
+
+    status = ucg_planc_ucx_p2p_isend(row, 2 * group_size, ucg_dt_get_predefined(UCG_DT_TYPE_INT64),
+                                     leader, op->tag, vgroup, params);
+    UCG_CHECK_GOTO(status, out);
+    if (send_total != 0) {
+        status = ucg_planc_ucx_p2p_isend(pool, send_total, dt, leader, op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    for (int32_t node = 0; node < nnode; ++node) {
+        int64_t len = recv_offsets[node + 1] - recv_offsets[node];
+        if (len == 0) {
+            continue;
+        }
+        status = ucg_planc_ucx_p2p_irecv(pool + recv_offsets[node], len, dt,
+                                         leader, op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_member_unpack(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    int32_t nnode = op->alltoallv.na.nnode;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int64_t *recv_offsets = op->alltoallv.na.recv_offsets;
+
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        status = ucg_planc_ucx_alltoallv_na_unpack(op, op->alltoallv.na.lens, node,
+                                                   op->alltoallv.pool + recv_offsets[node]);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_leader_intra(ucg_planc_ucx_op_t *op,
+                                                            ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int32_t start = op->alltoallv.na.node_start[mynode];
+    int64_t *lens = op->alltoallv.na.lens;
+
+    status = ucg_planc_ucx_alltoallv_na_intra(op, params);
+    UCG_CHECK_GOTO(status, out);
+
+    /* I'm the first member of my node, my row is the first one. */
+    ucg_planc_ucx_alltoallv_na_fill_row(op, lens);
+    for (int32_t l = 1; l < op->alltoallv.na.nlocal; ++l) {
+        status = ucg_planc_ucx_p2p_irecv(lens + 2 * group_size * l, 2 * group_size,
+                                         ucg_dt_get_predefined(UCG_DT_TYPE_INT64),
+                                         op->alltoallv.na.members[start + l],
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Lay out the pool and receive the payload of the local ranks.
+ *
+ * The pool of the leader is [payloads of local ranks][regions to other nodes]
+ * [regions from other nodes].
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_leader_gather(ucg_planc_ucx_op_t *op,
+                                                             ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t nnode = op->alltoallv.na.nnode;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int32_t nlocal = op->alltoallv.na.nlocal;
+    int32_t start = op->alltoallv.na.node_start[mynode];
+    const int32_t *node_of = op->alltoallv.na.node_of;
+    int64_t *lens = op->alltoallv.na.lens;
+    int64_t *local_offsets = op->alltoallv.na.local_offsets;
+    int64_t *send_offsets = op->alltoallv.na.send_offsets;
+    int64_t *recv_offsets = op->alltoallv.na.recv_offsets;
+    int64_t *cursors = op->alltoallv.na.cursors;
+
+    /* Count the bytes to every node in the cursors first. */
+    for (int32_t node = 0; node < nnode; ++node) {
+        cursors[node] = 0;
+    }
+    int64_t offset = 0;
+    for (int32_t l = 0; l < nlocal; ++l) {
+        const int64_t *row = lens + 2 * group_size * l;
+        local_offsets[l] = offset;
+        for (ucg_rank_t peer = 0; peer < group_size; ++peer) {
+            offset += row[peer];
+            cursors[node_of[peer]] += row[peer];
+        }
+    }
+    local_offsets[nlocal] = offset;
+    for (int32_t node = 0; node < nnode; ++node) {
+        send_offsets[node] = offset;
+        offset += cursors[node];
+    }
+    send_offsets[nnode] = offset;
+    for (int32_t node = 0; node < nnode; ++node) {
+        recv_offsets[node] = offset;
+        if (node == mynode) {
+            continue;
+        }
+        for (int32_t l = 0; l < nlocal; ++l) {
+            offset += ucg_planc_ucx_alltoallv_na_node_recv_bytes(op, lens + 2 * group_size * l,
+                                                                 node);
+        }
+    }
+    recv_offsets[nnode] = offset;
+    status = ucg_planc_ucx_alltoallv_pool_reserve(op, offset);
+    UCG_CHECK_GOTO(status, out);
+
+    uint8_t *pool = op->alltoallv.pool;
+    status = ucg_planc_ucx_alltoallv_na_pack(op, lens, pool);
+    UCG_CHECK_GOTO(status, out);
+    for (int32_t l = 1; l < nlocal; ++l) {
+        int64_t len = local_offsets[l + 1] - local_offsets[l];
+        if (len == 0) {
+            continue;
+        }
+        status = ucg_planc_ucx_p2p_irecv(pool + local_offsets[l], len,
+                                         ucg_dt_get_predefined(UCG_DT_TYPE_UINT8),
+                                         op->alltoallv.na.members[start + l],
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Regroup the payloads by node and exchange them between leaders.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_leader_exchange(ucg_planc_ucx_op_t *op,
+                                                               ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t nnode = op->alltoallv.na.nnode;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int32_t nlocal = op->alltoallv.na.nlocal;
+    const int32_t *node_of = op->alltoallv.na.node_of;
+    int64_t *lens = op->alltoallv.na.lens;
+    int64_t *local_offsets = op->alltoallv.na.local_offsets;
+    int64_t *send_offsets = op->alltoallv.na.send_offsets;
+    int64_t *recv_offsets = op->alltoallv.na.recv_offsets;
+    int64_t *cursors = op->alltoallv.na.cursors;
+    uint8_t *pool = op->alltoallv.pool;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+
+    /* The payload of a local rank is in the order of the destination rank. */
+    for (int32_t node = 0; node < nnode; ++node) {
+        cursors[node] = send_offsets[node];
+    }
+    for (ucg_rank_t peer = 0; peer < group_size; ++peer) {
+        int32_t node = node_of[peer];
+        if (node == mynode) {
+            continue;
+        }
+        for (int32_t l = 0; l < nlocal; ++l) {
+            int64_t len = lens[2 * group_size * l + peer];
+            if (len == 0) {
+                continue;
+            }
+            memcpy(pool + cursors[node], pool + local_offsets[l], len);
+            cursors[node] += len;
+            local_offsets[l] += len;
+        }
+    }
+
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t peer = ucg_planc_ucx_alltoallv_na_leader(op, node);
+        int64_t len = recv_offsets[node + 1] - recv_offsets[node];
+        if (len != 0) {
+            status = ucg_planc_ucx_p2p_irecv(pool + recv_offsets[node], len, dt,
+                                             peer, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        len = send_offsets[node + 1] - send_offsets[node];
+        if (len != 0) {
+            status = ucg_planc_ucx_p2p_isend(pool + send_offsets[node], len, dt,
+                                             peer, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Scatter the regions from other nodes to the local ranks.
+ *
+ * A region from another node is ordered by the local rank first, so the part
+ * of a local rank is contiguous.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_leader_scatter(ucg_planc_ucx_op_t *op,
+                                                              ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t nnode = op->alltoallv.na.nnode;
+    int32_t mynode = op->alltoallv.na.mynode;
+    int32_t nlocal = op->alltoallv.na.nlocal;
+    int32_t start = op->alltoallv.na.node_start[mynode];
+    int64_t *lens = op->alltoallv.na.lens;
+    int64_t *recv_offsets = op->alltoallv.na.recv_offsets;
+    int64_t *cursors = op->alltoallv.na.cursors;
+    uint8_t *pool = op->alltoallv.pool;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+
+    for (int32_t node = 0; node < nnode; ++node) {
+        cursors[node] = recv_offsets[node];
+    }
+    for (int32_t l = 0; l < nlocal; ++l) {
+        const int64_t *row = lens + 2 * group_size * l;
+        for (int32_t node = 0; node < nnode; ++node) {
+            if (node == mynode) {
+                continue;
+            }
+            int64_t len = ucg_planc_ucx_alltoallv_na_node_recv_bytes(op, row, node);
+            if (l == 0) {
+                status = ucg_planc_ucx_alltoallv_na_unpack(op, row, node, pool + cursors[node]);
+                UCG_CHECK_GOTO(status, out);
+            } else if (len != 0) {
+                status = ucg_planc_ucx_p2p_isend(pool + cursors[node], len, dt,
+                                                 op->alltoallv.na.members[start + l],
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            cursors[node] += len;
+        }
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_leader_progress(ucg_planc_ucx_op_t *op,
+                                                               ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_INTRA)) {
+        status = ucg_planc_ucx_alltoallv_na_leader_intra(op, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_GATHER)) {
+        status = ucg_planc_ucx_alltoallv_na_leader_gather(op, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_EXCHANGE)) {
+        status = ucg_planc_ucx_alltoallv_na_leader_exchange(op, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_SCATTER)) {
+        status = ucg_planc_ucx_alltoallv_na_leader_scatter(op, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_member_progress(ucg_planc_ucx_op_t *op,
+                                                               ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_INTRA)) {
+        status = ucg_planc_ucx_alltoallv_na_member_post(op, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_NA_UNPACK)) {
+        status = ucg_planc_ucx_alltoallv_na_member_unpack(op);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (ucg_planc_ucx_alltoallv_na_is_leader(op)) {
+        status = ucg_planc_ucx_alltoallv_na_leader_progress(op, &params);
+    } else {
+        status = ucg_planc_ucx_alltoallv_na_member_progress(op, &params);
+    }
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_planc_ucx_alltoallv_na_is_leader(op)) {
+        op->flags = UCG_ALLTOALLV_NA_LEADER_FLAGS;
+    } else {
+        op->flags = UCG_ALLTOALLV_NA_MEMBER_FLAGS;
+    }
+
+    status = ucg_planc_ucx_alltoallv_self_copy(op);
+    if (status != UCG_OK) {
+        op->super.super.status = status;
+        return status;
+    }
+
+    status = ucg_planc_ucx_alltoallv_na_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+/**
+ * @brief Group the ranks by node, the leader of a node is its smallest rank.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_init(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+    int32_t nnode = topo->detail.nnode;
+    int32_t mynode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, myrank),
+                                              UCG_TOPO_LOC_NODE_ID);
+
+    int32_t nlocal = 0;
+    ucg_rank_t leader = UCG_INVALID_RANK;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id == mynode) {
+            leader = nlocal++ == 0 ? rank : leader;
+        }
+    }
+    /* Member has only one row, the leader has one row per local rank. */
+    int32_t nrows = myrank == leader ? nlocal : 1;
+
+    op->alltoallv.pool = NULL;
+    op->alltoallv.pool_size = 0;
+    size_t size = sizeof(int64_t) * (2 * group_size * nrows + 3 * (nnode + 1) + nlocal + 1) +
+                  sizeof(int32_t) * (2 * group_size + 2 * (nnode + 1));
+    status = ucg_planc_ucx_op_get_staging(op, size, 0, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    int64_t *lens = (int64_t*)op->staging_area;
+    op->alltoallv.na.lens = lens;
+    op->alltoallv.na.send_offsets = lens + 2 * group_size * nrows;
+    op->alltoallv.na.recv_offsets = op->alltoallv.na.send_offsets + (nnode + 1);
+    op->alltoallv.na.cursors = op->alltoallv.na.recv_offsets + (nnode + 1);
+    op->alltoallv.na.local_offsets = op->alltoallv.na.cursors + (nnode + 1);
+    int32_t *node_of = (int32_t*)(op->alltoallv.na.local_offsets + nlocal + 1);
+    int32_t *members = node_of + group_size;
+    int32_t *node_start = members + group_size;
+    int32_t *fill = node_start + (nnode + 1);
+    op->alltoallv.na.node_of = node_of;
+    op->alltoallv.na.members = members;
+    op->alltoallv.na.node_start = node_start;
+    op->alltoallv.na.nnode = nnode;
+    op->alltoallv.na.mynode = mynode;
+    op->alltoallv.na.nlocal = nlocal;
+
+    for (int32_t node = 0; node <= nnode; ++node) {
+        node_start[node] = 0;
+    }
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        node_of[rank] = topo->detail.locations[group_rank].node_id;
+        ++node_start[node_of[rank] + 1];
+    }
+    for (int32_t node = 0; node < nnode; ++node) {
+        node_start[node + 1] += node_start[node];
+        fill[node] = node_start[node];
+    }
+    /* Counting sort keeps the ranks of a node in ascending order. */
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        members[fill[node_of[rank]]++] = rank;
+    }
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_alltoallv_na_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                  ucg_vgroup_t *vgroup,
+                                  const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_alltoallv_na_op_trigger,
+                                 ucg_planc_ucx_alltoallv_na_op_progress,
+                                 ucg_planc_ucx_alltoallv_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_alltoallv_na_op_init(ucx_op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize alltoallv node-aware ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_na_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status;
+    status = ucg_planc_ucx_alltoallv_na_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_alltoallv_na_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
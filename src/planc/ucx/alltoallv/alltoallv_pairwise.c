@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+enum {
+    UCG_ALLTOALLV_PAIRWISE_POST = UCG_BIT(0),
+};
+
+/**
+ * @brief Peer of the step when the exchange is in place.
+ *
+ * The block to a peer and the block from it share the same place in recvbuf,
+ * so both directions go to one peer in the same step. (step - myrank) pairs
+ * the ranks symmetrically and visits every peer once in steps [0, group_size).
+ */
+static inline ucg_rank_t ucg_planc_ucx_alltoallv_pairwise_inplace_peer(ucg_rank_t myrank,
+                                                                       uint32_t group_size,
+                                                                       int32_t step)
+{
+    return (step + group_size - myrank) % group_size;
+}
+
+/**
+ * @brief Copy the blocks of the batch out of recvbuf before they are overwritten.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_stage(ucg_planc_ucx_op_t *op,
+                                                           int32_t nsteps)
+{
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int32_t step = op->alltoallv.pairwise.step;
+    int64_t extent = ucg_dt_extent(args->recvtype);
+
+    int64_t size = 0;
+    for (int32_t i = 0; i < nsteps; ++i) {
+        ucg_rank_t peer = ucg_planc_ucx_alltoallv_pairwise_inplace_peer(myrank, group_size,
+                                                                        step + i);
+        if (peer != myrank) {
+            size += ucg_planc_ucx_alltoallv_recv_bytes(args, peer);
+        }
+    }
+    ucg_status_t status = ucg_planc_ucx_alltoallv_pool_reserve(op, size);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    uint8_t *buffer = op->alltoallv.pool;
+    for (int32_t i = 0; i < nsteps; ++i) {
+        ucg_rank_t peer = ucg_planc_ucx_alltoallv_pairwise_inplace_peer(myrank, group_size,
+                                                                        step + i);
+        if (peer == myrank) {
+            continue;
+        }
+        int64_t len = ucg_planc_ucx_alltoallv_recv_bytes(args, peer);
+        status = ucg_dt_memcpy(buffer, len, ucg_dt_get_predefined(UCG_DT_TYPE_UINT8),
+                               (char*)args->recvbuf + args->rdispls[peer] * extent,
+                               args->recvcounts[peer], args->recvtype);
+        if (status != UCG_OK) {
+            return status;
+        }
+        buffer += len;
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_post(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int32_t step = op->alltoallv.pairwise.step;
+    int32_t nsteps = ucg_min(op->alltoallv.pairwise.batch, (int32_t)group_size - step);
+    int in_place = args->sendbuf == UCG_IN_PLACE;
+    int64_t rextent = ucg_dt_extent(args->recvtype);
+    int64_t sextent = in_place ? 0 : ucg_dt_extent(args->sendtype);
+    uint8_t *staged = NULL;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (in_place) {
+        status = ucg_planc_ucx_alltoallv_pairwise_stage(op, nsteps);
+        UCG_CHECK_GOTO(status, out);
+        staged = op->alltoallv.pool;
+    }
+
+    for (int32_t i = 0; i < nsteps; ++i, ++step) {
+        ucg_rank_t recv_peer;
+        ucg_rank_t send_peer;
+        if (in_place) {
+            recv_peer = ucg_planc_ucx_alltoallv_pairwise_inplace_peer(myrank, group_size, step);
+            if (recv_peer == myrank) {
+                continue;
+            }
+            send_peer = recv_peer;
+        } else {
+            recv_peer = (myrank + group_size - step) % group_size;
+            send_peer = (myrank + step) % group_size;
+        }
+        if (args->recvcounts[recv_peer] != 0) {
+            void *rbuf = (char*)args->recvbuf + args->rdispls[recv_peer] * rextent;
+            status = ucg_planc_ucx_p2p_irecv(rbuf, args->recvcounts[recv_peer], args->recvtype,
+                                             recv_peer, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        if (in_place) {
+            int64_t len = ucg_planc_ucx_alltoallv_recv_bytes(args, send_peer);
+            if (len != 0) {
+                status = ucg_planc_ucx_p2p_isend(staged, len,
+                                                 ucg_dt_get_predefined(UCG_DT_TYPE_UINT8),
+                                                 send_peer, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            staged += len;
+        } else if (args->sendcounts[send_peer] != 0) {
+            const void *sbuf = (const char*)args->sendbuf + args->sdispls[send_peer] * sextent;
+            status = ucg_planc_ucx_p2p_isend(sbuf, args->sendcounts[send_peer], args->sendtype,
+                                             send_peer, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+    op->alltoallv.pairwise.step = step;
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    uint32_t group_size = op->super.vgroup->size;
+
+    while (op->alltoallv.pairwise.step < group_size) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_PAIRWISE_POST)) {
+            status = ucg_planc_ucx_alltoallv_pairwise_post(op);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, &op->p2p_state);
+        UCG_CHECK_GOTO(status, out);
+        op->flags |= UCG_ALLTOALLV_PAIRWISE_POST;
+    }
+    /* The last batch may still be in flight. */
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, &op->p2p_state);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_ALLTOALLV_PAIRWISE_POST;
+    /* Out of place, step 0 is the self block which is copied locally. */
+    op->alltoallv.pairwise.step =
+        op->super.super.args.alltoallv.sendbuf == UCG_IN_PLACE ? 0 : 1;
+
+    status = ucg_planc_ucx_alltoallv_self_copy(op);
+    if (status != UCG_OK) {
+        op->super.super.status = status;
+        return status;
+    }
+
+    status = ucg_planc_ucx_alltoallv_pairwise_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_alltoallv_pairwise_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                        ucg_vgroup_t *vgroup,
+                                        const ucg_coll_args_t *args,
+                                        ucg_planc_ucx_alltoallv_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_alltoallv_pairwise_op_trigger,
+                                 ucg_planc_ucx_alltoallv_pairwise_op_progress,
+                                 ucg_planc_ucx_alltoallv_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucx_op->alltoallv.pool = NULL;
+    ucx_op->alltoallv.pool_size = 0;
+    ucx_op->alltoallv.pairwise.batch = ucg_max(config->pairwise_batch, 1);
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_pairwise_prepare(ucg_vgroup_t *vgroup,
+                                                      const ucg_coll_args_t *args,
+                                                      ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_alltoallv_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, alltoallv,
+                                                         UCG_COLL_TYPE_ALLTOALLV);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_alltoallv_pairwise_op_new(ucx_group, vgroup,
+                                                                         args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
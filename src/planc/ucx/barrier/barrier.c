@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "barrier.h"
@@ -11,31 +11,40 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_barrier_plan_attr[] = {
     {ucg_planc_ucx_barrier_rd_prepare,
-     1, "Recursive doubling", PLAN_DOMAIN},
+     1, "Recursive doubling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_barrier_na_rd_and_bntree_prepare,
-     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_barrier_sa_rd_and_bntree_prepare,
-     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_barrier_na_rd_and_kntree_prepare,
-     4, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     4, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_barrier_sa_rd_and_kntree_prepare,
-     5, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     5, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_barrier_na_kntree_prepare,
-     6, "Node-aware k-nomial tree", PLAN_DOMAIN},
+     6, "Node-aware k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_barrier_sa_kntree_prepare,
-     7, "Socket-aware k-nomial tree", PLAN_DOMAIN},
+     7, "Socket-aware k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_barrier_na_inc_prepare,
-     8, "Node-aware in-network-computing", PLAN_DOMAIN},
+     8, "Node-aware in-network-computing", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE},
 
     {ucg_planc_ucx_barrier_sa_inc_prepare,
-     9, "Socket-aware in-network-computing", PLAN_DOMAIN},
+     9, "Socket-aware in-network-computing", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE},
 
     {NULL},
 };
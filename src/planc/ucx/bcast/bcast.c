@@ -11,43 +11,55 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_bcast_plan_attr[] = {
     {ucg_planc_ucx_bcast_bntree_prepare,
-     1, "Binomial tree", PLAN_DOMAIN},
+     1, "Binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_bcast_na_bntree_prepare,
-     2, "Node-aware binomial tree", PLAN_DOMAIN},
+     2, "Node-aware binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_bcast_na_kntree_and_bntree_prepare,
-     3, "Node-aware k-nomial tree and binomial tree", PLAN_DOMAIN},
+     3, "Node-aware k-nomial tree and binomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_bcast_na_kntree_prepare,
-     4, "Node-aware k-nomial tree", PLAN_DOMAIN},
+     4, "Node-aware k-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_bcast_na_inc_prepare,
-     5, "Node-aware in-network-computing", PLAN_DOMAIN},
+     5, "Node-aware in-network-computing", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE},
 
     {ucg_planc_ucx_bcast_ring_prepare,
-     6, "Ring", PLAN_DOMAIN},
+     6, "Ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     // {ucg_planc_ucx_bcast_nta_kntree_prepare,
     //  7, "Net-topo-aware k-nomial tree", PLAN_DOMAIN},
 
     {ucg_planc_ucx_bcast_van_de_geijn_prepare,
-     8, "van de Geijn(scatter+allgather)", PLAN_DOMAIN},
+     8, "van de Geijn(scatter+allgather)", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
 
     {ucg_planc_ucx_bcast_kntree_prepare,
-     10, "K-nomial tree", PLAN_DOMAIN},
+     10, "K-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_bcast_long_prepare,
-     11, "Long(scatter+allgather)", PLAN_DOMAIN},
+     11, "Long(scatter+allgather)", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE | UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_bcast_inc_ring_m_prepare,
-     12, "increasing-ring(modified)", PLAN_DOMAIN},
+     12, "increasing-ring(modified)", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_bcast_inc_2_ring_m_prepare,
-     13, "increasing-2-ring(modified)", PLAN_DOMAIN},
+     13, "increasing-2-ring(modified)", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {ucg_planc_ucx_bcast_long_m_prepare,
-     14, "Long(modified)", PLAN_DOMAIN},
+     14, "Long(modified)", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE | UCG_PLANC_UCX_PREWIRE_PEERS_RING},
 
     {NULL},
 };
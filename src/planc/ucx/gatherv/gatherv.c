@@ -1,10 +1,14 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "gatherv.h"
 #include "planc_ucx_plan.h"
 #include "planc_ucx_global.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
 
 #define PLAN_DOMAIN "planc ucx gatherv"
 
@@ -12,23 +16,453 @@ static ucg_plan_attr_t ucg_planc_ucx_gatherv_plan_attr[] = {
     {ucg_planc_ucx_gatherv_linear_prepare,
      1, "Linear", PLAN_DOMAIN},
 
+    {ucg_planc_ucx_gatherv_kntree_prepare,
+     2, "Knomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
+
+    {ucg_planc_ucx_gatherv_na_kntree_prepare,
+     3, "Node-aware K-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
+
+    {ucg_planc_ucx_gatherv_linear_fc_prepare,
+     4, "Linear with flow control", PLAN_DOMAIN},
+
     {NULL},
 };
 
 UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_GATHERV,
                              ucg_planc_ucx_gatherv_plan_attr);
 
-UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_GATHERV, NULL, 0)
+static ucg_config_field_t gatherv_config_table[] = {
+    {"GATHERV_KNTREE_DEGREE", "4",
+     "Configure the k value in kntree algo for gatherv",
+     ucg_offsetof(ucg_planc_ucx_gatherv_config_t, kntree_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {"GATHERV_NA_KNTREE_INTER_DEGREE", "4",
+     "Configure the k value between nodes in node-aware kntree algo for gatherv",
+     ucg_offsetof(ucg_planc_ucx_gatherv_config_t, na_kntree_inter_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {"GATHERV_NA_KNTREE_INTRA_DEGREE", "2",
+     "Configure the k value in a node in node-aware kntree algo for gatherv",
+     ucg_offsetof(ucg_planc_ucx_gatherv_config_t, na_kntree_intra_degree),
+     UCG_CONFIG_TYPE_INT},
 
-static ucg_plan_policy_t gatherv_plan_policy[] = {
-    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {"GATHERV_LINEAR_MAX_OUTSTANDING", "32",
+     "Configure the maximum number of outstanding receives of root in linear "
+     "with flow control algo for gatherv",
+     ucg_offsetof(ucg_planc_ucx_gatherv_config_t, linear_max_outstanding),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_GATHERV, gatherv_config_table,
+                                    sizeof(ucg_planc_ucx_gatherv_config_t))
+
+/**
+ * The message size of gatherv is unknown to the non-root ranks, so the plans
+ * are chosen by the scale only. Root of linear posts a receive per rank, it
+ * is only kept for a few ranks, the trees take log(n) steps and the
+ * node-aware one only sends one message per node across the network.
+ */
+static ucg_plan_policy_t gatherv_few_nodes[] = {
+    {4,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t gatherv_default[] = {
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {4,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t gatherv_na[] = {
+    {3,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+    {4,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
     UCG_PLAN_LAST_POLICY,
 };
 
 const ucg_plan_policy_t *ucg_planc_ucx_get_gatherv_plan_policy(ucg_planc_ucx_node_level_t node_level,
                                                                ucg_planc_ucx_ppn_level_t ppn_level)
 {
-    UCG_UNUSED(node_level, ppn_level);
-    ucg_plan_policy_t *policy = gatherv_plan_policy;
+    ucg_plan_policy_t *policy;
+    if (ppn_level != PPN_LEVEL_1) {
+        policy = gatherv_na;
+    } else if (node_level == NODE_LEVEL_4) {
+        policy = gatherv_few_nodes;
+    } else {
+        policy = gatherv_default;
+    }
     return policy;
-}
\ No newline at end of file
+}
+
+enum {
+    UCG_GATHERV_TREE_COUNT_RECV = UCG_BIT(0),
+    UCG_GATHERV_TREE_COUNT_SEND = UCG_BIT(1),
+    UCG_GATHERV_TREE_DATA_RECV = UCG_BIT(2),
+    UCG_GATHERV_TREE_DATA_SEND = UCG_BIT(3),
+    UCG_GATHERV_TREE_UNPACK = UCG_BIT(4),
+};
+
+#define UCG_GATHERV_TREE_COUNT_FLAGS UCG_GATHERV_TREE_COUNT_RECV | \
+                                     UCG_GATHERV_TREE_COUNT_SEND
+
+#define UCG_GATHERV_TREE_DATA_FLAGS UCG_GATHERV_TREE_DATA_RECV | \
+                                    UCG_GATHERV_TREE_DATA_SEND
+
+#define UCG_GATHERV_TREE_ROOT_FLAGS UCG_GATHERV_TREE_DATA_RECV | \
+                                    UCG_GATHERV_TREE_UNPACK
+
+void ucg_planc_ucx_gatherv_fanin_init(ucg_planc_ucx_gatherv_fanin_t *fanin, int size,
+                                      int degree, ucg_rank_t root, ucg_rank_t myrank)
+{
+    ucg_algo_kntree_iter_t *iter = &fanin->iter;
+    ucg_algo_kntree_iter_init(iter, size, degree, root, myrank, 0);
+    fanin->ranks = NULL;
+    fanin->children = NULL;
+    fanin->nchild = 0;
+    while (ucg_algo_kntree_iter_child_value(iter) != UCG_INVALID_RANK) {
+        fanin->nchild++;
+        ucg_algo_kntree_iter_child_inc(iter);
+    }
+    ucg_algo_kntree_iter_reset(iter);
+    return;
+}
+
+void ucg_planc_ucx_gatherv_fanin_fill(ucg_planc_ucx_gatherv_fanin_t *fanin,
+                                      ucg_planc_ucx_gatherv_child_t *children,
+                                      const ucg_rank_t *ranks)
+{
+    ucg_algo_kntree_iter_t *iter = &fanin->iter;
+    int size = iter->size;
+    ucg_rank_t root = iter->root;
+    fanin->ranks = ranks;
+    fanin->children = children;
+    /* The iterator gives the children from the smallest subtree, sort them by distance. */
+    ucg_rank_t peer;
+    int32_t n = 0;
+    while ((peer = ucg_algo_kntree_iter_child_value(iter)) != UCG_INVALID_RANK) {
+        ucg_rank_t idx = (peer - root + size) % size;
+        int32_t i = n++;
+        for (; i > 0 && children[i - 1].idx > idx; --i) {
+            children[i] = children[i - 1];
+        }
+        memset(&children[i], 0, sizeof(children[i]));
+        children[i].idx = idx;
+        children[i].rank = ranks == NULL ? peer : ranks[peer];
+        ucg_algo_kntree_iter_child_inc(iter);
+    }
+    ucg_algo_kntree_iter_reset(iter);
+    return;
+}
+
+static inline ucg_rank_t ucg_planc_ucx_gatherv_fanin_rank(ucg_planc_ucx_gatherv_fanin_t *fanin,
+                                                          ucg_rank_t peer)
+{
+    return fanin->ranks == NULL ? peer : fanin->ranks[peer];
+}
+
+/* I send my subtree to the parent of the highest tree I take part in. */
+static ucg_rank_t ucg_planc_ucx_gatherv_tree_parent(ucg_planc_ucx_op_t *op)
+{
+    ucg_planc_ucx_gatherv_fanin_t *fanin = &op->gatherv.tree.fanin[op->gatherv.tree.nlevel - 1];
+    ucg_rank_t peer = ucg_algo_kntree_iter_parent_value(&fanin->iter);
+    if (peer == UCG_INVALID_RANK) {
+        return UCG_INVALID_RANK;
+    }
+    return ucg_planc_ucx_gatherv_fanin_rank(fanin, peer);
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_check_bytes(int64_t bytes)
+{
+    if (bytes > INT32_MAX) {
+        ucg_error("Gatherv tree doesn't support a subtree of %ld bytes", bytes);
+        return UCG_ERR_INVALID_PARAM;
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_tree_post_count(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_dt_t *int64_dt = ucg_dt_get_predefined(UCG_DT_TYPE_INT64);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    for (int32_t level = 0; level < gatherv->tree.nlevel; ++level) {
+        ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[level];
+        for (int32_t i = 0; i < fanin->nchild; ++i) {
+            ucg_planc_ucx_gatherv_child_t *child = &fanin->children[i];
+            status = ucg_planc_ucx_p2p_irecv(&child->bytes, 1, int64_dt,
+                                             child->rank,
+                                             op->tag, op->super.vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+/* Lay out my subtree in the staging area, and send its bytes if parent isn't root. */
+static ucg_status_t ucg_planc_ucx_gatherv_tree_send_count(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    int64_t offset = gatherv->tree.own_bytes;
+    int32_t nchild = 0;
+    for (int32_t level = 0; level < gatherv->tree.nlevel; ++level) {
+        ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[level];
+        for (int32_t i = 0; i < fanin->nchild; ++i) {
+            fanin->children[i].offset = offset;
+            offset += fanin->children[i].bytes;
+        }
+        nchild += fanin->nchild;
+    }
+    gatherv->tree.total = offset;
+    status = ucg_planc_ucx_gatherv_check_bytes(offset);
+    UCG_CHECK_GOTO(status, out);
+
+    /* A leaf sends its sendbuf directly. */
+    if (nchild > 0 && offset > 0) {
+        status = ucg_planc_ucx_op_get_staging(op, offset, 0, NULL);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+    ucg_rank_t parent = ucg_planc_ucx_gatherv_tree_parent(op);
+    if (parent != args->root) {
+        status = ucg_planc_ucx_p2p_isend(&gatherv->tree.total, 1,
+                                         ucg_dt_get_predefined(UCG_DT_TYPE_INT64),
+                                         parent, op->tag, op->super.vgroup, &params);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_tree_post_data(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int is_root = (vgroup->myrank == args->root);
+    ucg_dt_t *uint8_dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (is_root) {
+        if (args->sendbuf != UCG_IN_PLACE && args->recvcounts[args->root] > 0) {
+            int64_t extent = ucg_dt_extent(args->recvtype);
+            status = ucg_dt_memcpy((char*)args->recvbuf + args->displs[args->root] * extent,
+                                   args->recvcounts[args->root], args->recvtype,
+                                   args->sendbuf, args->sendcount, args->sendtype);
+            UCG_CHECK_GOTO(status, out);
+        }
+    } else if (op->staging_area != NULL && gatherv->tree.own_bytes > 0) {
+        status = ucg_dt_memcpy(op->staging_area, gatherv->tree.own_bytes, uint8_dt,
+                               args->sendbuf, args->sendcount, args->sendtype);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+    for (int32_t level = 0; level < gatherv->tree.nlevel; ++level) {
+        ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[level];
+        for (int32_t i = 0; i < fanin->nchild; ++i) {
+            ucg_planc_ucx_gatherv_child_t *child = &fanin->children[i];
+            ucg_rank_t peer = child->rank;
+            if (child->bytes == 0) {
+                continue;
+            }
+            if (child->offset >= 0) {
+                status = ucg_planc_ucx_p2p_irecv((uint8_t*)op->staging_area + child->offset,
+                                                 child->bytes, uint8_dt, peer,
+                                                 op->tag, vgroup, &params);
+            } else {
+                /* The subtree is contiguous in recvbuf of root. */
+                ucg_rank_t first = gatherv->tree.order[child->start];
+                int64_t count = child->bytes / ucg_dt_size(args->recvtype);
+                void *rbuf = (char*)args->recvbuf +
+                             args->displs[first] * ucg_dt_extent(args->recvtype);
+                status = ucg_planc_ucx_p2p_irecv(rbuf, count, args->recvtype, peer,
+                                                 op->tag, vgroup, &params);
+            }
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_tree_send_data(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (gatherv->tree.total == 0) {
+        return UCG_OK;
+    }
+    ucg_rank_t parent = ucg_planc_ucx_gatherv_tree_parent(op);
+    if (op->staging_area == NULL) {
+        return ucg_planc_ucx_p2p_isend(args->sendbuf, args->sendcount, args->sendtype,
+                                       parent, op->tag, op->super.vgroup, &params);
+    }
+    return ucg_planc_ucx_p2p_isend(op->staging_area, gatherv->tree.total,
+                                   ucg_dt_get_predefined(UCG_DT_TYPE_UINT8),
+                                   parent, op->tag, op->super.vgroup, &params);
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_tree_unpack(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_dt_t *uint8_dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+    int64_t recvtype_size = ucg_dt_size(args->recvtype);
+    int64_t recvtype_extent = ucg_dt_extent(args->recvtype);
+
+    for (int32_t level = 0; level < gatherv->tree.nlevel; ++level) {
+        ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[level];
+        for (int32_t i = 0; i < fanin->nchild; ++i) {
+            ucg_planc_ucx_gatherv_child_t *child = &fanin->children[i];
+            if (child->offset < 0) {
+                continue;
+            }
+            uint8_t *packed = (uint8_t*)op->staging_area + child->offset;
+            for (int32_t j = child->start; j < child->start + child->count; ++j) {
+                ucg_rank_t rank = gatherv->tree.order[j];
+                int32_t rcount = args->recvcounts[rank];
+                if (rcount == 0) {
+                    continue;
+                }
+                int64_t bytes = rcount * recvtype_size;
+                status = ucg_dt_memcpy((char*)args->recvbuf + args->displs[rank] * recvtype_extent,
+                                       rcount, args->recvtype, packed, bytes, uint8_dt);
+                UCG_CHECK_GOTO(status, out);
+                packed += bytes;
+            }
+        }
+    }
+
+out:
+    return status;
+}
+
+ucg_status_t ucg_planc_ucx_gatherv_tree_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    /* 1. gather the bytes of the subtrees, only once */
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_TREE_COUNT_RECV)) {
+        status = ucg_planc_ucx_gatherv_tree_post_count(op);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, &op->p2p_state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_TREE_COUNT_SEND)) {
+        status = ucg_planc_ucx_gatherv_tree_send_count(op);
+        UCG_CHECK_GOTO(status, out);
+        op->gatherv.tree.counted = 1;
+    }
+
+    /* 2. gather the data of the subtrees */
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_TREE_DATA_RECV)) {
+        status = ucg_planc_ucx_gatherv_tree_post_data(op);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, &op->p2p_state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_TREE_DATA_SEND)) {
+        status = ucg_planc_ucx_gatherv_tree_send_data(op);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, &op->p2p_state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_TREE_UNPACK)) {
+        status = ucg_planc_ucx_gatherv_tree_unpack(op);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+ucg_status_t ucg_planc_ucx_gatherv_tree_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+
+    if (op->super.vgroup->myrank == ucg_op->super.args.gatherv.root) {
+        op->flags = UCG_GATHERV_TREE_ROOT_FLAGS;
+    } else if (op->gatherv.tree.counted) {
+        op->flags = UCG_GATHERV_TREE_DATA_FLAGS;
+    } else {
+        op->flags = UCG_GATHERV_TREE_COUNT_FLAGS | UCG_GATHERV_TREE_DATA_FLAGS;
+    }
+
+    status = ucg_planc_ucx_gatherv_tree_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+/**
+ * Root knows the bytes of every subtree from recvcounts. A subtree is received
+ * into recvbuf directly if its ranks are adjacent there, otherwise it is
+ * received into the staging area and unpacked at the end.
+ *
+ * The ranges of the children in the packed order must be filled by the caller.
+ */
+ucg_status_t ucg_planc_ucx_gatherv_tree_root_init(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status;
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    const ucg_rank_t *order = gatherv->tree.order;
+    int64_t recvtype_size = ucg_dt_size(args->recvtype);
+    int contiguous = ucg_dt_is_contiguous(args->recvtype);
+
+    int64_t staging_size = 0;
+    for (int32_t level = 0; level < gatherv->tree.nlevel; ++level) {
+        ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[level];
+        for (int32_t i = 0; i < fanin->nchild; ++i) {
+            ucg_planc_ucx_gatherv_child_t *child = &fanin->children[i];
+            int adjacent = contiguous;
+            int64_t count = 0;
+            for (int32_t j = child->start; j < child->start + child->count; ++j) {
+                if (j > child->start && args->displs[order[j]] !=
+                    args->displs[order[j - 1]] + args->recvcounts[order[j - 1]]) {
+                    adjacent = 0;
+                }
+                count += args->recvcounts[order[j]];
+            }
+            child->bytes = count * recvtype_size;
+            status = ucg_planc_ucx_gatherv_check_bytes(child->bytes);
+            if (status != UCG_OK) {
+                return status;
+            }
+            if (adjacent || child->bytes == 0) {
+                child->offset = -1;
+            } else {
+                child->offset = staging_size;
+                staging_size += child->bytes;
+            }
+        }
+    }
+
+    if (staging_size == 0) {
+        return UCG_OK;
+    }
+    return ucg_planc_ucx_op_get_staging(op, staging_size, 0, NULL);
+}
@@ -6,11 +6,92 @@
 #define UCG_PLANC_UCX_GATHERV_H_
 
 #include "planc/ucx/planc_ucx_def.h"
+#include "planc/ucx/planc_ucx_context.h"
 #include "core/ucg_plan.h"
+#include "util/algo/ucg_kntree.h"
+
+typedef struct ucg_planc_ucx_gatherv_config {
+    int kntree_degree;
+    /* for node-aware kntree */
+    int na_kntree_inter_degree;
+    int na_kntree_intra_degree;
+    /* for linear with flow control */
+    int linear_max_outstanding;
+} ucg_planc_ucx_gatherv_config_t;
+
+/**
+ * @brief A child of the gathering tree and the bytes of its subtree.
+ */
+typedef struct ucg_planc_ucx_gatherv_child {
+    ucg_rank_t rank;
+    /* Distance to the root of the tree */
+    ucg_rank_t idx;
+    int64_t bytes;
+    /* Where the subtree is in my staging area, -1 if root receives into recvbuf. */
+    int64_t offset;
+    /* Only used by root, the range of the subtree in the packed order. */
+    int32_t start;
+    int32_t count;
+} ucg_planc_ucx_gatherv_child_t;
+
+/**
+ * @brief Fan-in of a k-nomial tree gathering the data of the subtrees
+ *
+ * A rank packs its data and the data of its children in the order of the
+ * distance to the root, so the data of a subtree is a contiguous stream and
+ * only its byte count is needed to place it. The byte counts are gathered up
+ * the tree once, root knows all of them.
+ */
+typedef struct ucg_planc_ucx_gatherv_fanin {
+    ucg_algo_kntree_iter_t iter;
+    /* Maps the ranks of the tree to the ranks of vgroup, NULL if they are the same. */
+    const ucg_rank_t *ranks;
+    /* Sorted by the distance to the root */
+    ucg_planc_ucx_gatherv_child_t *children;
+    int32_t nchild;
+} ucg_planc_ucx_gatherv_fanin_t;
+
+typedef struct ucg_planc_ucx_gatherv {
+    union {
+        struct {
+            /* Next rank to receive from and the cap of outstanding receives. */
+            int32_t idx;
+            int32_t max_outstanding;
+        } linear;
+        struct {
+            /**
+             * Gather in my node to the leader, and then among the leaders to
+             * root for node-aware; kntree only uses the first one. A rank
+             * takes part in the second one only if it's a leader. Their
+             * children and ranks and the order are in the meta area.
+             */
+            ucg_planc_ucx_gatherv_fanin_t fanin[2];
+            int32_t nlevel;
+            /* Only used by root, the vgroup ranks in the packed order. */
+            ucg_rank_t *order;
+            int64_t own_bytes;
+            /* Bytes of my subtree */
+            int64_t total;
+            /* Byte counts are gathered by the first trigger. */
+            uint8_t counted;
+        } tree;
+    };
+} ucg_planc_ucx_gatherv_t;
 
 const ucg_plan_policy_t *ucg_planc_ucx_get_gatherv_plan_policy(ucg_planc_ucx_node_level_t node_level,
                                                                ucg_planc_ucx_ppn_level_t ppn_level);
 
+/* Common routines of the tree algorithms */
+/* Count the children, the caller provides the room of them to the fill. */
+void ucg_planc_ucx_gatherv_fanin_init(ucg_planc_ucx_gatherv_fanin_t *fanin, int size,
+                                      int degree, ucg_rank_t root, ucg_rank_t myrank);
+void ucg_planc_ucx_gatherv_fanin_fill(ucg_planc_ucx_gatherv_fanin_t *fanin,
+                                      ucg_planc_ucx_gatherv_child_t *children,
+                                      const ucg_rank_t *ranks);
+ucg_status_t ucg_planc_ucx_gatherv_tree_op_progress(ucg_plan_op_t *ucg_op);
+ucg_status_t ucg_planc_ucx_gatherv_tree_op_trigger(ucg_plan_op_t *ucg_op);
+ucg_status_t ucg_planc_ucx_gatherv_tree_root_init(ucg_planc_ucx_op_t *op);
+
 ucg_status_t ucg_planc_ucx_gatherv_linear_op_progress(ucg_plan_op_t *ucg_op);
 
 ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_linear_op_new(ucg_planc_ucx_group_t *ucx_group,
@@ -20,5 +101,14 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_linear_op_new(ucg_planc_ucx_group_t *u
 ucg_status_t ucg_planc_ucx_gatherv_linear_prepare(ucg_vgroup_t *vgroup,
                                                   const ucg_coll_args_t *args,
                                                   ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_gatherv_linear_fc_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_gatherv_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                  const ucg_coll_args_t *args,
+                                                  ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_gatherv_na_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op);
 
 #endif // UCG_PLANC_UCX_GATHERV_H_
\ No newline at end of file
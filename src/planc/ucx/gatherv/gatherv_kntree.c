@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "gatherv.h"
+#include "planc_ucx_plan.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+/**
+ * K-nomial tree gatherv
+ *
+ * Every rank gathers the data of its subtree and sends it to its parent in
+ * one message, so root only receives from log(n) children instead of n - 1
+ * ranks. The ranks only know their own count, the byte counts of the subtrees
+ * are aggregated up the tree by the first trigger and kept for the persistent
+ * request. Root knows all of them from recvcounts.
+ */
+
+static ucg_status_t ucg_planc_ucx_gatherv_kntree_op_init(ucg_planc_ucx_op_t *op,
+                                                         ucg_planc_ucx_gatherv_config_t *config)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    const ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_planc_ucx_gatherv_fanin_t *fanin = &gatherv->tree.fanin[0];
+    uint32_t group_size = vgroup->size;
+    int is_root = (vgroup->myrank == args->root);
+
+    memset(&gatherv->tree, 0, sizeof(gatherv->tree));
+    gatherv->tree.nlevel = 1;
+    ucg_planc_ucx_gatherv_fanin_init(fanin, group_size, ucg_max(config->kntree_degree, 1),
+                                     args->root, vgroup->myrank);
+
+    /* The children, and the packed order of root after them. */
+    size_t children_size = sizeof(ucg_planc_ucx_gatherv_child_t) * fanin->nchild;
+    size_t order_size = is_root ? sizeof(ucg_rank_t) * group_size : 0;
+    status = ucg_planc_ucx_op_get_meta(op, children_size + order_size);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_planc_ucx_gatherv_fanin_fill(fanin, op->meta_area, NULL);
+    if (!is_root) {
+        gatherv->tree.own_bytes = (int64_t)args->sendcount * ucg_dt_size(args->sendtype);
+        return UCG_OK;
+    }
+
+    /* The packed order is the distance to root. */
+    ucg_rank_t *order = (ucg_rank_t*)((uint8_t*)op->meta_area + children_size);
+    gatherv->tree.order = order;
+    for (uint32_t i = 0; i < group_size; ++i) {
+        order[i] = (i + args->root) % group_size;
+    }
+    for (int32_t i = 0; i < fanin->nchild; ++i) {
+        ucg_planc_ucx_gatherv_child_t *child = &fanin->children[i];
+        child->start = child->idx;
+        child->count = ucg_algo_kntree_get_subtree_size(&fanin->iter, child->rank);
+    }
+    return ucg_planc_ucx_gatherv_tree_root_init(op);
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                               ucg_vgroup_t *vgroup,
+                                                               const ucg_coll_args_t *args,
+                                                               ucg_planc_ucx_gatherv_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_gatherv_tree_op_trigger,
+                                 ucg_planc_ucx_gatherv_tree_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_gatherv_kntree_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize gatherv kntree ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    ucg_planc_ucx_op_put_staging(ucx_op);
+    ucg_planc_ucx_op_put_meta(ucx_op);
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_gatherv_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                  const ucg_coll_args_t *args,
+                                                  ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_gatherv_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, gatherv,
+                                                         UCG_COLL_TYPE_GATHERV);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_gatherv_kntree_op_new(ucx_group, vgroup,
+                                                                     args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -101,6 +101,88 @@ static ucg_status_t ucg_planc_ucx_gatherv_linear_op_trigger(ucg_plan_op_t *ucg_o
     return status == UCG_INPROGRESS ? UCG_OK : status;
 }
 
+/**
+ * Root of linear receives from all ranks at once, the unexpected messages and
+ * the requests of thousands of ranks overwhelm it. With flow control, root
+ * keeps at most max_outstanding receives in flight and posts the next one
+ * when one completes.
+ */
+static ucg_status_t ucg_planc_ucx_gatherv_linear_fc_op_root(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int32_t group_size = vgroup->size;
+    int32_t window = op->gatherv.linear.max_outstanding;
+    int64_t recvtype_extent = ucg_dt_extent(args->recvtype);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_GATHERV_LINEAR_RECV)) {
+        int32_t rcount = args->recvcounts[args->root];
+        if (args->sendbuf != UCG_IN_PLACE && rcount != 0) {
+            status = ucg_dt_memcpy((char*)args->recvbuf + args->displs[args->root] * recvtype_extent,
+                                   rcount, args->recvtype,
+                                   args->sendbuf, args->sendcount, args->sendtype);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+    while (1) {
+        while (op->gatherv.linear.idx < group_size &&
+               params.state->inflight_recv_cnt < window) {
+            int32_t i = op->gatherv.linear.idx++;
+            int32_t rcount = args->recvcounts[i];
+            if (i == args->root || rcount == 0) {
+                continue;
+            }
+            void *rbuf = (char*)args->recvbuf + args->displs[i] * recvtype_extent;
+            status = ucg_planc_ucx_p2p_irecv(rbuf, rcount, args->recvtype, i,
+                                            op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        if (status == UCG_OK && op->gatherv.linear.idx < group_size) {
+            continue;
+        }
+        /* Stop until a receive completes, or all receives have been posted. */
+        if (status != UCG_INPROGRESS || op->gatherv.linear.idx == group_size ||
+            params.state->inflight_recv_cnt >= window) {
+            break;
+        }
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_linear_fc_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+
+    if (myrank == args->root) {
+        status = ucg_planc_ucx_gatherv_linear_fc_op_root(op);
+    } else {
+        status = ucg_planc_ucx_gatherv_linear_op_non_root(op);
+    }
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_linear_fc_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_GATHERV_LINEAR_FLAGS;
+    op->gatherv.linear.idx = 0;
+    status = ucg_planc_ucx_gatherv_linear_fc_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
 ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_linear_op_new(ucg_planc_ucx_group_t *ucx_group,
                                                         ucg_vgroup_t *vgroup,
                                                         const ucg_coll_args_t *args)
@@ -160,3 +242,53 @@ ucg_status_t ucg_planc_ucx_gatherv_linear_prepare(ucg_vgroup_t *vgroup,
     *op = &linear_op->super;
     return UCG_OK;
 }
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_linear_fc_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                                  ucg_vgroup_t *vgroup,
+                                                                  const ucg_coll_args_t *args,
+                                                                  ucg_planc_ucx_gatherv_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                              ucg_planc_ucx_gatherv_linear_fc_op_trigger,
+                                              ucg_planc_ucx_gatherv_linear_fc_op_progress,
+                                              ucg_planc_ucx_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucx_op->gatherv.linear.idx = 0;
+    ucx_op->gatherv.linear.max_outstanding = ucg_max(config->linear_max_outstanding, 1);
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_gatherv_linear_fc_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_gatherv_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, gatherv,
+                                                         UCG_COLL_TYPE_GATHERV);
+    ucg_planc_ucx_op_t *fc_op = ucg_planc_ucx_gatherv_linear_fc_op_new(ucx_group, vgroup,
+                                                                       args, config);
+    if (fc_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &fc_op->super;
+    return UCG_OK;
+}
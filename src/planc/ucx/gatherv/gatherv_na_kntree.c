@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "gatherv.h"
+#include "planc_ucx_plan.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Node-aware k-nomial tree gatherv
+ *
+ * The ranks of a node gather to the leader of the node by a k-nomial tree,
+ * and then the leaders gather to root by another one, so only one message
+ * per node crosses the network. The root is the leader of its node, the
+ * lowest rank is the leader of other nodes.
+ *
+ * A leader packs the data of its node before the data of its children among
+ * the leaders, so root receives the nodes in the order of the leaders and
+ * the ranks of a node in the order of the tree in the node.
+ */
+
+static ucg_status_t ucg_planc_ucx_gatherv_na_kntree_check(ucg_vgroup_t *vgroup)
+{
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Gatherv node-aware kntree don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Gatherv node-aware kntree don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+/**
+ * The ranks of every node in the packed order, the nodes are in the order of
+ * the leaders and the leader is the first of its node. node_start[i] is where
+ * the node of leaders[i] starts, it's followed by a cursor for every node.
+ */
+static void ucg_planc_ucx_gatherv_na_kntree_fill_order(ucg_planc_ucx_op_t *op,
+                                                       const ucg_rank_t *leaders,
+                                                       int32_t nleader,
+                                                       int32_t *node_start)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_topo_t *topo = vgroup->group->topo;
+    uint32_t group_size = vgroup->size;
+    ucg_rank_t *order = op->gatherv.tree.order;
+    int32_t nnode = topo->detail.nnode;
+    int32_t *cursor = node_start + nleader + 1;
+
+    for (int32_t node = 0; node < nnode; ++node) {
+        cursor[node] = 0;
+    }
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        ++cursor[topo->detail.locations[group_rank].node_id];
+    }
+    node_start[0] = 0;
+    for (int32_t i = 0; i < nleader; ++i) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, leaders[i]);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        node_start[i + 1] = node_start[i] + cursor[node];
+        order[node_start[i]] = leaders[i];
+        cursor[node] = node_start[i] + 1;
+    }
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        /* The leaders are placed, root or the first rank I meet of its node. */
+        if (rank == order[0] || rank == order[cursor[node] - 1]) {
+            continue;
+        }
+        order[cursor[node]++] = rank;
+    }
+    return;
+}
+
+static ucg_status_t ucg_planc_ucx_gatherv_na_kntree_op_init(ucg_planc_ucx_op_t *op,
+                                                            ucg_planc_ucx_gatherv_config_t *config)
+{
+    ucg_status_t status;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    const ucg_coll_gatherv_args_t *args = &op->super.super.args.gatherv;
+    ucg_planc_ucx_gatherv_t *gatherv = &op->gatherv;
+    ucg_rank_t myrank = vgroup->myrank;
+    ucg_rank_t root = args->root;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+    int32_t nnode = topo->detail.nnode;
+    int32_t mynode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, myrank),
+                                              UCG_TOPO_LOC_NODE_ID);
+    int32_t rootnode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, root),
+                                                UCG_TOPO_LOC_NODE_ID);
+    int is_root = (myrank == root);
+
+    memset(&gatherv->tree, 0, sizeof(gatherv->tree));
+    int32_t nlocal = 0;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id == mynode) {
+            ++nlocal;
+        }
+    }
+
+    /**
+     * The ranks are laid out in a temporary buffer of the staging cache first,
+     * because the meta area is sized by the trees made of them. The first rank
+     * of every node is only needed here, it's after the leaders.
+     */
+    ucg_bufcache_t *cache = &op->ucx_group->staging_cache;
+    ucg_rank_t *locals = ucg_bufcache_get(cache, sizeof(ucg_rank_t) * (nlocal + 2 * nnode));
+    if (locals == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_rank_t *leaders = locals + nlocal;
+    ucg_rank_t *first = leaders + nnode;
+
+    /* The leader of my node is at 0, and the root is at 0 of the leaders. */
+    for (int32_t node = 0; node < nnode; ++node) {
+        first[node] = UCG_INVALID_RANK;
+    }
+    ucg_rank_t leader = (mynode == rootnode) ? root : UCG_INVALID_RANK;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (first[node] == UCG_INVALID_RANK) {
+            first[node] = rank;
+        }
+        if (node == mynode && leader == UCG_INVALID_RANK) {
+            leader = rank;
+        }
+    }
+    int32_t nfilled = 0;
+    ucg_rank_t my_local = 0;
+    locals[nfilled++] = leader;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id != mynode || rank == leader) {
+            continue;
+        }
+        if (rank == myrank) {
+            my_local = nfilled;
+        }
+        locals[nfilled++] = rank;
+    }
+    int32_t nleader = 0;
+    ucg_rank_t my_leader = 0;
+    leaders[nleader++] = root;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == rootnode || first[node] == UCG_INVALID_RANK) {
+            continue;
+        }
+        if (first[node] == myrank) {
+            my_leader = nleader;
+        }
+        leaders[nleader++] = first[node];
+    }
+
+    ucg_planc_ucx_gatherv_fanin_t *intra = &gatherv->tree.fanin[0];
+    ucg_planc_ucx_gatherv_fanin_t *inter = &gatherv->tree.fanin[1];
+    gatherv->tree.nlevel = (myrank == leader) ? 2 : 1;
+    ucg_planc_ucx_gatherv_fanin_init(intra, nlocal, ucg_max(config->na_kntree_intra_degree, 1),
+                                     0, my_local);
+    if (myrank == leader) {
+        ucg_planc_ucx_gatherv_fanin_init(inter, nleader,
+                                         ucg_max(config->na_kntree_inter_degree, 1),
+                                         0, my_leader);
+    }
+
+    /**
+     * The children of both trees, the ranks of them, and then root also needs
+     * the packed order and where every node starts in it.
+     */
+    size_t children_size = sizeof(ucg_planc_ucx_gatherv_child_t) *
+                           (intra->nchild + inter->nchild);
+    size_t ranks_size = sizeof(ucg_rank_t) * (nlocal + nleader);
+    size_t root_size = is_root ? sizeof(ucg_rank_t) * group_size +
+                                 sizeof(int32_t) * (2 * nnode + 1) : 0;
+    status = ucg_planc_ucx_op_get_meta(op, children_size + ranks_size + root_size);
+    if (status == UCG_OK) {
+        memcpy((uint8_t*)op->meta_area + children_size, locals, ranks_size);
+    }
+    ucg_bufcache_put(locals);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_planc_ucx_gatherv_child_t *children = op->meta_area;
+    locals = (ucg_rank_t*)(children + intra->nchild + inter->nchild);
+    leaders = locals + nlocal;
+    ucg_planc_ucx_gatherv_fanin_fill(intra, children, locals);
+    if (myrank == leader) {
+        ucg_planc_ucx_gatherv_fanin_fill(inter, children + intra->nchild, leaders);
+    }
+    if (!is_root) {
+        gatherv->tree.own_bytes = (int64_t)args->sendcount * ucg_dt_size(args->sendtype);
+        return UCG_OK;
+    }
+
+    gatherv->tree.order = leaders + nleader;
+    int32_t *node_start = (int32_t*)(gatherv->tree.order + group_size);
+    ucg_planc_ucx_gatherv_na_kntree_fill_order(op, leaders, nleader, node_start);
+    /* The node of root is at the beginning of the packed order. */
+    for (int32_t i = 0; i < intra->nchild; ++i) {
+        ucg_planc_ucx_gatherv_child_t *child = &intra->children[i];
+        child->start = child->idx;
+        child->count = ucg_algo_kntree_get_subtree_size(&intra->iter, child->idx);
+    }
+    for (int32_t i = 0; i < inter->nchild; ++i) {
+        ucg_planc_ucx_gatherv_child_t *child = &inter->children[i];
+        int32_t nnode_subtree = ucg_algo_kntree_get_subtree_size(&inter->iter, child->idx);
+        child->start = node_start[child->idx];
+        child->count = node_start[child->idx + nnode_subtree] - child->start;
+    }
+    return ucg_planc_ucx_gatherv_tree_root_init(op);
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_gatherv_na_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                                  ucg_vgroup_t *vgroup,
+                                                                  const ucg_coll_args_t *args,
+                                                                  ucg_planc_ucx_gatherv_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_gatherv_tree_op_trigger,
+                                 ucg_planc_ucx_gatherv_tree_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_gatherv_na_kntree_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize gatherv node-aware kntree ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    ucg_planc_ucx_op_put_staging(ucx_op);
+    ucg_planc_ucx_op_put_meta(ucx_op);
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_gatherv_na_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_gatherv_na_kntree_check(vgroup);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_gatherv_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, gatherv,
+                                                         UCG_COLL_TYPE_GATHERV);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_gatherv_na_kntree_op_new(ucx_group, vgroup,
+                                                                        args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
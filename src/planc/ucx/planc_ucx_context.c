@@ -35,10 +35,38 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_SCATTERV]),
      UCG_CONFIG_TYPE_STRING},
 
+    {"GATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_GATHERV]),
+     UCG_CONFIG_TYPE_STRING},
+
     {"ALLGATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_ALLGATHERV]),
      UCG_CONFIG_TYPE_STRING},
 
+    {"REDUCE_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_REDUCE]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"REDUCE_SCATTER_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_REDUCE_SCATTER]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"REDUCE_SCATTER_BLOCK_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"SCAN_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_SCAN]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"EXSCAN_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_EXSCAN]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"ALLGATHER_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_ALLGATHER]),
+     UCG_CONFIG_TYPE_STRING},
+
     {"IBCAST_ATTR", "", UCG_PLAN_ATTR_DESC,
      ucg_offsetof(ucg_planc_ucx_config_t,  plan_attr[UCG_COLL_TYPE_IBCAST]),
      UCG_CONFIG_TYPE_STRING},
@@ -59,10 +87,38 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_ISCATTERV]),
      UCG_CONFIG_TYPE_STRING},
 
+    {"IGATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IGATHERV]),
+     UCG_CONFIG_TYPE_STRING},
+
     {"IALLGATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IALLGATHERV]),
      UCG_CONFIG_TYPE_STRING},
 
+    {"IREDUCE_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IREDUCE]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"IREDUCE_SCATTER_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IREDUCE_SCATTER]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"IREDUCE_SCATTER_BLOCK_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"ISCAN_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_ISCAN]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"IEXSCAN_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IEXSCAN]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"IALLGATHER_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_IALLGATHER]),
+     UCG_CONFIG_TYPE_STRING},
+
     {"NPOLLS", "3",
      "Number of ucp progress polling cycles for p2p requests testing",
      ucg_offsetof(ucg_planc_ucx_config_t, n_polls),
@@ -98,6 +154,25 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, planm),
      UCG_CONFIG_TYPE_STRING_ARRAY},
 
+    {"STAGING_CACHE_MAX_SIZE", "4m",
+     "Staging areas of collective operations up to this size are kept in a per-group\n"
+     "cache and reused by later operations instead of being freed",
+     ucg_offsetof(ucg_planc_ucx_config_t, staging_cache_max_size),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"STAGING_CACHE_DEPTH", "4",
+     "Maximum number of cached staging areas of every power-of-two size class, 0 disables the cache",
+     ucg_offsetof(ucg_planc_ucx_config_t, staging_cache_depth),
+     UCG_CONFIG_TYPE_UINT},
+
+    {"PREWIRE", "off",
+     "When to connect the peers that the plans of a group talk to\n"
+     " - off   : connect a peer on its first send or receive\n"
+     " - lazy  : connect them in bulk when the first operation of the group is prepared\n"
+     " - eager : connect them in bulk when the group is created",
+     ucg_offsetof(ucg_planc_ucx_config_t, prewire),
+     UCG_CONFIG_TYPE_ENUM(ucg_planc_ucx_prewire_names)},
+
     {NULL}
 };
 UCG_CONFIG_REGISTER_TABLE(ucg_planc_ucx_config_table, "UCG PlanC UCX", PLANC_UCX_CONFIG_PREFIX,
@@ -436,6 +511,25 @@ err:
     return ucg_status_s2g(ucs_status);
 }
 
+static ucg_status_t ucg_planc_ucx_context_init_eps(ucg_planc_ucx_context_t *ctx)
+{
+    ucg_planc_ucx_ep_table_t *eps = &ctx->eps;
+
+    for (int i = 0; i < UCG_PLANC_UCX_EP_CACHE_SIZE; ++i) {
+        eps->cache[i].ctx_rank = UCG_INVALID_RANK;
+        eps->cache[i].ep = NULL;
+    }
+    ucg_hash_init_inplace(ucx_ep, &eps->hash);
+    /* Only presize the hash when the user knows the number of peers. */
+    if (ctx->config.estimated_num_eps > 0 &&
+        ucg_hash_resize(ucx_ep, &eps->hash, ctx->config.estimated_num_eps) < 0) {
+        ucg_error("Failed to allocate ucp eps for %d peers", ctx->config.estimated_num_eps);
+        ucg_hash_cleanup_inplace(ucx_ep, &eps->hash);
+        return UCG_ERR_NO_MEMORY;
+    }
+    return UCG_OK;
+}
+
 static int ucg_planc_ucx_ctx_is_required_planm(ucg_planm_t *planm,
                                                ucg_config_names_array_t required)
 {
@@ -535,11 +629,8 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
         }
     }
 
-    ctx->eps = ucg_calloc(ctx->ucg_context->oob_group.size, sizeof(ucp_ep_h), "ucp eps");
-    if (ctx->eps == NULL) {
-        ucg_error("Failed to allocate %zd bytes for ucp_eps",
-                  ctx->ucg_context->oob_group.size * sizeof(ucp_ep_h));
-        status = UCG_ERR_NO_MEMORY;
+    status = ucg_planc_ucx_context_init_eps(ctx);
+    if (status != UCG_OK) {
         goto err_destroy_worker;
     }
 
@@ -579,7 +670,7 @@ void ucg_planc_ucx_context_cleanup(ucg_planc_context_h context)
         ucp_worker_destroy(ctx->ucp_worker);
         ucp_cleanup(ctx->ucp_context);
     }
-    ucg_free(ctx->eps);
+    ucg_hash_cleanup_inplace(ucx_ep, &ctx->eps.hash);
     ucg_mpool_cleanup(&ctx->op_mp, 1);
     ucg_free(ctx->planm_rscs);
     ucg_planc_ucx_context_free_policy(ctx);
@@ -626,6 +717,26 @@ out:
     return ucg_status_s2g(ucs_status);
 }
 
+ucg_status_t ucg_planc_ucx_context_put_ep(ucg_planc_ucx_context_t *context,
+                                          ucg_rank_t ctx_rank, ucp_ep_h ep)
+{
+    ucg_planc_ucx_ep_table_t *eps = &context->eps;
+    int ret;
+
+    ucg_hiter_t iter = ucg_hash_put(ucx_ep, &eps->hash, ctx_rank, &ret);
+    if (ret == UCG_HASH_PUT_FAILED) {
+        ucg_error("Failed to add the ucp ep of proc %d", ctx_rank);
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_hash_value(&eps->hash, iter) = ep;
+
+    ucg_planc_ucx_ep_cache_entry_t *entry;
+    entry = &eps->cache[ctx_rank & (UCG_PLANC_UCX_EP_CACHE_SIZE - 1)];
+    entry->ctx_rank = ctx_rank;
+    entry->ep = ep;
+    return UCG_OK;
+}
+
 ucp_worker_h ucg_planc_ucx_context_get_worker(ucg_planc_ucx_context_t *context)
 {
     if (ucg_unlikely(context->ucp_worker == NULL)) {
@@ -15,6 +15,13 @@
 #include "core/ucg_request.h"
 #include "core/ucg_plan.h"
 #include "util/ucg_mpool.h"
+#include "util/ucg_hash.h"
+#include "util/ucg_helper.h"
+
+#include "planc_ucx_prewire.h"
+
+/* Number of entries of the hot peer cache in front of the endpoint hash */
+#define UCG_PLANC_UCX_EP_CACHE_SIZE 64
 
 typedef enum {
     UCX_BUILTIN,
@@ -39,12 +46,34 @@ typedef struct ucg_planc_ucx_config {
     int8_t reduce_consistency;
     ucg_ternary_auto_value_t use_oob;
     ucg_config_names_array_t planm;
+    size_t staging_cache_max_size;
+    unsigned staging_cache_depth;
+    ucg_planc_ucx_prewire_t prewire;
 } ucg_planc_ucx_config_t;
 
 typedef struct ucg_planc_ucx_resource_planm {
     ucg_planm_t *planm;
 } ucg_planc_ucx_resource_planm_t;
 
+typedef struct ucg_planc_ucx_ep_cache_entry {
+    ucg_rank_t ctx_rank;
+    ucp_ep_h ep;
+} ucg_planc_ucx_ep_cache_entry_t;
+
+UCG_HASH_MAP_INIT_INT(ucx_ep, ucp_ep_h);
+
+/**
+ * Endpoints of the peers, keyed by the context rank.
+ *
+ * A rank only talks to a few peers under most plans, so the endpoints are kept
+ * in a hash instead of an array of the whole oob group. The recent peers are
+ * cached in a direct-mapped array, which is checked first on the send path.
+ */
+typedef struct ucg_planc_ucx_ep_table {
+    ucg_planc_ucx_ep_cache_entry_t cache[UCG_PLANC_UCX_EP_CACHE_SIZE];
+    ucg_hash_t(ucx_ep) hash;
+} ucg_planc_ucx_ep_table_t;
+
 typedef struct ucg_planc_ucx_context {
     ucg_context_t *ucg_context;
     ucg_planc_ucx_config_t config;
@@ -58,8 +87,8 @@ typedef struct ucg_planc_ucx_context {
     size_t ucp_addrlen;
     ucp_address_t *worker_address;
 
-    /* The length of the eps array is determined by @ref ucg_oob_group_t::size */
-    ucp_ep_h *eps;
+    /* Endpoints of the peers that have been connected */
+    ucg_planc_ucx_ep_table_t eps;
 
     /* pool of @ref ucg_planc_ucx_op_t */
     ucg_mpool_t op_mp;
@@ -79,6 +108,30 @@ static inline int ucg_planc_ucx_context_config_builtin_check(ucg_planc_ucx_conte
     return context->config.config_bundle[type][UCX_BUILTIN] ? 1 : 0;
 }
 
+static inline ucp_ep_h ucg_planc_ucx_context_get_ep(ucg_planc_ucx_context_t *context,
+                                                    ucg_rank_t ctx_rank)
+{
+    ucg_planc_ucx_ep_table_t *eps = &context->eps;
+    ucg_planc_ucx_ep_cache_entry_t *entry;
+
+    entry = &eps->cache[ctx_rank & (UCG_PLANC_UCX_EP_CACHE_SIZE - 1)];
+    if (ucg_likely(entry->ctx_rank == ctx_rank)) {
+        return entry->ep;
+    }
+
+    ucg_hiter_t iter = ucg_hash_get(ucx_ep, &eps->hash, ctx_rank);
+    if (iter == ucg_hash_end(&eps->hash)) {
+        return NULL;
+    }
+    entry->ctx_rank = ctx_rank;
+    entry->ep = ucg_hash_value(&eps->hash, iter);
+    return entry->ep;
+}
+
+/** Endpoint table */
+ucg_status_t ucg_planc_ucx_context_put_ep(ucg_planc_ucx_context_t *context,
+                                          ucg_rank_t ctx_rank, ucp_ep_h ep);
+
 /** Configuration */
 ucg_status_t ucg_planc_ucx_config_read(const char *env_prefix,
                                        const char *filename,
@@ -26,6 +26,15 @@ ucg_status_t ucg_planc_ucx_group_create(ucg_planc_context_h context,
     }
 
     ucx_group->context = (ucg_planc_ucx_context_t *)context;
+    status = ucg_bufcache_init(&ucx_group->staging_cache,
+                               ucx_group->context->config.staging_cache_max_size,
+                               ucx_group->context->config.staging_cache_depth,
+                               "ucg planc ucx staging area");
+    if (status != UCG_OK) {
+        ucg_error("Failed to init staging cache");
+        goto err_destruct_group;
+    }
+
     for (int i = 0; i < UCG_ALGO_GROUP_TYPE_LAST; ++i) {
         ucx_group->groups[i].super.myrank = UCG_INVALID_RANK;
         ucx_group->groups[i].super.group = params->group;
@@ -35,14 +44,42 @@ ucg_status_t ucg_planc_ucx_group_create(ucg_planc_context_h context,
     *planc_group = (ucg_planc_group_h)ucx_group;
     return UCG_OK;
 
+err_destruct_group:
+    UCG_CLASS_DESTRUCT(ucg_planc_group_t, &ucx_group->super);
 err_free_ucx_group:
     ucg_free(ucx_group);
     return status;
 }
 
+static void ucg_planc_ucx_group_print_staging_stats(ucg_planc_ucx_group_t *ucx_group)
+{
+    ucg_bufcache_stats_t stats;
+    ucg_bufcache_get_stats(&ucx_group->staging_cache, &stats);
+
+    uint64_t total = stats.hits + stats.misses + stats.bypasses;
+    if (total == 0) {
+        return;
+    }
+    ucg_debug("staging cache of group %u: %lu gets, hit rate %.1f%%, "
+              "%lu misses, %lu bypasses, %lu evictions",
+              ucx_group->super.super.group->id, total, 100.0 * stats.hits / total,
+              stats.misses, stats.bypasses, stats.evictions);
+    return;
+}
+
 void ucg_planc_ucx_group_destroy(ucg_planc_group_h planc_group)
 {
     ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(planc_group, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_group_print_staging_stats(ucx_group);
+    ucg_bufcache_cleanup(&ucx_group->staging_cache);
+    ucg_rank_map_pool_t *pool = ucx_group->super.super.group->context->rank_map_pool;
+    for (int i = 0; i < UCG_ALGO_GROUP_TYPE_LAST; ++i) {
+        ucg_planc_ucx_algo_group_t *algo_group = &ucx_group->groups[i];
+        if (algo_group->state == UCG_ALGO_GROUP_STATE_ENABLE) {
+            ucg_vgroup_cleanup_ctx_rank_map(&algo_group->super, pool);
+            ucg_rank_map_cleanup(&algo_group->super.rank_map);
+        }
+    }
     UCG_CLASS_DESTRUCT(ucg_planc_group_t, &ucx_group->super);
     ucg_free(ucx_group);
     return;
@@ -144,6 +181,8 @@ ucg_status_t ucg_planc_ucx_create_node_leader_algo_group(ucg_planc_ucx_group_t *
         if (status != UCG_OK) {
             goto err_free_global_ranks;
         }
+        ucg_vgroup_init_ctx_rank_map(&algo_group->super, vgroup->group->context->rank_map_pool,
+                                     &vgroup->group->rank_map);
     }
 
 err_free_global_ranks:
@@ -240,6 +279,8 @@ ucg_status_t ucg_planc_ucx_create_only_node_leader_algo_group(ucg_planc_ucx_grou
         if (status != UCG_OK) {
             goto err_free_global_ranks;
         }
+        ucg_vgroup_init_ctx_rank_map(&algo_group->super, vgroup->group->context->rank_map_pool,
+                                     &vgroup->group->rank_map);
     }
 
 err_free_global_ranks:
@@ -329,6 +370,8 @@ ucg_status_t ucg_planc_ucx_create_socket_leader_algo_group(ucg_planc_ucx_group_t
         if (status != UCG_OK) {
             goto err_free_offsets;
         }
+        ucg_vgroup_init_ctx_rank_map(&algo_group->super, vgroup->group->context->rank_map_pool,
+                                     &vgroup->group->rank_map);
     }
 
 err_free_offsets:
@@ -1,12 +1,15 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_PLANC_UCX_GROUP_H_
 #define UCG_PLANC_UCX_GROUP_H_
 
 #include "planc_ucx_context.h"
+#include "planc_ucx_prewire.h"
 #include "planc/ucg_planc.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_bufcache.h"
 
 typedef enum ucg_planc_ucx_algo_group_type {
     UCG_ALGO_GROUP_TYPE_NODE_LEADER, /**< Offset node_leader group to which myrank belongs. */
@@ -33,6 +36,14 @@ typedef struct ucg_planc_ucx_group {
 
     /* cached groups */
     ucg_planc_ucx_algo_group_t groups[UCG_ALGO_GROUP_TYPE_LAST];
+
+    /* staging areas of the ops of this group */
+    ucg_bufcache_t staging_cache;
+
+    /* peers to prewire, @ref ucg_planc_ucx_prewire_peers_t */
+    uint8_t prewire_pending;
+    uint32_t prewire_peers;
+    uint32_t prewire_topo_peers[UCG_TOPO_GROUP_TYPE_LAST];
 } ucg_planc_ucx_group_t;
 
 ucg_status_t ucg_planc_ucx_group_create(ucg_planc_context_h context,
@@ -10,6 +10,7 @@
 
 #include "core/ucg_group.h"
 #include "core/ucg_rank_map.h"
+#include "core/ucg_request.h"
 
 #include "util/ucg_malloc.h"
 #include "util/ucg_log.h"
@@ -113,20 +114,47 @@ static ucg_status_t ucg_planc_ucx_p2p_get_ucp_dt(ucg_dt_t *dt,
     return UCG_OK;
 }
 
+static void ucg_planc_ucx_p2p_close_ep(ucp_ep_h ep, ucp_worker_h ucp_worker)
+{
+    ucs_status_t status;
+    // ucs_status_ptr_t close_req = ucp_ep_close_nb(ep, UCP_EP_CLOSE_MODE_FLUSH);
+    /**
+     * The peer process may have exited when sending the disconnection request.
+     * Therefore, the process is hung in @ref ucp_worker_progress.
+     * In this example, @ref ucp_ep_close_nb is not performed.
+     */
+    ucs_status_ptr_t close_req = NULL;
+    if (UCS_PTR_IS_PTR(close_req)) {
+        do {
+            ucp_worker_progress(ucp_worker);
+            status = ucp_request_check_status(close_req);
+        } while (status == UCS_INPROGRESS);
+        ucp_request_free(close_req);
+    } else {
+        status = UCS_PTR_STATUS(close_req);
+    }
+    if (status != UCS_OK) {
+        ucg_error("Failed to close ucp ep, ep %p, status %s",
+                  ep, ucs_status_string(status));
+    }
+    return;
+}
+
 static ucp_ep_h ucg_planc_ucx_p2p_get_ucp_ep(ucg_vgroup_t *vgroup, ucg_rank_t vrank,
                                              ucg_planc_ucx_group_t *ucx_group)
 {
-    ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
-    ucg_rank_t ctx_rank = ucg_group_get_ctx_rank(vgroup->group, group_rank);
+    /* One rank-map evaluation when the endpoint exists. */
+    ucg_rank_t ctx_rank = ucg_vgroup_get_ctx_rank(vgroup, vrank);
     ucg_planc_ucx_context_t *ucx_context = ucx_group->context;
 
-    if (ucx_context->eps[ctx_rank] != NULL) {
-        return ucx_context->eps[ctx_rank];
+    ucp_ep_h ep = ucg_planc_ucx_context_get_ep(ucx_context, ctx_rank);
+    if (ep != NULL) {
+        return ep;
     }
 
-    ucp_ep_h ep = NULL;
     if (ucx_context->config.use_oob == UCG_YES) {
         void *group = vgroup->group->oob_group.group;
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
         ep = ucg_planc_ucx_get_oob_ucp_ep(group, group_rank);
     } else {
         ucg_context_t *context = vgroup->group->context;
@@ -146,43 +174,35 @@ static ucp_ep_h ucg_planc_ucx_p2p_get_ucp_ep(ucg_vgroup_t *vgroup, ucg_rank_t vr
         }
     }
 
-    ucx_context->eps[ctx_rank] = ep;
+    if (ucg_planc_ucx_context_put_ep(ucx_context, ctx_rank, ep) != UCG_OK) {
+        if (ucx_context->config.use_oob == UCG_NO) {
+            ucg_planc_ucx_p2p_close_ep(ep, ucx_context->ucp_worker);
+        }
+        return NULL;
+    }
     return ep;
 }
 
-static void ucg_planc_ucx_p2p_close_ep(ucp_ep_h ep, ucp_worker_h ucp_worker)
+ucg_status_t ucg_planc_ucx_p2p_connect(ucg_vgroup_t *vgroup, ucg_rank_t vrank,
+                                       ucg_planc_ucx_group_t *ucx_group)
 {
-    ucs_status_t status;
-    // ucs_status_ptr_t close_req = ucp_ep_close_nb(ep, UCP_EP_CLOSE_MODE_FLUSH);
-    /**
-     * The peer process may have exited when sending the disconnection request.
-     * Therefore, the process is hung in @ref ucp_worker_progress.
-     * In this example, @ref ucp_ep_close_nb is not performed.
-     */
-    ucs_status_ptr_t close_req = NULL;
-    if (UCS_PTR_IS_PTR(close_req)) {
-        do {
-            ucp_worker_progress(ucp_worker);
-            status = ucp_request_check_status(close_req);
-        } while (status == UCS_INPROGRESS);
-        ucp_request_free(close_req);
-    } else {
-        status = UCS_PTR_STATUS(close_req);
-    }
-    if (status != UCS_OK) {
-        ucg_error("Failed to close ucp ep, ep %p, status %s",
-                  ep, ucs_status_string(status));
-    }
-    return;
+    ucp_ep_h ep = ucg_planc_ucx_p2p_get_ucp_ep(vgroup, vrank, ucx_group);
+    return ep == NULL ? UCG_ERR_NO_RESOURCE : UCG_OK;
 }
 
 void ucg_planc_ucx_p2p_close_all_ep(ucg_planc_ucx_context_t *context)
 {
-    int oob_group_size = context->ucg_context->oob_group.size;
-    for (int i = 0; i < oob_group_size; ++i) {
-        if (context->eps[i] != NULL) {
-            ucg_planc_ucx_p2p_close_ep(context->eps[i], context->ucp_worker);
-        }
+    ucp_ep_h ep;
+    ucg_hash_foreach_value(&context->eps.hash, ep, {
+        ucg_planc_ucx_p2p_close_ep(ep, context->ucp_worker);
+    });
+    return;
+}
+
+static inline void ucg_planc_ucx_p2p_wakeup(ucg_planc_ucx_p2p_state_t *state)
+{
+    if (state->request != NULL) {
+        ucg_request_wakeup(state->request);
     }
     return;
 }
@@ -196,6 +216,7 @@ static void ucg_planc_ucx_p2p_isend_done(void *request, ucs_status_t status,
         state->status = UCG_ERR_IO_ERROR;
     }
     --state->inflight_send_cnt;
+    ucg_planc_ucx_p2p_wakeup(state);
     ucg_planc_ucx_p2p_req_t *req = (ucg_planc_ucx_p2p_req_t*)request;
     if (req->free_in_cb) {
         ucg_planc_ucx_p2p_req_free(request);
@@ -213,6 +234,7 @@ static void ucg_planc_ucx_p2p_irecv_done(void *request, ucs_status_t status,
         state->status = UCG_ERR_IO_ERROR;
     }
     --state->inflight_recv_cnt;
+    ucg_planc_ucx_p2p_wakeup(state);
     ucg_planc_ucx_p2p_req_t *req = (ucg_planc_ucx_p2p_req_t*)request;
     if (req->free_in_cb) {
         ucg_planc_ucx_p2p_req_free(request);
@@ -257,6 +279,8 @@ ucg_status_t ucg_planc_ucx_p2p_isend(const void *buffer, int32_t count,
               group->myrank, ucg_rank_map_eval(&vgroup->rank_map, vrank),
               ucp_tag, count, ucg_dt_size(dt), ucg_dt_extent(dt));
     ucs_status_ptr_t ucp_req = ucp_tag_send_nbx(ep, buffer, count, ucp_tag, &req_param);
+    /* The op may wait for the next progress to handle the completed send. */
+    ucg_planc_ucx_p2p_wakeup(state);
     if (ucp_req == NULL || UCS_PTR_IS_ERR(ucp_req)) {
         return ucg_status_s2g(UCS_PTR_STATUS(ucp_req));
     }
@@ -292,8 +316,6 @@ void *ucg_planc_ucx_get_ucp_ep(void *arg, void *group, int rank)
     ucg_planc_ucx_context_t *ucx_context = (ucg_planc_ucx_context_t *)arg;
     ucg_vgroup_t *vgroup = (ucg_vgroup_t *)group;
     ucg_rank_t vrank = (ucg_rank_t)rank;
-    ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
-    ucg_rank_t ctx_rank = ucg_group_get_ctx_rank(vgroup->group, group_rank);
     ucg_context_t *context = vgroup->group->context;
     ucg_planc_ucx_t *planc_ucx = ucg_planc_ucx_instance();
     ucg_proc_info_t *proc_info = NULL;
@@ -301,11 +323,13 @@ void *ucg_planc_ucx_get_ucp_ep(void *arg, void *group, int rank)
 
     if (ucx_context->config.use_oob == UCG_YES) {
         void *group = vgroup->group->oob_group.group;
-        return ucg_planc_ucx_get_oob_ucp_ep(group, group_rank);
+        return ucg_planc_ucx_get_oob_ucp_ep(group, ucg_rank_map_eval(&vgroup->rank_map, vrank));
     }
 
-    if (ucx_context->eps[ctx_rank] != NULL) {
-        return ucx_context->eps[ctx_rank];
+    ucg_rank_t ctx_rank = ucg_vgroup_get_ctx_rank(vgroup, vrank);
+    ep = ucg_planc_ucx_context_get_ep(ucx_context, ctx_rank);
+    if (ep != NULL) {
+        return ep;
     }
 
     void *ucp_addr = ucg_context_get_proc_addr(context, ctx_rank, &planc_ucx->super, &proc_info);
@@ -325,7 +349,10 @@ void *ucg_planc_ucx_get_ucp_ep(void *arg, void *group, int rank)
         goto free_proc_info;
     }
 
-    ucx_context->eps[ctx_rank] = ep;
+    if (ucg_planc_ucx_context_put_ep(ucx_context, ctx_rank, ep) != UCG_OK) {
+        ucg_planc_ucx_p2p_close_ep(ep, ucx_context->ucp_worker);
+        ep = NULL;
+    }
 free_proc_info:
     ucg_free_proc_info(proc_info);
     return ep;
@@ -370,6 +397,7 @@ ucg_status_t ucg_planc_ucx_p2p_irecv(void *buffer, int32_t count,
     }
     ucs_status_ptr_t ucp_req = ucp_tag_recv_nbx(ucp_worker, buffer, count, ucp_tag,
                                                 UCG_P2P_TAG_MASK, &req_param);
+    ucg_planc_ucx_p2p_wakeup(state);
     if (ucp_req == NULL || UCS_PTR_IS_ERR(ucp_req)) {
         return ucg_status_s2g(UCS_PTR_STATUS(ucp_req));
     }
@@ -415,6 +443,8 @@ ucg_status_t ucg_planc_ucx_p2p_test(ucg_planc_ucx_group_t *ucx_group,
     }
     int polls = 0;
     int n_polls = context->config.n_polls;
+    /* In a batch, the worker has been progressed once for all the requests. */
+    int in_batch = ucg_request_in_batch();
     while (polls++ < n_polls) {
         ucs_status_t status = ucp_request_check_status(*req);
         if (status != UCS_INPROGRESS) {
@@ -422,6 +452,9 @@ ucg_status_t ucg_planc_ucx_p2p_test(ucg_planc_ucx_group_t *ucx_group,
             *req = NULL;
             return ucg_status_s2g(status);
         }
+        if (in_batch) {
+            break;
+        }
         ucp_worker_progress(ucp_worker);
     }
     return UCG_INPROGRESS;
@@ -433,6 +466,10 @@ ucg_status_t ucg_planc_ucx_p2p_testall(ucg_planc_ucx_group_t *ucx_group,
     if (state->inflight_send_cnt == 0 && state->inflight_recv_cnt == 0) {
         return state->status;
     }
+    /* In a batch, the worker has been progressed once for all the requests. */
+    if (ucg_request_in_batch()) {
+        return UCG_INPROGRESS;
+    }
 
     ucg_planc_ucx_context_t *context = ucx_group->context;
     ucp_worker_h ucp_worker = ucg_planc_ucx_context_get_worker(context);
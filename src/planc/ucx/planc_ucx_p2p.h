@@ -34,6 +34,8 @@ typedef struct ucg_planc_ucx_p2p_state {
     ucg_status_t status;
     int inflight_send_cnt;
     int inflight_recv_cnt;
+    /** Woken up on every p2p event of this state, can be NULL. */
+    ucg_request_t *request;
 } ucg_planc_ucx_p2p_state_t;
 
 typedef struct ucg_planc_ucx_p2p_params {
@@ -136,6 +138,12 @@ static inline void ucg_planc_ucx_p2p_state_reset(ucg_planc_ucx_p2p_state_t *stat
 
 void ucg_planc_ucx_p2p_close_all_ep(ucg_planc_ucx_context_t *context);
 
+/**
+ * @brief Create the endpoint of the peer without waiting for the wire-up.
+ */
+ucg_status_t ucg_planc_ucx_p2p_connect(ucg_vgroup_t *vgroup, ucg_rank_t vrank,
+                                       ucg_planc_ucx_group_t *ucx_group);
+
 void *ucg_planc_ucx_get_ucp_ep(void *arg, void *group, int rank);
 
 static inline void *ucg_planc_ucx_get_ucp_worker(void *arg)
@@ -42,6 +42,26 @@ static const ucg_plan_policy_t* ucg_planc_ucx_get_plan_policy(ucg_coll_type_t co
         case UCG_COLL_TYPE_IREDUCE:
             policy = ucg_planc_ucx_get_reduce_plan_policy(node_level, ppn_level);
             break;
+        case UCG_COLL_TYPE_ALLTOALLV:
+        case UCG_COLL_TYPE_IALLTOALLV:
+            policy = ucg_planc_ucx_get_alltoallv_plan_policy(node_level, ppn_level);
+            break;
+        case UCG_COLL_TYPE_REDUCE_SCATTER:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER:
+        case UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK:
+        case UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK:
+            policy = ucg_planc_ucx_get_reduce_scatter_plan_policy(node_level, ppn_level);
+            break;
+        case UCG_COLL_TYPE_SCAN:
+        case UCG_COLL_TYPE_ISCAN:
+        case UCG_COLL_TYPE_EXSCAN:
+        case UCG_COLL_TYPE_IEXSCAN:
+            policy = ucg_planc_ucx_get_scan_plan_policy(node_level, ppn_level);
+            break;
+        case UCG_COLL_TYPE_ALLGATHER:
+        case UCG_COLL_TYPE_IALLGATHER:
+            policy = ucg_planc_ucx_get_allgather_plan_policy(node_level, ppn_level);
+            break;
         default:
             break;
     }
@@ -73,48 +93,76 @@ static ucg_coll_type_t ucg_planc_ucx_coll_nonblock_2_block(ucg_coll_type_t coll)
         case UCG_COLL_TYPE_IREDUCE:
             new_coll = UCG_COLL_TYPE_REDUCE;
             break;
+        case UCG_COLL_TYPE_IALLTOALLV:
+            new_coll = UCG_COLL_TYPE_ALLTOALLV;
+            break;
+        case UCG_COLL_TYPE_IREDUCE_SCATTER:
+            new_coll = UCG_COLL_TYPE_REDUCE_SCATTER;
+            break;
+        case UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK:
+            new_coll = UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK;
+            break;
+        case UCG_COLL_TYPE_ISCAN:
+            new_coll = UCG_COLL_TYPE_SCAN;
+            break;
+        case UCG_COLL_TYPE_IEXSCAN:
+            new_coll = UCG_COLL_TYPE_EXSCAN;
+            break;
+        case UCG_COLL_TYPE_IALLGATHER:
+            new_coll = UCG_COLL_TYPE_ALLGATHER;
+            break;
         default:
             break;
     }
     return new_coll;
 }
-static ucg_status_t ucg_planc_ucx_set_plan_attr(ucg_vgroup_t *vgroup,
-                                                ucg_coll_type_t coll_type,
-                                                const ucg_plan_policy_t *policy,
-                                                ucg_plan_attr_t *attr)
+static const ucg_plan_attr_t* ucg_planc_ucx_find_plan_attr(ucg_coll_type_t coll_type,
+                                                            int32_t id)
 {
-    attr->id = policy->id;
-    attr->range = policy->range;
-    attr->score = policy->score;
-    attr->vgroup = vgroup;
-
     /**
      * Non-blocking is treated as blocking because the @ucg_planc_ucx_xxx_plan_attr
      * array is registered as blocking mode only.
      */
     coll_type = ucg_planc_ucx_coll_nonblock_2_block(coll_type);
 
-    ucg_plan_attr_t *plan_attr = UCG_PLAN_ATTR_ARRAY(ucg_planc_ucx, coll_type);
+    const ucg_plan_attr_t *plan_attr = UCG_PLAN_ATTR_ARRAY(ucg_planc_ucx, coll_type);
     if (plan_attr == NULL) {
-        return UCG_ERR_NOT_FOUND;
+        return NULL;
     }
     for (; !UCG_PLAN_ATTR_IS_LAST(plan_attr); ++plan_attr) {
-        if (plan_attr->id == attr->id) {
-            attr->prepare = plan_attr->prepare;
-            attr->name = plan_attr->name;
-            attr->domain = plan_attr->domain;
-            attr->deprecated = plan_attr->deprecated;
-            return UCG_OK;
+        if (plan_attr->id == id) {
+            return plan_attr;
         }
     }
-    return UCG_ERR_NOT_FOUND;
+    return NULL;
 }
 
-static ucg_status_t ucg_planc_ucx_add_default_plans(ucg_planc_ucx_group_t *ucx_group,
-                                                    ucg_plans_t *plans)
+static ucg_status_t ucg_planc_ucx_set_plan_attr(ucg_vgroup_t *vgroup,
+                                                ucg_coll_type_t coll_type,
+                                                const ucg_plan_policy_t *policy,
+                                                ucg_plan_attr_t *attr)
 {
-    ucg_vgroup_t *vgroup = &ucx_group->super.super;
-    ucg_group_t *group = vgroup->group;
+    const ucg_plan_attr_t *plan_attr = ucg_planc_ucx_find_plan_attr(coll_type, policy->id);
+    if (plan_attr == NULL) {
+        return UCG_ERR_NOT_FOUND;
+    }
+
+    attr->id = policy->id;
+    attr->range = policy->range;
+    attr->score = policy->score;
+    attr->vgroup = vgroup;
+    attr->prepare = plan_attr->prepare;
+    attr->name = plan_attr->name;
+    attr->domain = plan_attr->domain;
+    attr->peers = plan_attr->peers;
+    attr->deprecated = plan_attr->deprecated;
+    return UCG_OK;
+}
+
+static const ucg_plan_policy_t* ucg_planc_ucx_get_default_policy(ucg_planc_ucx_group_t *ucx_group,
+                                                                 ucg_coll_type_t coll_type)
+{
+    ucg_group_t *group = ucx_group->super.super.group;
 
     /* calc node_level and ppn_level */
     int32_t nnode = group->topo->detail.nnode;
@@ -122,6 +170,60 @@ static ucg_status_t ucg_planc_ucx_add_default_plans(ucg_planc_ucx_group_t *ucx_g
     ave_ppn = nnode == 0 ? UCG_TOPO_PPX_UNKNOWN : group->size / nnode;
     ucg_planc_ucx_node_level_t node_level = ucg_planc_ucx_get_node_level(nnode);
     ucg_planc_ucx_ppn_level_t ppn_level = ucg_planc_ucx_get_ppn_level(ave_ppn);
+    return ucg_planc_ucx_get_plan_policy(coll_type, node_level, ppn_level, ucx_group);
+}
+
+/**
+ * The policy is shadowed if a usable plan with a higher score covers its whole
+ * range, then it's only a fallback.
+ */
+static int ucg_planc_ucx_policy_is_shadowed(ucg_coll_type_t coll_type,
+                                            const ucg_plan_policy_t *policy,
+                                            const ucg_plan_policy_t *others)
+{
+    if (others == NULL) {
+        return 0;
+    }
+
+    for (; !UCG_PLAN_POLICY_IS_LAST(others); ++others) {
+        if (others->score <= policy->score ||
+            others->range.start > policy->range.start ||
+            others->range.end < policy->range.end) {
+            continue;
+        }
+        const ucg_plan_attr_t *plan_attr = ucg_planc_ucx_find_plan_attr(coll_type, others->id);
+        if (plan_attr != NULL && !plan_attr->deprecated) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Only the peers of the plans that are selected first are pre-wired. */
+static void ucg_planc_ucx_prewire_add_policy(ucg_planc_ucx_group_t *ucx_group,
+                                             ucg_coll_type_t coll_type,
+                                             const ucg_plan_policy_t *policy,
+                                             const ucg_plan_attr_t *attr)
+{
+    ucg_planc_ucx_context_t *context = ucx_group->context;
+    if (context->config.prewire == UCG_PLANC_UCX_PREWIRE_OFF || attr->peers == 0) {
+        return;
+    }
+
+    const ucg_plan_policy_t *default_policy;
+    default_policy = ucg_planc_ucx_get_default_policy(ucx_group, coll_type);
+    if (ucg_planc_ucx_policy_is_shadowed(coll_type, policy, default_policy) ||
+        ucg_planc_ucx_policy_is_shadowed(coll_type, policy, context->user_policy[coll_type])) {
+        return;
+    }
+    ucg_planc_ucx_prewire_add_peers(ucx_group, attr->peers);
+    return;
+}
+
+static ucg_status_t ucg_planc_ucx_add_default_plans(ucg_planc_ucx_group_t *ucx_group,
+                                                    ucg_plans_t *plans)
+{
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
 
     ucg_plan_params_t params;
     params.mem_type = UCG_MEM_TYPE_HOST;
@@ -130,7 +232,7 @@ static ucg_status_t ucg_planc_ucx_add_default_plans(ucg_planc_ucx_group_t *ucx_g
     ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
     for (; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
         /* get internal policy */
-        default_policy = ucg_planc_ucx_get_plan_policy(coll_type, node_level, ppn_level, ucx_group);
+        default_policy = ucg_planc_ucx_get_default_policy(ucx_group, coll_type);
         if (default_policy == NULL) {
             continue;
         }
@@ -147,6 +249,7 @@ static ucg_status_t ucg_planc_ucx_add_default_plans(ucg_planc_ucx_group_t *ucx_g
                 ucg_error("Failed to add default plan, coll type %d", coll_type);
                 return status;
             }
+            ucg_planc_ucx_prewire_add_policy(ucx_group, coll_type, default_policy, &params.attr);
         }
     }
     return UCG_OK;
@@ -176,6 +279,7 @@ static ucg_status_t ucg_planc_ucx_add_user_plans(ucg_planc_ucx_group_t *ucx_grou
                 ucg_error("Failed to add user plan, coll type %d", coll_type);
                 return status;
             }
+            ucg_planc_ucx_prewire_add_policy(ucx_group, coll_type, user_policy_ptr, &params.attr);
         }
     }
     return UCG_OK;
@@ -217,9 +321,12 @@ ucg_status_t ucg_planc_ucx_get_plans(ucg_planc_group_h planc_group, ucg_plans_t
         status = planm->get_plans(planc_group, plans);
         if (status != UCG_OK) {
             ucg_error("Failed to get ucx plans in planm %s", planm->super.name);
-            break;
+            return status;
         }
     }
 
+    if (context->config.prewire == UCG_PLANC_UCX_PREWIRE_EAGER) {
+        ucg_planc_ucx_group_prewire(ucx_group);
+    }
     return status;
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_PLANC_UCX_PLAN_H_
@@ -18,6 +18,12 @@
 #include "reduce/reduce.h"
 #include "scatterv/scatterv.h"
 #include "gatherv/gatherv.h"
+#include "alltoallv/alltoallv.h"
+#include "reduce_scatter/reduce_scatter.h"
+#include "scan/scan.h"
+#include "allgather/allgather.h"
+#include "util/ucg_bufcache.h"
+#include "util/ucg_math.h"
 
 #define UCG_PLAN_UCX_PLAN_SCORE_0TH 90
 #define UCG_PLAN_UCX_PLAN_SCORE_1ST (UCG_PLAN_UCX_PLAN_SCORE_0TH - 1)
@@ -45,6 +51,8 @@ typedef struct ucg_planc_ucx_op {
     /* Abstracted fields, the concrete op determines how to use these. */
     uint64_t flags;
     void *staging_area;
+    /* Metadata which is needed before the staging area can be sized. */
+    void *meta_area;
     /* Fields related to collective operations. */
     union {
         ucg_planc_ucx_bcast_t bcast;
@@ -53,6 +61,11 @@ typedef struct ucg_planc_ucx_op {
         ucg_planc_ucx_allgatherv_t allgatherv;
         ucg_planc_ucx_reduce_t reduce;
         ucg_planc_ucx_scatterv_t scatterv;
+        ucg_planc_ucx_alltoallv_t alltoallv;
+        ucg_planc_ucx_reduce_scatter_t reduce_scatter;
+        ucg_planc_ucx_scan_t scan;
+        ucg_planc_ucx_allgather_t allgather;
+        ucg_planc_ucx_gatherv_t gatherv;
     };
 } ucg_planc_ucx_op_t;
 
@@ -74,13 +87,69 @@ typedef struct ucg_planc_ucx_algo_table {
 
 UCG_PLAN_ATTR_TABLE_DECLARE(ucg_planc_ucx);
 
-static inline ucg_status_t ucg_planc_ucx_op_discard(ucg_plan_op_t *ucg_op)
+/**
+ * @brief Get the staging area of @a size bytes from the staging cache of the group.
+ *
+ * If @a scratch is not NULL, a scratch area of @a scratch_size bytes is placed
+ * after the staging area, it is released together with the staging area.
+ */
+static inline ucg_status_t ucg_planc_ucx_op_get_staging(ucg_planc_ucx_op_t *op, size_t size,
+                                                        size_t scratch_size, void **scratch)
 {
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    size_t scratch_offset = ucg_align_up_pow2(size, sizeof(void*));
+
+    ucg_assert(op->staging_area == NULL);
+    op->staging_area = ucg_bufcache_get(&op->ucx_group->staging_cache,
+                                        scratch_offset + scratch_size);
+    if (op->staging_area == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    if (scratch != NULL) {
+        *scratch = (uint8_t*)op->staging_area + scratch_offset;
+    }
+    return UCG_OK;
+}
 
+static inline void ucg_planc_ucx_op_put_staging(ucg_planc_ucx_op_t *op)
+{
     if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
+        ucg_bufcache_put(op->staging_area);
+        op->staging_area = NULL;
+    }
+    return;
+}
+
+/**
+ * @brief Get the meta area of @a size bytes from the staging cache of the group.
+ *
+ * It's for the op whose staging area is sized in progress, the meta area is
+ * kept until the op is discarded.
+ */
+static inline ucg_status_t ucg_planc_ucx_op_get_meta(ucg_planc_ucx_op_t *op, size_t size)
+{
+    ucg_assert(op->meta_area == NULL);
+    op->meta_area = ucg_bufcache_get(&op->ucx_group->staging_cache, size);
+    if (op->meta_area == NULL) {
+        return UCG_ERR_NO_MEMORY;
     }
+    return UCG_OK;
+}
+
+static inline void ucg_planc_ucx_op_put_meta(ucg_planc_ucx_op_t *op)
+{
+    if (op->meta_area != NULL) {
+        ucg_bufcache_put(op->meta_area);
+        op->meta_area = NULL;
+    }
+    return;
+}
+
+static inline ucg_status_t ucg_planc_ucx_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_put_staging(op);
+    ucg_planc_ucx_op_put_meta(op);
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
     return UCG_OK;
@@ -91,8 +160,15 @@ static inline void ucg_planc_ucx_op_init(ucg_planc_ucx_op_t *op,
 {
     op->ucx_group = ucx_group;
     ucg_planc_ucx_p2p_state_reset(&op->p2p_state);
+    /* All progress of ucx op is driven by its p2p operations. */
+    op->p2p_state.request = &op->super.super;
+    op->super.super.flags |= UCG_REQUEST_FLAG_WAKEUP;
     op->flags = 0;
     op->staging_area = NULL;
+    op->meta_area = NULL;
+    if (ucg_unlikely(ucx_group->prewire_pending)) {
+        ucg_planc_ucx_group_prewire(ucx_group);
+    }
     return;
 }
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "planc_ucx_prewire.h"
+#include "planc_ucx_group.h"
+#include "planc_ucx_p2p.h"
+
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/algo/ucg_kntree.h"
+#include "util/algo/ucg_rd.h"
+#include "util/algo/ucg_ring.h"
+#include "util/ucg_log.h"
+
+#define PEERS_RD     UCG_PLANC_UCX_PREWIRE_PEERS_RD
+#define PEERS_TREE   UCG_PLANC_UCX_PREWIRE_PEERS_TREE
+#define PEERS_RING   UCG_PLANC_UCX_PREWIRE_PEERS_RING
+#define PEERS_BRUCK  UCG_PLANC_UCX_PREWIRE_PEERS_BRUCK
+#define PEERS_NA     UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE
+#define PEERS_SA     UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE
+#define PEERS_FLAT   (PEERS_RD | PEERS_TREE | PEERS_RING | PEERS_BRUCK)
+
+const char *ucg_planc_ucx_prewire_names[] = {
+    [UCG_PLANC_UCX_PREWIRE_OFF] = "off",
+    [UCG_PLANC_UCX_PREWIRE_LAZY] = "lazy",
+    [UCG_PLANC_UCX_PREWIRE_EAGER] = "eager",
+    [UCG_PLANC_UCX_PREWIRE_LAST] = NULL,
+};
+
+void ucg_planc_ucx_prewire_add_peers(ucg_planc_ucx_group_t *ucx_group, uint32_t peers)
+{
+    if (ucx_group->context->config.prewire == UCG_PLANC_UCX_PREWIRE_OFF) {
+        return;
+    }
+
+    uint32_t flat = peers & PEERS_FLAT;
+    uint32_t *topo_peers = ucx_group->prewire_topo_peers;
+    if (peers & (PEERS_NA | PEERS_SA)) {
+        topo_peers[UCG_TOPO_GROUP_TYPE_NODE] |= PEERS_TREE;
+        topo_peers[UCG_TOPO_GROUP_TYPE_NODE_LEADER] |= flat;
+        if (peers & PEERS_SA) {
+            topo_peers[UCG_TOPO_GROUP_TYPE_SOCKET] |= PEERS_TREE;
+            topo_peers[UCG_TOPO_GROUP_TYPE_SOCKET_LEADER] |= PEERS_TREE;
+        }
+    } else {
+        ucx_group->prewire_peers |= flat;
+    }
+    if (peers != 0) {
+        ucx_group->prewire_pending = 1;
+    }
+    return;
+}
+
+static void ucg_planc_ucx_prewire_connect(ucg_planc_ucx_group_t *ucx_group,
+                                          ucg_vgroup_t *vgroup, ucg_rank_t peer)
+{
+    if (peer == UCG_INVALID_RANK || peer == vgroup->myrank) {
+        return;
+    }
+    /* The endpoint is still created by the first use if it fails here. */
+    (void)ucg_planc_ucx_p2p_connect(vgroup, peer, ucx_group);
+    return;
+}
+
+static void ucg_planc_ucx_prewire_vgroup(ucg_planc_ucx_group_t *ucx_group,
+                                         ucg_vgroup_t *vgroup, uint32_t peers)
+{
+    int size = vgroup->size;
+    ucg_rank_t myrank = vgroup->myrank;
+    ucg_rank_t peer;
+
+    if (peers == 0 || size <= 1) {
+        return;
+    }
+
+    if (peers & PEERS_RD) {
+        ucg_algo_rd_iter_t iter;
+        ucg_algo_rd_iter_init(&iter, size, myrank);
+        while ((peer = ucg_algo_rd_iter_value_inc(&iter)) != UCG_INVALID_RANK) {
+            ucg_planc_ucx_prewire_connect(ucx_group, vgroup, peer);
+        }
+    }
+
+    if (peers & PEERS_TREE) {
+        /* Fan-out uses the left-most tree and fan-in uses the right-most one. */
+        for (uint8_t leftmost = 0; leftmost <= 1; ++leftmost) {
+            ucg_algo_kntree_iter_t iter;
+            ucg_algo_kntree_iter_init(&iter, size, 2, 0, myrank, leftmost);
+            ucg_planc_ucx_prewire_connect(ucx_group, vgroup,
+                                          ucg_algo_kntree_iter_parent_value(&iter));
+            while ((peer = ucg_algo_kntree_iter_child_value(&iter)) != UCG_INVALID_RANK) {
+                ucg_planc_ucx_prewire_connect(ucx_group, vgroup, peer);
+                ucg_algo_kntree_iter_child_inc(&iter);
+            }
+        }
+    }
+
+    if (peers & PEERS_RING) {
+        ucg_algo_ring_iter_t iter;
+        ucg_algo_ring_iter_init(&iter, size, myrank);
+        ucg_planc_ucx_prewire_connect(ucx_group, vgroup, ucg_algo_ring_iter_left_value(&iter));
+        ucg_planc_ucx_prewire_connect(ucx_group, vgroup, ucg_algo_ring_iter_right_value(&iter));
+    }
+
+    if (peers & PEERS_BRUCK) {
+        for (int distance = 1; distance < size; distance <<= 1) {
+            ucg_planc_ucx_prewire_connect(ucx_group, vgroup, (myrank + distance) % size);
+            ucg_planc_ucx_prewire_connect(ucx_group, vgroup, (myrank - distance + size) % size);
+        }
+    }
+    return;
+}
+
+void ucg_planc_ucx_group_prewire(ucg_planc_ucx_group_t *ucx_group)
+{
+    if (!ucx_group->prewire_pending) {
+        return;
+    }
+    ucx_group->prewire_pending = 0;
+
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    ucg_planc_ucx_prewire_vgroup(ucx_group, vgroup, ucx_group->prewire_peers);
+
+    ucg_topo_t *topo = vgroup->group->topo;
+    for (int type = 0; type < UCG_TOPO_GROUP_TYPE_LAST; ++type) {
+        uint32_t peers = ucx_group->prewire_topo_peers[type];
+        if (peers == 0) {
+            continue;
+        }
+        ucg_topo_group_t *topo_group = ucg_topo_get_group(topo, (ucg_topo_group_type_t)type);
+        if (topo_group == NULL || topo_group->state != UCG_TOPO_GROUP_STATE_ENABLE) {
+            continue;
+        }
+        ucg_planc_ucx_prewire_vgroup(ucx_group, &topo_group->super, peers);
+    }
+
+    ucg_debug("Prewired group %u, %u endpoints in the context",
+              vgroup->group->id, ucg_hash_size(&ucx_group->context->eps.hash));
+    return;
+}
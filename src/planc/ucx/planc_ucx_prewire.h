@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_PREWIRE_H_
+#define UCG_PLANC_UCX_PREWIRE_H_
+
+#include "planc_ucx_def.h"
+#include "ucg/api/ucg.h"
+#include "core/ucg_request.h"
+
+/**
+ * Pre-wiring of the endpoints
+ *
+ * The endpoint of a peer is created by its first send or receive, which puts
+ * the address lookup and @ref ucp_ep_create on the latency path of the first
+ * collective. With pre-wiring, the peers that the plans of a group talk to are
+ * connected in bulk before that, either when the group is created (eager) or
+ * when its first operation is prepared (lazy). The endpoints are created
+ * without waiting for the wire-up, which is completed by the later progress.
+ *
+ * The peers are described by the communication patterns of the plans that are
+ * selected first, see @ref ucg_plan_attr_t::peers, which are applied to the
+ * group and to the topology groups of the hierarchical plans. They are a hint,
+ * a peer that is missed is still connected on its first use.
+ */
+
+typedef enum ucg_planc_ucx_prewire {
+    UCG_PLANC_UCX_PREWIRE_OFF,
+    UCG_PLANC_UCX_PREWIRE_LAZY,
+    UCG_PLANC_UCX_PREWIRE_EAGER,
+    UCG_PLANC_UCX_PREWIRE_LAST,
+} ucg_planc_ucx_prewire_t;
+
+extern const char *ucg_planc_ucx_prewire_names[];
+
+/**
+ * Communication patterns of a plan, which are set in @ref ucg_plan_attr_t::peers
+ * of the builtin plans. 0 means the plan talks to every peer.
+ */
+typedef enum ucg_planc_ucx_prewire_peers {
+    /* Partners of recursive doubling and halving, including the extra ranks */
+    UCG_PLANC_UCX_PREWIRE_PEERS_RD = UCG_BIT(0),
+    /* Parent and children of the binomial trees rooted at rank 0 */
+    UCG_PLANC_UCX_PREWIRE_PEERS_TREE = UCG_BIT(1),
+    /* Left and right neighbours */
+    UCG_PLANC_UCX_PREWIRE_PEERS_RING = UCG_BIT(2),
+    /* Ranks at distance 2^k in both directions */
+    UCG_PLANC_UCX_PREWIRE_PEERS_BRUCK = UCG_BIT(3),
+    /**
+     * The patterns above are applied to the node leaders instead of the group,
+     * and the tree is applied to the members of my node.
+     */
+    UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE = UCG_BIT(4),
+    /**
+     * Same as node-aware, and the tree is also applied to the members of my
+     * socket and the socket leaders of my node.
+     */
+    UCG_PLANC_UCX_PREWIRE_PEERS_SOCKET_AWARE = UCG_BIT(5),
+} ucg_planc_ucx_prewire_peers_t;
+
+/**
+ * @brief Add the peers of a plan to the peers of the group.
+ *
+ * @param [in] peers        Patterns of the plan, @ref ucg_plan_attr_t::peers.
+ *
+ * Nothing is added if pre-wiring is off.
+ */
+void ucg_planc_ucx_prewire_add_peers(ucg_planc_ucx_group_t *ucx_group, uint32_t peers);
+
+/**
+ * @brief Connect the peers added to the group.
+ *
+ * It's done once, later calls return immediately.
+ */
+void ucg_planc_ucx_group_prewire(ucg_planc_ucx_group_t *ucx_group);
+
+#endif
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "reduce.h"
@@ -10,7 +10,20 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_reduce_plan_attr[] = {
     {ucg_planc_ucx_reduce_kntree_prepare,
-     1, "K-nomial tree", PLAN_DOMAIN},
+     1, "K-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
+
+    {ucg_planc_ucx_reduce_chain_prepare,
+     2, "Pipelined chain", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
+
+    {ucg_planc_ucx_reduce_rabenseifner_prepare,
+     3, "Rabenseifner", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {ucg_planc_ucx_reduce_na_kntree_prepare,
+     4, "Node-aware K-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {NULL},
 };
@@ -23,20 +36,192 @@ static ucg_config_field_t reduce_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_reduce_config_t, kntree_degree),
      UCG_CONFIG_TYPE_INT},
 
+    {"REDUCE_CHAIN_SEGSIZE", "64k",
+     "Configure the segment size in pipelined chain algo for reduce, the vector\n"
+     "is received, reduced and forwarded in segments of this size",
+     ucg_offsetof(ucg_planc_ucx_reduce_config_t, chain_segsize),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"REDUCE_CHAIN_DEPTH", "2",
+     "Configure the number of segments in flight in pipelined chain algo for\n"
+     "reduce, each of them takes a staging buffer of segment size, minimum is 2",
+     ucg_offsetof(ucg_planc_ucx_reduce_config_t, chain_depth),
+     UCG_CONFIG_TYPE_INT},
+
+    {"REDUCE_NA_KNTREE_INTER_DEGREE", "8",
+     "Configure the k value among nodes in node-aware kntree algo for reduce",
+     ucg_offsetof(ucg_planc_ucx_reduce_config_t, na_kntree_inter_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {"REDUCE_NA_KNTREE_INTRA_DEGREE", "2",
+     "Configure the k value in a node in node-aware kntree algo for reduce",
+     ucg_offsetof(ucg_planc_ucx_reduce_config_t, na_kntree_intra_degree),
+     UCG_CONFIG_TYPE_INT},
+
     {NULL}
 };
 UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_REDUCE, reduce_config_table,
                                     sizeof(ucg_planc_ucx_reduce_config_t))
 
-static ucg_plan_policy_t reduce_plan_policy[] = {
-    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+/**
+ * Trees are bound by the bandwidth of the root for large messages, which only
+ * receive about the size of the vector per rank with Rabenseifner, and the
+ * chain streams the vector once through every rank. The chain also supports
+ * non-commutative ops, so it is the fallback of every table.
+ */
+static ucg_plan_policy_t reduce_default[] = {
+    {1,  {0, 16384}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {3,  {16384, 4194304}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {2,  {4194304, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t reduce_na[] = {
+    {4,  {0, 16384}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {3,  {16384, 4194304}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {2,  {4194304, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_2ND},
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
     UCG_PLAN_LAST_POLICY,
 };
 
 const ucg_plan_policy_t *ucg_planc_ucx_get_reduce_plan_policy(ucg_planc_ucx_node_level_t node_level,
                                                               ucg_planc_ucx_ppn_level_t ppn_level)
 {
-    UCG_UNUSED(node_level, ppn_level);
-    ucg_plan_policy_t *policy = reduce_plan_policy;
+    UCG_UNUSED(node_level);
+    ucg_plan_policy_t *policy = (ppn_level == PPN_LEVEL_1) ? reduce_default : reduce_na;
     return policy;
-}
\ No newline at end of file
+}
+
+void ucg_planc_ucx_reduce_fanin_init(ucg_planc_ucx_reduce_fanin_t *fanin, int size,
+                                     int degree, ucg_rank_t root, ucg_rank_t myrank,
+                                     const ucg_rank_t *ranks)
+{
+    ucg_algo_kntree_iter_t *iter = &fanin->iter;
+    ucg_algo_kntree_iter_init(iter, size, degree, root, myrank, 0);
+    fanin->ranks = ranks;
+    fanin->requests_count = 0;
+    while (ucg_algo_kntree_iter_child_value(iter) != UCG_INVALID_RANK) {
+        fanin->requests_count++;
+        ucg_algo_kntree_iter_child_inc(iter);
+    }
+    ucg_algo_kntree_iter_reset(iter);
+    return;
+}
+
+void ucg_planc_ucx_reduce_fanin_reset(ucg_planc_ucx_reduce_fanin_t *fanin)
+{
+    ucg_algo_kntree_iter_reset(&fanin->iter);
+    fanin->bitcount = 0;
+    memset(fanin->req_bitmap, 0, fanin->requests_count);
+    for (int i = 0; i < fanin->requests_count; i++) {
+        fanin->requests[i] = NULL;
+    }
+    return;
+}
+
+static inline ucg_rank_t ucg_planc_ucx_reduce_fanin_rank(ucg_planc_ucx_reduce_fanin_t *fanin,
+                                                         ucg_rank_t peer)
+{
+    return fanin->ranks == NULL ? peer : fanin->ranks[peer];
+}
+
+ucg_status_t ucg_planc_ucx_reduce_fanin_progress(ucg_planc_ucx_op_t *op,
+                                                 ucg_planc_ucx_reduce_fanin_t *fanin,
+                                                 uint8_t post)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_reduce_t *reduce = &op->reduce;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_algo_kntree_iter_t *iter = &fanin->iter;
+    ucg_rank_t peer;
+    int idx = 0;
+
+    if (post) {
+        while ((peer = ucg_algo_kntree_iter_child_value(iter)) != UCG_INVALID_RANK) {
+            params.request = &fanin->requests[idx];
+            status = ucg_planc_ucx_p2p_irecv(fanin->slots + idx * fanin->slot_size,
+                                             args->count, args->dt,
+                                             ucg_planc_ucx_reduce_fanin_rank(fanin, peer),
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            /* increase iterator to enter next loop */
+            ucg_algo_kntree_iter_child_inc(iter);
+            idx++;
+        }
+    }
+
+    for (idx = 0; idx < fanin->requests_count; idx++) {
+        if (fanin->req_bitmap[idx]) {
+            continue;
+        }
+        status = ucg_planc_ucx_p2p_test(op->ucx_group, &fanin->requests[idx]);
+        if (status == UCG_INPROGRESS) {
+            continue;
+        }
+        UCG_CHECK_GOTO(status, out);
+        uint8_t *slot = fanin->slots + idx * fanin->slot_size;
+        if (reduce->data != reduce->acc) {
+            /* My input is not copied to acc, the first reduction takes it. */
+            status = ucg_op_reduce3(args->op, slot, (void*)reduce->data, reduce->acc,
+                                    args->count, args->dt);
+            reduce->data = reduce->acc;
+        } else {
+            status = ucg_op_reduce(args->op, slot, reduce->acc, args->count, args->dt);
+        }
+        UCG_CHECK_GOTO(status, out);
+        fanin->req_bitmap[idx] = 1;
+        ++fanin->bitcount;
+    }
+
+    status = (fanin->bitcount == fanin->requests_count) ? UCG_OK : UCG_INPROGRESS;
+
+out:
+    return status;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_fanin_send(ucg_planc_ucx_op_t *op,
+                                             ucg_planc_ucx_reduce_fanin_t *fanin,
+                                             uint8_t post)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    ucg_rank_t peer = ucg_algo_kntree_iter_parent_value(&fanin->iter);
+    if (peer == UCG_INVALID_RANK) {
+        return UCG_OK;
+    }
+
+    if (post) {
+        /* A leaf sends its input directly. */
+        status = ucg_planc_ucx_p2p_isend(op->reduce.data, args->count, args->dt,
+                                         ucg_planc_ucx_reduce_fanin_rank(fanin, peer),
+                                         op->tag, op->super.vgroup, &params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+out:
+    return status;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_finish(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_reduce_t *reduce = &op->reduce;
+
+    /* Nothing was reduced, e.g. there is only one rank. */
+    if (reduce->acc != args->recvbuf || reduce->data == reduce->acc) {
+        return UCG_OK;
+    }
+    reduce->data = reduce->acc;
+    return ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                         ucg_planc_ucx_reduce_input(args), args->count, args->dt);
+}
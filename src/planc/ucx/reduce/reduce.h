@@ -10,23 +10,135 @@
 #include "planc/ucx/planc_ucx_group.h"
 #include "planc/ucx/planc_ucx_p2p.h"
 #include "core/ucg_plan.h"
+#include "core/ucg_dt.h"
 #include "util/algo/ucg_kntree.h"
 
 typedef struct ucg_planc_ucx_reduce_config {
     int kntree_degree;
+    /* for pipelined chain */
+    size_t chain_segsize;
+    int chain_depth;
+    /* for node-aware kntree */
+    int na_kntree_inter_degree;
+    int na_kntree_intra_degree;
 } ucg_planc_ucx_reduce_config_t;
 
-typedef struct ucg_planc_ucx_reduce {
-    ucg_algo_kntree_iter_t kntree_iter;
+/**
+ * @brief Fan-in of a k-nomial tree
+ *
+ * The partial results of the children are received into slots and reduced
+ * into my partial result as they arrive.
+ */
+typedef struct ucg_planc_ucx_reduce_fanin {
+    ucg_algo_kntree_iter_t iter;
+    /* Maps the ranks of the tree to the ranks of vgroup, NULL if they are the same. */
+    const ucg_rank_t *ranks;
+    /* One slot and one request per child */
+    uint8_t *slots;
+    int64_t slot_size;
     ucg_planc_ucx_p2p_req_t **requests;
     int requests_count;
     uint8_t* req_bitmap;
     int bitcount;
+} ucg_planc_ucx_reduce_fanin_t;
+
+/**
+ * @brief Reduce op auxiliary information
+ *
+ * Only the root must provide recvbuf, other ranks keep their partial result in
+ * the staging area unless the operation is in place.
+ */
+typedef struct ucg_planc_ucx_reduce {
+    /* My partial result, it is my input until the first reduction. */
+    const void *data;
+    /* Where the partial result is reduced to, recvbuf at root. */
+    void *acc;
+    union {
+        ucg_planc_ucx_reduce_fanin_t kntree;
+        struct {
+            /* The previous rank of the chain, UCG_INVALID_RANK for the head. */
+            ucg_rank_t upstream;
+            /* The next rank of the chain, UCG_INVALID_RANK for the end. */
+            ucg_rank_t downstream;
+            /* The end of the chain relays the result to me if I'm the root but not
+               the end, UCG_INVALID_RANK otherwise. */
+            ucg_rank_t relay;
+            int32_t segcount;
+            int32_t nsegs;
+            /* Number of staging areas, a segment holds one until it is forwarded. */
+            int32_t depth;
+            int32_t posted;
+            int32_t completed;
+            int32_t released;
+            int64_t seg_size;
+            ucg_planc_ucx_p2p_req_t **recv_requests;
+            ucg_planc_ucx_p2p_req_t **send_requests;
+        } chain;
+        struct {
+            int32_t nsteps;
+            int32_t nprocs_rem;
+            /* Ranks are shifted so that the root is 0, it's -1 if I'm folded. */
+            ucg_rank_t new_rank;
+            /* Current bit of the new rank and the range of blocks I hold. */
+            int32_t mask;
+            int32_t low;
+            int32_t high;
+            /* The count is split into 2^nsteps blocks, the first rem ones have one more. */
+            int32_t blkcount;
+            int32_t blkrem;
+            uint8_t *recv;
+        } rabenseifner;
+        struct {
+            /* Reduce in my node to the leader, and then among the leaders to root. */
+            ucg_planc_ucx_reduce_fanin_t intra;
+            ucg_planc_ucx_reduce_fanin_t inter;
+            uint8_t is_leader;
+        } na;
+    };
 } ucg_planc_ucx_reduce_t;
 
+/**
+ * @brief Bytes spanned by @a count elements of @a dt.
+ */
+static inline int64_t ucg_planc_ucx_reduce_span(const ucg_dt_t *dt, int64_t count)
+{
+    return count == 0 ? 0 : dt->true_extent + dt->extent * (count - 1);
+}
+
+/**
+ * @brief The input of the rank, it is in recvbuf when the operation is in place.
+ */
+static inline const void *ucg_planc_ucx_reduce_input(const ucg_coll_reduce_args_t *args)
+{
+    return (args->sendbuf == UCG_IN_PLACE) ? args->recvbuf : args->sendbuf;
+}
+
+/**
+ * @brief Whether recvbuf can hold my partial result, it is not significant at
+ * the non-root rank unless the operation is in place.
+ */
+static inline int ucg_planc_ucx_reduce_use_recvbuf(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_reduce_args_t *args)
+{
+    return vgroup->myrank == args->root || args->sendbuf == UCG_IN_PLACE;
+}
+
 const ucg_plan_policy_t *ucg_planc_ucx_get_reduce_plan_policy(ucg_planc_ucx_node_level_t node_level,
                                                               ucg_planc_ucx_ppn_level_t ppn_level);
 
+/* Common routines of the reduce algorithms */
+void ucg_planc_ucx_reduce_fanin_init(ucg_planc_ucx_reduce_fanin_t *fanin, int size,
+                                     int degree, ucg_rank_t root, ucg_rank_t myrank,
+                                     const ucg_rank_t *ranks);
+void ucg_planc_ucx_reduce_fanin_reset(ucg_planc_ucx_reduce_fanin_t *fanin);
+ucg_status_t ucg_planc_ucx_reduce_fanin_progress(ucg_planc_ucx_op_t *op,
+                                                 ucg_planc_ucx_reduce_fanin_t *fanin,
+                                                 uint8_t post);
+ucg_status_t ucg_planc_ucx_reduce_fanin_send(ucg_planc_ucx_op_t *op,
+                                             ucg_planc_ucx_reduce_fanin_t *fanin,
+                                             uint8_t post);
+ucg_status_t ucg_planc_ucx_reduce_finish(ucg_planc_ucx_op_t *op);
+
 /* xxx_op_new routines are provided for internal algorithm combination */
 ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
                                                        ucg_vgroup_t *vgroup,
@@ -37,5 +149,14 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_kntree_op_new(ucg_planc_ucx_group_t *uc
 ucg_status_t ucg_planc_ucx_reduce_kntree_prepare(ucg_vgroup_t *vgroup,
                                                  const ucg_coll_args_t *args,
                                                  ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_reduce_chain_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_reduce_rabenseifner_prepare(ucg_vgroup_t *vgroup,
+                                                       const ucg_coll_args_t *args,
+                                                       ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_reduce_na_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                    const ucg_coll_args_t *args,
+                                                    ucg_plan_op_t **op);
 
-#endif
\ No newline at end of file
+#endif
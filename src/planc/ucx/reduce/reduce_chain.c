@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce.h"
+#include "planc_ucx_plan.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+#define UCG_REDUCE_CHAIN_MIN_DEPTH 2
+
+/* op flags needed by reduce pipelined chain. */
+enum {
+    UCG_REDUCE_CHAIN_PIPELINE = UCG_BIT(0),
+    UCG_REDUCE_CHAIN_SEND = UCG_BIT(1),
+    UCG_REDUCE_CHAIN_SEND_POST = UCG_BIT(2),
+    UCG_REDUCE_CHAIN_RELAY = UCG_BIT(3),
+    UCG_REDUCE_CHAIN_RELAY_RECV = UCG_BIT(4),
+};
+
+static inline void ucg_planc_ucx_reduce_chain_seg(ucg_planc_ucx_op_t *op, int32_t seg,
+                                                  int32_t *offset, int32_t *count)
+{
+    int32_t segcount = op->reduce.chain.segcount;
+    int32_t total = op->super.super.args.reduce.count;
+
+    *offset = seg * segcount;
+    *count = ucg_min(segcount, total - *offset);
+    return;
+}
+
+/**
+ * @brief Receive, reduce and forward the segments from upstream.
+ *
+ * Up to depth segments are received ahead, each into its own staging area.
+ * A segment is reduced with my input as soon as it arrives and forwarded to
+ * downstream from the same staging area, which is reused once the send is
+ * completed. The end of the chain reduces the segments into recvbuf.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_pipeline(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t upstream = op->reduce.chain.upstream;
+    ucg_rank_t downstream = op->reduce.chain.downstream;
+    int32_t nsegs = op->reduce.chain.nsegs;
+    int32_t depth = op->reduce.chain.depth;
+    int32_t *posted = &op->reduce.chain.posted;
+    int32_t *completed = &op->reduce.chain.completed;
+    int32_t *released = &op->reduce.chain.released;
+    ucg_planc_ucx_p2p_req_t **recv_requests = op->reduce.chain.recv_requests;
+    ucg_planc_ucx_p2p_req_t **send_requests = op->reduce.chain.send_requests;
+    uint8_t *staging_area = (uint8_t*)op->staging_area - args->dt->true_lb;
+    int64_t seg_size = op->reduce.chain.seg_size;
+    const uint8_t *data = op->reduce.data;
+    int32_t offset;
+    int32_t count;
+
+    for (;;) {
+        /* Release the staging areas whose segments are forwarded. */
+        while (*released < *completed) {
+            status = ucg_planc_ucx_p2p_test(op->ucx_group, &send_requests[*released % depth]);
+            UCG_CHECK_GOTO(status, out);
+            ++*released;
+        }
+        if (*released == nsegs) {
+            break;
+        }
+
+        /* Receive ahead while there are free staging areas. */
+        while (*posted < nsegs && *posted - *released < depth) {
+            int32_t slot = *posted % depth;
+            ucg_planc_ucx_reduce_chain_seg(op, *posted, &offset, &count);
+            send_requests[slot] = NULL;
+            params.request = &recv_requests[slot];
+            status = ucg_planc_ucx_p2p_irecv(staging_area + slot * seg_size, count,
+                                             args->dt, upstream, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            ++*posted;
+        }
+
+        /* Complete segments in order. */
+        if (*completed == *posted) {
+            status = UCG_INPROGRESS;
+            goto out;
+        }
+        int32_t slot = *completed % depth;
+        status = ucg_planc_ucx_p2p_test(op->ucx_group, &recv_requests[slot]);
+        UCG_CHECK_GOTO(status, out);
+        ucg_planc_ucx_reduce_chain_seg(op, *completed, &offset, &count);
+        uint8_t *tmp = staging_area + slot * seg_size;
+        if (downstream == UCG_INVALID_RANK) {
+            status = ucg_op_reduce3(args->op, data + offset * dt_ext, tmp,
+                                    (uint8_t*)args->recvbuf + offset * dt_ext,
+                                    count, args->dt);
+            UCG_CHECK_GOTO(status, out);
+        } else {
+            /* The upstream ones are the latter operands, the order is kept. */
+            status = ucg_op_reduce(args->op, data + offset * dt_ext, tmp, count, args->dt);
+            UCG_CHECK_GOTO(status, out);
+            params.request = &send_requests[slot];
+            status = ucg_planc_ucx_p2p_isend(tmp, count, args->dt, downstream,
+                                             op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        ++*completed;
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief The head of the chain sends its input in segments.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_send(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    int32_t offset;
+    int32_t count;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_CHAIN_SEND_POST)) {
+        const uint8_t *data = op->reduce.data;
+        for (int32_t seg = 0; seg < op->reduce.chain.nsegs; ++seg) {
+            ucg_planc_ucx_reduce_chain_seg(op, seg, &offset, &count);
+            status = ucg_planc_ucx_p2p_isend(data + offset * dt_ext, count, args->dt,
+                                             op->reduce.chain.downstream, op->tag,
+                                             op->super.vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+out:
+    return status;
+}
+
+/**
+ * @brief The root receives the result from the end of the chain.
+ *
+ * The receives are posted at first, the end may wait for them to release its
+ * staging areas while I'm still in the chain. My input is staged if it's in
+ * recvbuf, see trigger.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_relay(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    int32_t offset;
+    int32_t count;
+
+    for (int32_t seg = 0; seg < op->reduce.chain.nsegs; ++seg) {
+        ucg_planc_ucx_reduce_chain_seg(op, seg, &offset, &count);
+        status = ucg_planc_ucx_p2p_irecv((uint8_t*)args->recvbuf + offset * dt_ext,
+                                         count, args->dt, op->reduce.chain.relay,
+                                         op->tag, op->super.vgroup, &params);
+        UCG_CHECK_GOTO(status, out);
+    }
+out:
+    return status;
+}
+
+/**
+ * @brief Pipelined chain algorithm for reduce operation.
+ *
+ * Every rank receives the partial result of the ranks after it in the chain
+ * segment by segment, reduces its input into it and forwards it, so the vector
+ * goes through every link once and the reductions of all ranks overlap.
+ *
+ * For commutative ops the chain ends at the root. Otherwise the chain is
+ * rank size - 1, ..., 1, 0 to keep the order of operands, and rank 0 relays
+ * the result to the root.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_CHAIN_RELAY_RECV)) {
+        status = ucg_planc_ucx_reduce_chain_op_relay(op);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_CHAIN_PIPELINE)) {
+        status = ucg_planc_ucx_reduce_chain_op_pipeline(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_CHAIN_PIPELINE);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_CHAIN_SEND)) {
+        status = ucg_planc_ucx_reduce_chain_op_send(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_CHAIN_SEND);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_CHAIN_RELAY)) {
+        ucg_planc_ucx_p2p_params_t params;
+        ucg_planc_ucx_op_set_p2p_params(op, &params);
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_CHAIN_RELAY);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_coll_reduce_args_t *args = &ucg_op->super.args.reduce;
+
+    ucg_planc_ucx_op_reset(op);
+    op->reduce.data = ucg_planc_ucx_reduce_input(args);
+    op->reduce.chain.posted = 0;
+    op->reduce.chain.completed = 0;
+    op->reduce.chain.released = 0;
+
+    op->flags = 0;
+    if (op->reduce.chain.upstream != UCG_INVALID_RANK) {
+        op->flags |= UCG_REDUCE_CHAIN_PIPELINE;
+    } else if (op->reduce.chain.downstream != UCG_INVALID_RANK) {
+        op->flags |= UCG_REDUCE_CHAIN_SEND | UCG_REDUCE_CHAIN_SEND_POST;
+    } else if (args->sendbuf != UCG_IN_PLACE) {
+        /* Special case for group size == 1 */
+        status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                               args->sendbuf, args->count, args->dt);
+        op->super.super.status = status;
+        return status;
+    }
+    if (op->reduce.chain.relay != UCG_INVALID_RANK) {
+        op->flags |= UCG_REDUCE_CHAIN_RELAY | UCG_REDUCE_CHAIN_RELAY_RECV;
+        if (args->sendbuf == UCG_IN_PLACE) {
+            /* The result is received to recvbuf while my input is in use, it's after the slots. */
+            int32_t nslot = (op->reduce.chain.upstream == UCG_INVALID_RANK) ? 0 :
+                            op->reduce.chain.depth;
+            void *input = (uint8_t*)op->staging_area - args->dt->true_lb +
+                          op->reduce.chain.seg_size * nslot;
+            status = ucg_dt_memcpy(input, args->count, args->dt,
+                                   args->recvbuf, args->count, args->dt);
+            if (status != UCG_OK) {
+                return status;
+            }
+            op->reduce.data = input;
+        }
+    }
+
+    status = ucg_planc_ucx_reduce_chain_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_chain_op_init(ucg_planc_ucx_op_t *op,
+                                                       ucg_planc_ucx_reduce_config_t *config)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    uint32_t group_size = vgroup->size;
+    ucg_rank_t my_rank = vgroup->myrank;
+    ucg_rank_t root = args->root;
+    ucg_dt_t *dt = args->dt;
+
+    /* The chain ends at rank 0 if the op is not commutative, see progress. */
+    ucg_rank_t end = ucg_op_is_commutative(args->op) ? root : 0;
+    ucg_rank_t pos = (my_rank + group_size - end) % group_size;
+    op->reduce.chain.upstream = (pos + 1 < group_size) ? (my_rank + 1) % group_size :
+                                                         UCG_INVALID_RANK;
+    op->reduce.chain.downstream = (pos > 0) ? (my_rank + group_size - 1) % group_size :
+                                              UCG_INVALID_RANK;
+    op->reduce.chain.relay = UCG_INVALID_RANK;
+    if (end != root) {
+        if (my_rank == end) {
+            op->reduce.chain.downstream = root;
+        } else if (my_rank == root) {
+            op->reduce.chain.relay = end;
+        }
+    }
+
+    int64_t segcount = config->chain_segsize / ucg_dt_extent(dt);
+    if (segcount <= 0) {
+        segcount = 1;
+    } else if (segcount > args->count && args->count > 0) {
+        segcount = args->count;
+    }
+    int32_t nsegs = (args->count + segcount - 1) / segcount;
+    int32_t depth = ucg_max(config->chain_depth, UCG_REDUCE_CHAIN_MIN_DEPTH);
+    depth = ucg_min(depth, ucg_max(nsegs, 1));
+    int64_t seg_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_span(dt, segcount),
+                                         sizeof(void*));
+    op->reduce.chain.segcount = segcount;
+    op->reduce.chain.nsegs = nsegs;
+    op->reduce.chain.depth = depth;
+    op->reduce.chain.seg_size = seg_size;
+    op->reduce.chain.recv_requests = NULL;
+    op->reduce.chain.send_requests = NULL;
+
+    /* The head sends from my input and needs no staging area for segments. */
+    int32_t nslot = (op->reduce.chain.upstream == UCG_INVALID_RANK) ? 0 : depth;
+    int64_t input_size = 0;
+    if (op->reduce.chain.relay != UCG_INVALID_RANK && args->sendbuf == UCG_IN_PLACE) {
+        input_size = ucg_planc_ucx_reduce_span(dt, args->count);
+    }
+    if (nslot == 0 && input_size == 0) {
+        return UCG_OK;
+    }
+
+    void *scratch = NULL;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, seg_size * nslot + input_size,
+                                                       2 * sizeof(ucg_planc_ucx_p2p_req_t*) * nslot,
+                                                       &scratch);
+    if (status != UCG_OK) {
+        return status;
+    }
+    op->reduce.chain.recv_requests = (ucg_planc_ucx_p2p_req_t**)scratch;
+    op->reduce.chain.send_requests = op->reduce.chain.recv_requests + depth;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_chain_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                             ucg_vgroup_t *vgroup,
+                                                             const ucg_coll_args_t *args,
+                                                             ucg_planc_ucx_reduce_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_chain_op_trigger,
+                                 ucg_planc_ucx_reduce_chain_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_reduce_chain_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce pipelined chain ucx op");
+        goto err_destruct;
+    }
+
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_chain_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    if (args->reduce.count < 0) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_reduce_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, reduce,
+                                                         UCG_COLL_TYPE_REDUCE);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_chain_op_new(ucx_group, vgroup,
+                                                                   args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
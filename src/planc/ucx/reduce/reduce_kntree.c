@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "reduce.h"
@@ -30,102 +30,30 @@ static ucg_status_t ucg_planc_ucx_reduce_kntree_check(ucg_vgroup_t *vgroup,
     return UCG_OK;
 }
 
-static ucg_status_t ucg_planc_ucx_reduce_kntree_op_recv_and_reduce(ucg_planc_ucx_op_t *op)
-{
-    ucg_status_t status = UCG_OK;
-    ucg_vgroup_t *vgroup = op->super.vgroup;
-    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
-    void *recvbuf = args->recvbuf;
-    ucg_dt_t *dt = args->dt;
-    int32_t count = args->count;
-    void *staging_area;
-    uint64_t data_size = dt->true_extent + dt->extent * (count - 1);
-    ucg_planc_ucx_p2p_params_t params;
-    ucg_planc_ucx_op_set_p2p_params(op, &params);
-    ucg_algo_kntree_iter_t *iter = &op->reduce.kntree_iter;
-    ucg_rank_t peer;
-    int idx = 0;
-
-    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_RECV_FROM_CHILD_RECV)) {
-        while ((peer = ucg_algo_kntree_iter_child_value(iter)) != UCG_INVALID_RANK) {
-            params.request = &op->reduce.requests[idx];
-            staging_area = op->staging_area + idx * data_size;
-            status = ucg_planc_ucx_p2p_irecv(staging_area, args->count, args->dt,
-                                             peer, op->tag, vgroup, &params);
-            UCG_CHECK_GOTO(status, out);
-            /* increase iterator to enter next loop */
-            ucg_algo_kntree_iter_child_inc(iter);
-            idx++;
-        }
-    }
-
-    for (idx = 0; idx < op->reduce.requests_count; idx++) {
-        if (op->reduce.req_bitmap[idx]) {
-            continue;
-        }
-        status = ucg_planc_ucx_p2p_test(op->ucx_group, &op->reduce.requests[idx]);
-        if (status == UCG_INPROGRESS) {
-            continue;
-        }
-        UCG_CHECK_GOTO(status, out);
-        staging_area = op->staging_area + idx * data_size;
-        status = ucg_op_reduce(args->op, staging_area, recvbuf, args->count, args->dt);
-        UCG_CHECK_GOTO(status, out);
-        op->reduce.req_bitmap[idx] = 1;
-        ++op->reduce.bitcount;
-    }
-
-    status = (op->reduce.bitcount == op->reduce.requests_count) ? UCG_OK : UCG_INPROGRESS;
-
-out:
-    return status;
-}
-
-static ucg_status_t ucg_planc_ucx_reduce_kntree_op_send(ucg_planc_ucx_op_t *op)
-{
-    ucg_status_t status = UCG_OK;
-    ucg_vgroup_t *vgroup = op->super.vgroup;
-    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
-    const void *sendbuf = args->recvbuf;
-    ucg_planc_ucx_p2p_params_t params;
-    ucg_planc_ucx_op_set_p2p_params(op, &params);
-    ucg_algo_kntree_iter_t *iter = &op->reduce.kntree_iter;
-    ucg_rank_t peer;
-
-    peer = ucg_algo_kntree_iter_parent_value(iter);
-    if (peer == UCG_INVALID_RANK) {
-        return UCG_OK;
-    }
-
-    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SEND_TO_PARENT_SEND)) {
-        status = ucg_planc_ucx_p2p_isend(sendbuf, args->count, args->dt,
-                                         peer, op->tag, vgroup, &params);
-        UCG_CHECK_GOTO(status, out);
-    }
-    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
-out:
-    return status;
-}
-
 static ucg_status_t ucg_planc_ucx_reduce_kntree_op_progress(ucg_plan_op_t *ucg_op)
 {
     ucg_status_t status = UCG_OK;
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_reduce_fanin_t *fanin = &op->reduce.kntree;
 
     /* 1. receive & reduce from child */
     if (ucg_test_flags(op->flags, UCG_REDUCE_RECV_FROM_CHILD)) {
-        status = ucg_planc_ucx_reduce_kntree_op_recv_and_reduce(op);
+        uint8_t post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_RECV_FROM_CHILD_RECV);
+        status = ucg_planc_ucx_reduce_fanin_progress(op, fanin, post);
         UCG_CHECK_GOTO(status, out);
         ucg_clear_flags(&op->flags, UCG_REDUCE_RECV_FROM_CHILD);
     }
 
     /* 2. send to my parent */
     if (ucg_test_flags(op->flags, UCG_REDUCE_SEND_TO_PARENT)) {
-        status = ucg_planc_ucx_reduce_kntree_op_send(op);
+        uint8_t post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SEND_TO_PARENT_SEND);
+        status = ucg_planc_ucx_reduce_fanin_send(op, fanin, post);
         UCG_CHECK_GOTO(status, out);
         ucg_clear_flags(&op->flags, UCG_REDUCE_SEND_TO_PARENT);
     }
 
+    status = ucg_planc_ucx_reduce_finish(op);
+
 out:
     op->super.super.status = status;
     return status;
@@ -137,49 +65,15 @@ static ucg_status_t ucg_planc_ucx_reduce_kntree_op_trigger(ucg_plan_op_t *ucg_op
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
     ucg_planc_ucx_op_reset(op);
 
-    ucg_algo_kntree_iter_t *iter = &op->reduce.kntree_iter;
-    ucg_algo_kntree_iter_reset(iter);
-    op->reduce.bitcount = 0;
-    memset(op->reduce.req_bitmap, 0, op->reduce.requests_count);
-    for (int i = 0; i < op->reduce.requests_count; i++) {
-        op->reduce.requests[i] = NULL;
-    }
+    ucg_planc_ucx_reduce_fanin_reset(&op->reduce.kntree);
+    /* My input is reduced into the accumulator by the first reduction, no copy. */
+    op->reduce.data = ucg_planc_ucx_reduce_input(&ucg_op->super.args.reduce);
     op->flags = UCG_REDUCE_KNTREE_FLAGS;
 
-    ucg_coll_reduce_args_t *args = &ucg_op->super.args.reduce;
-    if (args->sendbuf != UCG_IN_PLACE) {
-        status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
-                               args->sendbuf, args->count, args->dt);
-        if (status != UCG_OK) {
-            return status;
-        }
-    }
-
     status = ucg_planc_ucx_reduce_kntree_op_progress(ucg_op);
     return status == UCG_INPROGRESS ? UCG_OK : status;
 }
 
-static ucg_status_t ucg_planc_ucx_reduce_kntree_op_discard(ucg_plan_op_t *ucg_op)
-{
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-
-    if (op->reduce.requests != NULL) {
-        ucg_free(op->reduce.requests);
-    }
-
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
-
-    if (op->reduce.req_bitmap != NULL) {
-        ucg_free(op->reduce.req_bitmap);
-    }
-
-    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
-    ucg_mpool_put(op);
-    return UCG_OK;
-}
-
 static inline
 ucg_status_t ucg_planc_ucx_reduce_kntree_op_init(ucg_planc_ucx_op_t *op,
                                                  ucg_planc_ucx_group_t *ucx_group,
@@ -189,45 +83,41 @@ ucg_status_t ucg_planc_ucx_reduce_kntree_op_init(ucg_planc_ucx_op_t *op,
     ucg_planc_ucx_op_init(op, ucx_group);
 
     ucg_vgroup_t *vgroup = op->super.vgroup;
-    ucg_algo_kntree_iter_t *iter = &op->reduce.kntree_iter;
+    ucg_planc_ucx_reduce_fanin_t *fanin = &op->reduce.kntree;
     const ucg_coll_reduce_args_t *coll_args = &op->super.super.args.reduce;
-    ucg_algo_kntree_iter_init(iter, vgroup->size, config->kntree_degree,
-                              coll_args->root, vgroup->myrank, 0);
+    ucg_planc_ucx_reduce_fanin_init(fanin, vgroup->size, config->kntree_degree,
+                                    coll_args->root, vgroup->myrank, NULL);
 
     ucg_dt_t *dt = coll_args->dt;
-    int32_t count = coll_args->count;
-    int64_t data_size = dt->true_extent + dt->extent * (count - 1);
-    int32_t requests_count = 0;
-    while (ucg_algo_kntree_iter_child_value(iter) != UCG_INVALID_RANK) {
-        requests_count++;
-        ucg_algo_kntree_iter_child_inc(iter);
-    }
-    op->staging_area = ucg_malloc(data_size * requests_count, "reduce kntree op staging area");
-    if (op->staging_area == NULL) {
-        goto err;
-    }
-
-    op->reduce.requests = ucg_malloc(sizeof(ucg_planc_ucx_p2p_req_t *) * requests_count,
-                                     "reduce kntree requests");
-    if (op->reduce.requests == NULL) {
-        goto err_free_staging_area;
+    int32_t requests_count = fanin->requests_count;
+    int use_recvbuf = ucg_planc_ucx_reduce_use_recvbuf(vgroup, coll_args);
+    /* A non-root rank needs the accumulator only if it has children. */
+    int32_t nslots = requests_count;
+    if (!use_recvbuf && requests_count > 0) {
+        ++nslots;
+    }
+    fanin->slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_span(dt, coll_args->count),
+                                         sizeof(void*));
+    void *scratch = NULL;
+    size_t requests_size = sizeof(ucg_planc_ucx_p2p_req_t *) * requests_count;
+    status = ucg_planc_ucx_op_get_staging(op, fanin->slot_size * nslots,
+                                          requests_size + requests_count * sizeof(uint8_t),
+                                          &scratch);
+    if (status != UCG_OK) {
+        return status;
     }
-
-    op->reduce.req_bitmap = ucg_malloc(requests_count * sizeof(uint8_t), "reduce bitmap");
-    if (op->reduce.req_bitmap == NULL) {
-        goto err_free_requests;
+    uint8_t *base = (uint8_t*)op->staging_area - dt->true_lb;
+    if (use_recvbuf) {
+        op->reduce.acc = coll_args->recvbuf;
+    } else {
+        op->reduce.acc = (requests_count > 0) ? base : NULL;
+        base += (requests_count > 0) ? fanin->slot_size : 0;
     }
-
-    op->reduce.requests_count = requests_count;
+    fanin->slots = base;
+    fanin->requests = (ucg_planc_ucx_p2p_req_t **)scratch;
+    fanin->req_bitmap = (uint8_t *)(scratch + requests_size);
 
     return status;
-
-err_free_requests:
-    ucg_free(op->reduce.requests);
-err_free_staging_area:
-    ucg_free(op->staging_area);
-err:
-    return UCG_ERR_NO_MEMORY;
 }
 
 ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
@@ -246,7 +136,7 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_kntree_op_new(ucg_planc_ucx_group_t *uc
     status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &op->super, vgroup,
                                  ucg_planc_ucx_reduce_kntree_op_trigger,
                                  ucg_planc_ucx_reduce_kntree_op_progress,
-                                 ucg_planc_ucx_reduce_kntree_op_discard,
+                                 ucg_planc_ucx_op_discard,
                                  args);
     if (status != UCG_OK) {
         ucg_error("Failed to initialize super of ucx op");
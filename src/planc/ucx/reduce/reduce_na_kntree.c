@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce.h"
+#include "planc_ucx_plan.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Node-aware k-nomial tree reduce
+ *
+ * The ranks of a node reduce to the leader of the node by a k-nomial tree,
+ * and then the leaders reduce to the root by another one, so only the leaders
+ * communicate across nodes. The root is the leader of its node, the lowest
+ * rank is the leader of other nodes.
+ *
+ * Both trees share the slots of the children, the leader receives from other
+ * nodes after the reduction in its node is done.
+ */
+
+/* op flags needed by node-aware kntree reduce. */
+enum {
+    UCG_REDUCE_NA_KNTREE_INTRA_RECV = UCG_BIT(0),
+    UCG_REDUCE_NA_KNTREE_INTRA_RECV_POST = UCG_BIT(1),
+    UCG_REDUCE_NA_KNTREE_INTRA_SEND = UCG_BIT(2),
+    UCG_REDUCE_NA_KNTREE_INTRA_SEND_POST = UCG_BIT(3),
+    UCG_REDUCE_NA_KNTREE_INTER_RECV = UCG_BIT(4),
+    UCG_REDUCE_NA_KNTREE_INTER_RECV_POST = UCG_BIT(5),
+    UCG_REDUCE_NA_KNTREE_INTER_SEND = UCG_BIT(6),
+    UCG_REDUCE_NA_KNTREE_INTER_SEND_POST = UCG_BIT(7),
+};
+
+#define UCG_REDUCE_NA_KNTREE_LEADER_FLAGS UCG_REDUCE_NA_KNTREE_INTRA_RECV | \
+                                          UCG_REDUCE_NA_KNTREE_INTRA_RECV_POST | \
+                                          UCG_REDUCE_NA_KNTREE_INTER_RECV | \
+                                          UCG_REDUCE_NA_KNTREE_INTER_RECV_POST | \
+                                          UCG_REDUCE_NA_KNTREE_INTER_SEND | \
+                                          UCG_REDUCE_NA_KNTREE_INTER_SEND_POST
+
+#define UCG_REDUCE_NA_KNTREE_MEMBER_FLAGS UCG_REDUCE_NA_KNTREE_INTRA_RECV | \
+                                          UCG_REDUCE_NA_KNTREE_INTRA_RECV_POST | \
+                                          UCG_REDUCE_NA_KNTREE_INTRA_SEND | \
+                                          UCG_REDUCE_NA_KNTREE_INTRA_SEND_POST
+
+static ucg_status_t ucg_planc_ucx_reduce_na_kntree_check(ucg_vgroup_t *vgroup,
+                                                         const ucg_coll_args_t *args)
+{
+    if (!ucg_op_is_commutative(args->reduce.op)) {
+        ucg_info("Reduce node-aware kntree don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Reduce node-aware kntree don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Reduce node-aware kntree don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_na_kntree_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_reduce_fanin_t *intra = &op->reduce.na.intra;
+    ucg_planc_ucx_reduce_fanin_t *inter = &op->reduce.na.inter;
+    uint8_t post;
+
+    /* 1. reduce in my node */
+    if (ucg_test_flags(op->flags, UCG_REDUCE_NA_KNTREE_INTRA_RECV)) {
+        post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTRA_RECV_POST);
+        status = ucg_planc_ucx_reduce_fanin_progress(op, intra, post);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTRA_RECV);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_NA_KNTREE_INTRA_SEND)) {
+        post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTRA_SEND_POST);
+        status = ucg_planc_ucx_reduce_fanin_send(op, intra, post);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTRA_SEND);
+    }
+
+    /* 2. reduce among the leaders */
+    if (ucg_test_flags(op->flags, UCG_REDUCE_NA_KNTREE_INTER_RECV)) {
+        post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTER_RECV_POST);
+        status = ucg_planc_ucx_reduce_fanin_progress(op, inter, post);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTER_RECV);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_NA_KNTREE_INTER_SEND)) {
+        post = ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTER_SEND_POST);
+        status = ucg_planc_ucx_reduce_fanin_send(op, inter, post);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_NA_KNTREE_INTER_SEND);
+    }
+
+    status = ucg_planc_ucx_reduce_finish(op);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_na_kntree_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+
+    ucg_planc_ucx_reduce_fanin_reset(&op->reduce.na.intra);
+    if (op->reduce.na.is_leader) {
+        ucg_planc_ucx_reduce_fanin_reset(&op->reduce.na.inter);
+        op->flags = UCG_REDUCE_NA_KNTREE_LEADER_FLAGS;
+    } else {
+        op->flags = UCG_REDUCE_NA_KNTREE_MEMBER_FLAGS;
+    }
+    op->reduce.data = ucg_planc_ucx_reduce_input(&ucg_op->super.args.reduce);
+
+    status = ucg_planc_ucx_reduce_na_kntree_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_na_kntree_op_init(ucg_planc_ucx_op_t *op,
+                                                           ucg_planc_ucx_reduce_config_t *config)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    const ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_rank_t myrank = vgroup->myrank;
+    ucg_rank_t root = args->root;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+    int32_t nnode = topo->detail.nnode;
+    int32_t mynode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, myrank),
+                                              UCG_TOPO_LOC_NODE_ID);
+    int32_t rootnode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, root),
+                                                UCG_TOPO_LOC_NODE_ID);
+
+    int32_t nlocal = 0;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id == mynode) {
+            ++nlocal;
+        }
+    }
+
+    /**
+     * The ranks are laid out in a temporary buffer of the staging cache first,
+     * because the staging area is sized by the trees made of them. The first
+     * rank of every node is only needed here, it's after the leaders.
+     */
+    ucg_bufcache_t *cache = &op->ucx_group->staging_cache;
+    ucg_rank_t *locals = ucg_bufcache_get(cache, sizeof(ucg_rank_t) * (nlocal + 2 * nnode));
+    if (locals == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_rank_t *leaders = locals + nlocal;
+    ucg_rank_t *first = leaders + nnode;
+
+    /* The leader of my node is at 0, and the root is at 0 of the leaders. */
+    for (int32_t node = 0; node < nnode; ++node) {
+        first[node] = UCG_INVALID_RANK;
+    }
+    ucg_rank_t leader = (mynode == rootnode) ? root : UCG_INVALID_RANK;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (first[node] == UCG_INVALID_RANK) {
+            first[node] = rank;
+        }
+        if (node == mynode && leader == UCG_INVALID_RANK) {
+            leader = rank;
+        }
+    }
+    int32_t nfilled = 0;
+    ucg_rank_t my_local = 0;
+    locals[nfilled++] = leader;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id != mynode || rank == leader) {
+            continue;
+        }
+        if (rank == myrank) {
+            my_local = nfilled;
+        }
+        locals[nfilled++] = rank;
+    }
+    int32_t nleader = 0;
+    ucg_rank_t my_leader = 0;
+    leaders[nleader++] = root;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == rootnode || first[node] == UCG_INVALID_RANK) {
+            continue;
+        }
+        if (first[node] == myrank) {
+            my_leader = nleader;
+        }
+        leaders[nleader++] = first[node];
+    }
+
+    ucg_planc_ucx_reduce_fanin_t *intra = &op->reduce.na.intra;
+    ucg_planc_ucx_reduce_fanin_t *inter = &op->reduce.na.inter;
+    op->reduce.na.is_leader = (myrank == leader);
+    ucg_planc_ucx_reduce_fanin_init(intra, nlocal, ucg_max(config->na_kntree_intra_degree, 1),
+                                    0, my_local, NULL);
+    inter->requests_count = 0;
+    if (op->reduce.na.is_leader) {
+        ucg_planc_ucx_reduce_fanin_init(inter, nleader,
+                                        ucg_max(config->na_kntree_inter_degree, 1),
+                                        0, my_leader, NULL);
+    }
+
+    /**
+     * Both trees share the slots, and acc is needed if I have children. The
+     * requests and bitmaps of both trees and then the ranks are in the scratch
+     * area.
+     */
+    int32_t nchild = intra->requests_count + inter->requests_count;
+    int32_t nslot = ucg_max(intra->requests_count, inter->requests_count);
+    int use_recvbuf = ucg_planc_ucx_reduce_use_recvbuf(vgroup, args);
+    int64_t slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_span(args->dt, args->count),
+                                          sizeof(void*));
+    int64_t acc_size = (!use_recvbuf && nchild > 0) ? slot_size : 0;
+    size_t requests_size = sizeof(ucg_planc_ucx_p2p_req_t*) * nchild;
+    size_t ranks_offset = ucg_align_up_pow2(requests_size + nchild, sizeof(ucg_rank_t));
+    size_t ranks_size = sizeof(ucg_rank_t) * (nlocal + nleader);
+    uint8_t *scratch = NULL;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, acc_size + slot_size * nslot,
+                                                       ranks_offset + ranks_size,
+                                                       (void**)&scratch);
+    if (status == UCG_OK) {
+        memcpy(scratch + ranks_offset, locals, ranks_size);
+    }
+    ucg_bufcache_put(locals);
+    if (status != UCG_OK) {
+        return status;
+    }
+    uint8_t *staging_area = (uint8_t*)op->staging_area - args->dt->true_lb;
+    if (use_recvbuf) {
+        op->reduce.acc = args->recvbuf;
+    } else {
+        op->reduce.acc = (nchild > 0) ? staging_area : NULL;
+    }
+    intra->slots = inter->slots = staging_area + acc_size;
+    intra->slot_size = inter->slot_size = slot_size;
+    intra->requests = (ucg_planc_ucx_p2p_req_t**)scratch;
+    inter->requests = intra->requests + intra->requests_count;
+    intra->req_bitmap = scratch + requests_size;
+    inter->req_bitmap = intra->req_bitmap + intra->requests_count;
+    intra->ranks = (ucg_rank_t*)(scratch + ranks_offset);
+    inter->ranks = intra->ranks + nlocal;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_na_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                                 ucg_vgroup_t *vgroup,
+                                                                 const ucg_coll_args_t *args,
+                                                                 ucg_planc_ucx_reduce_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_na_kntree_op_trigger,
+                                 ucg_planc_ucx_reduce_na_kntree_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_reduce_na_kntree_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce node-aware kntree ucx op");
+        goto err_destruct;
+    }
+
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_na_kntree_prepare(ucg_vgroup_t *vgroup,
+                                                    const ucg_coll_args_t *args,
+                                                    ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status;
+    status = ucg_planc_ucx_reduce_na_kntree_check(vgroup, args);
+    if (status != UCG_OK) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_reduce_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, reduce,
+                                                         UCG_COLL_TYPE_REDUCE);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_na_kntree_op_new(ucx_group, vgroup,
+                                                                       args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
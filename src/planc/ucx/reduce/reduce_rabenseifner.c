@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce.h"
+#include "planc_ucx_plan.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/* op flags needed by reduce rabenseifner. */
+enum {
+    UCG_REDUCE_RABENSEIFNER_FOLD = UCG_BIT(0),
+    UCG_REDUCE_RABENSEIFNER_FOLD_POST = UCG_BIT(1),
+    UCG_REDUCE_RABENSEIFNER_REDUCE_SCATTER = UCG_BIT(2),
+    UCG_REDUCE_RABENSEIFNER_GATHER = UCG_BIT(3),
+    UCG_REDUCE_RABENSEIFNER_STEP_POST = UCG_BIT(4),
+};
+
+#define UCG_REDUCE_RABENSEIFNER_FLAGS UCG_REDUCE_RABENSEIFNER_REDUCE_SCATTER | \
+                                      UCG_REDUCE_RABENSEIFNER_GATHER | \
+                                      UCG_REDUCE_RABENSEIFNER_STEP_POST
+
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_check(ucg_vgroup_t *vgroup,
+                                                            const ucg_coll_args_t *args)
+{
+    uint32_t group_size = vgroup->size;
+    int32_t count = args->reduce.count;
+    if (count < group_size) {
+        ucg_info("Reduce rabenseifner don't support count < group_size");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_op_flag_t flags = args->reduce.op->flags;
+    if (!(flags & UCG_OP_FLAG_IS_COMMUTATIVE)) {
+        ucg_info("Reduce rabenseifner don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_planc_ucx_group_t* ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    if (ucx_group->context->config.reduce_consistency == 1) {
+        ucg_info("Reduce rabenseifner don't support reduce calculation results consistency");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+/**
+ * @brief Convert the new rank to the rank of vgroup.
+ */
+static inline ucg_rank_t ucg_planc_ucx_reduce_rabenseifner_rank(ucg_planc_ucx_op_t *op,
+                                                                ucg_rank_t new_rank)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int32_t nprocs_rem = op->reduce.rabenseifner.nprocs_rem;
+    ucg_rank_t vrank = (new_rank < nprocs_rem) ? new_rank * 2 : new_rank + nprocs_rem;
+    return (vrank + op->super.super.args.reduce.root) % vgroup->size;
+}
+
+/**
+ * @brief Element offset of a block, the first blkrem blocks have one more.
+ */
+static inline int64_t ucg_planc_ucx_reduce_rabenseifner_offset(ucg_planc_ucx_op_t *op,
+                                                               int32_t block)
+{
+    int32_t blkcount = op->reduce.rabenseifner.blkcount;
+    int32_t blkrem = op->reduce.rabenseifner.blkrem;
+    return (int64_t)block * blkcount + ucg_min(block, blkrem);
+}
+
+/**
+ * @brief Where the input of my neighbour is folded in, acc unless my input is there.
+ */
+static inline void *ucg_planc_ucx_reduce_rabenseifner_fold_buf(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    return (args->sendbuf == UCG_IN_PLACE) ? op->reduce.rabenseifner.recv : op->reduce.acc;
+}
+
+/**
+ * @brief The ranks beyond the power of two fold their input into the neighbours.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_fold(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_reduce_t *reduce = &op->reduce;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t vrank = (vgroup->myrank + vgroup->size - args->root) % vgroup->size;
+    ucg_rank_t peer = (vrank % 2 == 0) ? (vgroup->myrank + 1) % vgroup->size :
+                                         (vgroup->myrank + vgroup->size - 1) % vgroup->size;
+    uint8_t folded = (reduce->rabenseifner.new_rank == UCG_INVALID_RANK);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_FOLD_POST)) {
+        if (folded) {
+            status = ucg_planc_ucx_p2p_isend(reduce->data, args->count, args->dt,
+                                             peer, op->tag, vgroup, &params);
+        } else {
+            status = ucg_planc_ucx_p2p_irecv(ucg_planc_ucx_reduce_rabenseifner_fold_buf(op),
+                                             args->count, args->dt, peer, op->tag,
+                                             vgroup, &params);
+        }
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (!folded) {
+        status = ucg_op_reduce3(args->op, ucg_planc_ucx_reduce_rabenseifner_fold_buf(op),
+                                (void*)reduce->data, reduce->acc, args->count, args->dt);
+        UCG_CHECK_GOTO(status, out);
+        reduce->data = reduce->acc;
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Recursive halving, every step exchanges half of the blocks I hold.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_reduce_scatter(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_reduce_t *reduce = &op->reduce;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t new_rank = reduce->rabenseifner.new_rank;
+    int32_t *mask = &reduce->rabenseifner.mask;
+    int32_t *low = &reduce->rabenseifner.low;
+    int32_t *high = &reduce->rabenseifner.high;
+
+    while (*mask > 0) {
+        int32_t mid = (*low + *high) / 2;
+        int32_t keep_low = (new_rank & *mask) ? mid : *low;
+        int32_t keep_high = (new_rank & *mask) ? *high : mid;
+        int32_t send_low = (new_rank & *mask) ? *low : mid;
+        int32_t send_high = (new_rank & *mask) ? mid : *high;
+        int64_t keep_offset = ucg_planc_ucx_reduce_rabenseifner_offset(op, keep_low);
+        int64_t keep_count = ucg_planc_ucx_reduce_rabenseifner_offset(op, keep_high) -
+                             keep_offset;
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_STEP_POST)) {
+            ucg_rank_t peer = ucg_planc_ucx_reduce_rabenseifner_rank(op, new_rank ^ *mask);
+            int64_t send_offset = ucg_planc_ucx_reduce_rabenseifner_offset(op, send_low);
+            int64_t send_count = ucg_planc_ucx_reduce_rabenseifner_offset(op, send_high) -
+                                 send_offset;
+            status = ucg_planc_ucx_p2p_isend((const uint8_t*)reduce->data + send_offset * dt_ext,
+                                             send_count, args->dt, peer, op->tag,
+                                             vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            status = ucg_planc_ucx_p2p_irecv(reduce->rabenseifner.recv, keep_count,
+                                             args->dt, peer, op->tag, vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        status = ucg_op_reduce3(args->op, reduce->rabenseifner.recv,
+                                (uint8_t*)reduce->data + keep_offset * dt_ext,
+                                (uint8_t*)reduce->acc + keep_offset * dt_ext,
+                                keep_count, args->dt);
+        UCG_CHECK_GOTO(status, out);
+        /* The blocks I hold are in acc from now on. */
+        reduce->data = reduce->acc;
+        *low = keep_low;
+        *high = keep_high;
+        *mask >>= 1;
+        op->flags |= UCG_REDUCE_RABENSEIFNER_STEP_POST;
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Binomial gather of the reduced blocks to the new rank 0, i.e. the root.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_gather(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_planc_ucx_reduce_t *reduce = &op->reduce;
+    int64_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t new_rank = reduce->rabenseifner.new_rank;
+    int32_t nprocs_pof2 = UCG_BIT(reduce->rabenseifner.nsteps);
+    int32_t *mask = &reduce->rabenseifner.mask;
+    int32_t *low = &reduce->rabenseifner.low;
+    int32_t *high = &reduce->rabenseifner.high;
+
+    while (*mask < nprocs_pof2) {
+        ucg_rank_t peer = ucg_planc_ucx_reduce_rabenseifner_rank(op, new_rank ^ *mask);
+        /* I send the blocks I hold and I'm done, or receive the same number of blocks. */
+        uint8_t is_sender = !!(new_rank & *mask);
+        int32_t blk_low = is_sender ? *low : *high;
+        int32_t blk_high = is_sender ? *high : *high + (*high - *low);
+        int64_t offset = ucg_planc_ucx_reduce_rabenseifner_offset(op, blk_low);
+        int64_t count = ucg_planc_ucx_reduce_rabenseifner_offset(op, blk_high) - offset;
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_STEP_POST)) {
+            uint8_t *buf = (uint8_t*)reduce->acc + offset * dt_ext;
+            if (is_sender) {
+                status = ucg_planc_ucx_p2p_isend(buf, count, args->dt, peer,
+                                                 op->tag, vgroup, &params);
+            } else {
+                status = ucg_planc_ucx_p2p_irecv(buf, count, args->dt, peer,
+                                                 op->tag, vgroup, &params);
+            }
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        if (is_sender) {
+            break;
+        }
+        *high = blk_high;
+        *mask <<= 1;
+        op->flags |= UCG_REDUCE_RABENSEIFNER_STEP_POST;
+    }
+
+out:
+    return status;
+}
+
+/**
+ * @brief Rabenseifner algorithm for reduce operation.
+ *
+ * Reduce-scatter by recursive halving and then binomial gather to the root,
+ * the root receives about twice the size of the vector in total instead of
+ * the vector from each of its children in a tree. Ranks are shifted so that
+ * the root is 0, the ranks beyond the power of two fold into their neighbours
+ * at first as allreduce rabenseifner does.
+ *
+ * @note The op must be commutative and count >= group size.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_RABENSEIFNER_FOLD)) {
+        status = ucg_planc_ucx_reduce_rabenseifner_op_fold(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_FOLD);
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_RABENSEIFNER_REDUCE_SCATTER)) {
+        status = ucg_planc_ucx_reduce_rabenseifner_op_reduce_scatter(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_REDUCE_SCATTER);
+        op->reduce.rabenseifner.mask = 1;
+    }
+
+    if (ucg_test_flags(op->flags, UCG_REDUCE_RABENSEIFNER_GATHER)) {
+        status = ucg_planc_ucx_reduce_rabenseifner_op_gather(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_REDUCE_RABENSEIFNER_GATHER);
+    }
+
+    status = ucg_planc_ucx_reduce_finish(op);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &ucg_op->super.args.reduce;
+
+    ucg_planc_ucx_op_reset(op);
+    op->reduce.data = ucg_planc_ucx_reduce_input(args);
+    op->reduce.rabenseifner.mask = UCG_BIT(op->reduce.rabenseifner.nsteps) >> 1;
+    op->reduce.rabenseifner.low = 0;
+    op->reduce.rabenseifner.high = UCG_BIT(op->reduce.rabenseifner.nsteps);
+
+    ucg_rank_t vrank = (vgroup->myrank + vgroup->size - args->root) % vgroup->size;
+    if (op->reduce.rabenseifner.new_rank == UCG_INVALID_RANK) {
+        op->flags = UCG_REDUCE_RABENSEIFNER_FOLD | UCG_REDUCE_RABENSEIFNER_FOLD_POST;
+    } else if (vrank < 2 * op->reduce.rabenseifner.nprocs_rem) {
+        op->flags = UCG_REDUCE_RABENSEIFNER_FOLD | UCG_REDUCE_RABENSEIFNER_FOLD_POST |
+                    UCG_REDUCE_RABENSEIFNER_FLAGS;
+    } else {
+        op->flags = UCG_REDUCE_RABENSEIFNER_FLAGS;
+    }
+
+    status = ucg_planc_ucx_reduce_rabenseifner_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_rabenseifner_op_init(ucg_planc_ucx_op_t *op)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    uint32_t group_size = vgroup->size;
+    ucg_dt_t *dt = args->dt;
+
+    ucg_rank_t vrank = (vgroup->myrank + group_size - args->root) % group_size;
+    int32_t nsteps = ucg_ilog2(group_size);
+    int32_t nprocs_pof2 = UCG_BIT(nsteps);
+    int32_t nprocs_rem = group_size - nprocs_pof2;
+    ucg_rank_t new_rank;
+    if (vrank < 2 * nprocs_rem) {
+        new_rank = (vrank % 2 == 0) ? vrank / 2 : UCG_INVALID_RANK;
+    } else {
+        new_rank = vrank - nprocs_rem;
+    }
+    op->reduce.rabenseifner.nsteps = nsteps;
+    op->reduce.rabenseifner.nprocs_rem = nprocs_rem;
+    op->reduce.rabenseifner.new_rank = new_rank;
+    op->reduce.rabenseifner.blkcount = args->count / nprocs_pof2;
+    op->reduce.rabenseifner.blkrem = args->count % nprocs_pof2;
+    op->reduce.rabenseifner.recv = NULL;
+
+    int use_recvbuf = ucg_planc_ucx_reduce_use_recvbuf(vgroup, args);
+    if (new_rank == UCG_INVALID_RANK) {
+        /* I only send my input to my neighbour. */
+        op->reduce.acc = use_recvbuf ? args->recvbuf : NULL;
+        return UCG_OK;
+    }
+
+    /**
+     * The first step receives the larger half of the blocks, and the input of
+     * my neighbour is received here if it can't be received to acc.
+     */
+    int64_t acc_size = use_recvbuf ? 0 : ucg_align_up_pow2(ucg_planc_ucx_reduce_span(dt, args->count),
+                                                           sizeof(void*));
+    int64_t recv_count = ucg_planc_ucx_reduce_rabenseifner_offset(op, nprocs_pof2 / 2);
+    if (vrank < 2 * nprocs_rem && args->sendbuf == UCG_IN_PLACE) {
+        recv_count = args->count;
+    }
+    int64_t recv_size = ucg_planc_ucx_reduce_span(dt, recv_count);
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, acc_size + recv_size, 0, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    uint8_t *staging_area = (uint8_t*)op->staging_area - dt->true_lb;
+    op->reduce.acc = use_recvbuf ? args->recvbuf : staging_area;
+    op->reduce.rabenseifner.recv = staging_area + acc_size;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_reduce_rabenseifner_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                                   ucg_vgroup_t *vgroup,
+                                                                   const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_rabenseifner_op_trigger,
+                                 ucg_planc_ucx_reduce_rabenseifner_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_reduce_rabenseifner_op_init(ucx_op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce rabenseifner ucx op");
+        goto err_destruct;
+    }
+
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_rabenseifner_prepare(ucg_vgroup_t *vgroup,
+                                                       const ucg_coll_args_t *args,
+                                                       ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status;
+    status = ucg_planc_ucx_reduce_rabenseifner_check(vgroup, args);
+    if (status != UCG_OK) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_rabenseifner_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce_scatter.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_global.h"
+#include "util/ucg_log.h"
+
+#define PLAN_DOMAIN "planc ucx reduce_scatter"
+
+static ucg_plan_attr_t ucg_planc_ucx_reduce_scatter_plan_attr[] = {
+    {ucg_planc_ucx_reduce_scatter_ring_prepare,
+     1, "Ring", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RING},
+
+    {ucg_planc_ucx_reduce_scatter_rh_prepare,
+     2, "Recursive halving", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {ucg_planc_ucx_reduce_scatter_na_prepare,
+     3, "Node-aware", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {NULL},
+};
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_REDUCE_SCATTER,
+                             ucg_planc_ucx_reduce_scatter_plan_attr);
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK,
+                             ucg_planc_ucx_reduce_scatter_plan_attr);
+
+/* Reduce_scatter_block shares the configuration of reduce_scatter. */
+static ucg_config_field_t reduce_scatter_config_table[] = {
+    {"REDUCE_SCATTER_NA_FANIN_DEGREE", "4",
+     "Configure the number of local ranks reduced at a time by the leader in "
+     "node-aware algo for reduce_scatter",
+     ucg_offsetof(ucg_planc_ucx_reduce_scatter_config_t, na_fanin_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_REDUCE_SCATTER, reduce_scatter_config_table,
+                                    sizeof(ucg_planc_ucx_reduce_scatter_config_t))
+
+/**
+ * The message size is the size of the whole input vector. Ring and node-aware
+ * only support commutative ops, recursive halving supports all ops and is the
+ * fallback of every table.
+ */
+static ucg_plan_policy_t reduce_scatter_default[] = {
+    {2,  {0, 8192}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {1,  {8192, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t reduce_scatter_na[] = {
+    {3,  {0, 4096}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {2,  {4096, 8192}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {1,  {8192, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {2,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_reduce_scatter_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                      ucg_planc_ucx_ppn_level_t ppn_level)
+{
+    UCG_UNUSED(node_level);
+    ucg_plan_policy_t *policy = (ppn_level == PPN_LEVEL_1) ? reduce_scatter_default
+                                                            : reduce_scatter_na;
+    return policy;
+}
+
+static inline int ucg_planc_ucx_reduce_scatter_is_block(ucg_coll_type_t coll_type)
+{
+    return coll_type == UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK ||
+           coll_type == UCG_COLL_TYPE_IREDUCE_SCATTER_BLOCK;
+}
+
+ucg_dt_t *ucg_planc_ucx_reduce_scatter_get_dt(const ucg_coll_args_t *args)
+{
+    return ucg_planc_ucx_reduce_scatter_is_block(args->type) ?
+           args->reduce_scatter_block.dt : args->reduce_scatter.dt;
+}
+
+ucg_op_t *ucg_planc_ucx_reduce_scatter_get_op(const ucg_coll_args_t *args)
+{
+    return ucg_planc_ucx_reduce_scatter_is_block(args->type) ?
+           args->reduce_scatter_block.op : args->reduce_scatter.op;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_check(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                int64_t *total, int32_t *max_count)
+{
+    uint32_t group_size = vgroup->size;
+    int64_t count = 0;
+    int32_t max = 0;
+    if (ucg_planc_ucx_reduce_scatter_is_block(args->type)) {
+        if (args->reduce_scatter_block.recvcount < 0) {
+            ucg_error("Invalid recvcount %d", args->reduce_scatter_block.recvcount);
+            return UCG_ERR_INVALID_PARAM;
+        }
+        max = args->reduce_scatter_block.recvcount;
+        count = (int64_t)max * group_size;
+    } else {
+        for (uint32_t i = 0; i < group_size; ++i) {
+            int32_t recvcount = args->reduce_scatter.recvcounts[i];
+            if (recvcount < 0) {
+                ucg_error("Invalid recvcounts[%u] %d", i, recvcount);
+                return UCG_ERR_INVALID_PARAM;
+            }
+            count += recvcount;
+            max = ucg_max(max, recvcount);
+        }
+    }
+    /* The whole vector may be sent in one message. */
+    if (count > INT32_MAX) {
+        ucg_info("Reduce_scatter don't support total count > INT32_MAX");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    *total = count;
+    if (max_count != NULL) {
+        *max_count = max;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_op_init(ucg_planc_ucx_op_t *op, size_t data_size,
+                                                  size_t scratch_size, void **scratch)
+{
+    ucg_coll_args_t *args = &op->super.super.args;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    uint32_t group_size = op->super.vgroup->size;
+    int is_block = ucg_planc_ucx_reduce_scatter_is_block(args->type);
+
+    const void *sendbuf;
+    if (is_block) {
+        sendbuf = args->reduce_scatter_block.sendbuf;
+        rs->recvbuf = args->reduce_scatter_block.recvbuf;
+        rs->dt = args->reduce_scatter_block.dt;
+        rs->op = args->reduce_scatter_block.op;
+    } else {
+        sendbuf = args->reduce_scatter.sendbuf;
+        rs->recvbuf = args->reduce_scatter.recvbuf;
+        rs->dt = args->reduce_scatter.dt;
+        rs->op = args->reduce_scatter.op;
+        rs->counts = args->reduce_scatter.recvcounts;
+    }
+    rs->input = (sendbuf == UCG_IN_PLACE) ? rs->recvbuf : sendbuf;
+
+    /* The displacements and the counts of the block type are in the scratch area. */
+    size_t counts_size = is_block ? ucg_align_up_pow2(sizeof(int32_t) * group_size,
+                                                      sizeof(int64_t)) : 0;
+    size_t displs_size = sizeof(int64_t) * (group_size + 1);
+    uint8_t *base = NULL;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, data_size,
+                                                       displs_size + counts_size + scratch_size,
+                                                       (void**)&base);
+    if (status != UCG_OK) {
+        return status;
+    }
+    rs->displs = (int64_t*)base;
+    if (is_block) {
+        int32_t *counts = (int32_t*)(base + displs_size);
+        for (uint32_t i = 0; i < group_size; ++i) {
+            counts[i] = args->reduce_scatter_block.recvcount;
+        }
+        rs->counts = counts;
+    }
+    rs->displs[0] = 0;
+    for (uint32_t i = 0; i < group_size; ++i) {
+        rs->displs[i + 1] = rs->displs[i] + rs->counts[i];
+    }
+    if (scratch != NULL) {
+        *scratch = base + displs_size + counts_size;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_copy_block(ucg_planc_ucx_op_t *op, const void *src)
+{
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    int32_t count = rs->counts[op->super.vgroup->myrank];
+
+    if (count == 0 || src == rs->recvbuf) {
+        return UCG_OK;
+    }
+    return ucg_dt_memcpy(rs->recvbuf, count, rs->dt, src, count, rs->dt);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_REDUCE_SCATTER_H_
+#define UCG_PLANC_UCX_REDUCE_SCATTER_H_
+
+#include "planc/ucx/planc_ucx_def.h"
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_dt.h"
+
+typedef struct ucg_planc_ucx_reduce_scatter_config {
+    /* Max number of local ranks reduced by the leader at a time */
+    int na_fanin_degree;
+} ucg_planc_ucx_reduce_scatter_config_t;
+
+/**
+ * @brief Reduce_scatter op auxiliary information
+ *
+ * Reduce_scatter and reduce_scatter_block share the algorithms, the arguments
+ * of both are normalized when the op is created. Block i of the input vector
+ * has counts[i] elements at displs[i], displs[size] is the total count.
+ */
+typedef struct ucg_planc_ucx_reduce_scatter {
+    /* recvbuf when the operation is in place */
+    const void *input;
+    void *recvbuf;
+    ucg_dt_t *dt;
+    ucg_op_t *op;
+    const int32_t *counts;
+    int64_t *displs;
+    union {
+        struct {
+            int32_t step;
+            /* Bytes of a slot, one for the partial result and one to receive. */
+            int64_t slot_size;
+        } ring;
+        struct {
+            int32_t nstep;
+            int32_t nprocs_rem;
+            ucg_rank_t new_rank;
+            /* Current bit of the new rank and the range of positions I hold. */
+            int32_t mask;
+            int32_t low;
+            int32_t high;
+            /**
+             * Blocks are placed in bit-reversed order of their new ranks, so
+             * that the range halved at every step is contiguous. Position p
+             * starts at pos_displs[p] of the staging area.
+             */
+            int64_t *pos_displs;
+            /* Offset of the receive buffer in the staging area. */
+            int64_t recv_offset;
+        } rh;
+        struct {
+            int32_t nnode;
+            int32_t mynode;
+            int32_t fanin_degree;
+            /* The next local rank to reduce, in members[node_start[mynode], ...) */
+            int32_t next;
+            int32_t nrecv;
+            /* Ranks grouped by node in ascending order, the first one of a node is its leader. */
+            ucg_rank_t *members;
+            int32_t *node_start;
+            /**
+             * The leader keeps the blocks grouped by node, block i is at
+             * packed_displs[i] and the blocks of node n start at
+             * node_displs[n].
+             */
+            int64_t *packed_displs;
+            int64_t *node_displs;
+        } na;
+    };
+} ucg_planc_ucx_reduce_scatter_t;
+
+/**
+ * @brief Bytes spanned by @a count elements of @a dt.
+ */
+static inline int64_t ucg_planc_ucx_reduce_scatter_span(const ucg_dt_t *dt, int64_t count)
+{
+    return count == 0 ? 0 : dt->true_extent + dt->extent * (count - 1);
+}
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_reduce_scatter_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                                      ucg_planc_ucx_ppn_level_t ppn_level);
+
+/* Common routines of the reduce_scatter algorithms */
+ucg_status_t ucg_planc_ucx_reduce_scatter_check(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                int64_t *total, int32_t *max_count);
+ucg_dt_t *ucg_planc_ucx_reduce_scatter_get_dt(const ucg_coll_args_t *args);
+ucg_op_t *ucg_planc_ucx_reduce_scatter_get_op(const ucg_coll_args_t *args);
+ucg_status_t ucg_planc_ucx_reduce_scatter_op_init(ucg_planc_ucx_op_t *op, size_t data_size,
+                                                  size_t scratch_size, void **scratch);
+ucg_status_t ucg_planc_ucx_reduce_scatter_copy_block(ucg_planc_ucx_op_t *op, const void *src);
+
+/* xxx_prepare routines are provided for core layer to creat collective request */
+ucg_status_t ucg_planc_ucx_reduce_scatter_ring_prepare(ucg_vgroup_t *vgroup,
+                                                       const ucg_coll_args_t *args,
+                                                       ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_reduce_scatter_rh_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_reduce_scatter_na_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op);
+
+#endif
@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce_scatter.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+
+/**
+ * Node-aware reduce_scatter
+ *
+ * The ranks of a node send their vectors to the leader of the node, which
+ * reduces them in batches. The leaders then exchange the blocks of every
+ * other node, so that each leader holds the result of the blocks of its node,
+ * and scatter them to the ranks of the node. Only the leaders communicate
+ * across nodes, one message per pair of nodes.
+ *
+ * The leader keeps the blocks grouped by node, so the blocks of a node are
+ * sent and reduced with one call however the ranks are placed.
+ */
+
+/* op flags needed by node-aware reduce_scatter. */
+enum {
+    UCG_REDUCE_SCATTER_NA_FANIN = UCG_BIT(0),
+    UCG_REDUCE_SCATTER_NA_FANIN_POST = UCG_BIT(1),
+    UCG_REDUCE_SCATTER_NA_EXCHANGE = UCG_BIT(2),
+    UCG_REDUCE_SCATTER_NA_EXCHANGE_REDUCE = UCG_BIT(3),
+    UCG_REDUCE_SCATTER_NA_SCATTER = UCG_BIT(4),
+};
+
+#define UCG_REDUCE_SCATTER_NA_LEADER_FLAGS UCG_REDUCE_SCATTER_NA_FANIN_POST | \
+                                           UCG_REDUCE_SCATTER_NA_EXCHANGE | \
+                                           UCG_REDUCE_SCATTER_NA_EXCHANGE_REDUCE | \
+                                           UCG_REDUCE_SCATTER_NA_SCATTER
+
+#define UCG_REDUCE_SCATTER_NA_MEMBER_FLAGS UCG_REDUCE_SCATTER_NA_FANIN | \
+                                           UCG_REDUCE_SCATTER_NA_SCATTER
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_check(ucg_vgroup_t *vgroup,
+                                                          const ucg_coll_args_t *args,
+                                                          int64_t *total)
+{
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_check(vgroup, args, total, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (!ucg_op_is_commutative(ucg_planc_ucx_reduce_scatter_get_op(args))) {
+        ucg_info("Reduce_scatter node-aware don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    if (ucx_group->context->config.reduce_consistency == 1) {
+        ucg_info("Reduce_scatter node-aware don't support reduce calculation results consistency");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Reduce_scatter node-aware don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Reduce_scatter node-aware don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+static inline ucg_rank_t ucg_planc_ucx_reduce_scatter_na_leader(ucg_planc_ucx_op_t *op,
+                                                                int32_t node)
+{
+    return op->reduce_scatter.na.members[op->reduce_scatter.na.node_start[node]];
+}
+
+static inline int ucg_planc_ucx_reduce_scatter_na_is_leader(ucg_planc_ucx_op_t *op)
+{
+    int32_t mynode = op->reduce_scatter.na.mynode;
+    return op->super.vgroup->myrank == ucg_planc_ucx_reduce_scatter_na_leader(op, mynode);
+}
+
+static inline int32_t ucg_planc_ucx_reduce_scatter_na_node_count(ucg_planc_ucx_op_t *op,
+                                                                 int32_t node)
+{
+    const int64_t *node_displs = op->reduce_scatter.na.node_displs;
+    return node_displs[node + 1] - node_displs[node];
+}
+
+/**
+ * @brief Copy my input to the staging area in the order of the leader.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_place(ucg_planc_ucx_op_t *op)
+{
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    uint8_t *accum = (uint8_t*)op->staging_area - rs->dt->true_lb;
+
+    for (ucg_rank_t rank = 0; rank < op->super.vgroup->size; ++rank) {
+        if (rs->counts[rank] == 0) {
+            continue;
+        }
+        ucg_status_t status = ucg_dt_memcpy(accum + rs->na.packed_displs[rank] * extent,
+                                            rs->counts[rank], rs->dt,
+                                            (const uint8_t*)rs->input +
+                                            rs->displs[rank] * extent,
+                                            rs->counts[rank], rs->dt);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_leader_fanin(ucg_planc_ucx_op_t *op,
+                                                                 ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int32_t mynode = rs->na.mynode;
+    int32_t end = rs->na.node_start[mynode + 1];
+    int32_t total = rs->displs[vgroup->size];
+    int64_t extent = ucg_dt_extent(rs->dt);
+    int64_t slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(rs->dt, total),
+                                          sizeof(void*));
+    uint8_t *accum = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    uint8_t *slots = accum + slot_size;
+
+    while (rs->na.next < end) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_FANIN_POST)) {
+            rs->na.nrecv = ucg_min(rs->na.fanin_degree, end - rs->na.next);
+            for (int32_t i = 0; i < rs->na.nrecv && total != 0; ++i) {
+                ucg_rank_t peer = rs->na.members[rs->na.next + i];
+                status = ucg_planc_ucx_p2p_irecv(slots + i * slot_size, total, rs->dt, peer,
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+        UCG_CHECK_GOTO(status, out);
+
+        /* The vectors of the ranks are in rank order, reduce them block by block. */
+        for (int32_t i = 0; i < rs->na.nrecv; ++i) {
+            for (ucg_rank_t rank = 0; rank < vgroup->size; ++rank) {
+                status = ucg_op_reduce(rs->op, slots + i * slot_size + rs->displs[rank] * extent,
+                                       accum + rs->na.packed_displs[rank] * extent,
+                                       rs->counts[rank], rs->dt);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        rs->na.next += rs->na.nrecv;
+        op->flags |= UCG_REDUCE_SCATTER_NA_FANIN_POST;
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_leader_exchange(ucg_planc_ucx_op_t *op,
+                                                                    ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int32_t nnode = rs->na.nnode;
+    int32_t mynode = rs->na.mynode;
+    int32_t total = rs->displs[vgroup->size];
+    int32_t mycount = ucg_planc_ucx_reduce_scatter_na_node_count(op, mynode);
+    int64_t extent = ucg_dt_extent(rs->dt);
+    int64_t slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(rs->dt, total),
+                                          sizeof(void*));
+    int64_t block_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(rs->dt, mycount),
+                                           sizeof(void*));
+    uint8_t *accum = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    uint8_t *slots = accum + slot_size;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_EXCHANGE)) {
+        for (int32_t step = 1; step < nnode; ++step) {
+            int32_t dst_node = (mynode + step) % nnode;
+            int32_t src_node = (mynode + nnode - step) % nnode;
+            int32_t count = ucg_planc_ucx_reduce_scatter_na_node_count(op, dst_node);
+            if (count != 0) {
+                status = ucg_planc_ucx_p2p_isend(accum + rs->na.node_displs[dst_node] * extent,
+                                                 count, rs->dt,
+                                                 ucg_planc_ucx_reduce_scatter_na_leader(op, dst_node),
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            if (mycount != 0) {
+                status = ucg_planc_ucx_p2p_irecv(slots + (step - 1) * block_size, mycount, rs->dt,
+                                                 ucg_planc_ucx_reduce_scatter_na_leader(op, src_node),
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_EXCHANGE_REDUCE)) {
+        uint8_t *mine = accum + rs->na.node_displs[mynode] * extent;
+        for (int32_t step = 1; step < nnode; ++step) {
+            status = ucg_op_reduce(rs->op, slots + (step - 1) * block_size, mine,
+                                   mycount, rs->dt);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_leader_scatter(ucg_planc_ucx_op_t *op,
+                                                                   ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t mynode = rs->na.mynode;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    uint8_t *accum = (uint8_t*)op->staging_area - rs->dt->true_lb;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_SCATTER)) {
+        for (int32_t i = rs->na.node_start[mynode] + 1;
+             i < rs->na.node_start[mynode + 1]; ++i) {
+            ucg_rank_t peer = rs->na.members[i];
+            if (rs->counts[peer] == 0) {
+                continue;
+            }
+            status = ucg_planc_ucx_p2p_isend(accum + rs->na.packed_displs[peer] * extent,
+                                             rs->counts[peer], rs->dt, peer,
+                                             op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_reduce_scatter_copy_block(op, accum +
+                                                         rs->na.packed_displs[myrank] * extent);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_leader_progress(ucg_planc_ucx_op_t *op,
+                                                                    ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+
+    status = ucg_planc_ucx_reduce_scatter_na_leader_fanin(op, params);
+    UCG_CHECK_GOTO(status, out);
+
+    status = ucg_planc_ucx_reduce_scatter_na_leader_exchange(op, params);
+    UCG_CHECK_GOTO(status, out);
+
+    status = ucg_planc_ucx_reduce_scatter_na_leader_scatter(op, params);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_member_progress(ucg_planc_ucx_op_t *op,
+                                                                    ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t total = rs->displs[vgroup->size];
+    ucg_rank_t leader = ucg_planc_ucx_reduce_scatter_na_leader(op, rs->na.mynode);
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_FANIN) && total != 0) {
+        status = ucg_planc_ucx_p2p_isend(rs->input, total, rs->dt, leader,
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+
+    /* In place, the result overwrites the input after it has been sent. */
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_NA_SCATTER) &&
+        rs->counts[myrank] != 0) {
+        status = ucg_planc_ucx_p2p_irecv(rs->recvbuf, rs->counts[myrank], rs->dt, leader,
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (ucg_planc_ucx_reduce_scatter_na_is_leader(op)) {
+        status = ucg_planc_ucx_reduce_scatter_na_leader_progress(op, &params);
+    } else {
+        status = ucg_planc_ucx_reduce_scatter_na_member_progress(op, &params);
+    }
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_planc_ucx_reduce_scatter_na_is_leader(op)) {
+        op->flags = UCG_REDUCE_SCATTER_NA_LEADER_FLAGS;
+        /* The leader itself is the first local rank. */
+        op->reduce_scatter.na.next = op->reduce_scatter.na.node_start[op->reduce_scatter.na.mynode] + 1;
+        status = ucg_planc_ucx_reduce_scatter_na_place(op);
+        if (status != UCG_OK) {
+            op->super.super.status = status;
+            return status;
+        }
+    } else {
+        op->flags = UCG_REDUCE_SCATTER_NA_MEMBER_FLAGS;
+    }
+
+    status = ucg_planc_ucx_reduce_scatter_na_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+/**
+ * @brief Group the ranks by node, the leader of a node is its smallest rank.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_scatter_na_op_init(ucg_planc_ucx_op_t *op,
+                                                            int64_t total,
+                                                            ucg_planc_ucx_reduce_scatter_config_t *config)
+{
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+    int32_t nnode = topo->detail.nnode;
+    int32_t mynode = ucg_topo_get_location_id(topo, ucg_rank_map_eval(&vgroup->rank_map, myrank),
+                                              UCG_TOPO_LOC_NODE_ID);
+    int32_t fanin_degree = ucg_max(config->na_fanin_degree, 1);
+
+    int32_t nlocal = 0;
+    ucg_rank_t leader = UCG_INVALID_RANK;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id == mynode) {
+            leader = nlocal++ == 0 ? rank : leader;
+        }
+    }
+
+    /**
+     * The leader needs the packed vector, the slots of the fan-in and the
+     * slots of the blocks from other nodes, the latter reuse the former.
+     */
+    size_t data_size = 0;
+    if (myrank == leader) {
+        ucg_dt_t *dt = ucg_planc_ucx_reduce_scatter_get_dt(&op->super.super.args);
+        int64_t slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(dt, total),
+                                              sizeof(void*));
+        int32_t nslot = ucg_min(fanin_degree, nlocal - 1);
+        /* The blocks of my node are only known after grouping, the total bounds them. */
+        data_size = slot_size * (1 + ucg_max(nslot, nnode - 1));
+    }
+    size_t scratch_size = sizeof(int64_t) * (group_size + nnode + 1) +
+                          sizeof(int32_t) * (2 * group_size + 2 * (nnode + 1));
+    uint8_t *scratch = NULL;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_op_init(op, data_size, scratch_size,
+                                                               (void**)&scratch);
+    if (status != UCG_OK) {
+        return status;
+    }
+    int64_t *packed_displs = (int64_t*)scratch;
+    int64_t *node_displs = packed_displs + group_size;
+    int32_t *node_of = (int32_t*)(node_displs + nnode + 1);
+    int32_t *members = node_of + group_size;
+    int32_t *node_start = members + group_size;
+    int32_t *fill = node_start + (nnode + 1);
+    rs->na.packed_displs = packed_displs;
+    rs->na.node_displs = node_displs;
+    rs->na.members = members;
+    rs->na.node_start = node_start;
+    rs->na.nnode = nnode;
+    rs->na.mynode = mynode;
+    rs->na.fanin_degree = fanin_degree;
+
+    for (int32_t node = 0; node <= nnode; ++node) {
+        node_start[node] = 0;
+    }
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        node_of[rank] = topo->detail.locations[group_rank].node_id;
+        ++node_start[node_of[rank] + 1];
+    }
+    for (int32_t node = 0; node < nnode; ++node) {
+        node_start[node + 1] += node_start[node];
+        fill[node] = node_start[node];
+    }
+    /* Counting sort keeps the ranks of a node in ascending order. */
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        members[fill[node_of[rank]]++] = rank;
+    }
+
+    int64_t offset = 0;
+    for (int32_t node = 0; node < nnode; ++node) {
+        node_displs[node] = offset;
+        for (int32_t i = node_start[node]; i < node_start[node + 1]; ++i) {
+            packed_displs[members[i]] = offset;
+            offset += rs->counts[members[i]];
+        }
+    }
+    node_displs[nnode] = offset;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_reduce_scatter_na_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                       ucg_vgroup_t *vgroup,
+                                       const ucg_coll_args_t *args,
+                                       int64_t total,
+                                       ucg_planc_ucx_reduce_scatter_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_scatter_na_op_trigger,
+                                 ucg_planc_ucx_reduce_scatter_na_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_reduce_scatter_na_op_init(ucx_op, total, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce_scatter node-aware ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_na_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    int64_t total;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_na_check(vgroup, args, &total);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_reduce_scatter_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, reduce_scatter,
+                                                         UCG_COLL_TYPE_REDUCE_SCATTER);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_scatter_na_op_new(ucx_group, vgroup, args,
+                                                                        total, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
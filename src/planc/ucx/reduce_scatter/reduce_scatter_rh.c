@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce_scatter.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Recursive halving reduce_scatter
+ *
+ * If the group size is not a power of two, the first 2 * rem ranks fold in
+ * pairs: the even rank sends its whole vector to the odd one and waits for
+ * its block, the odd rank takes over both blocks. The remaining pof2 ranks
+ * halve the vector in log2(pof2) steps, the peer of step b differs in bit b
+ * of the new rank.
+ *
+ * Since the distance grows from 1, the data of a rank is always the
+ * reduction of a contiguous range of ranks, and it is combined with the
+ * range of the peer in rank order, so non-commutative ops are supported.
+ * The blocks are placed in bit-reversed order of the new ranks to keep the
+ * halved range contiguous.
+ */
+
+enum {
+    UCG_REDUCE_SCATTER_RH_FOLD = UCG_BIT(0),
+    UCG_REDUCE_SCATTER_RH_FOLD_REDUCE = UCG_BIT(1),
+    UCG_REDUCE_SCATTER_RH_POST = UCG_BIT(2),
+    UCG_REDUCE_SCATTER_RH_RESULT = UCG_BIT(3),
+};
+
+#define UCG_REDUCE_SCATTER_RH_FLAGS UCG_REDUCE_SCATTER_RH_FOLD | \
+                                    UCG_REDUCE_SCATTER_RH_FOLD_REDUCE | \
+                                    UCG_REDUCE_SCATTER_RH_POST | \
+                                    UCG_REDUCE_SCATTER_RH_RESULT
+
+static inline int32_t ucg_planc_ucx_reduce_scatter_rh_reverse(int32_t value, int32_t nbits)
+{
+    int32_t result = 0;
+    for (int32_t i = 0; i < nbits; ++i) {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+}
+
+/**
+ * @brief The first original block of new rank @a new_rank, the second one
+ * follows it if the new rank is a folded pair.
+ */
+static inline ucg_rank_t ucg_planc_ucx_reduce_scatter_rh_first_block(int32_t new_rank,
+                                                                     int32_t nprocs_rem)
+{
+    return (new_rank < nprocs_rem) ? 2 * new_rank : new_rank + nprocs_rem;
+}
+
+/**
+ * @brief The rank that holds the data of new rank @a new_rank.
+ */
+static inline ucg_rank_t ucg_planc_ucx_reduce_scatter_rh_rank(int32_t new_rank,
+                                                              int32_t nprocs_rem)
+{
+    return (new_rank < nprocs_rem) ? 2 * new_rank + 1 : new_rank + nprocs_rem;
+}
+
+/**
+ * @brief Copy the input to the staging area with the blocks in position order.
+ */
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_place(ucg_planc_ucx_op_t *op)
+{
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    int32_t nstep = rs->rh.nstep;
+    int32_t nprocs_rem = rs->rh.nprocs_rem;
+    const int64_t *pos_displs = rs->rh.pos_displs;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    uint8_t *tmp = (uint8_t*)op->staging_area - rs->dt->true_lb;
+
+    for (int32_t pos = 0; pos < UCG_BIT(nstep); ++pos) {
+        int32_t new_rank = ucg_planc_ucx_reduce_scatter_rh_reverse(pos, nstep);
+        ucg_rank_t block = ucg_planc_ucx_reduce_scatter_rh_first_block(new_rank, nprocs_rem);
+        int32_t count = pos_displs[pos + 1] - pos_displs[pos];
+        if (count == 0) {
+            continue;
+        }
+        ucg_status_t status = ucg_dt_memcpy(tmp + pos_displs[pos] * extent, count, rs->dt,
+                                            (const uint8_t*)rs->input +
+                                            rs->displs[block] * extent,
+                                            count, rs->dt);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_fold(ucg_planc_ucx_op_t *op,
+                                                         ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t total = rs->displs[vgroup->size];
+    uint8_t *tmp = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    uint8_t *recv = tmp + rs->rh.recv_offset;
+
+    if (myrank % 2 == 0) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_FOLD) && total != 0) {
+            status = ucg_planc_ucx_p2p_isend(tmp, total, rs->dt, myrank + 1,
+                                             op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+        UCG_CHECK_GOTO(status, out);
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_RESULT) &&
+            rs->counts[myrank] != 0) {
+            status = ucg_planc_ucx_p2p_irecv(rs->recvbuf, rs->counts[myrank], rs->dt,
+                                             myrank + 1, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+        goto out;
+    }
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_FOLD) && total != 0) {
+        status = ucg_planc_ucx_p2p_irecv(recv, total, rs->dt, myrank - 1,
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+    UCG_CHECK_GOTO(status, out);
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_FOLD_REDUCE)) {
+        /* The data of the lower rank is the left operand. */
+        status = ucg_op_reduce(rs->op, recv, tmp, total, rs->dt);
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_halving(ucg_planc_ucx_op_t *op,
+                                                            ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t nprocs_pof2 = UCG_BIT(rs->rh.nstep);
+    int32_t nprocs_rem = rs->rh.nprocs_rem;
+    ucg_rank_t new_rank = rs->rh.new_rank;
+    const int64_t *pos_displs = rs->rh.pos_displs;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    uint8_t *tmp = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    uint8_t *recv = tmp + rs->rh.recv_offset;
+    int32_t *mask = &rs->rh.mask;
+
+    while (*mask < nprocs_pof2) {
+        int32_t low = rs->rh.low;
+        int32_t high = rs->rh.high;
+        int32_t mid = low + (high - low) / 2;
+        ucg_rank_t peer = ucg_planc_ucx_reduce_scatter_rh_rank(new_rank ^ *mask, nprocs_rem);
+        int32_t keep_low = (new_rank & *mask) ? mid : low;
+        int32_t keep_high = (new_rank & *mask) ? high : mid;
+        int32_t send_low = (new_rank & *mask) ? low : mid;
+        int32_t send_high = (new_rank & *mask) ? mid : high;
+        int32_t keep_count = pos_displs[keep_high] - pos_displs[keep_low];
+        int32_t send_count = pos_displs[send_high] - pos_displs[send_low];
+        uint8_t *keep = tmp + pos_displs[keep_low] * extent;
+
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_POST)) {
+            if (send_count != 0) {
+                status = ucg_planc_ucx_p2p_isend(tmp + pos_displs[send_low] * extent,
+                                                 send_count, rs->dt, peer,
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            if (keep_count != 0) {
+                status = ucg_planc_ucx_p2p_irecv(recv, keep_count, rs->dt, peer,
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+        UCG_CHECK_GOTO(status, out);
+
+        if (peer < myrank) {
+            status = ucg_op_reduce(rs->op, recv, keep, keep_count, rs->dt);
+        } else {
+            status = ucg_op_reduce3(rs->op, keep, recv, keep, keep_count, rs->dt);
+        }
+        UCG_CHECK_GOTO(status, out);
+
+        rs->rh.low = keep_low;
+        rs->rh.high = keep_high;
+        *mask <<= 1;
+        op->flags |= UCG_REDUCE_SCATTER_RH_POST;
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_result(ucg_planc_ucx_op_t *op,
+                                                           ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    uint8_t *tmp = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    /* Only one position is left, the one of my new rank. */
+    uint8_t *result = tmp + rs->rh.pos_displs[rs->rh.low] * extent;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RH_RESULT)) {
+        if (myrank < 2 * rs->rh.nprocs_rem) {
+            /* The block of the folded rank comes first. */
+            int32_t count = rs->counts[myrank - 1];
+            if (count != 0) {
+                status = ucg_planc_ucx_p2p_isend(result, count, rs->dt, myrank - 1,
+                                                 op->tag, vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            result += count * extent;
+        }
+        status = ucg_planc_ucx_reduce_scatter_copy_block(op, result);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params->state);
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_rank_t myrank = op->super.vgroup->myrank;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    if (myrank < 2 * op->reduce_scatter.rh.nprocs_rem) {
+        status = ucg_planc_ucx_reduce_scatter_rh_fold(op, &params);
+        /* The even rank is done after the fold. */
+        if (status != UCG_OK || myrank % 2 == 0) {
+            goto out;
+        }
+    }
+
+    status = ucg_planc_ucx_reduce_scatter_rh_halving(op, &params);
+    UCG_CHECK_GOTO(status, out);
+
+    status = ucg_planc_ucx_reduce_scatter_rh_result(op, &params);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_REDUCE_SCATTER_RH_FLAGS;
+    op->reduce_scatter.rh.mask = 1;
+    op->reduce_scatter.rh.low = 0;
+    op->reduce_scatter.rh.high = UCG_BIT(op->reduce_scatter.rh.nstep);
+
+    /* The input is not read any more, which makes in-place simple. */
+    status = ucg_planc_ucx_reduce_scatter_rh_place(op);
+    if (status != UCG_OK) {
+        op->super.super.status = status;
+        return status;
+    }
+
+    status = ucg_planc_ucx_reduce_scatter_rh_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_rh_op_init(ucg_planc_ucx_op_t *op,
+                                                            int64_t total)
+{
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t nstep = ucg_ilog2(vgroup->size);
+    int32_t nprocs_pof2 = UCG_BIT(nstep);
+    int32_t nprocs_rem = vgroup->size - nprocs_pof2;
+
+    rs->rh.nstep = nstep;
+    rs->rh.nprocs_rem = nprocs_rem;
+    if (myrank < 2 * nprocs_rem) {
+        rs->rh.new_rank = (myrank % 2 == 0) ? UCG_INVALID_RANK : myrank / 2;
+    } else {
+        rs->rh.new_rank = myrank - nprocs_rem;
+    }
+
+    /* The folded rank receives the whole vector, a half is enough for others. */
+    ucg_dt_t *dt = ucg_planc_ucx_reduce_scatter_get_dt(&op->super.super.args);
+    int64_t span = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(dt, total),
+                                     sizeof(void*));
+    int64_t *pos_displs = NULL;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_op_init(op, 2 * span,
+                                                               sizeof(int64_t) * (nprocs_pof2 + 1),
+                                                               (void**)&pos_displs);
+    if (status != UCG_OK) {
+        return status;
+    }
+    rs->rh.recv_offset = span;
+    rs->rh.pos_displs = pos_displs;
+
+    pos_displs[0] = 0;
+    for (int32_t pos = 0; pos < nprocs_pof2; ++pos) {
+        int32_t new_rank = ucg_planc_ucx_reduce_scatter_rh_reverse(pos, nstep);
+        ucg_rank_t block = ucg_planc_ucx_reduce_scatter_rh_first_block(new_rank, nprocs_rem);
+        int64_t count = rs->counts[block];
+        if (new_rank < nprocs_rem) {
+            count += rs->counts[block + 1];
+        }
+        pos_displs[pos + 1] = pos_displs[pos] + count;
+    }
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_reduce_scatter_rh_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                       ucg_vgroup_t *vgroup,
+                                       const ucg_coll_args_t *args,
+                                       int64_t total)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_scatter_rh_op_trigger,
+                                 ucg_planc_ucx_reduce_scatter_rh_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_reduce_scatter_rh_op_init(ucx_op, total);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce_scatter recursive halving ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_rh_prepare(ucg_vgroup_t *vgroup,
+                                                     const ucg_coll_args_t *args,
+                                                     ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    int64_t total;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_check(vgroup, args, &total, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_scatter_rh_op_new(ucx_group, vgroup,
+                                                                        args, total);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "reduce_scatter.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+/**
+ * Ring reduce_scatter
+ *
+ * At step k, rank r sends the partial result of block (r - k - 1) to rank
+ * (r + 1) and receives the partial result of block (r - k - 2) from rank
+ * (r - 1), which is reduced with its own block. After size - 1 steps, the
+ * block received last is block r and it is complete. Every rank sends and
+ * receives about (size - 1) / size of the vector, which suits large messages.
+ */
+
+enum {
+    UCG_REDUCE_SCATTER_RING_POST = UCG_BIT(0),
+};
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_ring_check(ucg_vgroup_t *vgroup,
+                                                            const ucg_coll_args_t *args,
+                                                            int32_t *max_count)
+{
+    int64_t total;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_check(vgroup, args, &total, max_count);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (!ucg_op_is_commutative(ucg_planc_ucx_reduce_scatter_get_op(args))) {
+        ucg_info("Reduce_scatter ring don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    if (ucx_group->context->config.reduce_consistency == 1) {
+        ucg_info("Reduce_scatter ring don't support reduce calculation results consistency");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_ring_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_reduce_scatter_t *rs = &op->reduce_scatter;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    int64_t extent = ucg_dt_extent(rs->dt);
+    ucg_rank_t left = (myrank + group_size - 1) % group_size;
+    ucg_rank_t right = (myrank + 1) % group_size;
+    /* The partial result to send and the block received from left. */
+    uint8_t *partial = (uint8_t*)op->staging_area - rs->dt->true_lb;
+    uint8_t *recv = partial + rs->ring.slot_size;
+    int32_t *step = &rs->ring.step;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (*step < (int32_t)group_size - 1) {
+        ucg_rank_t send_block = (myrank + 2 * group_size - *step - 1) % group_size;
+        ucg_rank_t recv_block = (myrank + 2 * group_size - *step - 2) % group_size;
+        if (ucg_test_and_clear_flags(&op->flags, UCG_REDUCE_SCATTER_RING_POST)) {
+            if (rs->counts[send_block] != 0) {
+                const void *sbuf = (*step == 0) ?
+                                   (const uint8_t*)rs->input + rs->displs[send_block] * extent :
+                                   partial;
+                status = ucg_planc_ucx_p2p_isend(sbuf, rs->counts[send_block], rs->dt,
+                                                 right, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            if (rs->counts[recv_block] != 0) {
+                status = ucg_planc_ucx_p2p_irecv(recv, rs->counts[recv_block], rs->dt,
+                                                 left, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        /* The partial result has been sent, so it can be overwritten. */
+        status = ucg_op_reduce3(rs->op, recv,
+                                (uint8_t*)rs->input + rs->displs[recv_block] * extent,
+                                partial, rs->counts[recv_block], rs->dt);
+        UCG_CHECK_GOTO(status, out);
+        ++(*step);
+        op->flags |= UCG_REDUCE_SCATTER_RING_POST;
+    }
+
+    /* In place, the input is still read by the last reduction, so it is not
+     * reduced to recvbuf directly. */
+    if (group_size == 1) {
+        status = ucg_planc_ucx_reduce_scatter_copy_block(op, rs->input);
+    } else {
+        status = ucg_planc_ucx_reduce_scatter_copy_block(op, partial);
+    }
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_reduce_scatter_ring_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    op->flags = UCG_REDUCE_SCATTER_RING_POST;
+    op->reduce_scatter.ring.step = 0;
+
+    status = ucg_planc_ucx_reduce_scatter_ring_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_planc_ucx_op_t *
+ucg_planc_ucx_reduce_scatter_ring_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                         ucg_vgroup_t *vgroup,
+                                         const ucg_coll_args_t *args,
+                                         int32_t max_count)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_reduce_scatter_ring_op_trigger,
+                                 ucg_planc_ucx_reduce_scatter_ring_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    ucg_dt_t *dt = ucg_planc_ucx_reduce_scatter_get_dt(args);
+    int64_t slot_size = ucg_align_up_pow2(ucg_planc_ucx_reduce_scatter_span(dt, max_count),
+                                          sizeof(void*));
+    status = ucg_planc_ucx_reduce_scatter_op_init(ucx_op, 2 * slot_size, 0, NULL);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize reduce_scatter ring ucx op");
+        goto err_destruct;
+    }
+    ucx_op->reduce_scatter.ring.slot_size = slot_size;
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_reduce_scatter_ring_prepare(ucg_vgroup_t *vgroup,
+                                                       const ucg_coll_args_t *args,
+                                                       ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    int32_t max_count;
+    ucg_status_t status = ucg_planc_ucx_reduce_scatter_ring_check(vgroup, args, &max_count);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_reduce_scatter_ring_op_new(ucx_group, vgroup,
+                                                                          args, max_count);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "scan.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_global.h"
+#include "util/ucg_log.h"
+
+#define PLAN_DOMAIN "planc ucx scan"
+
+static ucg_plan_attr_t ucg_planc_ucx_scan_plan_attr[] = {
+    {ucg_planc_ucx_scan_rd_prepare,
+     1, "Recursive doubling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {ucg_planc_ucx_scan_na_prepare,
+     2, "Node-aware recursive doubling", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_RD},
+
+    {NULL},
+};
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_SCAN,
+                             ucg_planc_ucx_scan_plan_attr);
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_EXSCAN,
+                             ucg_planc_ucx_scan_plan_attr);
+
+/* Exscan shares the configuration of scan. */
+static ucg_config_field_t scan_config_table[] = {
+    {"SCAN_NA_BCAST_DEGREE", "4",
+     "Configure the k value of the tree broadcasting the prefix of a node in "
+     "node-aware algo for scan",
+     ucg_offsetof(ucg_planc_ucx_scan_config_t, na_bcast_degree),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_SCAN, scan_config_table,
+                                    sizeof(ucg_planc_ucx_scan_config_t))
+
+/**
+ * Scan is bound by latency. Node-aware only takes log2(nnode) steps over the
+ * network, but it needs the ranks of a node to be contiguous, recursive
+ * doubling supports all layouts and is the fallback of every table.
+ */
+static ucg_plan_policy_t scan_default[] = {
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+static ucg_plan_policy_t scan_na[] = {
+    {2,  {0, 65536}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+    {1,  {65536, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_1ST},
+
+    {1,  {0, UCG_PLAN_RANGE_MAX}, UCG_PLAN_UCX_PLAN_SCORE_3RD},
+    UCG_PLAN_LAST_POLICY,
+};
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_scan_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                            ucg_planc_ucx_ppn_level_t ppn_level)
+{
+    UCG_UNUSED(node_level);
+    ucg_plan_policy_t *policy = (ppn_level == PPN_LEVEL_1) ? scan_default : scan_na;
+    return policy;
+}
+
+ucg_status_t ucg_planc_ucx_scan_check(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args)
+{
+    UCG_UNUSED(vgroup);
+    if (args->scan.count < 0) {
+        ucg_error("Invalid count %d", args->scan.count);
+        return UCG_ERR_INVALID_PARAM;
+    }
+    return UCG_OK;
+}
+
+void ucg_planc_ucx_scan_rd_init(ucg_planc_ucx_scan_rd_t *rd, int size, ucg_rank_t myidx,
+                                const ucg_rank_t *ranks)
+{
+    ucg_algo_rd_iter_init(&rd->iter, size, myidx);
+    rd->ranks = ranks;
+    rd->myidx = myidx;
+    return;
+}
+
+void ucg_planc_ucx_scan_rd_reset(ucg_planc_ucx_scan_rd_t *rd, const void *data)
+{
+    ucg_algo_rd_iter_reset(&rd->iter);
+    rd->data = data;
+    rd->cur = data;
+    rd->has_prefix = 0;
+    return;
+}
+
+static inline ucg_rank_t ucg_planc_ucx_scan_rd_rank(ucg_planc_ucx_scan_rd_t *rd, ucg_rank_t idx)
+{
+    return rd->ranks == NULL ? idx : rd->ranks[idx];
+}
+
+/* The first and the last value of the proxy are the extra rank. */
+static inline int ucg_planc_ucx_scan_rd_is_extra(ucg_algo_rd_iter_t *iter)
+{
+    return iter->type == UCG_ALGO_RD_ITER_PROXY &&
+           (iter->idx == 0 || iter->idx == iter->max_idx - 1);
+}
+
+/* After the last exchange, only the prefix is needed. */
+static inline int ucg_planc_ucx_scan_rd_is_last(ucg_algo_rd_iter_t *iter)
+{
+    int end = (iter->type == UCG_ALGO_RD_ITER_PROXY) ? iter->max_idx - 1 : iter->max_idx;
+    return iter->idx + 1 == end;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_rd_post(ucg_planc_ucx_op_t *op,
+                                               ucg_planc_ucx_scan_rd_t *rd,
+                                               ucg_rank_t peer,
+                                               ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_algo_rd_iter_t *iter = &rd->iter;
+    ucg_rank_t rank = ucg_planc_ucx_scan_rd_rank(rd, peer);
+
+    if (iter->type == UCG_ALGO_RD_ITER_EXTRA) {
+        if (iter->idx == 0) {
+            status = ucg_planc_ucx_p2p_isend(rd->data, args->count, args->dt, rank,
+                                             op->tag, vgroup, params);
+        } else if (rd->myidx > 0) {
+            status = ucg_planc_ucx_p2p_irecv(rd->prefix, args->count, args->dt, rank,
+                                             op->tag, vgroup, params);
+        }
+        return status;
+    }
+
+    if (ucg_planc_ucx_scan_rd_is_extra(iter)) {
+        if (iter->idx == 0) {
+            status = ucg_planc_ucx_p2p_irecv(rd->extra, args->count, args->dt, rank,
+                                             op->tag, vgroup, params);
+        } else if (rd->has_prefix) {
+            status = ucg_planc_ucx_p2p_isend(rd->prefix, args->count, args->dt, rank,
+                                             op->tag, vgroup, params);
+        }
+        return status;
+    }
+
+    status = ucg_planc_ucx_p2p_isend(rd->cur, args->count, args->dt, rank,
+                                     op->tag, vgroup, params);
+    if (status != UCG_OK) {
+        return status;
+    }
+    return ucg_planc_ucx_p2p_irecv(rd->recv, args->count, args->dt, rank,
+                                   op->tag, vgroup, params);
+}
+
+static ucg_status_t ucg_planc_ucx_scan_rd_reduce(ucg_planc_ucx_op_t *op,
+                                                 ucg_planc_ucx_scan_rd_t *rd,
+                                                 ucg_rank_t peer)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_algo_rd_iter_t *iter = &rd->iter;
+
+    if (iter->type == UCG_ALGO_RD_ITER_EXTRA) {
+        rd->has_prefix = (iter->idx != 0 && rd->myidx > 0);
+        return UCG_OK;
+    }
+
+    if (ucg_planc_ucx_scan_rd_is_extra(iter)) {
+        if (iter->idx == 0) {
+            /* The input of the extra rank is the left operand. */
+            status = ucg_op_reduce3(args->op, rd->extra, (void*)rd->data, rd->partial,
+                                    args->count, args->dt);
+            rd->cur = rd->partial;
+        } else if (rd->has_prefix) {
+            status = ucg_op_reduce3(args->op, rd->prefix, rd->extra, rd->prefix,
+                                    args->count, args->dt);
+        } else {
+            status = ucg_dt_memcpy(rd->prefix, args->count, args->dt,
+                                   rd->extra, args->count, args->dt);
+            rd->has_prefix = 1;
+        }
+        return status;
+    }
+
+    /* The partial result is updated before the prefix, the prefix may be the input. */
+    if (peer < rd->myidx) {
+        if (!ucg_planc_ucx_scan_rd_is_last(iter)) {
+            status = ucg_op_reduce3(args->op, rd->recv, (void*)rd->cur, rd->partial,
+                                    args->count, args->dt);
+            UCG_CHECK_GOTO(status, out);
+            rd->cur = rd->partial;
+        }
+        if (rd->has_prefix) {
+            status = ucg_op_reduce(args->op, rd->recv, rd->prefix, args->count, args->dt);
+        } else {
+            status = ucg_dt_memcpy(rd->prefix, args->count, args->dt,
+                                   rd->recv, args->count, args->dt);
+            rd->has_prefix = 1;
+        }
+    } else if (!ucg_planc_ucx_scan_rd_is_last(iter)) {
+        status = ucg_op_reduce3(args->op, rd->cur, rd->recv, rd->partial,
+                                args->count, args->dt);
+        rd->cur = rd->partial;
+    }
+
+out:
+    return status;
+}
+
+ucg_status_t ucg_planc_ucx_scan_rd_progress(ucg_planc_ucx_op_t *op,
+                                            ucg_planc_ucx_scan_rd_t *rd,
+                                            uint64_t post_flag)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_algo_rd_iter_t *iter = &rd->iter;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t peer;
+
+    while ((peer = ucg_algo_rd_iter_value(iter)) != UCG_INVALID_RANK) {
+        if (ucg_test_and_clear_flags(&op->flags, post_flag)) {
+            status = ucg_planc_ucx_scan_rd_post(op, rd, peer, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+
+        status = ucg_planc_ucx_scan_rd_reduce(op, rd, peer);
+        UCG_CHECK_GOTO(status, out);
+        ucg_algo_rd_iter_inc(iter);
+        op->flags |= post_flag;
+    }
+
+out:
+    return status;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_SCAN_H_
+#define UCG_PLANC_UCX_SCAN_H_
+
+#include "planc/ucx/planc_ucx_def.h"
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_dt.h"
+#include "util/algo/ucg_rd.h"
+#include "util/algo/ucg_kntree.h"
+
+typedef struct ucg_planc_ucx_scan_config {
+    /* k value of the tree broadcasting the prefix of a node to its members */
+    int na_bcast_degree;
+} ucg_planc_ucx_scan_config_t;
+
+/**
+ * @brief Recursive doubling prefix reduction over ranks[0], ..., ranks[size-1]
+ *
+ * After the iterator is exhausted, prefix holds the reduction of the inputs
+ * of the ranks before me if has_prefix is set. The proxy of a non power of
+ * two group receives the input of the extra rank first and sends the prefix
+ * back at the end.
+ */
+typedef struct ucg_planc_ucx_scan_rd {
+    ucg_algo_rd_iter_t iter;
+    /* NULL means the identity map */
+    const ucg_rank_t *ranks;
+    ucg_rank_t myidx;
+    /* My input */
+    const void *data;
+    /* Reduction of the inputs of the subcube I'm in, it's data before the first step. */
+    const void *cur;
+    void *partial;
+    void *recv;
+    /* Input of the extra rank, only used by the proxy. */
+    void *extra;
+    void *prefix;
+    uint8_t has_prefix;
+} ucg_planc_ucx_scan_rd_t;
+
+/**
+ * @brief Scan op auxiliary information
+ *
+ * Scan and exscan share the algorithms, the arguments of both are in
+ * ucg_coll_args_t::scan.
+ */
+typedef struct ucg_planc_ucx_scan {
+    /* recvbuf when the operation is in place */
+    const void *input;
+    uint8_t exclusive;
+    /* Among all ranks, or among the ranks in my node for node-aware. */
+    ucg_planc_ucx_scan_rd_t rd;
+    struct {
+        /* Among the leaders, the last rank of every node. */
+        ucg_planc_ucx_scan_rd_t inter;
+        /* Broadcast the prefix of my node from the leader. */
+        ucg_algo_kntree_iter_t bcast;
+        int32_t nlocal;
+        int32_t mynode;
+        uint8_t is_leader;
+        /* Reduction of the inputs of my node, the input of the leader in inter. */
+        void *total;
+    } na;
+} ucg_planc_ucx_scan_t;
+
+/**
+ * @brief Bytes spanned by @a count elements of @a dt.
+ */
+static inline int64_t ucg_planc_ucx_scan_span(const ucg_dt_t *dt, int64_t count)
+{
+    return count == 0 ? 0 : dt->true_extent + dt->extent * (count - 1);
+}
+
+static inline int ucg_planc_ucx_scan_is_exclusive(ucg_coll_type_t coll_type)
+{
+    return coll_type == UCG_COLL_TYPE_EXSCAN || coll_type == UCG_COLL_TYPE_IEXSCAN;
+}
+
+const ucg_plan_policy_t *ucg_planc_ucx_get_scan_plan_policy(ucg_planc_ucx_node_level_t node_level,
+                                                            ucg_planc_ucx_ppn_level_t ppn_level);
+
+/* Common routines of the scan algorithms */
+ucg_status_t ucg_planc_ucx_scan_check(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args);
+void ucg_planc_ucx_scan_rd_init(ucg_planc_ucx_scan_rd_t *rd, int size, ucg_rank_t myidx,
+                                const ucg_rank_t *ranks);
+void ucg_planc_ucx_scan_rd_reset(ucg_planc_ucx_scan_rd_t *rd, const void *data);
+ucg_status_t ucg_planc_ucx_scan_rd_progress(ucg_planc_ucx_op_t *op,
+                                            ucg_planc_ucx_scan_rd_t *rd,
+                                            uint64_t post_flag);
+
+/* xxx_prepare routines are provided for core layer to creat collective request */
+ucg_status_t ucg_planc_ucx_scan_rd_prepare(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op);
+ucg_status_t ucg_planc_ucx_scan_na_prepare(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op);
+
+#endif
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "scan.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+/**
+ * Node-aware recursive doubling scan
+ *
+ * 1. The ranks of a node do the recursive doubling scan among themselves.
+ * 2. The last rank of every node is the leader, it knows the reduction of
+ *    the inputs of its node, and the leaders do the recursive doubling
+ *    exscan to get the prefix of the nodes before theirs.
+ * 3. The leader broadcasts the prefix of its node by a k-nomial tree.
+ *
+ * A rank combines the prefix of its node and the prefix in its node, only
+ * log2(nnode) steps go through the network. Every node must hold a range of
+ * ranks so that the order of ranks is kept, non-commutative ops are supported.
+ */
+
+/* op flags needed by node-aware scan. */
+enum {
+    UCG_SCAN_NA_INTRA = UCG_BIT(0),
+    UCG_SCAN_NA_INTRA_POST = UCG_BIT(1),
+    UCG_SCAN_NA_TOTAL = UCG_BIT(2),
+    UCG_SCAN_NA_INTER = UCG_BIT(3),
+    UCG_SCAN_NA_INTER_POST = UCG_BIT(4),
+    UCG_SCAN_NA_BCAST_RECV = UCG_BIT(5),
+    UCG_SCAN_NA_BCAST_RECV_POST = UCG_BIT(6),
+    UCG_SCAN_NA_BCAST_SEND = UCG_BIT(7),
+    UCG_SCAN_NA_BCAST_SEND_POST = UCG_BIT(8),
+};
+
+#define UCG_SCAN_NA_BCAST_FLAGS UCG_SCAN_NA_BCAST_SEND | \
+                                UCG_SCAN_NA_BCAST_SEND_POST
+
+#define UCG_SCAN_NA_LEADER_FLAGS UCG_SCAN_NA_TOTAL | \
+                                 UCG_SCAN_NA_INTER | \
+                                 UCG_SCAN_NA_INTER_POST
+
+#define UCG_SCAN_NA_MEMBER_FLAGS UCG_SCAN_NA_BCAST_RECV | \
+                                 UCG_SCAN_NA_BCAST_RECV_POST
+
+static ucg_status_t ucg_planc_ucx_scan_na_check(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args)
+{
+    ucg_topo_t *topo = vgroup->group->topo;
+    if (topo->detail.nnode <= 1) {
+        ucg_info("Scan node-aware don't support only one node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (topo->ppn == 1) {
+        ucg_info("Scan node-aware don't support ppn==1");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (!topo->detail.nrank_continuous) {
+        ucg_info("Scan node-aware don't support discontinuous ranks of node");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return ucg_planc_ucx_scan_check(vgroup, args);
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_bcast_recv(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_algo_kntree_iter_t *iter = &scan->na.bcast;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    ucg_rank_t peer = ucg_algo_kntree_iter_parent_value(iter);
+    if (ucg_test_and_clear_flags(&op->flags, UCG_SCAN_NA_BCAST_RECV_POST)) {
+        status = ucg_planc_ucx_p2p_irecv(scan->na.inter.prefix, args->count, args->dt,
+                                         scan->rd.ranks[peer], op->tag,
+                                         op->super.vgroup, &params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+    UCG_CHECK_GOTO(status, out);
+    scan->na.inter.has_prefix = 1;
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_bcast_send(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_algo_kntree_iter_t *iter = &scan->na.bcast;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_rank_t peer;
+
+    if (ucg_test_and_clear_flags(&op->flags, UCG_SCAN_NA_BCAST_SEND_POST)) {
+        while ((peer = ucg_algo_kntree_iter_child_value(iter)) != UCG_INVALID_RANK) {
+            status = ucg_planc_ucx_p2p_isend(scan->na.inter.prefix, args->count, args->dt,
+                                             scan->rd.ranks[peer], op->tag,
+                                             op->super.vgroup, &params);
+            UCG_CHECK_GOTO(status, out);
+            ucg_algo_kntree_iter_child_inc(iter);
+        }
+    }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+
+out:
+    return status;
+}
+
+/* The leader reduces the inputs of its node, it's the input of the leaders exscan. */
+static ucg_status_t ucg_planc_ucx_scan_na_total(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_status_t status = UCG_OK;
+    const void *data = scan->input;
+
+    if (scan->rd.has_prefix) {
+        status = ucg_op_reduce3(args->op, scan->rd.prefix, (void*)scan->input,
+                                scan->na.total, args->count, args->dt);
+        data = scan->na.total;
+    }
+    ucg_planc_ucx_scan_rd_reset(&scan->na.inter, data);
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_finish(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_planc_ucx_scan_rd_t *local = &scan->rd;
+    ucg_planc_ucx_scan_rd_t *node = &scan->na.inter;
+    ucg_status_t status = UCG_OK;
+
+    if (scan->exclusive) {
+        if (local->has_prefix && node->has_prefix) {
+            status = ucg_op_reduce3(args->op, node->prefix, local->prefix, args->recvbuf,
+                                    args->count, args->dt);
+        } else if (local->has_prefix || node->has_prefix) {
+            status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                                   local->has_prefix ? local->prefix : node->prefix,
+                                   args->count, args->dt);
+        }
+        return status;
+    }
+
+    if (local->has_prefix) {
+        status = ucg_op_reduce3(args->op, local->prefix, (void*)scan->input, args->recvbuf,
+                                args->count, args->dt);
+    } else if (scan->input != args->recvbuf) {
+        status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                               scan->input, args->count, args->dt);
+    }
+    if (status == UCG_OK && node->has_prefix) {
+        status = ucg_op_reduce(args->op, node->prefix, args->recvbuf, args->count, args->dt);
+    }
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+
+    /* 1. scan in my node */
+    if (ucg_test_flags(op->flags, UCG_SCAN_NA_INTRA)) {
+        status = ucg_planc_ucx_scan_rd_progress(op, &scan->rd, UCG_SCAN_NA_INTRA_POST);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_SCAN_NA_INTRA);
+    }
+
+    /* 2. exscan among the leaders */
+    if (ucg_test_and_clear_flags(&op->flags, UCG_SCAN_NA_TOTAL)) {
+        status = ucg_planc_ucx_scan_na_total(op);
+        UCG_CHECK_GOTO(status, out);
+    }
+    if (ucg_test_flags(op->flags, UCG_SCAN_NA_INTER)) {
+        status = ucg_planc_ucx_scan_rd_progress(op, &scan->na.inter, UCG_SCAN_NA_INTER_POST);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_SCAN_NA_INTER);
+    }
+
+    /* 3. broadcast the prefix of my node */
+    if (ucg_test_flags(op->flags, UCG_SCAN_NA_BCAST_RECV)) {
+        status = ucg_planc_ucx_scan_na_bcast_recv(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_SCAN_NA_BCAST_RECV);
+    }
+    if (ucg_test_flags(op->flags, UCG_SCAN_NA_BCAST_SEND)) {
+        status = ucg_planc_ucx_scan_na_bcast_send(op);
+        UCG_CHECK_GOTO(status, out);
+        ucg_clear_flags(&op->flags, UCG_SCAN_NA_BCAST_SEND);
+    }
+
+    status = ucg_planc_ucx_scan_na_finish(op);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_op->super.args.scan.count == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    op->flags = UCG_SCAN_NA_INTRA | UCG_SCAN_NA_INTRA_POST;
+    if (scan->na.is_leader) {
+        op->flags |= UCG_SCAN_NA_LEADER_FLAGS;
+    } else if (scan->na.mynode > 0) {
+        op->flags |= UCG_SCAN_NA_MEMBER_FLAGS;
+    }
+    /* Nothing is before the first node, and a single rank node has no member. */
+    if (scan->na.mynode > 0 && scan->na.nlocal > 1) {
+        op->flags |= UCG_SCAN_NA_BCAST_FLAGS;
+        ucg_algo_kntree_iter_reset(&scan->na.bcast);
+    }
+    ucg_planc_ucx_scan_rd_reset(&scan->rd, scan->input);
+    scan->na.inter.has_prefix = 0;
+
+    status = ucg_planc_ucx_scan_na_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_na_op_init(ucg_planc_ucx_op_t *op,
+                                                  ucg_planc_ucx_scan_config_t *config)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t group_size = vgroup->size;
+    ucg_topo_t *topo = vgroup->group->topo;
+
+    scan->exclusive = ucg_planc_ucx_scan_is_exclusive(op->super.super.args.type);
+    scan->input = (args->sendbuf == UCG_IN_PLACE) ? args->recvbuf : args->sendbuf;
+
+    /* Ranks of a node are a block, the last rank of every block is the leader. */
+    int32_t nblock = 0;
+    int32_t mynode = 0;
+    ucg_rank_t start = 0;
+    int32_t last_node = -1;
+    for (ucg_rank_t rank = 0; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (node != last_node) {
+            ++nblock;
+            last_node = node;
+            if (rank <= myrank) {
+                mynode = nblock - 1;
+                start = rank;
+            }
+        }
+    }
+    int32_t nlocal = 0;
+    int32_t mynode_id = topo->detail.locations[ucg_rank_map_eval(&vgroup->rank_map,
+                                                                 myrank)].node_id;
+    for (ucg_rank_t rank = start; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        if (topo->detail.locations[group_rank].node_id != mynode_id) {
+            break;
+        }
+        ++nlocal;
+    }
+
+    ucg_rank_t myidx = myrank - start;
+    ucg_planc_ucx_scan_rd_t *intra = &scan->rd;
+    ucg_planc_ucx_scan_rd_t *inter = &scan->na.inter;
+    scan->na.mynode = mynode;
+    scan->na.is_leader = (myidx == nlocal - 1);
+    ucg_planc_ucx_scan_rd_init(intra, nlocal, myidx, NULL);
+    int is_proxy = (ucg_algo_rd_iter_type(&intra->iter) == UCG_ALGO_RD_ITER_PROXY);
+    if (scan->na.is_leader) {
+        ucg_planc_ucx_scan_rd_init(inter, nblock, mynode, NULL);
+        is_proxy |= (ucg_algo_rd_iter_type(&inter->iter) == UCG_ALGO_RD_ITER_PROXY);
+    }
+    scan->na.nlocal = nlocal;
+    if (nlocal > 1) {
+        ucg_algo_kntree_iter_init(&scan->na.bcast, nlocal, ucg_max(config->na_bcast_degree, 1),
+                                  nlocal - 1, myidx, 1);
+    }
+
+    /**
+     * partial, recv and extra are shared by both, then the prefixes and total.
+     * The ranks of my node and the leaders are in the scratch.
+     */
+    int64_t span = ucg_align_up_pow2(ucg_planc_ucx_scan_span(args->dt, args->count),
+                                     sizeof(void*));
+    int32_t nbuf = 4 + is_proxy + scan->na.is_leader;
+    ucg_rank_t *locals;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, span * nbuf,
+                                                       sizeof(ucg_rank_t) * (nlocal + nblock),
+                                                       (void**)&locals);
+    if (status != UCG_OK) {
+        return status;
+    }
+    uint8_t *staging_area = (uint8_t*)op->staging_area - args->dt->true_lb;
+    intra->partial = inter->partial = staging_area;
+    intra->recv = inter->recv = staging_area + span;
+    staging_area += 2 * span;
+    intra->extra = inter->extra = is_proxy ? staging_area : NULL;
+    staging_area += is_proxy * span;
+    intra->prefix = staging_area;
+    inter->prefix = staging_area + span;
+    scan->na.total = scan->na.is_leader ? staging_area + 2 * span : NULL;
+
+    ucg_rank_t *leaders = locals + nlocal;
+    for (int32_t i = 0; i < nlocal; ++i) {
+        locals[i] = start + i;
+    }
+    int32_t nleader = 0;
+    last_node = topo->detail.locations[ucg_rank_map_eval(&vgroup->rank_map, 0)].node_id;
+    for (ucg_rank_t rank = 1; rank < group_size; ++rank) {
+        ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, rank);
+        int32_t node = topo->detail.locations[group_rank].node_id;
+        if (node != last_node) {
+            leaders[nleader++] = rank - 1;
+            last_node = node;
+        }
+    }
+    leaders[nleader++] = group_size - 1;
+    intra->ranks = locals;
+    inter->ranks = leaders;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_scan_na_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                        ucg_vgroup_t *vgroup,
+                                                        const ucg_coll_args_t *args,
+                                                        ucg_planc_ucx_scan_config_t *config)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_scan_na_op_trigger,
+                                 ucg_planc_ucx_scan_na_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_scan_na_op_init(ucx_op, config);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize scan node-aware ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_scan_na_prepare(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_scan_na_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_scan_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, scan,
+                                                         UCG_COLL_TYPE_SCAN);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_scan_na_op_new(ucx_group, vgroup, args, config);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "scan.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_dt.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+/**
+ * Recursive doubling scan
+ *
+ * At step b, a rank exchanges the reduction of its subcube with the rank that
+ * differs in bit b, the received one is added to the prefix if it comes from
+ * a lower rank. Subcubes are ranges of ranks and they are combined in rank
+ * order, so non-commutative ops are supported.
+ *
+ * The prefix of exscan is the result, it's accumulated in recvbuf directly.
+ */
+
+enum {
+    UCG_SCAN_RD_POST = UCG_BIT(0),
+};
+
+static ucg_status_t ucg_planc_ucx_scan_rd_finish(ucg_planc_ucx_op_t *op)
+{
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_planc_ucx_scan_rd_t *rd = &scan->rd;
+
+    if (scan->exclusive) {
+        return UCG_OK;
+    }
+    if (rd->has_prefix) {
+        return ucg_op_reduce3(args->op, rd->prefix, (void*)scan->input, args->recvbuf,
+                              args->count, args->dt);
+    }
+    if (scan->input == args->recvbuf) {
+        return UCG_OK;
+    }
+    return ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
+                         scan->input, args->count, args->dt);
+}
+
+static ucg_status_t ucg_planc_ucx_scan_rd_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    status = ucg_planc_ucx_scan_rd_progress(op, &op->scan.rd, UCG_SCAN_RD_POST);
+    UCG_CHECK_GOTO(status, out);
+
+    status = ucg_planc_ucx_scan_rd_finish(op);
+
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_rd_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_reset(op);
+    if (ucg_op->super.args.scan.count == 0) {
+        op->super.super.status = UCG_OK;
+        return UCG_OK;
+    }
+    op->flags = UCG_SCAN_RD_POST;
+    ucg_planc_ucx_scan_rd_reset(&op->scan.rd, op->scan.input);
+
+    status = ucg_planc_ucx_scan_rd_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_scan_rd_op_init(ucg_planc_ucx_op_t *op)
+{
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_scan_args_t *args = &op->super.super.args.scan;
+    ucg_planc_ucx_scan_t *scan = &op->scan;
+    ucg_planc_ucx_scan_rd_t *rd = &scan->rd;
+
+    scan->exclusive = ucg_planc_ucx_scan_is_exclusive(op->super.super.args.type);
+    scan->input = (args->sendbuf == UCG_IN_PLACE) ? args->recvbuf : args->sendbuf;
+    ucg_planc_ucx_scan_rd_init(rd, vgroup->size, vgroup->myrank, NULL);
+
+    /* partial, recv, extra of the proxy and prefix of scan */
+    int64_t span = ucg_align_up_pow2(ucg_planc_ucx_scan_span(args->dt, args->count),
+                                     sizeof(void*));
+    int is_proxy = (ucg_algo_rd_iter_type(&rd->iter) == UCG_ALGO_RD_ITER_PROXY);
+    int32_t nbuf = 2 + is_proxy + !scan->exclusive;
+    ucg_status_t status = ucg_planc_ucx_op_get_staging(op, span * nbuf, 0, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+    uint8_t *staging_area = (uint8_t*)op->staging_area - args->dt->true_lb;
+    rd->partial = staging_area;
+    rd->recv = staging_area + span;
+    rd->extra = is_proxy ? staging_area + 2 * span : NULL;
+    rd->prefix = scan->exclusive ? args->recvbuf : staging_area + (2 + is_proxy) * span;
+    return UCG_OK;
+}
+
+static ucg_planc_ucx_op_t *ucg_planc_ucx_scan_rd_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                        ucg_vgroup_t *vgroup,
+                                                        const ucg_coll_args_t *args)
+{
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status;
+    status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                 ucg_planc_ucx_scan_rd_op_trigger,
+                                 ucg_planc_ucx_scan_rd_op_progress,
+                                 ucg_planc_ucx_op_discard,
+                                 args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+
+    status = ucg_planc_ucx_scan_rd_op_init(ucx_op);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize scan recursive doubling ucx op");
+        goto err_destruct;
+    }
+    return ucx_op;
+
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &ucx_op->super);
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_scan_rd_prepare(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_scan_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_scan_rd_op_new(ucx_group, vgroup, args);
+    if (ucx_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &ucx_op->super;
+    return UCG_OK;
+}
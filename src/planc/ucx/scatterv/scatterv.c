@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "scatterv.h"
@@ -14,10 +14,12 @@ static ucg_plan_attr_t ucg_planc_ucx_scatterv_plan_attr[] = {
      1, "Linear", PLAN_DOMAIN},
 
     {ucg_planc_ucx_scatterv_kntree_prepare,
-     2, "Knomial tree", PLAN_DOMAIN},
+     2, "Knomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {ucg_planc_ucx_scatterv_na_kntree_prepare,
-     3, "Node-aware K-nomial tree", PLAN_DOMAIN},
+     3, "Node-aware K-nomial tree", PLAN_DOMAIN,
+     .peers = UCG_PLANC_UCX_PREWIRE_PEERS_NODE_AWARE | UCG_PLANC_UCX_PREWIRE_PEERS_TREE},
 
     {NULL},
 };
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "scatterv.h"
@@ -242,9 +242,9 @@ static ucg_status_t ucg_planc_ucx_scatterv_kntree_op_params(ucg_planc_ucx_op_t *
                 int32_t idx = (myrank + i + 1) % group_size;
                 size += (int64_t)op->scatterv.kntree.sendcounts[idx] * op->scatterv.kntree.sdtype_size;
             }
-            op->staging_area = ucg_malloc(size, "scatterv kntree staging area");
-            if (op->staging_area == NULL) {
-                return UCG_ERR_NO_MEMORY;
+            status = ucg_planc_ucx_op_get_staging(op, size, 0, NULL);
+            if (status != UCG_OK) {
+                return status;
             }
         }
     }
@@ -316,18 +316,6 @@ static ucg_status_t ucg_planc_ucx_scatterv_kntree_op_trigger(ucg_plan_op_t *ucg_
     return status == UCG_INPROGRESS ? UCG_OK : status;
 }
 
-static inline ucg_status_t ucg_planc_ucx_scatterv_kntree_op_discard(ucg_plan_op_t *ucg_op)
-{
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    if (op->scatterv.kntree.sendcounts != NULL) {
-        ucg_free(op->scatterv.kntree.sendcounts);
-    }
-    if (op->scatterv.kntree.staging_displs != NULL) {
-        ucg_free(op->scatterv.kntree.staging_displs);
-    }
-    return ucg_planc_ucx_op_discard(ucg_op);
-}
-
 static inline
 ucg_status_t ucg_planc_ucx_scatterv_kntree_op_init(ucg_planc_ucx_op_t *op,
                                                    ucg_planc_ucx_group_t *ucx_group,
@@ -348,16 +336,14 @@ ucg_status_t ucg_planc_ucx_scatterv_kntree_op_init(ucg_planc_ucx_op_t *op,
     if (myrank == args->root) {
         op->scatterv.kntree.sdtype_size = ucg_dt_size(args->sendtype);
     } else {
-        op->scatterv.kntree.sendcounts = ucg_malloc((int64_t)group_size * sizeof(int32_t),
-                                             "scatterv sendcounts");
-        if (op->scatterv.kntree.sendcounts == NULL) {
-            return UCG_ERR_NO_MEMORY;
-        }
-        op->scatterv.kntree.staging_displs = ucg_malloc((int64_t)op->scatterv.kntree.staging_count * sizeof(int32_t),
-                                                 "scatterv staging_displs");
-        if (op->scatterv.kntree.staging_displs == NULL) {
-            return UCG_ERR_NO_MEMORY;
+        /* The sendcounts and staging displs are in the meta area. */
+        int64_t count = (int64_t)group_size + op->scatterv.kntree.staging_count;
+        ucg_status_t status = ucg_planc_ucx_op_get_meta(op, count * sizeof(int32_t));
+        if (status != UCG_OK) {
+            return status;
         }
+        op->scatterv.kntree.sendcounts = (int32_t*)op->meta_area;
+        op->scatterv.kntree.staging_displs = op->scatterv.kntree.sendcounts + group_size;
     }
     op->scatterv.kntree.first_trigger = 1;
 
@@ -379,7 +365,7 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_scatterv_kntree_op_new(ucg_planc_ucx_group_t *
     ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
                                               ucg_planc_ucx_scatterv_kntree_op_trigger,
                                               ucg_planc_ucx_scatterv_kntree_op_progress,
-                                              ucg_planc_ucx_scatterv_kntree_op_discard,
+                                              ucg_planc_ucx_op_discard,
                                               args);
     if (status != UCG_OK) {
         ucg_error("Failed to initialize super of ucx op");
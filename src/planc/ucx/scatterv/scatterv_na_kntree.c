@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2023-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023-2024. All rights reserved.
  */
 
 #include "scatterv.h"
@@ -65,23 +65,38 @@ enum {
                                           UCG_KNTREE_RECV_FROM_PARENT | \
                                           UCG_KNTREE_RECV_SENDBUF)
 
-#define ucg_planc_ucx_free_ptr(ptr) \
+/* The temporary buffers of every phase are from the staging cache of the group. */
+#define scatterv_put_ptr(ptr) \
     do { \
         if (*ptr) { \
-            ucg_free(*ptr); \
+            ucg_bufcache_put(*ptr); \
         } \
         *ptr = NULL; \
     } while(0)
 
+static inline void *scatterv_get_buf(ucg_planc_ucx_op_t *ucx_op, size_t size)
+{
+    return ucg_bufcache_get(&ucx_op->ucx_group->staging_cache, size);
+}
+
+static inline void *scatterv_get_zeroed_buf(ucg_planc_ucx_op_t *ucx_op, size_t size)
+{
+    void *buf = scatterv_get_buf(ucx_op, size);
+    if (buf != NULL) {
+        memset(buf, 0, size);
+    }
+    return buf;
+}
+
 static inline void scatterv_free_intra_sendbuf(ucg_coll_scatterv_args_t *inter_args,
                                                ucg_coll_scatterv_args_t *intra_args,
                                                ucg_planc_ucx_scatterv_na_kntree_args_t *na_args)
 {
     UCG_CHECK_NULL_VOID(inter_args, intra_args, na_args);
     if (na_args->node_leader_group->state == UCG_TOPO_GROUP_STATE_ENABLE) {
-        ucg_planc_ucx_free_ptr((void **)&inter_args->sendbuf);
+        scatterv_put_ptr((void **)&inter_args->sendbuf);
     } else {
-        ucg_planc_ucx_free_ptr((void **)&intra_args->sendbuf);
+        scatterv_put_ptr((void **)&intra_args->sendbuf);
     }
     return;
 }
@@ -92,9 +107,9 @@ static inline void scatterv_free_intra_sendcounts(ucg_coll_scatterv_args_t *inte
 {
     UCG_CHECK_NULL_VOID(inter_args, intra_args, na_args);
     if (na_args->node_leader_group->state == UCG_TOPO_GROUP_STATE_ENABLE) {
-        ucg_planc_ucx_free_ptr((void **)&inter_args->sendcounts);
+        scatterv_put_ptr((void **)&inter_args->sendcounts);
     } else {
-        ucg_planc_ucx_free_ptr((void **)&intra_args->sendcounts);
+        scatterv_put_ptr((void **)&intra_args->sendcounts);
     }
     return;
 }
@@ -105,8 +120,8 @@ static inline void scatterv_free_root_adjust_root(ucg_coll_scatterv_args_t *inte
 {
     UCG_CHECK_NULL_VOID(inter_args, args);
     if (myrank == args->root) {
-        ucg_planc_ucx_free_ptr((void **)&inter_args->sendbuf);
-        ucg_planc_ucx_free_ptr((void **)&inter_args->sendcounts);
+        scatterv_put_ptr((void **)&inter_args->sendbuf);
+        scatterv_put_ptr((void **)&inter_args->sendcounts);
     }
     return;
 }
@@ -114,14 +129,14 @@ static inline void scatterv_free_root_adjust_root(ucg_coll_scatterv_args_t *inte
 static inline void scatterv_free_temp_buf(ucg_planc_ucx_scatterv_na_kntree_args_t *na_args)
 {
     UCG_CHECK_NULL_VOID(na_args);
-    ucg_planc_ucx_free_ptr((void **)&na_args->displs);
-    ucg_planc_ucx_free_ptr((void **)&na_args->sendcounts);
+    scatterv_put_ptr((void **)&na_args->displs);
+    scatterv_put_ptr((void **)&na_args->sendcounts);
     return;
 }
 
 static inline void scatterv_free_buf(void **buf)
 {
-    ucg_planc_ucx_free_ptr(buf);
+    scatterv_put_ptr(buf);
     return;
 }
 
@@ -327,8 +342,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_intra_node_data_op_prepare(ucg_plan_o
             total_len += intra_args->sendcounts[i];
         }
         uint64_t total_bufsize = total_len * na_args->sdtype_size;
-        intra_args->sendbuf = ucg_malloc(total_bufsize,
-                                         "scatterv intra node data sendbuf");
+        intra_args->sendbuf = scatterv_get_buf(ucx_op, total_bufsize);
         if (intra_args->sendbuf == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -336,8 +350,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_intra_node_data_op_prepare(ucg_plan_o
     }
 
     /* intra group temp sendcounts */
-    na_args->sendcounts = ucg_calloc(nprocs, sizeof(int32_t),
-                                     "scatterv inter temp sendcounts");
+    na_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, nprocs * sizeof(int32_t));
     if (na_args->sendcounts == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
@@ -352,8 +365,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_intra_node_data_op_prepare(ucg_plan_o
     }
 
     /* intra group temp displs */
-    na_args->displs = ucg_calloc(nprocs, sizeof(int32_t),
-                                 "scatterv inter temp displs");
+    na_args->displs = scatterv_get_zeroed_buf(ucx_op, nprocs * sizeof(int32_t));
     if (na_args->displs == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
@@ -391,9 +403,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_intra_node_params_op_prepare(ucg_plan
         intra_args->sendcounts = inter_args->sendcounts + global_myrank;
         intra_args->sendtype = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
     } else {
-        intra_args->sendcounts = ucg_calloc(group_nprocs,
-                                            sizeof(int32_t),
-                                            "scatterv inter node sendcounts");
+        intra_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, group_nprocs * sizeof(int32_t));
         if (intra_args->sendcounts == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -421,8 +431,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_inter_node_data_op_prepare(ucg_plan_o
             total_len += inter_args->sendcounts[i];
         }
         uint64_t total_bufsize = total_len * na_args->sdtype_size;
-        inter_args->sendbuf = ucg_malloc(total_bufsize,
-                                         "scatterv inter node sendbuf");
+        inter_args->sendbuf = scatterv_get_buf(ucx_op, total_bufsize);
         if (inter_args->sendbuf == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -431,8 +440,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_inter_node_data_op_prepare(ucg_plan_o
 
     /* inter group temp sendcounts */
     ucg_algo_kntree_iter_reset(iter);
-    na_args->sendcounts = ucg_calloc(nnodes, sizeof(int32_t),
-                                     "scatterv inter temp sendcounts");
+    na_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, nnodes * sizeof(int32_t));
     if (na_args->sendcounts == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
@@ -448,8 +456,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_inter_node_data_op_prepare(ucg_plan_o
     }
 
     /* inter group temp displs */
-    na_args->displs = ucg_calloc(nnodes, sizeof(int32_t),
-                                 "scatterv inter temp displs");
+    na_args->displs = scatterv_get_zeroed_buf(ucx_op, nnodes * sizeof(int32_t));
     if (na_args->displs == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
@@ -482,9 +489,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_inter_node_params_op_prepare(ucg_plan
     ucg_algo_kntree_iter_init(iter, vgroup->size, config->na_kntree_inter_degree,
                               0, vgroup->myrank, 1);
     if (myrank != UCG_TOPO_GROUP_LEADER) {
-        inter_args->sendcounts = ucg_calloc(global_nprocs,
-                                            sizeof(int32_t),
-                                            "scatterv inter node sendcounts");
+        inter_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, global_nprocs * sizeof(int32_t));
         if (inter_args->sendcounts == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -508,8 +513,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_adjust_root_data_op_prepare(ucg_plan_
         uint64_t bufsize = ucx_op->scatterv.na_kntree.sdtype_size * total_count;
         /* rank 0 set sendbuf size */
         na_args->sendbuf_size = bufsize;
-        inter_args->sendbuf = ucg_malloc(bufsize,
-                                         "scatterv adjust root data sendbuf");
+        inter_args->sendbuf = scatterv_get_buf(ucx_op, bufsize);
         if (inter_args->sendbuf == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -526,9 +530,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_adjust_root_params_op_prepare(ucg_pla
     ucg_coll_scatterv_args_t *inter_args = &ucx_op->scatterv.na_kntree.scatterv_inter.scatterv;
     uint32_t group_size = ucx_op->scatterv.na_kntree.global_nprocs;
     if (myrank == UCG_TOPO_GROUP_LEADER) {
-        inter_args->sendcounts = ucg_calloc(group_size,
-                                            sizeof(int32_t),
-                                            "scatterv adjust root params sendcounts");
+        inter_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, group_size * sizeof(int32_t));
         if (inter_args->sendcounts == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -764,8 +766,7 @@ static ucg_status_t ucg_planc_ucx_scatterv_na_kntree_op_trigger(ucg_plan_op_t *u
             total_count += args->sendcounts[i];
         }
         uint32_t bufsize = sdt_size * total_count;
-        inter_args->sendbuf = ucg_malloc(bufsize,
-                                         "scatterv adjust root data sendbuffer");
+        inter_args->sendbuf = scatterv_get_buf(ucx_op, bufsize);
         if (inter_args->sendbuf == NULL) {
             return UCG_ERR_NO_MEMORY;
         }
@@ -781,8 +782,10 @@ static ucg_status_t ucg_planc_ucx_scatterv_na_kntree_op_trigger(ucg_plan_op_t *u
             offset += args->sendcounts[i];
         }
         /* set sendcounts */
-        inter_args->sendcounts = ucg_calloc(group_size, sizeof(int32_t),
-                                 "scatterv inter temp sendcounts");
+        inter_args->sendcounts = scatterv_get_zeroed_buf(ucx_op, group_size * sizeof(int32_t));
+        if (inter_args->sendcounts == NULL) {
+            return UCG_ERR_NO_MEMORY;
+        }
         ucg_dt_memcpy((int32_t *)inter_args->sendcounts, group_size,
                       ucg_dt_get_predefined(UCG_DT_TYPE_INT32),
                       args->sendcounts, group_size,
@@ -187,6 +187,10 @@ typedef enum {
     UCG_RANK_MAP_TYPE_ARRAY, /**< dst_rank = ranks[src_rank] */
     UCG_RANK_MAP_TYPE_STRIDE, /**< dst_rank = start + src_rank * stride */
     UCG_RANK_MAP_TYPE_CB, /**< dst_rank = mapping(arg, src_rank) */
+    UCG_RANK_MAP_TYPE_BLOCK_STRIDE, /**< dst_rank = start + (src_rank / block) * block_stride +
+                                         (src_rank % block) * stride */
+    UCG_RANK_MAP_TYPE_RUNS, /**< dst_rank = runs[i].dst_rank + (src_rank - runs[i].src_rank),
+                                 runs[i] is the last run that src_rank >= runs[i].src_rank */
 } ucg_rank_map_type_t;
 
 /**
@@ -237,7 +241,9 @@ typedef enum {
  * @brief Data types
  * @note This is a union set of data types supported by all platforms which means
  * some data types are not available with a particular memory type. In the unavailable
- * case, UCG will return UCG_ERR_UNSUPPORTED.
+ * case, UCG will return UCG_ERR_UNSUPPORTED. *
+ * @note Since API 26.0, UCG_DT_TYPE_BF16 and the pair types are before
+ * UCG_DT_TYPE_PREDEFINED_LAST, the values from it on are changed.
  */
 typedef enum {
     /* Intrinsic data types. */
@@ -252,6 +258,15 @@ typedef enum {
     UCG_DT_TYPE_FP16,
     UCG_DT_TYPE_FP32,
     UCG_DT_TYPE_FP64,
+    /* bfloat16, it is stored as uint16_t and reduced in float. */
+    UCG_DT_TYPE_BF16,
+    /* Value-index pairs for UCG_OP_TYPE_MAXLOC and UCG_OP_TYPE_MINLOC, the
+     * layout is struct {value_type value; int32_t index;} */
+    UCG_DT_TYPE_FP32_INT32,
+    UCG_DT_TYPE_FP64_INT32,
+    UCG_DT_TYPE_INT16_INT32,
+    UCG_DT_TYPE_INT32_INT32,
+    UCG_DT_TYPE_INT64_INT32,
     UCG_DT_TYPE_PREDEFINED_LAST,
 
     /* User-defined data type. */
@@ -275,7 +290,9 @@ typedef enum {
  * @note This is a union set of reduction operation types supported by all
  * platforms which means some reduction operation types are not available with
  * a particular data type using a particular memory type. In the unavailable
- * case, UCG will return UCG_ERR_UNSUPPORTED.
+ * case, UCG will return UCG_ERR_UNSUPPORTED. *
+ * @note Since API 26.0, the logical, bitwise and loc operations are before
+ * UCG_OP_TYPE_PREDEFINED_LAST, the values from it on are changed.
  */
 typedef enum {
     /* Intrinsic reduction operation. */
@@ -283,6 +300,16 @@ typedef enum {
     UCG_OP_TYPE_MIN,
     UCG_OP_TYPE_SUM,
     UCG_OP_TYPE_PROD,
+    /* Logical and bitwise operations, integer data types only. */
+    UCG_OP_TYPE_LAND,
+    UCG_OP_TYPE_LOR,
+    UCG_OP_TYPE_LXOR,
+    UCG_OP_TYPE_BAND,
+    UCG_OP_TYPE_BOR,
+    UCG_OP_TYPE_BXOR,
+    /* Value-index pair data types only, ties take the smaller index. */
+    UCG_OP_TYPE_MAXLOC,
+    UCG_OP_TYPE_MINLOC,
     UCG_OP_TYPE_PREDEFINED_LAST,
 
     /* User-defined reduction operation. */
@@ -329,6 +356,15 @@ typedef enum {
     UCG_REQUEST_INFO_FIELD_CB = UCG_BIT(1), /**< Request completion callback. */
 } ucg_request_info_field_t;
 
+/**
+ * @ingroup UCG_BASE
+ * @brief Run of continuous destination ranks
+ */
+typedef struct {
+    ucg_rank_t src_rank; /**< First source rank of the run. */
+    ucg_rank_t dst_rank; /**< Destination rank of the first source rank. */
+} ucg_rank_map_run_t;
+
 /**
  * @ingroup UCG_BASE
  * @brief Rank mapping
@@ -350,6 +386,18 @@ typedef struct {
             ucg_rank_t (*mapping)(void *arg, ucg_rank_t rank);
             void *arg;
         } cb;
+        /* UCG_RANK_MAP_TYPE_BLOCK_STRIDE */
+        struct {
+            ucg_rank_t start;
+            int32_t stride; /* between the ranks in a block */
+            uint32_t block; /* number of ranks in a block */
+            int32_t block_stride; /* between the first ranks of the blocks */
+        } blocked;
+        /* UCG_RANK_MAP_TYPE_RUNS, runs[0].src_rank is 0 and src_rank is ascending. */
+        struct {
+            ucg_rank_map_run_t *runs;
+            uint32_t num_runs;
+        } runs;
     };
 } ucg_rank_map_t;
 
@@ -1134,6 +1182,39 @@ ucg_status_t ucg_request_allreduce_init(const void *sendbuf, void *recvbuf,
                                         ucg_request_type_t nb,
                                         ucg_request_h *request);
 
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent reduce request.
+ *
+ * The request combines the elements provided in the send buffer of each process
+ * in the group, using the reduction operation, and returns the combined value in
+ * the receive buffer of the root.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf     Starting address of send buffer, UCG_IN_PLACE at
+ *                          root means that the input is taken from recvbuf
+ * @param [out] recvbuf     Starting address of receive buffer, only significant
+ *                          at root
+ * @param [in]  count       Number of elements in send buffer
+ * @param [in]  dt          Data type of elements of send buffer
+ * @param [in]  op          Operation
+ * @param [in]  root        Rank of root process
+ * @param [in]  group       Communication group
+ * @param [in]  info        Informations for creating request
+ * @param [in]  nb          Nonblocking or blocking request
+ * @param [out] request     Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_reduce_init(const void *sendbuf, void *recvbuf,
+                                     int32_t count, ucg_dt_h dt,
+                                     ucg_op_h op, ucg_rank_t root,
+                                     ucg_group_h group,
+                                     const ucg_request_info_t *info,
+                                     ucg_request_type_t nb,
+                                     ucg_request_h *request);
+
 /**
  * @ingroup UCG_REQUEST
  * @brief Create a persistent barrier request.
@@ -1291,6 +1372,157 @@ ucg_status_t ucg_request_allgatherv_init(const void *sendbuf, int sendcount,
                                          ucg_dt_h recvtype, ucg_group_h group,
                                          const ucg_request_info_t *info,
                                          ucg_request_type_t nb, ucg_request_h *request);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent reduce_scatter request.
+ *
+ * The request combines the elements provided in the send buffer of each process
+ * in the group, using the reduction operation, and scatters the result. The i-th
+ * process receives recvcounts[i] elements of the result, the blocks are taken
+ * in rank order.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf         Starting address of send buffer, UCG_IN_PLACE
+ *                              means that the input is taken from recvbuf
+ * @param [out] recvbuf         Starting address of receive buffer
+ * @param [in]  recvcounts      Non-negative integer array (of length group size)
+ *                              specifying the number of elements of the result
+ *                              distributed to each rank
+ * @param [in]  dt              Data type of elements of send buffer
+ * @param [in]  op              Operation
+ * @param [in]  group           Communication group
+ * @param [in]  info            Informations for creating request
+ * @param [in]  nb              Nonblocking or blocking request
+ * @param [out] request         Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_reduce_scatter_init(const void *sendbuf, void *recvbuf,
+                                             const int32_t *recvcounts, ucg_dt_h dt,
+                                             ucg_op_h op, ucg_group_h group,
+                                             const ucg_request_info_t *info,
+                                             ucg_request_type_t nb,
+                                             ucg_request_h *request);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent reduce_scatter_block request.
+ *
+ * Same as @ref ucg_request_reduce_scatter_init, except that every process
+ * receives a block of recvcount elements.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf         Starting address of send buffer, UCG_IN_PLACE
+ *                              means that the input is taken from recvbuf
+ * @param [out] recvbuf         Starting address of receive buffer
+ * @param [in]  recvcount       Number of elements in receive buffer
+ * @param [in]  dt              Data type of elements of send buffer
+ * @param [in]  op              Operation
+ * @param [in]  group           Communication group
+ * @param [in]  info            Informations for creating request
+ * @param [in]  nb              Nonblocking or blocking request
+ * @param [out] request         Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_reduce_scatter_block_init(const void *sendbuf, void *recvbuf,
+                                                   int32_t recvcount, ucg_dt_h dt,
+                                                   ucg_op_h op, ucg_group_h group,
+                                                   const ucg_request_info_t *info,
+                                                   ucg_request_type_t nb,
+                                                   ucg_request_h *request);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent scan request.
+ *
+ * The request performs an inclusive prefix reduction, the receive buffer of the
+ * process with rank i holds the reduction of the send buffers of ranks 0,...,i.
+ * The operands are combined in rank order, so non-commutative operations are
+ * supported.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf         Starting address of send buffer, UCG_IN_PLACE
+ *                              means that the input is taken from recvbuf
+ * @param [out] recvbuf         Starting address of receive buffer
+ * @param [in]  count           Number of elements in send buffer
+ * @param [in]  dt              Data type of elements of send buffer
+ * @param [in]  op              Operation
+ * @param [in]  group           Communication group
+ * @param [in]  info            Informations for creating request
+ * @param [in]  nb              Nonblocking or blocking request
+ * @param [out] request         Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_scan_init(const void *sendbuf, void *recvbuf, int32_t count,
+                                   ucg_dt_h dt, ucg_op_h op, ucg_group_h group,
+                                   const ucg_request_info_t *info,
+                                   ucg_request_type_t nb, ucg_request_h *request);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent exscan request.
+ *
+ * Same as @ref ucg_request_scan_init, except that the prefix reduction is
+ * exclusive, the receive buffer of rank i holds the reduction of the send
+ * buffers of ranks 0,...,i-1. The receive buffer of rank 0 is not modified.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf         Starting address of send buffer, UCG_IN_PLACE
+ *                              means that the input is taken from recvbuf
+ * @param [out] recvbuf         Starting address of receive buffer
+ * @param [in]  count           Number of elements in send buffer
+ * @param [in]  dt              Data type of elements of send buffer
+ * @param [in]  op              Operation
+ * @param [in]  group           Communication group
+ * @param [in]  info            Informations for creating request
+ * @param [in]  nb              Nonblocking or blocking request
+ * @param [out] request         Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_exscan_init(const void *sendbuf, void *recvbuf, int32_t count,
+                                     ucg_dt_h dt, ucg_op_h op, ucg_group_h group,
+                                     const ucg_request_info_t *info,
+                                     ucg_request_type_t nb, ucg_request_h *request);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Create a persistent allgather request.
+ *
+ * Same as @ref ucg_request_allgatherv_init, except that every process
+ * contributes the same number of elements, the block of the j-th process is
+ * placed at offset j * recvcount * extent(recvtype) of the recvbuf.
+ *
+ * @note The request supports "create once and start many times".
+ *
+ * @param [in]  sendbuf         Starting address of send buffer, UCG_IN_PLACE
+ *                              means that the input is taken from the block
+ *                              of the process in recvbuf
+ * @param [in]  sendcount       Number of elements in send buffer
+ * @param [in]  sendtype        Datatype of send buffer elements
+ * @param [out] recvbuf         Address of receive buffer
+ * @param [in]  recvcount       Number of elements received from any process
+ * @param [in]  recvtype        Datatype of receive buffer elements
+ * @param [in]  group           Communication group
+ * @param [in]  info            Informations for creating request
+ * @param [in]  nb              Nonblocking or blocking request
+ * @param [out] request         Collective request
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_request_allgather_init(const void *sendbuf, int32_t sendcount,
+                                        ucg_dt_h sendtype, void *recvbuf,
+                                        int32_t recvcount, ucg_dt_h recvtype,
+                                        ucg_group_h group, const ucg_request_info_t *info,
+                                        ucg_request_type_t nb, ucg_request_h *request);
+
 /**
  * @ingroup UCG_REQUEST
  * @brief Start the request.
@@ -1326,6 +1558,66 @@ ucg_status_t ucg_request_start(ucg_request_h request);
  */
 ucg_status_t ucg_request_test(ucg_request_h request);
 
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Start a batch of requests.
+ *
+ * It's the same as calling @ref ucg_request_start for every request in order,
+ * but the locking is shared by the requests of the same context.
+ *
+ * If UCG_FUSION_WINDOW of the configuration is not 0 (the default is 0),
+ * adjacent small allreduces of the same group, datatype and op on host memory
+ * are fused into one allreduce, see also UCG_FUSION_MAX_SIZE. Only the requests
+ * passed to one call are fused, the ones started by @ref ucg_request_start
+ * never are. Every process of the group must start the same sequence of
+ * requests for them to be fused alike. The fused requests are completed
+ * together, each with its own complete callback. The fused allreduce may run
+ * another plan than the separate ones, so the rounding of the results may
+ * differ. Starting the same requests together again reuses the fused
+ * allreduce until one of them is cleaned up.
+ *
+ * @param [in] count        Number of requests
+ * @param [in] requests     Collective requests
+ * @retval UCG_OK All the requests are started successfully.
+ * @retval Otherwise Failed to start a request, the requests before it are
+ *         started and the ones after it are not.
+ */
+ucg_status_t ucg_request_startall(uint32_t count, ucg_request_h *requests);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Test for the completion of a batch of requests.
+ *
+ * Every request is progressed like @ref ucg_request_test, but the underlying
+ * transports are progressed once for the whole batch rather than once per
+ * request. It works best when the requests of a group are adjacent.
+ *
+ * @param [in] count        Number of requests
+ * @param [in] requests     Collective requests, NULL ones are ignored
+ * @retval UCG_OK All the requests are completed successfully.
+ * @retval UCG_INPROGRESS Some requests have not been completed.
+ * @retval Otherwise A request has failed, which can only be cleanup through
+ *         @ref ucg_request_cleanup
+ */
+ucg_status_t ucg_request_testall(uint32_t count, ucg_request_h *requests);
+
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Wait for the completion of any request of a batch.
+ *
+ * The requests are progressed like @ref ucg_request_testall until one of them
+ * is not in progress. A request that is not started is treated as completed,
+ * so replace the handled requests with NULL before waiting again.
+ *
+ * @param [in]  count       Number of requests
+ * @param [in]  requests    Collective requests, NULL ones are ignored
+ * @param [out] index       Index of the completed request, -1 if all the
+ *                          requests are NULL
+ * @retval Status of the completed request, UCG_OK if all the requests are NULL.
+ */
+ucg_status_t ucg_request_waitany(uint32_t count, ucg_request_h *requests,
+                                 int32_t *index);
+
 /**
  * @ingroup UCG_REQUEST
  * @brief Free the request.
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_ATOMIC_H_
@@ -13,5 +13,12 @@
 #define ucg_atomic_sub64(_ptr, _val)          ucs_atomic_sub64(_ptr, _val)
 #define ucg_atomic_cswap8(_ptr, _compare, _swap)         ucs_atomic_cswap8(_ptr, _compare, _swap)
 #define ucg_atomic_bool_cswap8(_ptr, _compare, _swap)    ucs_atomic_bool_cswap8(_ptr, _compare, _swap)
+#define ucg_atomic_bool_cswap32(_ptr, _compare, _swap)   ucs_atomic_bool_cswap32(_ptr, _compare, _swap)
 #define ucg_atomic_bool_cswap64(_ptr, _compare, _swap)   ucs_atomic_bool_cswap64(_ptr, _compare, _swap)
+/* Pairs with ucg_atomic_store_release() to publish the data written before it. */
+#define ucg_atomic_load_acquire(_ptr)         __atomic_load_n(_ptr, __ATOMIC_ACQUIRE)
+#define ucg_atomic_store_release(_ptr, _val)  __atomic_store_n(_ptr, _val, __ATOMIC_RELEASE)
+/* Pointer variants, both are full barriers. */
+#define ucg_atomic_bool_cswap_ptr(_ptr, _compare, _swap) __sync_bool_compare_and_swap(_ptr, _compare, _swap)
+#define ucg_atomic_swap_ptr(_ptr, _val)       __atomic_exchange_n(_ptr, _val, __ATOMIC_SEQ_CST)
 #endif
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+#include "ucg_bufcache.h"
+#include "ucg_helper.h"
+#include "ucg_malloc.h"
+
+#define UCG_BUFCACHE_NO_CLASS (-1)
+
+/* The header keeps the buffer following it aligned to 16 bytes. */
+struct ucg_bufcache_elem {
+    ucg_bufcache_t *cache;
+    ucg_bufcache_elem_t *next;
+    int32_t class_idx;
+} __attribute__((aligned(16)));
+
+static inline int ucg_bufcache_class_index(size_t size)
+{
+    if (size <= UCG_BUFCACHE_MIN_SIZE) {
+        return 0;
+    }
+    /* ceil(log2(size)) - log2(UCG_BUFCACHE_MIN_SIZE) */
+    return 64 - __builtin_clzll(size - 1) - 6;
+}
+
+static inline size_t ucg_bufcache_class_size(int class_idx)
+{
+    return (size_t)UCG_BUFCACHE_MIN_SIZE << class_idx;
+}
+
+ucg_status_t ucg_bufcache_init(ucg_bufcache_t *cache, size_t max_size,
+                               uint32_t max_per_class, const char *name)
+{
+    UCG_CHECK_NULL_INVALID(cache, name);
+
+    memset(cache, 0, sizeof(*cache));
+    cache->max_size = max_per_class == 0 ? 0 : max_size;
+    cache->max_per_class = max_per_class;
+    cache->name = name;
+    return ucg_lock_init(&cache->lock, UCG_LOCK_TYPE_SPINLOCK);
+}
+
+void ucg_bufcache_cleanup(ucg_bufcache_t *cache)
+{
+    for (int i = 0; i < UCG_BUFCACHE_CLASSES; ++i) {
+        ucg_bufcache_class_t *cls = &cache->classes[i];
+        while (cls->head != NULL) {
+            ucg_bufcache_elem_t *elem = cls->head;
+            cls->head = elem->next;
+            ucg_free(elem);
+        }
+        cls->count = 0;
+    }
+    ucg_lock_destroy(&cache->lock);
+    return;
+}
+
+void *ucg_bufcache_get(ucg_bufcache_t *cache, size_t size)
+{
+    ucg_bufcache_elem_t *elem = NULL;
+    int class_idx = ucg_bufcache_class_index(size);
+
+    if (size > cache->max_size || class_idx >= UCG_BUFCACHE_CLASSES) {
+        elem = ucg_malloc(sizeof(ucg_bufcache_elem_t) + size, cache->name);
+        if (elem == NULL) {
+            return NULL;
+        }
+        elem->cache = cache;
+        elem->class_idx = UCG_BUFCACHE_NO_CLASS;
+        ucg_lock_enter(&cache->lock);
+        ++cache->stats.bypasses;
+        ucg_lock_leave(&cache->lock);
+        return elem + 1;
+    }
+
+    ucg_bufcache_class_t *cls = &cache->classes[class_idx];
+    ucg_lock_enter(&cache->lock);
+    elem = cls->head;
+    if (elem != NULL) {
+        cls->head = elem->next;
+        --cls->count;
+        ++cache->stats.hits;
+        ucg_lock_leave(&cache->lock);
+        return elem + 1;
+    }
+    ++cache->stats.misses;
+    ucg_lock_leave(&cache->lock);
+
+    elem = ucg_malloc(sizeof(ucg_bufcache_elem_t) + ucg_bufcache_class_size(class_idx),
+                      cache->name);
+    if (elem == NULL) {
+        return NULL;
+    }
+    elem->cache = cache;
+    elem->class_idx = class_idx;
+    return elem + 1;
+}
+
+void ucg_bufcache_put(void *buf)
+{
+    ucg_bufcache_elem_t *elem = (ucg_bufcache_elem_t*)buf - 1;
+    ucg_bufcache_t *cache = elem->cache;
+
+    if (elem->class_idx == UCG_BUFCACHE_NO_CLASS) {
+        ucg_free(elem);
+        return;
+    }
+
+    ucg_bufcache_class_t *cls = &cache->classes[elem->class_idx];
+    ucg_lock_enter(&cache->lock);
+    if (cls->count < cache->max_per_class) {
+        elem->next = cls->head;
+        cls->head = elem;
+        ++cls->count;
+        ucg_lock_leave(&cache->lock);
+        return;
+    }
+    ++cache->stats.evictions;
+    ucg_lock_leave(&cache->lock);
+    ucg_free(elem);
+    return;
+}
+
+void ucg_bufcache_get_stats(ucg_bufcache_t *cache, ucg_bufcache_stats_t *stats)
+{
+    ucg_lock_enter(&cache->lock);
+    *stats = cache->stats;
+    ucg_lock_leave(&cache->lock);
+    return;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_BUFCACHE_H_
+#define UCG_BUFCACHE_H_
+
+#include "ucg/api/ucg.h"
+#include "ucg_lock.h"
+
+/* Size of the smallest class, class i holds buffers of (UCG_BUFCACHE_MIN_SIZE << i) bytes */
+#define UCG_BUFCACHE_MIN_SIZE 64
+#define UCG_BUFCACHE_CLASSES  32
+
+typedef struct ucg_bufcache_elem ucg_bufcache_elem_t;
+
+typedef struct ucg_bufcache_stats {
+    uint64_t hits;      /**< Buffers got from the cache */
+    uint64_t misses;    /**< Buffers allocated because the class is empty */
+    uint64_t bypasses;  /**< Buffers allocated because they are too large */
+    uint64_t evictions; /**< Buffers freed because the class is full */
+} ucg_bufcache_stats_t;
+
+typedef struct ucg_bufcache_class {
+    ucg_bufcache_elem_t *head;
+    uint32_t count;
+} ucg_bufcache_class_t;
+
+/**
+ * @brief Cache of temporary buffers grouped by power-of-two size classes.
+ *
+ * Buffers returned by ucg_bufcache_put() are kept for the next
+ * ucg_bufcache_get() of the same class instead of being freed, so that
+ * repeated allocations of similar sizes do not go to the allocator.
+ */
+typedef struct ucg_bufcache {
+    ucg_lock_t lock;
+    /* Buffers larger than it are allocated and freed directly */
+    size_t max_size;
+    /* Maximum number of buffers kept in one class */
+    uint32_t max_per_class;
+    ucg_bufcache_class_t classes[UCG_BUFCACHE_CLASSES];
+    ucg_bufcache_stats_t stats;
+    const char *name;
+} ucg_bufcache_t;
+
+/**
+ * @brief Initialize a buffer cache.
+ *
+ * @param [in] cache            the buffer cache
+ * @param [in] max_size         buffers larger than it are not cached, 0 disables caching
+ * @param [in] max_per_class    the max number of buffers kept in one size class
+ * @param [in] name             the name of this cache, must be valid until cleanup
+ */
+ucg_status_t ucg_bufcache_init(ucg_bufcache_t *cache, size_t max_size,
+                               uint32_t max_per_class, const char *name);
+
+/**
+ * @brief Free all cached buffers.
+ * @note All buffers got from the cache must be put back before cleanup.
+ */
+void ucg_bufcache_cleanup(ucg_bufcache_t *cache);
+
+/**
+ * @brief Get a buffer of at least @a size bytes, aligned to 16 bytes.
+ *
+ * @return the buffer, NULL if failed.
+ */
+void *ucg_bufcache_get(ucg_bufcache_t *cache, size_t size);
+
+/**
+ * @brief Put a buffer got from ucg_bufcache_get() back to its cache.
+ */
+void ucg_bufcache_put(void *buf);
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+void ucg_bufcache_get_stats(ucg_bufcache_t *cache, ucg_bufcache_stats_t *stats);
+
+#endif
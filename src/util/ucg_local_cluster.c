@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "ucg_local_cluster.h"
+#include "ucg_malloc.h"
+#include "ucg_log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define UCG_LCLUSTER_SLOT_SIZE (64 * 1024)
+
+/* Shared by all ranks. In process mode, it is mapped before fork. */
+typedef struct ucg_lcluster_shm {
+    volatile uint32_t arrived;
+    volatile uint32_t sense;
+    volatile uint32_t failed;
+    uint32_t nranks;
+    uint32_t slot_size;
+    char slots[];
+} ucg_lcluster_shm_t;
+
+/* OOB state of one rank, it's the ucg_oob_group_t::group. */
+typedef struct ucg_lcluster_peer {
+    ucg_lcluster_shm_t *shm;
+    ucg_rank_t myrank;
+    uint32_t local_sense;
+} ucg_lcluster_peer_t;
+
+typedef struct ucg_lcluster_thread {
+    pthread_t tid;
+    ucg_rank_t myrank;
+    int ret;
+} ucg_lcluster_thread_t;
+
+/**
+ * State of the running cluster. The location and proc info callbacks have no
+ * user argument, so they have to be global. In process mode, every rank has
+ * its own copy after fork; in thread mode, all ranks share the same one.
+ */
+static struct {
+    ucg_lcluster_params_t params;
+    ucg_lcluster_shm_t *shm;
+    ucg_lcluster_func_t func;
+    void *arg;
+    /* Serialize config parsing and context initialization of rank threads. */
+    pthread_mutex_t init_lock;
+    /* Process information of all ranks, each takes proc_info_size bytes. */
+    uint8_t *proc_info;
+    uint32_t proc_info_size;
+} ucg_lcluster = {
+    .init_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void ucg_lcluster_set_failed(ucg_lcluster_shm_t *shm)
+{
+    __atomic_store_n(&shm->failed, 1, __ATOMIC_RELEASE);
+    return;
+}
+
+static ucg_status_t ucg_lcluster_peer_barrier(ucg_lcluster_peer_t *peer)
+{
+    ucg_lcluster_shm_t *shm = peer->shm;
+    uint32_t sense = peer->local_sense ^ 1;
+
+    peer->local_sense = sense;
+    if (__atomic_add_fetch(&shm->arrived, 1, __ATOMIC_ACQ_REL) == shm->nranks) {
+        __atomic_store_n(&shm->arrived, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&shm->sense, sense, __ATOMIC_RELEASE);
+        return UCG_OK;
+    }
+
+    while (__atomic_load_n(&shm->sense, __ATOMIC_ACQUIRE) != sense) {
+        if (__atomic_load_n(&shm->failed, __ATOMIC_ACQUIRE)) {
+            return UCG_ERR_IO_ERROR;
+        }
+        sched_yield();
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_lcluster_oob_allgather(const void *sendbuf, void *recvbuf,
+                                               int32_t count, void *group)
+{
+    ucg_lcluster_peer_t *peer = (ucg_lcluster_peer_t*)group;
+    ucg_lcluster_shm_t *shm = peer->shm;
+    char *myslot = shm->slots + (size_t)peer->myrank * shm->slot_size;
+    ucg_status_t status;
+
+    if (count == 0) {
+        return ucg_lcluster_peer_barrier(peer);
+    }
+
+    for (int32_t offset = 0; offset < count; offset += shm->slot_size) {
+        int32_t length = count - offset;
+        if (length > shm->slot_size) {
+            length = shm->slot_size;
+        }
+        memcpy(myslot, (const char*)sendbuf + offset, length);
+        status = ucg_lcluster_peer_barrier(peer);
+        if (status != UCG_OK) {
+            return status;
+        }
+        for (uint32_t i = 0; i < shm->nranks; ++i) {
+            memcpy((char*)recvbuf + (size_t)i * count + offset,
+                   shm->slots + (size_t)i * shm->slot_size, length);
+        }
+        /* Nobody may overwrite the slots before everyone has read them. */
+        status = ucg_lcluster_peer_barrier(peer);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_lcluster_barrier(ucg_lcluster_rank_t *rank)
+{
+    return ucg_lcluster_peer_barrier((ucg_lcluster_peer_t*)rank->oob_group.group);
+}
+
+void ucg_lcluster_get_location(const ucg_lcluster_params_t *params,
+                               ucg_rank_t rank, ucg_location_t *location)
+{
+    uint32_t ppn = params->ppn == 0 ? params->nranks : params->ppn;
+    uint32_t pps = params->pps == 0 ? ppn : params->pps;
+    uint32_t node_id = rank / ppn;
+
+    location->field_mask = UCG_LOCATION_FIELD_NODE_ID |
+                           UCG_LOCATION_FIELD_SOCKET_ID |
+                           UCG_LOCATION_FIELD_SUBNET_ID;
+    location->subnet_id = params->nps == 0 ? 0 : node_id / params->nps;
+    location->node_id = node_id;
+    location->socket_id = (rank % ppn) / pps;
+    return;
+}
+
+static ucg_status_t ucg_lcluster_location_cb(ucg_rank_t rank, ucg_location_t *location)
+{
+    ucg_lcluster_get_location(&ucg_lcluster.params, rank, location);
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_lcluster_proc_info_cb(ucg_rank_t rank, ucg_proc_info_t **proc)
+{
+    if (ucg_lcluster.proc_info == NULL) {
+        return UCG_ERR_NOT_FOUND;
+    }
+
+    const ucg_proc_info_t *info;
+    info = (const ucg_proc_info_t*)(ucg_lcluster.proc_info +
+                                    (size_t)rank * ucg_lcluster.proc_info_size);
+    /* The caller releases it by ucg_free_proc_info(). */
+    ucg_proc_info_t *copy = ucg_malloc(info->size, "lcluster proc info");
+    if (copy == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    memcpy(copy, info, info->size);
+    *proc = copy;
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_lcluster_exchange_proc_info(ucg_lcluster_rank_t *rank)
+{
+    ucg_lcluster_peer_t *peer = (ucg_lcluster_peer_t*)rank->oob_group.group;
+    ucg_status_t status = UCG_ERR_NO_MEMORY;
+
+    ucg_proc_info_t *local = ucg_get_allocated_local_proc_info(rank->context);
+    if (local == NULL) {
+        ucg_error("Rank %d failed to get local proc info", rank->myrank);
+        return UCG_ERR_NO_RESOURCE;
+    }
+    ucg_lcluster_get_location(&ucg_lcluster.params, rank->myrank, &local->location);
+
+    uint32_t *sizes = ucg_malloc(rank->size * sizeof(uint32_t), "lcluster sizes");
+    if (sizes == NULL) {
+        goto out_free_local;
+    }
+    status = ucg_lcluster_oob_allgather(&local->size, sizes, sizeof(uint32_t), peer);
+    if (status != UCG_OK) {
+        goto out_free_sizes;
+    }
+
+    uint32_t max_size = 0;
+    for (uint32_t i = 0; i < rank->size; ++i) {
+        max_size = sizes[i] > max_size ? sizes[i] : max_size;
+    }
+
+    status = UCG_ERR_NO_MEMORY;
+    uint8_t *sendbuf = ucg_calloc(1, max_size, "lcluster sendbuf");
+    uint8_t *all = ucg_malloc((size_t)max_size * rank->size, "lcluster proc table");
+    if (sendbuf == NULL || all == NULL) {
+        ucg_free(sendbuf);
+        ucg_free(all);
+        goto out_free_sizes;
+    }
+    memcpy(sendbuf, local, local->size);
+    status = ucg_lcluster_oob_allgather(sendbuf, all, max_size, peer);
+    ucg_free(sendbuf);
+    if (status != UCG_OK) {
+        ucg_free(all);
+        goto out_free_sizes;
+    }
+
+    /* Rank threads gathered the same table, only one of them is kept. */
+    if (ucg_lcluster.params.mode == UCG_LCLUSTER_MODE_PROCESS || rank->myrank == 0) {
+        ucg_lcluster.proc_info = all;
+        ucg_lcluster.proc_info_size = max_size;
+    } else {
+        ucg_free(all);
+    }
+    /* Make sure the table is published before anyone uses it. */
+    status = ucg_lcluster_peer_barrier(peer);
+
+out_free_sizes:
+    ucg_free(sizes);
+out_free_local:
+    ucg_free_proc_info(local);
+    return status;
+}
+
+static ucg_status_t ucg_lcluster_context_init(ucg_lcluster_rank_t *rank)
+{
+    ucg_status_t status;
+    ucg_config_h config;
+
+    pthread_mutex_lock(&ucg_lcluster.init_lock);
+    status = ucg_config_read(NULL, NULL, &config);
+    if (status != UCG_OK) {
+        ucg_error("Rank %d failed to read config, %s",
+                  rank->myrank, ucg_status_string(status));
+        goto out_unlock;
+    }
+
+    ucg_params_t params = {
+        .field_mask = UCG_PARAMS_FIELD_OOB_GROUP |
+                      UCG_PARAMS_FIELD_LOCATION_CB |
+                      UCG_PARAMS_FIELD_PROC_INFO_CB |
+                      UCG_PARAMS_FIELD_THREAD_MODE,
+        .oob_group = rank->oob_group,
+        .get_location = ucg_lcluster_location_cb,
+        .get_proc_info = ucg_lcluster_proc_info_cb,
+        .thread_mode = ucg_lcluster.params.thread_mode,
+    };
+    status = ucg_init(&params, config, &rank->context);
+    ucg_config_release(config);
+    if (status != UCG_OK) {
+        ucg_error("Rank %d failed to init context, %s",
+                  rank->myrank, ucg_status_string(status));
+    }
+
+out_unlock:
+    pthread_mutex_unlock(&ucg_lcluster.init_lock);
+    return status;
+}
+
+ucg_status_t ucg_lcluster_group_create(ucg_lcluster_rank_t *rank, uint32_t id,
+                                       ucg_group_h *group)
+{
+    ucg_group_params_t group_params = {
+        .field_mask = UCG_GROUP_PARAMS_FIELD_ID |
+                      UCG_GROUP_PARAMS_FIELD_SIZE |
+                      UCG_GROUP_PARAMS_FIELD_MYRANK |
+                      UCG_GROUP_PARAMS_FIELD_RANK_MAP |
+                      UCG_GROUP_PARAMS_FIELD_OOB_GROUP,
+        .id = id,
+        .size = rank->size,
+        .myrank = rank->myrank,
+        .rank_map = {
+            .type = UCG_RANK_MAP_TYPE_FULL,
+            .size = rank->size,
+        },
+        .oob_group = rank->oob_group,
+    };
+    ucg_status_t status = ucg_group_create(rank->context, &group_params, group);
+    if (status != UCG_OK) {
+        ucg_error("Rank %d failed to create group %u, %s",
+                  rank->myrank, id, ucg_status_string(status));
+    }
+    return status;
+}
+
+static ucg_status_t ucg_lcluster_rank_init(ucg_lcluster_rank_t *rank)
+{
+    ucg_status_t status;
+
+    status = ucg_lcluster_context_init(rank);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    status = ucg_lcluster_exchange_proc_info(rank);
+    if (status != UCG_OK) {
+        goto err_cleanup_context;
+    }
+
+    status = ucg_lcluster_group_create(rank, 0, &rank->group);
+    if (status != UCG_OK) {
+        goto err_cleanup_context;
+    }
+    return UCG_OK;
+
+err_cleanup_context:
+    ucg_cleanup(rank->context);
+    return status;
+}
+
+static int ucg_lcluster_rank_main(ucg_rank_t myrank)
+{
+    ucg_lcluster_peer_t peer = {
+        .shm = ucg_lcluster.shm,
+        .myrank = myrank,
+        .local_sense = 0,
+    };
+    ucg_lcluster_rank_t rank = {
+        .myrank = myrank,
+        .size = ucg_lcluster.params.nranks,
+        .oob_group = {
+            .allgather = ucg_lcluster_oob_allgather,
+            .myrank = myrank,
+            .size = ucg_lcluster.params.nranks,
+            .num_local_procs = ucg_lcluster.params.nranks,
+            .group = &peer,
+        },
+    };
+
+    if (ucg_lcluster_rank_init(&rank) != UCG_OK) {
+        ucg_lcluster_set_failed(peer.shm);
+        return -1;
+    }
+
+    int ret = ucg_lcluster.func(&rank, ucg_lcluster.arg);
+    if (ret != 0) {
+        ucg_lcluster_set_failed(peer.shm);
+    }
+    /* Keep peers alive until everyone has finished communication. */
+    if (ucg_lcluster_peer_barrier(&peer) != UCG_OK) {
+        ret = -1;
+    }
+    ucg_group_destroy(rank.group);
+    ucg_cleanup(rank.context);
+    return ret;
+}
+
+static void ucg_lcluster_release_proc_info()
+{
+    ucg_free(ucg_lcluster.proc_info);
+    ucg_lcluster.proc_info = NULL;
+    ucg_lcluster.proc_info_size = 0;
+    return;
+}
+
+static void ucg_lcluster_kill_all(pid_t *pids, uint32_t nranks)
+{
+    for (uint32_t i = 0; i < nranks; ++i) {
+        if (pids[i] > 0) {
+            kill(pids[i], SIGKILL);
+        }
+    }
+    return;
+}
+
+static int ucg_lcluster_process_main(ucg_rank_t myrank)
+{
+    ucg_global_params_t global_params = {
+        .field_mask = 0,
+    };
+    if (ucg_global_init(&global_params) != UCG_OK) {
+        ucg_lcluster_set_failed(ucg_lcluster.shm);
+        return -1;
+    }
+
+    int ret = ucg_lcluster_rank_main(myrank);
+    ucg_lcluster_release_proc_info();
+    ucg_global_cleanup();
+    return ret;
+}
+
+static ucg_status_t ucg_lcluster_run_processes()
+{
+    uint32_t nranks = ucg_lcluster.params.nranks;
+    ucg_status_t status = UCG_ERR_NO_MEMORY;
+
+    pid_t *pids = ucg_calloc(nranks, sizeof(pid_t), "lcluster pids");
+    if (pids == NULL) {
+        return status;
+    }
+
+    /* Flush before fork so that buffered output is not duplicated. */
+    fflush(stdout);
+    fflush(stderr);
+    status = UCG_OK;
+    for (uint32_t i = 0; i < nranks; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int ret = ucg_lcluster_process_main(i);
+            fflush(stdout);
+            _exit(ret == 0 ? 0 : 1);
+        }
+        if (pid < 0) {
+            ucg_error("Failed to fork rank %u, %s", i, strerror(errno));
+            ucg_lcluster_kill_all(pids, i);
+            status = UCG_ERR_NO_RESOURCE;
+            break;
+        }
+        pids[i] = pid;
+    }
+
+    /* Once a rank fails, the others may wait for it forever. */
+    for (uint32_t done = 0; done < nranks;) {
+        int wstatus;
+        pid_t pid = wait(&wstatus);
+        if (pid < 0) {
+            break;
+        }
+        for (uint32_t i = 0; i < nranks; ++i) {
+            if (pids[i] == pid) {
+                pids[i] = 0;
+                ++done;
+                break;
+            }
+        }
+        if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+            if (status == UCG_OK) {
+                ucg_error("Rank process %d failed, terminating the others", pid);
+            }
+            status = UCG_ERR_IO_ERROR;
+            ucg_lcluster_kill_all(pids, nranks);
+        }
+    }
+    ucg_free(pids);
+    return status;
+}
+
+static void *ucg_lcluster_thread_main(void *arg)
+{
+    ucg_lcluster_thread_t *thread = (ucg_lcluster_thread_t*)arg;
+    thread->ret = ucg_lcluster_rank_main(thread->myrank);
+    return NULL;
+}
+
+static ucg_status_t ucg_lcluster_run_threads()
+{
+    uint32_t nranks = ucg_lcluster.params.nranks;
+    ucg_status_t status;
+
+    ucg_lcluster_thread_t *threads = ucg_calloc(nranks, sizeof(ucg_lcluster_thread_t),
+                                                "lcluster threads");
+    if (threads == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_global_params_t global_params = {
+        .field_mask = 0,
+    };
+    status = ucg_global_init(&global_params);
+    if (status != UCG_OK) {
+        goto out_free_threads;
+    }
+
+    uint32_t created;
+    for (created = 0; created < nranks; ++created) {
+        threads[created].myrank = created;
+        int rc = pthread_create(&threads[created].tid, NULL,
+                                ucg_lcluster_thread_main, &threads[created]);
+        if (rc != 0) {
+            ucg_error("Failed to create rank thread %u, %s", created, strerror(rc));
+            ucg_lcluster_set_failed(ucg_lcluster.shm);
+            status = UCG_ERR_NO_RESOURCE;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < created; ++i) {
+        pthread_join(threads[i].tid, NULL);
+        if (threads[i].ret != 0) {
+            status = UCG_ERR_IO_ERROR;
+        }
+    }
+    ucg_lcluster_release_proc_info();
+    ucg_global_cleanup();
+
+out_free_threads:
+    ucg_free(threads);
+    return status;
+}
+
+ucg_status_t ucg_lcluster_run(const ucg_lcluster_params_t *params,
+                              ucg_lcluster_func_t func, void *arg)
+{
+    ucg_status_t status;
+
+    if (params->nranks == 0 || params->mode >= UCG_LCLUSTER_MODE_LAST) {
+        ucg_error("Invalid local cluster, nranks %u mode %d",
+                  params->nranks, params->mode);
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    ucg_lcluster.params = *params;
+    if (ucg_lcluster.params.ppn == 0) {
+        ucg_lcluster.params.ppn = params->nranks;
+    }
+    if (ucg_lcluster.params.pps == 0) {
+        ucg_lcluster.params.pps = ucg_lcluster.params.ppn;
+    }
+    ucg_lcluster.func = func;
+    ucg_lcluster.arg = arg;
+
+    size_t shm_size = sizeof(ucg_lcluster_shm_t) +
+                      (size_t)params->nranks * UCG_LCLUSTER_SLOT_SIZE;
+    ucg_lcluster_shm_t *shm;
+    if (params->mode == UCG_LCLUSTER_MODE_PROCESS) {
+        shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shm == MAP_FAILED) {
+            ucg_error("Failed to map %zu bytes, %s", shm_size, strerror(errno));
+            return UCG_ERR_NO_MEMORY;
+        }
+    } else {
+        shm = ucg_malloc(shm_size, "lcluster shm");
+        if (shm == NULL) {
+            return UCG_ERR_NO_MEMORY;
+        }
+    }
+    shm->arrived = 0;
+    shm->sense = 0;
+    shm->failed = 0;
+    shm->nranks = params->nranks;
+    shm->slot_size = UCG_LCLUSTER_SLOT_SIZE;
+    ucg_lcluster.shm = shm;
+
+    if (params->mode == UCG_LCLUSTER_MODE_PROCESS) {
+        status = ucg_lcluster_run_processes();
+        munmap(shm, shm_size);
+    } else {
+        status = ucg_lcluster_run_threads();
+        ucg_free(shm);
+    }
+    ucg_lcluster.shm = NULL;
+    return status;
+}
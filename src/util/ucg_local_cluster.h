@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_LOCAL_CLUSTER_H_
+#define UCG_LOCAL_CLUSTER_H_
+
+#include "ucg/api/ucg.h"
+
+/**
+ * A local cluster runs several UCG ranks on one host without any external
+ * launcher. The OOB allgather is implemented over shared memory and the
+ * location of every rank is synthesized from the configured topology, so one
+ * host can pretend to be a cluster of many nodes and sockets.
+ */
+
+typedef enum ucg_lcluster_mode {
+    UCG_LCLUSTER_MODE_PROCESS, /**< Every rank is a forked process. */
+    UCG_LCLUSTER_MODE_THREAD, /**< Every rank is a thread with its own context. */
+    UCG_LCLUSTER_MODE_LAST,
+} ucg_lcluster_mode_t;
+
+typedef struct ucg_lcluster_params {
+    ucg_lcluster_mode_t mode;
+    uint32_t nranks;
+    /** Ranks per synthetic node, 0 means all ranks are on one node. */
+    uint32_t ppn;
+    /** Ranks per synthetic socket, 0 means one socket per node. */
+    uint32_t pps;
+    /** Nodes per synthetic subnet, 0 means all nodes are in one subnet. */
+    uint32_t nps;
+    /** Thread mode of the context of every rank. */
+    ucg_thread_mode_t thread_mode;
+} ucg_lcluster_params_t;
+
+/** Communication environment of one rank. */
+typedef struct ucg_lcluster_rank {
+    ucg_rank_t myrank;
+    uint32_t size;
+    ucg_oob_group_t oob_group;
+    ucg_context_h context;
+    /** Group of all ranks, the id is 0. */
+    ucg_group_h group;
+} ucg_lcluster_rank_t;
+
+/**
+ * @brief Routine of one rank.
+ * @return 0 for success, otherwise failure.
+ */
+typedef int (*ucg_lcluster_func_t)(ucg_lcluster_rank_t *rank, void *arg);
+
+/**
+ * @brief Launch a local cluster and run @a func in every rank.
+ *
+ * Every rank gets its own context and a group of all ranks before @a func is
+ * invoked, and they are released after all ranks return from @a func.
+ * In process mode, ucg_global_init() is invoked by every rank; in thread mode,
+ * it is invoked once by the caller. Only one local cluster can be running at
+ * a time.
+ *
+ * @note In process mode, the other ranks are killed once a rank fails. In thread
+ *       mode, the failure is only propagated through ucg_lcluster_barrier(),
+ *       ranks blocked in collective operations with the failed one may hang.
+ *
+ * @param [in] params       Parameters of the cluster
+ * @param [in] func         Routine of every rank
+ * @param [in] arg          Argument passed to @a func
+ * @return UCG_OK if all ranks succeed, otherwise error.
+ */
+ucg_status_t ucg_lcluster_run(const ucg_lcluster_params_t *params,
+                              ucg_lcluster_func_t func, void *arg);
+
+/**
+ * @brief Barrier of all ranks over the shared-memory OOB.
+ * @return UCG_OK for success, UCG_ERR_IO_ERROR if any rank has failed.
+ */
+ucg_status_t ucg_lcluster_barrier(ucg_lcluster_rank_t *rank);
+
+/**
+ * @brief Create another group of all ranks.
+ *
+ * It's a collective operation of all ranks, and the OOB of a rank must not be
+ * used by several threads at the same time.
+ *
+ * @param [in]  rank        The rank
+ * @param [in]  id          Group id, must be unique and not 0
+ * @param [out] group       The group, destroyed by ucg_group_destroy()
+ */
+ucg_status_t ucg_lcluster_group_create(ucg_lcluster_rank_t *rank, uint32_t id,
+                                       ucg_group_h *group);
+
+/**
+ * @brief Synthesized location of the rank.
+ */
+void ucg_lcluster_get_location(const ucg_lcluster_params_t *params,
+                               ucg_rank_t rank, ucg_location_t *location);
+
+#endif
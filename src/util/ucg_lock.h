@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_LOCK_H_
@@ -94,6 +94,21 @@ static inline void ucg_lock_enter(ucg_lock_t *lock)
     return;
 }
 
+/* 1 for lock success, 0 for failed */
+static inline int ucg_lock_try_enter(ucg_lock_t *lock)
+{
+    if (lock->type == UCG_LOCK_TYPE_NONE) {
+        return 1;
+    }
+
+    if (lock->type == UCG_LOCK_TYPE_SPINLOCK) {
+        return ucg_recursive_spin_trylock(&lock->spinlock);
+    }
+
+    ucg_assert(lock->type == UCG_LOCK_TYPE_MUTEX);
+    return pthread_mutex_trylock(&lock->mutex) == 0;
+}
+
 static inline void ucg_lock_leave(ucg_lock_t *lock)
 {
     if (lock->type == UCG_LOCK_TYPE_NONE) {
@@ -113,6 +128,7 @@ static inline void ucg_lock_leave(ucg_lock_t *lock)
 #define ucg_lock_init(_lock, _type) ({UCG_UNUSED(_lock, _type); UCG_OK;})
 #define ucg_lock_destroy(_lock) UCG_UNUSED(_lock)
 #define ucg_lock_enter(_lock) UCG_UNUSED(_lock)
+#define ucg_lock_try_enter(_lock) ({UCG_UNUSED(_lock); 1;})
 #define ucg_lock_leave(_lock) UCG_UNUSED(_lock)
 #endif //UCG_ENABLE_MT
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_LOG_H_
@@ -42,6 +42,9 @@ void ucg_log_configure(ucg_log_level_t max_level, const char *prefix);
  */
 ucs_log_component_config_t *ucg_log_component();
 
+/* Check whether the log level is enabled, use it to avoid building costly log arguments */
+#define ucg_log_is_enabled(_level) ucs_log_component_is_enabled(_level, ucg_log_component())
+
 #define ucg_log_detail(_level, _fmt, ...) ucs_log_component(_level, ucg_log_component(), _fmt, ##__VA_ARGS__)
 
 #define ucg_fatal(_fmt, ...)    ucg_log_detail(UCS_LOG_LEVEL_FATAL, _fmt, ##__VA_ARGS__)
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_MPSC_QUEUE_H_
+#define UCG_MPSC_QUEUE_H_
+
+#include "ucg_atomic.h"
+
+#include <stddef.h>
+
+/**
+ * Intrusive lock-free queue of multiple producers and a single consumer.
+ *
+ * Producers push elements one by one, the consumer takes all pushed elements
+ * at once. Since elements are never popped one by one, there is no ABA
+ * problem. The consumer must be serialized by the caller.
+ */
+
+typedef struct ucg_mpsc_elem {
+    struct ucg_mpsc_elem *next;
+} ucg_mpsc_elem_t;
+
+typedef struct ucg_mpsc_queue {
+    /* The last pushed element, the elements are linked in reverse order */
+    ucg_mpsc_elem_t *tail;
+} ucg_mpsc_queue_t;
+
+static inline void ucg_mpsc_queue_init(ucg_mpsc_queue_t *queue)
+{
+    queue->tail = NULL;
+    return;
+}
+
+static inline int ucg_mpsc_queue_is_empty(ucg_mpsc_queue_t *queue)
+{
+    return ucg_atomic_load_acquire(&queue->tail) == NULL;
+}
+
+/* Can be called by any thread. */
+static inline void ucg_mpsc_queue_push(ucg_mpsc_queue_t *queue, ucg_mpsc_elem_t *elem)
+{
+    ucg_mpsc_elem_t *tail;
+    do {
+        tail = ucg_atomic_load_acquire(&queue->tail);
+        elem->next = tail;
+    } while (!ucg_atomic_bool_cswap_ptr(&queue->tail, tail, elem));
+    return;
+}
+
+/**
+ * @brief Take all elements out of the queue.
+ *
+ * @return the first pushed element, the others follow it through
+ *         @ref ucg_mpsc_elem_t::next in push order, NULL if the queue is empty.
+ */
+static inline ucg_mpsc_elem_t *ucg_mpsc_queue_pull_all(ucg_mpsc_queue_t *queue)
+{
+    if (ucg_mpsc_queue_is_empty(queue)) {
+        return NULL;
+    }
+
+    ucg_mpsc_elem_t *elem = ucg_atomic_swap_ptr(&queue->tail, NULL);
+    ucg_mpsc_elem_t *head = NULL;
+    while (elem != NULL) {
+        ucg_mpsc_elem_t *next = elem->next;
+        elem->next = head;
+        head = elem;
+        elem = next;
+    }
+    return head;
+}
+
+#endif
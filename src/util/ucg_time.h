@@ -1,11 +1,13 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #ifndef UCG_TIME_H_
 #define UCG_TIME_H_
 
 #include <sys/time.h>
+#include <stdint.h>
+#include <time.h>
 
 /**
  * @brief return the micro-seconds(us) of now
@@ -19,4 +21,16 @@ static inline uint64_t ucg_get_time_us()
     return tv.tv_sec * factor + tv.tv_usec;
 }
 
+/**
+ * @brief return the nano-seconds(ns) of the monotonic clock
+ */
+static inline uint64_t ucg_get_time_ns()
+{
+    static uint64_t factor = 1000000000;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * factor + ts.tv_nsec;
+}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include <gtest/gtest.h>
@@ -275,6 +275,79 @@ TEST_F(test_ucg_context, init_fail_no_required_planc)
     ucg_config_release(config);
 }
 
+TEST_F(test_ucg_context, progress_thread)
+{
+    ucg_config_h config;
+    ASSERT_EQ(ucg_config_read(NULL, NULL, &config), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PLANC", "fake,fake2"), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PROGRESS_THREAD", "y"), UCG_OK);
+
+    ucg_context_h context;
+#ifdef UCG_ENABLE_MT
+    ASSERT_EQ(ucg_config_modify(config, "PROGRESS_THREAD_CORE", "0"), UCG_OK);
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_OK);
+    // The progress thread needs the locks of multi-thread mode.
+    ASSERT_EQ(context->thread_mode, UCG_THREAD_MODE_MULTI);
+    ASSERT_TRUE(context->progress_thread.enable);
+    // The application can still progress the context by itself.
+    ucg_progress(context);
+    // expect the thread is joined.
+    ucg_cleanup(context);
+#else
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_ERR_INVALID_PARAM);
+#endif
+
+    ucg_config_release(config);
+}
+
+TEST_F(test_ucg_context, plan_tune_file)
+{
+    char file[] = "/tmp/ucg_gtest_plan_tune_XXXXXX";
+    int fd = mkstemp(file);
+    ASSERT_NE(fd, -1);
+    FILE *stream = fdopen(fd, "w");
+    ASSERT_TRUE(stream != NULL);
+    fprintf(stream, "# comment\n");
+    fprintf(stream, "allreduce host 4 1024 3 ucx\n");
+    fprintf(stream, "invalid line\n");
+    fclose(stream);
+
+    ucg_config_h config;
+    ASSERT_EQ(ucg_config_read(NULL, NULL, &config), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PLANC", "fake,fake2"), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PLAN_TUNE", "y"), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PLAN_TUNE_FILE", file), UCG_OK);
+
+    ucg_context_h context;
+    // expect the invalid line is ignored.
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_OK);
+    ASSERT_TRUE(context->plan_tune.enable);
+    // expect the loaded results are saved by rank 0.
+    remove(file);
+    ucg_cleanup(context);
+
+    stream = fopen(file, "r");
+    ASSERT_TRUE(stream != NULL);
+    char line[128];
+    int found = 0;
+    while (fgets(line, sizeof(line), stream) != NULL) {
+        if (line[0] != '#') {
+            ASSERT_STREQ(line, "allreduce host 4 1024 3 ucx\n");
+            ++found;
+        }
+    }
+    fclose(stream);
+    ASSERT_EQ(found, 1);
+
+    // expect a missing file is fine.
+    remove(file);
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_OK);
+    ucg_cleanup(context);
+    remove(file);
+
+    ucg_config_release(config);
+}
+
 #ifdef UCG_ENABLE_CHECK_PARAMS
 TEST_F(test_ucg_context, cleanup_invalid_args)
 {
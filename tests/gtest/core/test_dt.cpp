@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include <gtest/gtest.h>
@@ -201,6 +201,25 @@ ucg_dt_h test_ucg_dt::m_ucg_contig_dt = NULL;
         free(expect); \
     } while (0)
 
+#define CHECK_ALL_INT(_ucg_op_type, _expect_op) \
+    do { \
+        uint32_t size = 1024; \
+        void *source = malloc(size); \
+        void *target = malloc(size); \
+        void *expect = malloc(size); \
+        CHECK(int8_t, _ucg_op_type, UCG_DT_TYPE_INT8, source, target, expect, size, _expect_op); \
+        CHECK(int16_t, _ucg_op_type, UCG_DT_TYPE_INT16, source, target, expect, size, _expect_op); \
+        CHECK(int32_t, _ucg_op_type, UCG_DT_TYPE_INT32, source, target, expect, size, _expect_op); \
+        CHECK(int64_t, _ucg_op_type, UCG_DT_TYPE_INT64, source, target, expect, size, _expect_op); \
+        CHECK(uint8_t, _ucg_op_type, UCG_DT_TYPE_UINT8, source, target, expect, size, _expect_op); \
+        CHECK(uint16_t, _ucg_op_type, UCG_DT_TYPE_UINT16, source, target, expect, size, _expect_op); \
+        CHECK(uint32_t, _ucg_op_type, UCG_DT_TYPE_UINT32, source, target, expect, size, _expect_op); \
+        CHECK(uint64_t, _ucg_op_type, UCG_DT_TYPE_UINT64, source, target, expect, size, _expect_op); \
+        free(source); \
+        free(target); \
+        free(expect); \
+    } while (0)
+
 typedef struct {
     const char *type;
 } user_op_t;
@@ -219,6 +238,42 @@ namespace {
     {
         return a * b;
     }
+
+    template<typename T>
+    T land(T a, T b)
+    {
+        return a && b;
+    }
+
+    template<typename T>
+    T lor(T a, T b)
+    {
+        return a || b;
+    }
+
+    template<typename T>
+    T lxor(T a, T b)
+    {
+        return !a != !b;
+    }
+
+    template<typename T>
+    T band(T a, T b)
+    {
+        return a & b;
+    }
+
+    template<typename T>
+    T bor(T a, T b)
+    {
+        return a | b;
+    }
+
+    template<typename T>
+    T bxor(T a, T b)
+    {
+        return a ^ b;
+    }
 }
 
 static ucg_status_t non_contig_dt_sum(void *op, const void *source, void *target, int32_t count, void *dt)
@@ -721,6 +776,72 @@ TEST_F(test_ucg_op, prod)
     CHECK_ALL(UCG_OP_TYPE_PROD, prod);
 }
 
+TEST_F(test_ucg_op, logical)
+{
+    CHECK_ALL_INT(UCG_OP_TYPE_LAND, land);
+    CHECK_ALL_INT(UCG_OP_TYPE_LOR, lor);
+    CHECK_ALL_INT(UCG_OP_TYPE_LXOR, lxor);
+}
+
+TEST_F(test_ucg_op, bitwise)
+{
+    CHECK_ALL_INT(UCG_OP_TYPE_BAND, band);
+    CHECK_ALL_INT(UCG_OP_TYPE_BOR, bor);
+    CHECK_ALL_INT(UCG_OP_TYPE_BXOR, bxor);
+}
+
+TEST_F(test_ucg_op, loc)
+{
+    typedef struct {
+        float value;
+        int32_t index;
+    } fp32_int32_t;
+    const int count = 4;
+    fp32_int32_t source[count] = {{1, 0}, {2, 1}, {3, 2}, {2, 4}};
+    fp32_int32_t max[count] = {{2, 1}, {2, 2}, {2, 3}, {2, 3}};
+    fp32_int32_t min[count];
+    memcpy(min, max, sizeof(max));
+    // Ties take the smaller index.
+    fp32_int32_t expect_max[count] = {{2, 1}, {2, 1}, {3, 2}, {2, 3}};
+    fp32_int32_t expect_min[count] = {{1, 0}, {2, 1}, {2, 3}, {2, 3}};
+
+    ucg_dt_t *dt = m_ucg_dt_predefined[UCG_DT_TYPE_FP32_INT32];
+    ucg_status_t status;
+    status = ucg_op_reduce(m_ucg_op_predefined[UCG_OP_TYPE_MAXLOC], source, max, count, dt);
+    ASSERT_EQ(status, UCG_OK);
+    status = ucg_op_reduce(m_ucg_op_predefined[UCG_OP_TYPE_MINLOC], source, min, count, dt);
+    ASSERT_EQ(status, UCG_OK);
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(max[i].value, expect_max[i].value) << i;
+        ASSERT_EQ(max[i].index, expect_max[i].index) << i;
+        ASSERT_EQ(min[i].value, expect_min[i].value) << i;
+        ASSERT_EQ(min[i].index, expect_min[i].index) << i;
+    }
+}
+
+TEST_F(test_ucg_op, bf16)
+{
+    // 1.5, 2.0 and 0.00390625 (2^-8) in bfloat16.
+    uint16_t source[3] = {0x3fc0, 0x4000, 0x3b80};
+    uint16_t target[3] = {0x3fc0, 0x4000, 0x3f80};
+    // 3.0, 4.0, and 1.00390625 rounded to even 1.0.
+    uint16_t expect[3] = {0x4040, 0x4080, 0x3f80};
+    ucg_status_t status = ucg_op_reduce(m_ucg_op_predefined[UCG_OP_TYPE_SUM], source, target, 3,
+                                        m_ucg_dt_predefined[UCG_DT_TYPE_BF16]);
+    ASSERT_EQ(status, UCG_OK);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(target[i], expect[i]) << i;
+    }
+}
+
+TEST_F(test_ucg_op, unsupported_dt)
+{
+    float source = 1, target = 1;
+    ucg_status_t status = ucg_op_reduce(m_ucg_op_predefined[UCG_OP_TYPE_BAND], &source, &target,
+                                        1, m_ucg_dt_predefined[UCG_DT_TYPE_FP32]);
+    ASSERT_EQ(status, UCG_ERR_UNSUPPORTED);
+}
+
 TEST_F(test_ucg_op, user)
 {
     const int count = 12;
@@ -742,4 +863,57 @@ TEST_F(test_ucg_op, user)
         ASSERT_EQ(expect[i].data1, target[i].data1);
         ASSERT_EQ(expect[i].data2, target[i].data2);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(test_ucg_op, reduce3)
+{
+    const int count = 100;
+    int32_t a[count], b[count], dst[count];
+    for (int i = 0; i < count; ++i) {
+        a[i] = i;
+        b[i] = 2 * i;
+        dst[i] = -1;
+    }
+    ucg_op_t *op = m_ucg_op_predefined[UCG_OP_TYPE_SUM];
+    ucg_dt_t *dt = m_ucg_dt_predefined[UCG_DT_TYPE_INT32];
+
+    // dst is another buffer, a and b are not changed.
+    ASSERT_EQ(ucg_op_reduce3(op, a, b, dst, count, dt), UCG_OK);
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(dst[i], 3 * i);
+        ASSERT_EQ(a[i], i);
+        ASSERT_EQ(b[i], 2 * i);
+    }
+
+    // dst is a or b.
+    ASSERT_EQ(ucg_op_reduce3(op, a, b, b, count, dt), UCG_OK);
+    ASSERT_EQ(ucg_op_reduce3(op, b, a, a, count, dt), UCG_OK);
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(b[i], 3 * i);
+        ASSERT_EQ(a[i], 4 * i);
+    }
+}
+
+TEST_F(test_ucg_op, reduce3_user)
+{
+    const int count = 12;
+    non_contig_dt_t a[count];
+    non_contig_dt_t b[count];
+    for (int i = 0; i < count; ++i) {
+        a[i].data1 = i;
+        a[i].data2 = i + 1;
+        b[i].data1 = i + 2;
+        b[i].data2 = i + 3;
+    }
+
+    ucg_status_t status = ucg_op_reduce3(m_ucg_op_user, a, b, b, count, m_ucg_dt_user);
+    ASSERT_EQ(status, UCG_OK);
+    status = ucg_op_reduce3(m_ucg_op_user, a, b, a, count, m_ucg_dt_user);
+    ASSERT_EQ(status, UCG_OK);
+    for (int i = 0; i < count; ++i) {
+        ASSERT_EQ(b[i].data1, 2 * i + 2);
+        ASSERT_EQ(b[i].data2, 2 * i + 4);
+        ASSERT_EQ(a[i].data1, 3 * i + 2);
+        ASSERT_EQ(a[i].data2, 3 * i + 5);
+    }
+}
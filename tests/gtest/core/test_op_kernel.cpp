@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "core/ucg_op_kernel.h"
+}
+
+static const char *g_op_names[UCG_OP_TYPE_PREDEFINED_LAST] = {
+    "max", "min", "sum", "prod", "land", "lor", "lxor", "band", "bor", "bxor",
+    "maxloc", "minloc",
+};
+static const char *g_dt_names[UCG_DT_TYPE_PREDEFINED_LAST] = {
+    "int8", "int16", "int32", "int64", "uint8", "uint16", "uint32", "uint64",
+    "fp16", "fp32", "fp64", "bf16", "fp32i32", "fp64i32", "i16i32", "i32i32", "i64i32",
+};
+static const size_t g_dt_sizes[UCG_DT_TYPE_PREDEFINED_LAST] = {
+    1, 2, 4, 8, 1, 2, 4, 8, 2, 4, 8, 2, 8, 16, 8, 8, 16,
+};
+
+template <typename T>
+struct pair_t {
+    T value;
+    int32_t index;
+};
+
+template <typename T>
+static void fill(void *buffer, int32_t count)
+{
+    T *p = (T*)buffer;
+    for (int32_t i = 0; i < count; ++i) {
+        // Small values keep the products of floating-point numbers finite.
+        p[i] = (T)(rand() % 7 - 3);
+    }
+}
+
+template <typename T>
+static void fill_pair(void *buffer, int32_t count)
+{
+    pair_t<T> *p = (pair_t<T>*)buffer;
+    // Zero the padding, kernels are free to copy it or not.
+    memset(buffer, 0, count * sizeof(*p));
+    for (int32_t i = 0; i < count; ++i) {
+        // Few distinct values to make ties of the index frequent.
+        p[i].value = (T)(rand() % 7 - 3);
+        p[i].index = rand() % 16;
+    }
+}
+
+static void fill(ucg_dt_type_t dt, void *buffer, int32_t count)
+{
+    switch (dt) {
+        case UCG_DT_TYPE_BF16:
+            for (int32_t i = 0; i < count; ++i) {
+                // The upper half of a float of few significant bits.
+                float value = (float)(rand() % 7 - 3);
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                ((uint16_t*)buffer)[i] = (uint16_t)(bits >> 16);
+            }
+            break;
+        case UCG_DT_TYPE_FP32_INT32:
+            fill_pair<float>(buffer, count);
+            break;
+        case UCG_DT_TYPE_FP64_INT32:
+            fill_pair<double>(buffer, count);
+            break;
+        case UCG_DT_TYPE_INT16_INT32:
+            fill_pair<int16_t>(buffer, count);
+            break;
+        case UCG_DT_TYPE_INT32_INT32:
+            fill_pair<int32_t>(buffer, count);
+            break;
+        case UCG_DT_TYPE_INT64_INT32:
+            fill_pair<int64_t>(buffer, count);
+            break;
+        case UCG_DT_TYPE_FP32:
+            fill<float>(buffer, count);
+            break;
+        case UCG_DT_TYPE_FP64:
+            fill<double>(buffer, count);
+            break;
+        default:
+            // Integers of all widths take random bytes.
+            for (size_t i = 0; i < count * g_dt_sizes[dt]; ++i) {
+                ((uint8_t*)buffer)[i] = (uint8_t)rand();
+            }
+            break;
+    }
+}
+
+class test_ucg_op_kernel : public testing::Test {
+public:
+    static const ucg_op_kernel_table_t *scalar()
+    {
+        return ucg_op_kernel_get_table(UCG_OP_KERNEL_ISA_SCALAR);
+    }
+};
+
+TEST_F(test_ucg_op_kernel, scalar_always_available)
+{
+    ASSERT_TRUE(scalar() != NULL);
+    ASSERT_TRUE(ucg_op_kernel_get_table(UCG_OP_KERNEL_ISA_AUTO) == NULL);
+    ASSERT_EQ(ucg_op_kernel_select(UCG_OP_KERNEL_ISA_SCALAR), UCG_OP_KERNEL_ISA_SCALAR);
+    ASSERT_TRUE(ucg_op_kernels == scalar());
+
+    ucg_op_kernel_isa_t isa = ucg_op_kernel_select(UCG_OP_KERNEL_ISA_AUTO);
+    ASSERT_TRUE(ucg_op_kernels == ucg_op_kernel_get_table(isa));
+}
+
+TEST_F(test_ucg_op_kernel, same_as_scalar)
+{
+    // Cover counts shorter than a vector, unaligned buffers and remainders.
+    const int32_t counts[] = {1, 3, 15, 16, 17, 31, 63, 64, 65, 1000, 4099};
+    const int32_t max_count = 4099;
+    const size_t max_size = max_count * 16 + 1;
+    std::vector<uint8_t> source(max_size), expect(max_size), target(max_size), dst(max_size);
+
+    for (int isa = UCG_OP_KERNEL_ISA_SCALAR + 1; isa < UCG_OP_KERNEL_ISA_AUTO; ++isa) {
+        const ucg_op_kernel_table_t *table = ucg_op_kernel_get_table((ucg_op_kernel_isa_t)isa);
+        if (table == NULL) {
+            continue;
+        }
+        for (int op = 0; op < UCG_OP_TYPE_PREDEFINED_LAST; ++op) {
+            for (int dt = 0; dt < UCG_DT_TYPE_PREDEFINED_LAST; ++dt) {
+                ucg_op_kernel_t kernel = (*table)[op][dt];
+                ucg_op_kernel_t ref = (*scalar())[op][dt];
+                ASSERT_EQ(kernel == NULL, ref == NULL);
+                if (kernel == NULL) {
+                    continue;
+                }
+                for (int32_t count : counts) {
+                    int offset = count & 1;
+                    fill((ucg_dt_type_t)dt, &source[offset], count);
+                    fill((ucg_dt_type_t)dt, &expect[offset], count);
+                    memcpy(&target[offset], &expect[offset], count * g_dt_sizes[dt]);
+
+                    ref(&source[offset], &expect[offset], &expect[offset], count);
+                    kernel(&source[offset], &target[offset], &target[offset], count);
+                    ASSERT_EQ(memcmp(&target[offset], &expect[offset], count * g_dt_sizes[dt]), 0)
+                        << ucg_op_kernel_isa_names[isa] << " " << g_op_names[op]
+                        << " " << g_dt_names[dt] << " count " << count;
+
+                    // Write to a third buffer.
+                    ref(&source[offset], &expect[offset], &expect[offset], count);
+                    memset(&dst[offset], 0, count * g_dt_sizes[dt]);
+                    kernel(&source[offset], &target[offset], &dst[offset], count);
+                    ASSERT_EQ(memcmp(&dst[offset], &expect[offset], count * g_dt_sizes[dt]), 0)
+                        << ucg_op_kernel_isa_names[isa] << " " << g_op_names[op]
+                        << " " << g_dt_names[dt] << " count " << count << " to dst";
+                }
+            }
+        }
+    }
+}
+
+// Benchmark, run it by --gtest_also_run_disabled_tests.
+TEST_F(test_ucg_op_kernel, DISABLED_bandwidth)
+{
+    const size_t size = 1 << 20;
+    const int iters = 20;
+    std::vector<uint8_t> source(size), target(size);
+
+    printf("%-8s %-8s", "op", "dt");
+    for (int isa = UCG_OP_KERNEL_ISA_SCALAR; isa < UCG_OP_KERNEL_ISA_AUTO; ++isa) {
+        if (ucg_op_kernel_get_table((ucg_op_kernel_isa_t)isa) != NULL) {
+            printf(" %10s", ucg_op_kernel_isa_names[isa]);
+        }
+    }
+    printf("   (GB/s)\n");
+
+    for (int op = 0; op < UCG_OP_TYPE_PREDEFINED_LAST; ++op) {
+        for (int dt = 0; dt < UCG_DT_TYPE_PREDEFINED_LAST; ++dt) {
+            if ((*scalar())[op][dt] == NULL) {
+                continue;
+            }
+            int32_t count = size / g_dt_sizes[dt];
+            fill((ucg_dt_type_t)dt, source.data(), count);
+            fill((ucg_dt_type_t)dt, target.data(), count);
+            printf("%-8s %-8s", g_op_names[op], g_dt_names[dt]);
+            for (int isa = UCG_OP_KERNEL_ISA_SCALAR; isa < UCG_OP_KERNEL_ISA_AUTO; ++isa) {
+                const ucg_op_kernel_table_t *table = ucg_op_kernel_get_table((ucg_op_kernel_isa_t)isa);
+                if (table == NULL) {
+                    continue;
+                }
+                ucg_op_kernel_t kernel = (*table)[op][dt];
+                kernel(source.data(), target.data(), target.data(), count);
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iters; ++i) {
+                    kernel(source.data(), target.data(), target.data(), count);
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                // Read source and target, write target.
+                printf(" %10.2f", 3.0 * size * iters / elapsed.count() / 1e9);
+            }
+            printf("\n");
+        }
+    }
+}
+
+TEST_F(test_ucg_op_kernel, fused_copy)
+{
+    // Reducing into the receive buffer is the same as reducing in place and copying.
+    const int32_t count = 4099;
+    const size_t size = count * 16;
+    std::vector<uint8_t> a(size), b(size), inplace(size), dst(size);
+
+    for (int isa = UCG_OP_KERNEL_ISA_SCALAR; isa < UCG_OP_KERNEL_ISA_AUTO; ++isa) {
+        const ucg_op_kernel_table_t *table = ucg_op_kernel_get_table((ucg_op_kernel_isa_t)isa);
+        if (table == NULL) {
+            continue;
+        }
+        for (int op = 0; op < UCG_OP_TYPE_PREDEFINED_LAST; ++op) {
+            for (int dt = 0; dt < UCG_DT_TYPE_PREDEFINED_LAST; ++dt) {
+                ucg_op_kernel_t kernel = (*table)[op][dt];
+                if (kernel == NULL) {
+                    continue;
+                }
+                size_t length = count * g_dt_sizes[dt];
+                fill((ucg_dt_type_t)dt, a.data(), count);
+                fill((ucg_dt_type_t)dt, b.data(), count);
+                memcpy(inplace.data(), b.data(), length);
+                kernel(a.data(), inplace.data(), inplace.data(), count);
+                // Zero the padding of pairs like fill(), which the kernels may skip.
+                memset(dst.data(), 0, length);
+                kernel(a.data(), b.data(), dst.data(), count);
+                ASSERT_EQ(memcmp(dst.data(), inplace.data(), length), 0)
+                    << ucg_op_kernel_isa_names[isa] << " " << g_op_names[op]
+                    << " " << g_dt_names[dt];
+            }
+        }
+    }
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include "test_plan.h"
@@ -175,6 +175,52 @@ TEST(test_ucg_plan, call_fallback)
     ucg_plans_cleanup(plans);
 }
 
+TEST(test_ucg_plan, select_by_msg_size)
+{
+    ucg_plans_t *plans = nullptr;
+    ucg_plans_t *merged = nullptr;
+    std::vector<ucg_plan_params_t> params = {
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {1000, 4096}, VGRP_PTR(11), 11}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {0, 1000}, VGRP_PTR(10), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {8192, UCG_PLAN_RANGE_MAX}, VGRP_PTR(12), 12}},
+    };
+    /* msg size => expected op, nullptr means no plan covers it. */
+    std::vector<std::pair<int32_t, ucg_plan_op_t*>> expect = {
+        {0, OP_PTR(10)}, {1, OP_PTR(10)}, {999, OP_PTR(10)}, {1000, OP_PTR(11)},
+        {1024, OP_PTR(11)}, {4095, OP_PTR(11)}, {4096, nullptr}, {8191, nullptr},
+        {8192, OP_PTR(12)}, {1 << 30, OP_PTR(12)},
+    };
+
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    for (auto &p : params) {
+        ASSERT_EQ(ucg_plans_add(plans, &p), UCG_OK);
+    }
+    ASSERT_EQ(ucg_plans_init(&merged), UCG_OK);
+    ASSERT_EQ(ucg_plans_merge(&merged, plans), UCG_OK);
+
+    for (ucg_plans_t *p : {plans, merged}) {
+        for (auto &e : expect) {
+            ucg_plan_op_t *op = nullptr;
+            ucg_coll_args_t args = {
+                .type = coll_type,
+                .bcast = {
+                    .count = e.first,
+                    .dt = &dt,
+                },
+            };
+            if (e.second == nullptr) {
+                EXPECT_EQ(ucg_plans_prepare(p, &args, 1, &op), UCG_ERR_NOT_FOUND);
+            } else {
+                ASSERT_EQ(ucg_plans_prepare(p, &args, 1, &op), UCG_OK);
+                EXPECT_EQ(op, e.second) << "msg size " << e.first;
+            }
+        }
+    }
+
+    ucg_plans_cleanup(merged);
+    ucg_plans_cleanup(plans);
+}
+
 TEST(test_ucg_plan, merge_list)
 {
     ucg_plans_t *dst = nullptr;
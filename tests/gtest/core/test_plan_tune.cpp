@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <ucg/api/ucg.h>
+#include "stub.h"
+
+extern "C" {
+#include "core/ucg_group.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_request.h"
+}
+
+using namespace test;
+
+/* Prepare calls of the slow plan and the failures left to return. */
+static int test_slow_prepared = 0;
+static int test_slow_failures = 0;
+
+static ucg_status_t test_slow_op_trigger(ucg_plan_op_t *op)
+{
+    op->super.status = UCG_INPROGRESS;
+    return UCG_OK;
+}
+
+static ucg_status_t test_slow_op_progress(ucg_plan_op_t *op)
+{
+    // expect it loses to the stub plan.
+    usleep(1000);
+    op->super.status = UCG_OK;
+    return UCG_OK;
+}
+
+static ucg_status_t test_slow_op_discard(ucg_plan_op_t *op)
+{
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, op);
+    free(op);
+    return UCG_OK;
+}
+
+static ucg_status_t test_slow_plan_prepare(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op)
+{
+    ++test_slow_prepared;
+    if (test_slow_failures > 0) {
+        --test_slow_failures;
+        return UCG_ERR_NO_RESOURCE;
+    }
+
+    ucg_plan_op_t *new_op = (ucg_plan_op_t *)malloc(sizeof(ucg_plan_op_t));
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, new_op, vgroup,
+                                              test_slow_op_trigger,
+                                              test_slow_op_progress,
+                                              test_slow_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        abort();
+    }
+    *op = new_op;
+    return UCG_OK;
+}
+
+class test_ucg_plan_tune : public ::testing::Test {
+public:
+    static void SetUpTestSuite()
+    {
+        stub::init(true);
+        setenv("UCG_PLANC", "fake", 1);
+        setenv("UCG_PLAN_TUNE", "y", 1);
+        setenv("UCG_PLAN_TUNE_SAMPLES", "1", 1);
+        ucg_config_h config;
+        ucg_config_read(NULL, NULL, &config);
+        ucg_init(&test_stub_context_params, config, &m_context);
+        ucg_config_release(config);
+        unsetenv("UCG_PLAN_TUNE");
+        unsetenv("UCG_PLAN_TUNE_SAMPLES");
+    }
+
+    static void TearDownTestSuite()
+    {
+        ucg_cleanup(m_context);
+        stub::cleanup();
+    }
+
+    void SetUp() override
+    {
+        test_slow_prepared = 0;
+        test_slow_failures = 0;
+        ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &m_group), UCG_OK);
+        ASSERT_TRUE(m_group->tune != NULL);
+
+        // The slow plan is selected first and the stub plan is its fallback, but
+        // not for the allreduce of the agreement.
+        ucg_plan_params_t params = {
+            .mem_type = UCG_MEM_TYPE_HOST,
+            .coll_type = UCG_COLL_TYPE_ALLREDUCE,
+            .attr = {
+                .prepare = test_slow_plan_prepare,
+                .id = 1,
+                .name = "slow",
+                .domain = "gtest",
+                .deprecated = 0,
+                .range = {
+                    .start = 1024,
+                    .end = UCG_PLAN_RANGE_MAX,
+                },
+                .vgroup = (ucg_vgroup_t*)m_group->planc_groups[0],
+                .score = 2,
+            },
+        };
+        ASSERT_EQ(ucg_plans_add(m_group->plans, &params), UCG_OK);
+    }
+
+    void TearDown() override
+    {
+        ucg_group_destroy(m_group);
+    }
+
+    /* Run an allreduce, return whether it's run by the slow plan. */
+    ucg_status_t allreduce(bool *slow)
+    {
+        const int count = 256;
+        double sendbuf[count] = {1};
+        double recvbuf[count];
+        ucg_request_info_t info = {
+            .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+            .mem_type = UCG_MEM_TYPE_HOST,
+        };
+        ucg_request_h request;
+        ucg_status_t status;
+        status = ucg_request_allreduce_init(sendbuf, recvbuf, count,
+                                            ucg_dt_get_predefined(UCG_DT_TYPE_FP64),
+                                            ucg_op_get_predefined(UCG_OP_TYPE_SUM),
+                                            m_group, &info, UCG_REQUEST_BLOCKING, &request);
+        if (status != UCG_OK) {
+            return status;
+        }
+        *slow = ucg_derived_of(request, ucg_plan_op_t)->trigger == test_slow_op_trigger;
+        status = ucg_request_start(request);
+        while (status == UCG_OK && (status = ucg_request_test(request)) == UCG_INPROGRESS);
+        ucg_request_cleanup(request);
+        return status;
+    }
+
+public:
+    static ucg_context_h m_context;
+    ucg_group_h m_group;
+};
+ucg_context_h test_ucg_plan_tune::m_context;
+
+TEST_F(test_ucg_plan_tune, take_turns_and_pin)
+{
+    bool slow;
+    // expect the candidates take turns in the warm-up and timed calls.
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(allreduce(&slow), UCG_OK);
+        ASSERT_EQ(slow, i % 2 == 0);
+    }
+
+    // expect the faster one is pinned once they agree.
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(allreduce(&slow), UCG_OK);
+        ASSERT_FALSE(slow);
+    }
+    // expect one probe and two turns.
+    ASSERT_EQ(test_slow_prepared, 3);
+}
+
+TEST_F(test_ucg_plan_tune, agree_to_drop_failed)
+{
+    // expect the candidate failed in the probe never takes a turn.
+    test_slow_failures = 1;
+    bool slow;
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_EQ(allreduce(&slow), UCG_OK);
+        ASSERT_FALSE(slow);
+    }
+    ASSERT_EQ(test_slow_prepared, 1);
+}
+
+TEST_F(test_ucg_plan_tune, failed_turn)
+{
+    bool slow;
+    ASSERT_EQ(allreduce(&slow), UCG_OK);
+    ASSERT_TRUE(slow);
+    ASSERT_EQ(allreduce(&slow), UCG_OK);
+    ASSERT_FALSE(slow);
+
+    // expect the call fails instead of running another plan than the peers.
+    test_slow_failures = 1;
+    ASSERT_EQ(allreduce(&slow), UCG_ERR_NO_RESOURCE);
+    ASSERT_EQ(allreduce(&slow), UCG_OK);
+    ASSERT_FALSE(slow);
+}
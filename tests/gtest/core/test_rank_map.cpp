@@ -1,12 +1,17 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
 #include "stub.h"
 
 extern "C" {
 #include "core/ucg_rank_map.h"
+#include "util/ucg_malloc.h"
 }
 
 using namespace test;
@@ -208,6 +213,52 @@ TEST_F(test_ucg_rank_map, optimize_array)
     free(ranks);
 }
 
+TEST_F(test_ucg_rank_map, optimize_block_stride)
+{
+    // the first 3 ranks of every node with 8 ranks, the last node is partial.
+    const int size = 11;
+    ucg_rank_t *ranks = (ucg_rank_t*)malloc(size * sizeof(ucg_rank_t));
+    for (int i = 0; i < size; ++i) {
+        ranks[i] = 2 + (i / 3) * 8 + (i % 3);
+    }
+    ucg_rank_map_t map;
+    ASSERT_EQ(ucg_rank_map_init_by_array(&map, &ranks, size, 0), UCG_OK);
+    ASSERT_EQ(map.type, UCG_RANK_MAP_TYPE_BLOCK_STRIDE);
+    ASSERT_EQ(map.blocked.block, 3);
+    ASSERT_EQ(map.blocked.block_stride, 8);
+    for (int i = 0; i < size; ++i) {
+        ASSERT_EQ(ucg_rank_map_eval(&map, i), ranks[i]);
+    }
+    ucg_rank_map_cleanup(&map);
+    free(ranks);
+}
+
+TEST_F(test_ucg_rank_map, optimize_runs)
+{
+    // nodes of 6, 5 and 7 ranks, every one without its first rank.
+    const int size = 15;
+    ucg_rank_t expect[size] = {1, 2, 3, 4, 5, 7, 8, 9, 10, 12, 13, 14, 15, 16, 17};
+    ucg_rank_t *ranks = (ucg_rank_t*)malloc(size * sizeof(ucg_rank_t));
+    memcpy(ranks, expect, sizeof(expect));
+    ucg_rank_map_t map;
+    ASSERT_EQ(ucg_rank_map_init_by_array(&map, &ranks, size, 1), UCG_OK);
+    ASSERT_TRUE(ranks == NULL);
+    ASSERT_EQ(map.type, UCG_RANK_MAP_TYPE_RUNS);
+    ASSERT_EQ(map.runs.num_runs, 3);
+    for (int i = 0; i < size; ++i) {
+        ASSERT_EQ(ucg_rank_map_eval(&map, i), expect[i]);
+    }
+
+    ucg_rank_map_t dst;
+    ASSERT_EQ(ucg_rank_map_copy(&dst, &map), UCG_OK);
+    ASSERT_TRUE(dst.runs.runs != map.runs.runs);
+    for (int i = 0; i < size; ++i) {
+        ASSERT_EQ(ucg_rank_map_eval(&dst, i), expect[i]);
+    }
+    ucg_rank_map_cleanup(&dst);
+    ucg_rank_map_cleanup(&map);
+}
+
 TEST_F(test_ucg_rank_map, optimize_stride)
 {
     ucg_rank_t *ranks;
@@ -313,4 +364,150 @@ TEST_F(test_ucg_rank_map, eval_unknow_type)
     map.type = (ucg_rank_map_type_t)123;
     map.size = 10;
     ASSERT_EQ(ucg_rank_map_eval(&map, 0), UCG_INVALID_RANK);
-}
\ No newline at end of file
+}
+
+TEST_F(test_ucg_rank_map, pool_share)
+{
+    ucg_rank_map_pool_t *pool;
+    ASSERT_EQ(ucg_rank_map_pool_init(&pool, UCG_LOCK_TYPE_NONE), UCG_OK);
+
+    ucg_rank_t ranks[] = {3, 1, 4, 0, 2};
+    const int size = sizeof(ranks) / sizeof(ranks[0]);
+    ucg_rank_map_t src;
+    src.type = UCG_RANK_MAP_TYPE_ARRAY;
+    src.size = size;
+    src.array = ranks;
+
+    // expect the maps of the same ranks share the array.
+    ucg_rank_map_t map1;
+    ucg_rank_map_t map2;
+    ASSERT_EQ(ucg_rank_map_pool_copy(pool, &map1, &src), UCG_OK);
+    ucg_rank_t *taken = (ucg_rank_t*)ucg_malloc(sizeof(ranks), "test ranks");
+    memcpy(taken, ranks, sizeof(ranks));
+    ASSERT_EQ(ucg_rank_map_pool_init_by_array(pool, &map2, &taken, size, 1), UCG_OK);
+    ASSERT_TRUE(taken == NULL);
+    ASSERT_EQ(map1.type, UCG_RANK_MAP_TYPE_ARRAY);
+    ASSERT_TRUE(map1.array != ranks);
+    ASSERT_TRUE(map1.array == map2.array);
+
+    // expect different ranks are not shared.
+    ucg_rank_map_t map3;
+    ranks[0] = 5;
+    ASSERT_EQ(ucg_rank_map_pool_copy(pool, &map3, &src), UCG_OK);
+    ASSERT_TRUE(map3.array != map1.array);
+    for (int i = 0; i < size; ++i) {
+        ASSERT_EQ(ucg_rank_map_eval(&map3, i), ranks[i]);
+    }
+    ASSERT_EQ(ucg_rank_map_pool_bytes(pool), 2 * sizeof(ranks));
+
+    // expect the array is still valid until the last one is released.
+    ucg_rank_map_pool_release(pool, &map1);
+    ASSERT_EQ(ucg_rank_map_eval(&map2, 0), 3);
+    ucg_rank_map_pool_release(pool, &map2);
+    ucg_rank_map_pool_release(pool, &map3);
+    ASSERT_EQ(ucg_rank_map_pool_bytes(pool), 0);
+
+    // expect the optimized map needs no array.
+    ucg_rank_t stride_ranks[] = {1, 3, 5, 7};
+    src.size = 4;
+    src.array = stride_ranks;
+    ASSERT_EQ(ucg_rank_map_pool_copy(pool, &map1, &src), UCG_OK);
+    ASSERT_EQ(map1.type, UCG_RANK_MAP_TYPE_STRIDE);
+    ucg_rank_map_pool_release(pool, &map1);
+
+    ucg_rank_map_pool_cleanup(pool);
+}
+
+TEST_F(test_ucg_rank_map, pool_compose)
+{
+    ucg_rank_map_pool_t *pool;
+    ASSERT_EQ(ucg_rank_map_pool_init(&pool, UCG_LOCK_TYPE_NONE), UCG_OK);
+
+    ucg_rank_t ranks[] = {6, 1, 9, 3, 0, 5, 2, 7};
+    const int size = sizeof(ranks) / sizeof(ranks[0]);
+    ucg_rank_map_t then;
+    then.type = UCG_RANK_MAP_TYPE_ARRAY;
+    then.size = size;
+    then.array = ranks;
+
+    // expect dst(r) = then(map(r)), which is optimized.
+    ucg_rank_map_t map;
+    map.type = UCG_RANK_MAP_TYPE_STRIDE;
+    map.size = size / 2;
+    map.strided.start = 1;
+    map.strided.stride = 2;
+    ucg_rank_map_t dst;
+    ASSERT_EQ(ucg_rank_map_pool_compose(pool, &dst, &map, &then), UCG_OK);
+    ASSERT_EQ(dst.size, map.size);
+    ASSERT_EQ(dst.type, UCG_RANK_MAP_TYPE_STRIDE);
+    for (uint32_t i = 0; i < map.size; ++i) {
+        ASSERT_EQ(ucg_rank_map_eval(&dst, i), ranks[1 + 2 * i]);
+    }
+    ucg_rank_map_pool_release(pool, &dst);
+
+    // expect the full-type one is skipped and the array is shared.
+    map.type = UCG_RANK_MAP_TYPE_FULL;
+    map.size = size;
+    ucg_rank_map_t dst2;
+    ASSERT_EQ(ucg_rank_map_pool_compose(pool, &dst, &map, &then), UCG_OK);
+    ASSERT_EQ(ucg_rank_map_pool_compose(pool, &dst2, &then, &map), UCG_OK);
+    ASSERT_EQ(dst.type, UCG_RANK_MAP_TYPE_ARRAY);
+    ASSERT_TRUE(dst.array == dst2.array);
+    ASSERT_EQ(ucg_rank_map_pool_bytes(pool), sizeof(ranks));
+    ucg_rank_map_pool_release(pool, &dst);
+    ucg_rank_map_pool_release(pool, &dst2);
+
+    // expect the callback-type is not composed.
+    map.type = UCG_RANK_MAP_TYPE_CB;
+    map.size = size;
+    map.cb.mapping = test_mapping_cb;
+    map.cb.arg = ranks;
+    then.type = UCG_RANK_MAP_TYPE_STRIDE;
+    then.strided.start = 0;
+    then.strided.stride = 2;
+    then.size = 2 * size;
+    ASSERT_EQ(ucg_rank_map_pool_compose(pool, &dst, &map, &then), UCG_ERR_UNSUPPORTED);
+
+    ucg_rank_map_pool_cleanup(pool);
+}
+
+TEST_F(test_ucg_rank_map, pool_dup_scale)
+{
+    const int num_dups = 256;
+    ucg_rank_map_pool_t *pool;
+    ASSERT_EQ(ucg_rank_map_pool_init(&pool, UCG_LOCK_TYPE_NONE), UCG_OK);
+
+    for (uint32_t size = 1024; size <= 64 * 1024; size *= 4) {
+        // shuffled ranks, which can't be optimized
+        std::vector<ucg_rank_t> ranks(size);
+        std::iota(ranks.begin(), ranks.end(), 0);
+        std::shuffle(ranks.begin(), ranks.end(), std::mt19937(size));
+        ucg_rank_map_t src;
+        src.type = UCG_RANK_MAP_TYPE_ARRAY;
+        src.size = size;
+        src.array = ranks.data();
+
+        for (int use_pool = 0; use_pool <= 1; ++use_pool) {
+            ucg_rank_map_pool_t *dup_pool = use_pool ? pool : NULL;
+            std::vector<ucg_rank_map_t> maps(num_dups);
+            for (int i = 0; i < num_dups; ++i) {
+                ASSERT_EQ(ucg_rank_map_pool_copy(dup_pool, &maps[i], &src), UCG_OK);
+            }
+
+            ASSERT_EQ(maps[0].type, UCG_RANK_MAP_TYPE_ARRAY);
+            if (use_pool) {
+                // expect the duplicates from the pool take one array.
+                ASSERT_EQ(ucg_rank_map_pool_bytes(pool), size * sizeof(ucg_rank_t));
+                ASSERT_TRUE(maps[0].array == maps[num_dups - 1].array);
+            } else {
+                ASSERT_TRUE(maps[0].array != maps[num_dups - 1].array);
+            }
+
+            for (int i = 0; i < num_dups; ++i) {
+                ucg_rank_map_pool_release(dup_pool, &maps[i]);
+            }
+        }
+        ASSERT_EQ(ucg_rank_map_pool_bytes(pool), 0);
+    }
+    ucg_rank_map_pool_cleanup(pool);
+}
@@ -30,10 +30,12 @@ public:
         stub::init(true);
         // use planc fake to test.
         setenv("UCG_PLANC", "fake", 1);
+        setenv("UCG_FUSION_WINDOW", "4k", 1);
         ucg_config_h config;
         ucg_config_read(NULL, NULL, &config);
         ucg_init(&test_stub_context_params, config, &m_context);
         ucg_config_release(config);
+        unsetenv("UCG_FUSION_WINDOW");
         ucg_group_create(m_context, &test_stub_group_params, &m_group);
     }
 
@@ -202,6 +204,168 @@ TEST_F(test_ucg_request, allreduce_init_unknown_mem_type)
                                          &op, m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
 }
 
+TEST_F(test_ucg_request, reduce_scatter)
+{
+    const int count = 10;
+    /* The stub group has 5 ranks. */
+    int sendbuf[count * 5] = {1};
+    int recvbuf[count] = {1};
+    int recvcounts[5] = {count, count, count, count, count};
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_op_t op = {
+        .type = UCG_OP_TYPE_MAX,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    // reduce_scatter
+    ucg_request_h request = nullptr;
+    ASSERT_EQ(ucg_request_reduce_scatter_init(sendbuf, recvbuf, recvcounts, &dt, &op,
+                                              m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
+
+    // ireduce_scatter
+    ucg_request_h non_request = nullptr;
+    ASSERT_EQ(ucg_request_reduce_scatter_init(sendbuf, recvbuf, recvcounts, &dt, &op,
+                                              m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(non_request), UCG_OK);
+
+    // reduce_scatter_block
+    ASSERT_EQ(ucg_request_reduce_scatter_block_init(sendbuf, recvbuf, count, &dt, &op,
+                                                    m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
+
+    // ireduce_scatter_block
+    ASSERT_EQ(ucg_request_reduce_scatter_block_init(sendbuf, recvbuf, count, &dt, &op,
+                                                    m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(non_request), UCG_OK);
+
+    // Inconsistent memory types are not supported.
+    info.mem_type = UCG_MEM_TYPE_UNKNOWN;
+    ASSERT_NE(ucg_request_reduce_scatter_init(sendbuf, test_stub_acl_buffer, recvcounts, &dt, &op,
+                                              m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+}
+
+TEST_F(test_ucg_request, reduce)
+{
+    const int count = 10;
+    int sendbuf[count] = {1};
+    int recvbuf[count] = {1};
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_op_t op = {
+        .type = UCG_OP_TYPE_MAX,
+    };
+    ucg_rank_t root = 0;
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    // reduce
+    ucg_request_h request = nullptr;
+    ASSERT_EQ(ucg_request_reduce_init(sendbuf, recvbuf, count, &dt, &op, root,
+                                      m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
+
+    // ireduce
+    ucg_request_h non_request = nullptr;
+    ASSERT_EQ(ucg_request_reduce_init(UCG_IN_PLACE, recvbuf, count, &dt, &op, root,
+                                      m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(non_request), UCG_OK);
+
+    // Inconsistent memory types are not supported.
+    info.mem_type = UCG_MEM_TYPE_UNKNOWN;
+    ASSERT_NE(ucg_request_reduce_init(sendbuf, test_stub_acl_buffer, count, &dt, &op, root,
+                                      m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+}
+
+TEST_F(test_ucg_request, scan)
+{
+    const int count = 10;
+    int sendbuf[count] = {1};
+    int recvbuf[count] = {1};
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_op_t op = {
+        .type = UCG_OP_TYPE_SUM,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    // scan
+    ucg_request_h request = nullptr;
+    ASSERT_EQ(ucg_request_scan_init(sendbuf, recvbuf, count, &dt, &op,
+                                    m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
+
+    // iexscan
+    ucg_request_h non_request = nullptr;
+    ASSERT_EQ(ucg_request_exscan_init(UCG_IN_PLACE, recvbuf, count, &dt, &op,
+                                      m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(non_request), UCG_OK);
+
+    // Inconsistent memory types are not supported.
+    info.mem_type = UCG_MEM_TYPE_UNKNOWN;
+    ASSERT_NE(ucg_request_scan_init(sendbuf, test_stub_acl_buffer, count, &dt, &op,
+                                    m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+}
+
+TEST_F(test_ucg_request, allgather)
+{
+    const int count = 10;
+    int sendbuf[count] = {1};
+    int recvbuf[count * 4] = {1};
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    // allgather
+    ucg_request_h request = nullptr;
+    ASSERT_EQ(ucg_request_allgather_init(sendbuf, count, &dt, recvbuf, count, &dt,
+                                         m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
+
+    // iallgather
+    ucg_request_h non_request = nullptr;
+    ASSERT_EQ(ucg_request_allgather_init(UCG_IN_PLACE, count, &dt, recvbuf, count, &dt,
+                                         m_group, &info, UCG_REQUEST_NONBLOCKING, &non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_start(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_test(non_request), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(non_request), UCG_OK);
+
+    // Inconsistent memory types are not supported.
+    info.mem_type = UCG_MEM_TYPE_UNKNOWN;
+    ASSERT_NE(ucg_request_allgather_init(sendbuf, count, &dt, test_stub_acl_buffer, count, &dt,
+                                         m_group, &info, UCG_REQUEST_BLOCKING, &request), UCG_OK);
+}
+
 TEST_F(test_ucg_request, barrier)
 {
     ucg_request_info_t info = {
@@ -438,6 +602,182 @@ TEST_F(test_ucg_request, test_ok)
     ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
 }
 
+TEST_F(test_ucg_request, startall_testall)
+{
+    const int count = 10;
+    const int num_requests = 3;
+    int buffer[count] = {1};
+    ucg_rank_t root = 0;
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    ucg_group_h group;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group), UCG_OK);
+
+    // The last one is of another group.
+    ucg_request_h requests[num_requests + 1];
+    for (int i = 0; i < num_requests; ++i) {
+        ucg_group_h req_group = (i == num_requests - 1) ? group : m_group;
+        ASSERT_EQ(ucg_request_bcast_init(buffer, count, &dt, root, req_group, &info,
+                                         UCG_REQUEST_NONBLOCKING, &requests[i]), UCG_OK);
+    }
+    requests[num_requests] = NULL;
+
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(ucg_request_startall(num_requests, requests), UCG_OK);
+        // The requests that are in progress cannot be started again.
+        ASSERT_NE(ucg_request_startall(num_requests, requests), UCG_OK);
+        // NULL is ignored.
+        ASSERT_EQ(ucg_request_testall(num_requests + 1, requests), UCG_OK);
+        // For the requests that have been completed, it can still be invoked.
+        ASSERT_EQ(ucg_request_testall(num_requests, requests), UCG_OK);
+    }
+
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(ucg_request_cleanup(requests[i]), UCG_OK);
+    }
+    ucg_group_destroy(group);
+}
+
+TEST_F(test_ucg_request, waitany)
+{
+    const int count = 10;
+    const int num_requests = 2;
+    int buffer[count] = {1};
+    ucg_rank_t root = 0;
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    ucg_request_h requests[num_requests];
+    ucg_request_h handles[num_requests];
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(ucg_request_bcast_init(buffer, count, &dt, root, m_group, &info,
+                                         UCG_REQUEST_NONBLOCKING, &requests[i]), UCG_OK);
+        handles[i] = requests[i];
+    }
+    ASSERT_EQ(ucg_request_startall(num_requests, requests), UCG_OK);
+
+    int32_t index;
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(ucg_request_waitany(num_requests, requests, &index), UCG_OK);
+        ASSERT_EQ(index, i);
+        requests[index] = NULL;
+    }
+    // All the requests are NULL.
+    ASSERT_EQ(ucg_request_waitany(num_requests, requests, &index), UCG_OK);
+    ASSERT_EQ(index, -1);
+
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(ucg_request_cleanup(handles[i]), UCG_OK);
+    }
+}
+
+TEST_F(test_ucg_request, startall_fusion)
+{
+    const int count = 4;
+    const int num_requests = 3;
+    int sendbuf[num_requests][count] = {{1}};
+    int recvbuf[num_requests][count] = {{0}};
+    ucg_rank_t root = 0;
+    ucg_dt_params_t dt_params = {
+        .field_mask = UCG_DT_PARAMS_FIELD_TYPE,
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_dt_h dt;
+    ASSERT_EQ(ucg_dt_create(&dt_params, &dt), UCG_OK);
+    ucg_op_params_t op_params = {
+        .field_mask = UCG_OP_PARAMS_FIELD_TYPE,
+        .type = UCG_OP_TYPE_SUM,
+    };
+    ucg_op_h op;
+    ASSERT_EQ(ucg_op_create(&op_params, &op), UCG_OK);
+
+    int complete[num_requests] = {0};
+    ucg_request_h requests[num_requests + 1];
+    for (int i = 0; i < num_requests; ++i) {
+        ucg_request_info_t info = {
+            .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE | UCG_REQUEST_INFO_FIELD_CB,
+            .mem_type = UCG_MEM_TYPE_HOST,
+            .complete_cb = {
+                .cb = test_ucg_request_complete_cb,
+                .arg = &complete[i],
+            },
+        };
+        ASSERT_EQ(ucg_request_allreduce_init(sendbuf[i], recvbuf[i], count, dt, op, m_group,
+                                             &info, UCG_REQUEST_NONBLOCKING, &requests[i]),
+                  UCG_OK);
+    }
+    // The bcast is not fused with the allreduces.
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    ASSERT_EQ(ucg_request_bcast_init(sendbuf[0], count, dt, root, m_group, &info,
+                                     UCG_REQUEST_NONBLOCKING, &requests[num_requests]),
+              UCG_OK);
+
+    ASSERT_EQ(ucg_request_startall(num_requests + 1, requests), UCG_OK);
+    // The fused allreduces are completed by one request.
+    ASSERT_EQ(ucg_progress(m_context), 2);
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(complete[i], 1);
+        ASSERT_EQ(ucg_request_test(requests[i]), UCG_OK);
+    }
+
+    // The fusion is kept for the next start of the same requests.
+    ucg_request_fusion_t *fusion = requests[0]->fusion;
+    ASSERT_TRUE(fusion != NULL);
+    for (int i = 1; i < num_requests; ++i) {
+        ASSERT_EQ(requests[i]->fusion, fusion);
+    }
+    ASSERT_TRUE(requests[num_requests]->fusion == NULL);
+
+    // The fused requests can be started and tested one by one as well.
+    ASSERT_EQ(ucg_request_startall(num_requests, requests), UCG_OK);
+    ASSERT_EQ(requests[0]->fusion, fusion);
+    ASSERT_NE(ucg_request_cleanup(requests[0]), UCG_OK);
+    for (int i = 0; i < num_requests; ++i) {
+        ASSERT_EQ(ucg_request_test(requests[i]), UCG_OK);
+    }
+
+    // Fusing a part of them releases the kept fusion.
+    ASSERT_EQ(ucg_request_startall(num_requests - 1, requests), UCG_OK);
+    ASSERT_EQ(ucg_progress(m_context), 1);
+    ASSERT_EQ(requests[1]->fusion, requests[0]->fusion);
+    ASSERT_TRUE(requests[num_requests - 1]->fusion == NULL);
+
+    // Cleaning up a member releases the fusion of the others.
+    ASSERT_EQ(ucg_request_cleanup(requests[0]), UCG_OK);
+    ASSERT_TRUE(requests[1]->fusion == NULL);
+
+    for (int i = 1; i < num_requests + 1; ++i) {
+        ASSERT_EQ(ucg_request_cleanup(requests[i]), UCG_OK);
+    }
+    ucg_op_destroy(op);
+    ucg_dt_destroy(dt);
+}
+
+#ifdef UCG_ENABLE_CHECK_PARAMS
+TEST_F(test_ucg_request, batch_invalid_args)
+{
+    ucg_request_h requests[1] = {NULL};
+    int32_t index;
+    ASSERT_EQ(ucg_request_startall(1, NULL), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_startall(1, requests), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_testall(1, NULL), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_waitany(1, NULL, &index), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_waitany(1, requests, NULL), UCG_ERR_INVALID_PARAM);
+}
+#endif
+
 TEST_F(test_ucg_request, cleanup_inprogress)
 {
     const int count = 10;
@@ -481,6 +821,39 @@ TEST_F(test_ucg_request, with_context_progress)
     ASSERT_EQ(ucg_request_cleanup(request), UCG_OK);
 }
 
+TEST_F(test_ucg_request, context_progress_multi_groups)
+{
+    const int count = 10;
+    int buffer[count] = {1};
+    ucg_rank_t root = 0;
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+    };
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+    ucg_group_h group;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group), UCG_OK);
+
+    // Every group has its own progress list, the context progresses all of them.
+    ucg_request_h request1 = nullptr;
+    ucg_request_h request2 = nullptr;
+    ASSERT_EQ(ucg_request_bcast_init(buffer, count, &dt, root, m_group,
+                                     &info, UCG_REQUEST_BLOCKING, &request1), UCG_OK);
+    ASSERT_EQ(ucg_request_bcast_init(buffer, count, &dt, root, group,
+                                     &info, UCG_REQUEST_BLOCKING, &request2), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request1), UCG_OK);
+    ASSERT_EQ(ucg_request_start(request2), UCG_OK);
+    ASSERT_EQ(ucg_progress(m_context), 2);
+    ASSERT_EQ(ucg_request_test(request1), UCG_OK);
+    ASSERT_EQ(ucg_request_test(request2), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request1), UCG_OK);
+    ASSERT_EQ(ucg_request_cleanup(request2), UCG_OK);
+
+    ucg_group_destroy(group);
+}
+
 TEST_F(test_ucg_request, complete_cb)
 {
     const int count = 10;
@@ -519,6 +892,18 @@ TEST_F(test_ucg_request, init_invalid_args)
               UCG_ERR_INVALID_PARAM);
     ASSERT_EQ(ucg_request_alltoallv_init(NULL, NULL, NULL, NULL, NULL, NULL, NULL,
               NULL, NULL, NULL, UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_reduce_scatter_init(NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_reduce_scatter_block_init(NULL, NULL, 0, NULL, NULL, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_reduce_init(NULL, NULL, 0, NULL, NULL, 0, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_scan_init(NULL, NULL, 0, NULL, NULL, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_exscan_init(NULL, NULL, 0, NULL, NULL, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
+    ASSERT_EQ(ucg_request_allgather_init(NULL, 0, NULL, NULL, 0, NULL, NULL, NULL,
+              UCG_REQUEST_BLOCKING, &request), UCG_ERR_INVALID_PARAM);
 }
 
 TEST_F(test_ucg_request, start_invalid_args)
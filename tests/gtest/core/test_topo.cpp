@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 #include <gtest/gtest.h>
 #include "stub.h"
@@ -38,6 +38,28 @@ static ucg_status_t test_topo_get_location(ucg_group_t *group, ucg_rank_t rank,
     return UCG_OK;
 }
 
+static int test_topo_get_location_calls = 0;
+static ucg_status_t test_topo_get_location_counted(ucg_group_t *group, ucg_rank_t rank,
+                                                   ucg_location_t *location)
+{
+    ++test_topo_get_location_calls;
+    return test_topo_get_location(group, rank, location);
+}
+
+// rank-by core of any number of ranks, for the benchmark
+static ucg_status_t test_topo_get_location_scaled(ucg_group_t *group, ucg_rank_t rank,
+                                                  ucg_location_t *location)
+{
+    ++test_topo_get_location_calls;
+    location->field_mask = UCG_LOCATION_FIELD_SUBNET_ID |
+                           UCG_LOCATION_FIELD_NODE_ID |
+                           UCG_LOCATION_FIELD_SOCKET_ID;
+    location->node_id = rank / ppn;
+    location->socket_id = (rank % ppn) / pps;
+    location->subnet_id = location->node_id / 64;
+    return UCG_OK;
+}
+
 static ucg_status_t test_topo_get_location_no_node_id(ucg_group_t *group, ucg_rank_t rank, ucg_location_t *location)
 {
     location->field_mask = UCG_LOCATION_FIELD_SOCKET_ID;
@@ -71,6 +93,7 @@ public:
 TEST_F(test_ucg_topo, init_invalid_args)
 {
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
 
     ASSERT_EQ(ucg_topo_init(NULL, NULL), UCG_ERR_INVALID_PARAM);
     ASSERT_EQ(ucg_topo_init(&params, NULL), UCG_ERR_INVALID_PARAM);
@@ -103,6 +126,7 @@ TEST_F(test_ucg_topo, init)
     group.size = 10;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.myrank = 3;
     params.rank_map = &map;
@@ -119,6 +143,7 @@ TEST_F(test_ucg_topo, init_fail_malloc)
     ucg_topo_t *topo;
     ucg_rank_map_t map;
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = NULL;
     params.myrank = 3;
     params.rank_map = &map;
@@ -149,6 +174,7 @@ TEST_F(test_ucg_topo, init_fail_location)
     map.size = 10;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = NULL;
     params.myrank = 3;
     params.rank_map = &map;
@@ -167,6 +193,7 @@ TEST_F(test_ucg_topo, get_socket_group_only)
     group.size = n_proc;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.rank_map = &map;
     params.myrank = 0;
@@ -192,6 +219,7 @@ TEST_F(test_ucg_topo, get_socket_leader_group_only)
     group.size = n_proc;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.rank_map = &map;
     params.myrank = 0;
@@ -207,34 +235,170 @@ TEST_F(test_ucg_topo, get_socket_leader_group_only)
     ucg_topo_cleanup(topo);
 }
 
-TEST_F(test_ucg_topo, get_group_fail_location)
+TEST_F(test_ucg_topo, get_location_once)
 {
     ucg_rank_map_t map;
     map.type = UCG_RANK_MAP_TYPE_FULL;
-    map.size = 10;
+    map.size = n_proc;
 
     ucg_group_t group;
-    group.size = 10;
+    group.size = n_proc;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
-    params.myrank = 3;
     params.rank_map = &map;
-    params.get_location = test_topo_get_location;
+    params.myrank = 0;
+    params.get_location = test_topo_get_location_counted;
 
+    test_topo_get_location_calls = 0;
     ucg_topo_t *topo;
     ASSERT_EQ(ucg_topo_init(&params, &topo), UCG_OK);
+    ASSERT_EQ(topo->ppn, ppn);
+    ASSERT_EQ(topo->pps, pps);
+    ASSERT_EQ(topo->detail.nnode, n_nodes);
+    ASSERT_EQ(topo->detail.nsocket, n_sockets);
+    ASSERT_EQ(topo->detail.nrank_continuous, 1);
+
+    // expect all the groups are derived from the locations fetched by init.
+    for (int i = 0; i < UCG_TOPO_GROUP_TYPE_LAST; ++i) {
+        ASSERT_TRUE(ucg_topo_get_group(topo, (ucg_topo_group_type_t)i) != NULL);
+    }
+    ASSERT_EQ(test_topo_get_location_calls, n_proc);
+    ucg_topo_cleanup(topo);
+}
 
-    topo->get_location = test_topo_get_location_fail;
-    ucg_topo_group_t *topo_group;
-    topo_group = ucg_topo_get_group(topo, UCG_TOPO_GROUP_TYPE_NODE);
-    ASSERT_TRUE(topo_group == NULL);
-    // Should still be NULL
-    topo_group = ucg_topo_get_group(topo, UCG_TOPO_GROUP_TYPE_NODE);
-    ASSERT_TRUE(topo_group == NULL);
+TEST_F(test_ucg_topo, share_snapshot)
+{
+    ucg_rank_map_pool_t *pool;
+    ASSERT_EQ(ucg_rank_map_pool_init(&pool, UCG_LOCK_TYPE_NONE), UCG_OK);
+
+    // The odd ranks of the context
+    ucg_rank_map_t map;
+    map.type = UCG_RANK_MAP_TYPE_STRIDE;
+    map.size = n_proc / 2;
+    map.strided.start = 1;
+    map.strided.stride = 2;
+
+    ucg_group_t group;
+    group.size = map.size;
+
+    ucg_topo_params_t params;
+    params.rank_map_pool = pool;
+    params.group = &group;
+    params.rank_map = &map;
+    params.myrank = 0;
+    params.get_location = test_topo_get_location_counted;
+
+    // expect the duplicated group uses the locations fetched by the first one.
+    test_topo_get_location_calls = 0;
+    ucg_topo_t *topo1;
+    ucg_topo_t *topo2;
+    ASSERT_EQ(ucg_topo_init(&params, &topo1), UCG_OK);
+    ASSERT_EQ(ucg_topo_init(&params, &topo2), UCG_OK);
+    ASSERT_EQ(test_topo_get_location_calls, map.size);
+    ASSERT_EQ(topo1->snapshot, topo2->snapshot);
+    ASSERT_EQ(topo1->detail.nnode, topo2->detail.nnode);
+
+    // expect the group of other ranks has its own.
+    ucg_rank_map_t map_full;
+    map_full.type = UCG_RANK_MAP_TYPE_FULL;
+    map_full.size = map.size;
+    params.rank_map = &map_full;
+    ucg_topo_t *topo3;
+    ASSERT_EQ(ucg_topo_init(&params, &topo3), UCG_OK);
+    ASSERT_EQ(test_topo_get_location_calls, 2 * map.size);
+    ASSERT_NE(topo1->snapshot, topo3->snapshot);
+
+    // expect the snapshot outlives the topology that creates it.
+    ucg_topo_cleanup(topo1);
+    ASSERT_TRUE(ucg_topo_get_group(topo2, UCG_TOPO_GROUP_TYPE_NODE) != NULL);
+    ucg_topo_cleanup(topo2);
+    ucg_topo_cleanup(topo3);
+    ucg_rank_map_pool_cleanup(pool);
+}
+
+TEST_F(test_ucg_topo, group_ctx_rank_map)
+{
+    // The odd ranks of the context
+    ucg_rank_map_t map;
+    map.type = UCG_RANK_MAP_TYPE_STRIDE;
+    map.size = n_proc / 2;
+    map.strided.start = 1;
+    map.strided.stride = 2;
+
+    ucg_group_t group;
+    group.size = map.size;
+
+    ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
+    params.group = &group;
+    params.rank_map = &map;
+    params.myrank = 0;
+    params.get_location = test_topo_get_location;
+
+    ucg_topo_t *topo;
+    ASSERT_EQ(ucg_topo_init(&params, &topo), UCG_OK);
+    // expect one rank-map converts the vgroup ranks to the context ranks.
+    for (int i = 0; i < UCG_TOPO_GROUP_TYPE_LAST; ++i) {
+        ucg_topo_group_t *topo_group = ucg_topo_get_group(topo, (ucg_topo_group_type_t)i);
+        ASSERT_TRUE(topo_group != NULL);
+        if (topo_group->state != UCG_TOPO_GROUP_STATE_ENABLE) {
+            continue;
+        }
+        ucg_vgroup_t *vgroup = &topo_group->super;
+        ASSERT_EQ(vgroup->ctx_rank_map.size, vgroup->size);
+        for (uint32_t vrank = 0; vrank < vgroup->size; ++vrank) {
+            ucg_rank_t group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
+            ASSERT_EQ(ucg_rank_map_eval(&vgroup->ctx_rank_map, vrank),
+                      ucg_rank_map_eval(&map, group_rank));
+        }
+    }
     ucg_topo_cleanup(topo);
 }
 
+TEST_F(test_ucg_topo, init_scale)
+{
+    ucg_rank_map_pool_t *pool;
+    ASSERT_EQ(ucg_rank_map_pool_init(&pool, UCG_LOCK_TYPE_NONE), UCG_OK);
+
+    for (int32_t size = 1024; size <= 64 * 1024; size *= 4) {
+        ucg_rank_map_t map;
+        map.type = UCG_RANK_MAP_TYPE_FULL;
+        map.size = size;
+
+        ucg_group_t group;
+        group.size = size;
+
+        ucg_topo_params_t params;
+        params.rank_map_pool = pool;
+        params.group = &group;
+        params.rank_map = &map;
+        params.myrank = size - 1;
+        params.get_location = test_topo_get_location_scaled;
+
+        test_topo_get_location_calls = 0;
+        ucg_topo_t *topo;
+        ASSERT_EQ(ucg_topo_init(&params, &topo), UCG_OK);
+
+        // a duplicated group
+        ucg_topo_t *dup_topo;
+        ASSERT_EQ(ucg_topo_init(&params, &dup_topo), UCG_OK);
+        ASSERT_EQ(topo->snapshot, dup_topo->snapshot);
+
+        for (int i = 0; i < UCG_TOPO_GROUP_TYPE_LAST; ++i) {
+            ASSERT_TRUE(ucg_topo_get_group(topo, (ucg_topo_group_type_t)i) != NULL);
+        }
+
+        // expect one callback per rank, whatever the number of groups.
+        ASSERT_EQ(test_topo_get_location_calls, size);
+        ASSERT_EQ(topo->detail.nnode, (size + ppn - 1) / ppn);
+        ucg_topo_cleanup(dup_topo);
+        ucg_topo_cleanup(topo);
+    }
+    ucg_rank_map_pool_cleanup(pool);
+}
+
 TEST_F(test_ucg_topo, get_group_no_node_id)
 {
     ucg_rank_map_t map;
@@ -245,15 +409,15 @@ TEST_F(test_ucg_topo, get_group_no_node_id)
     group.size = 10;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.myrank = 3;
     params.rank_map = &map;
-    params.get_location = test_topo_get_location;
+    params.get_location = test_topo_get_location_no_node_id;
 
     ucg_topo_t *topo;
     ASSERT_EQ(ucg_topo_init(&params, &topo), UCG_OK);
 
-    topo->get_location = test_topo_get_location_no_node_id;
     ucg_topo_group_t *topo_group;
     topo_group = ucg_topo_get_group(topo, UCG_TOPO_GROUP_TYPE_NODE);
     ASSERT_TRUE(topo_group == NULL);
@@ -273,15 +437,15 @@ TEST_F(test_ucg_topo, get_group_no_socket_id)
     group.size = 10;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.myrank = 3;
     params.rank_map = &map;
-    params.get_location = test_topo_get_location;
+    params.get_location = test_topo_get_location_no_socket_id;
 
     ucg_topo_t *topo;
     ASSERT_EQ(ucg_topo_init(&params, &topo), UCG_OK);
 
-    topo->get_location = test_topo_get_location_no_socket_id;
     ucg_topo_group_t *topo_group;
     topo_group = ucg_topo_get_group(topo, UCG_TOPO_GROUP_TYPE_SOCKET);
     ASSERT_TRUE(topo_group == NULL);
@@ -302,6 +466,7 @@ TEST_F(test_ucg_topo, get_group_fail_malloc)
     group.size = n_proc;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.rank_map = &map;
     params.myrank = 0;
@@ -343,6 +508,7 @@ TEST_F(test_ucg_topo, get_group_fail_malloc_and_retry)
     group.size = n_proc;
 
     ucg_topo_params_t params;
+    params.rank_map_pool = NULL;
     params.group = &group;
     params.rank_map = &map;
     params.myrank = 0;
@@ -376,6 +542,7 @@ public:
         group.size = n_proc;
 
         ucg_topo_params_t params;
+        params.rank_map_pool = NULL;
         params.group = &group;
         params.rank_map = &map;
         params.get_location = test_topo_get_location;
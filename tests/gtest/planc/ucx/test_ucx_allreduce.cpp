@@ -66,7 +66,6 @@ public:
         fill_config();
         static ucg_planc_ucx_context_t context = {
             .config = m_config,
-            .eps = NULL,
         };
 
         m_group.super.super.myrank = 0;
@@ -353,6 +352,29 @@ TEST_F(test_ucx_allreduce, allreduce_ring_check_error)
     EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
 }
 
+TEST_F(test_ucx_allreduce, allreduce_ring_pipeline_check_error)
+{
+    ucg_plan_op_t *op = NULL;
+    ucg_status_t status;
+    ucg_planc_ucx_group_t* ucx_group = ucg_derived_of(&m_group.super.super, ucg_planc_ucx_group_t);
+    ucx_group->context->config.reduce_consistency = 1;
+    status = ucg_planc_ucx_allreduce_ring_pipeline_prepare(&m_group.super.super, &m_args, &op);
+    ucx_group->context->config.reduce_consistency = 0;
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    ucg_plan_op_t *op1 = NULL;
+    m_args.allreduce.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED);
+    status = ucg_planc_ucx_allreduce_ring_pipeline_prepare(&m_group.super.super, &m_args, &op1);
+    m_args.allreduce.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE);
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    ucg_plan_op_t *op2 = NULL;
+    m_args.allreduce.count = 6;
+    status = ucg_planc_ucx_allreduce_ring_pipeline_prepare(&m_group.super.super, &m_args, &op2);
+    m_args.allreduce.count = 16;
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+}
+
 TEST_F(test_ucx_allreduce, allreduce_sa_kntree_check_error)
 {
     ucg_plan_op_t *op = NULL;
@@ -666,6 +688,25 @@ TEST_F(test_ucx_allreduce, allreduce_ring)
     EXPECT_EQ(status, UCG_OK);
 }
 
+TEST_F(test_ucx_allreduce, allreduce_ring_pipeline)
+{
+    ucg_plan_op_t *op = NULL;
+    ucg_status_t status;
+    status = ucg_planc_ucx_allreduce_ring_pipeline_prepare(&m_group.super.super, &m_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+
+    op->super.id = 1;
+    status = op->trigger(op);
+    EXPECT_EQ(status, UCG_OK);
+
+    ucg_planc_ucx_op_t *trigger_op = ucg_derived_of(op, ucg_planc_ucx_op_t);
+    EXPECT_GE(trigger_op->allreduce.ring_pipeline.depth, 2);
+    trigger_op->super.vgroup->size = 1;
+    status = op->trigger(op);
+    trigger_op->super.vgroup->size = 16;
+    EXPECT_EQ(status, UCG_OK);
+}
+
 TEST_F(test_ucx_allreduce, allreduce_sa_kntree)
 {
     ucg_plan_op_t *op = NULL;
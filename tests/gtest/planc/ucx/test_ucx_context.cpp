@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include <gtest/gtest.h>
@@ -41,6 +41,7 @@ TEST_F(test_planc_ucx_config, read_default_config)
     ASSERT_EQ(cfg->n_polls, 3);
     ASSERT_EQ(cfg->estimated_num_eps, 0);
     ASSERT_EQ(cfg->estimated_num_ppn, 0);
+    ASSERT_EQ(cfg->prewire, UCG_PLANC_UCX_PREWIRE_OFF);
 
     ucg_planc_ucx_config_release(config);
 }
@@ -58,6 +59,7 @@ TEST_F(test_planc_ucx_config, read_user_config)
     setenv("UCG_PLANC_UCX_NPOLLS", "20", 1);
     setenv("UCG_PLANC_UCX_ESTIMATED_NUM_EPS", "10", 1);
     setenv("UCG_PLANC_UCX_ESTIMATED_NUM_PPN", "5", 1);
+    setenv("UCG_PLANC_UCX_PREWIRE", "lazy", 1);
     ASSERT_EQ(ucg_planc_ucx_config_read(NULL, NULL, &config), UCG_OK);
 
     ucg_planc_ucx_config_t *cfg = (ucg_planc_ucx_config_t *)config;
@@ -72,8 +74,10 @@ TEST_F(test_planc_ucx_config, read_user_config)
     ASSERT_EQ(cfg->n_polls, 20);
     ASSERT_EQ(cfg->estimated_num_eps, 10);
     ASSERT_EQ(cfg->estimated_num_ppn, 5);
+    ASSERT_EQ(cfg->prewire, UCG_PLANC_UCX_PREWIRE_LAZY);
 
     ucg_planc_ucx_config_release(config);
+    unsetenv("UCG_PLANC_UCX_PREWIRE");
 }
 
 TEST_F(test_planc_ucx_config, read_user_env_prefix)
@@ -225,6 +229,28 @@ TEST_F(test_planc_ucx_context, init)
     ucg_planc_ucx_context_cleanup(context);
 }
 
+TEST_F(test_planc_ucx_context, ep_table)
+{
+    ucg_planc_context_h context;
+    ASSERT_EQ(ucg_planc_ucx_context_init(&m_params, m_config, &context), UCG_OK);
+    ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t *)context;
+
+    ASSERT_TRUE(ucg_planc_ucx_context_get_ep(ctx, 0) == NULL);
+    /* The ranks share a slot of the hot peer cache. */
+    ucp_ep_h ep0 = (ucp_ep_h)0x1000;
+    ucp_ep_h ep1 = (ucp_ep_h)0x2000;
+    ucg_rank_t rank1 = UCG_PLANC_UCX_EP_CACHE_SIZE;
+    ASSERT_EQ(ucg_planc_ucx_context_put_ep(ctx, 0, ep0), UCG_OK);
+    ASSERT_EQ(ucg_planc_ucx_context_put_ep(ctx, rank1, ep1), UCG_OK);
+    ASSERT_EQ(ucg_planc_ucx_context_get_ep(ctx, 0), ep0);
+    ASSERT_EQ(ucg_planc_ucx_context_get_ep(ctx, rank1), ep1);
+    ASSERT_EQ(ucg_planc_ucx_context_get_ep(ctx, 0), ep0);
+    ASSERT_TRUE(ucg_planc_ucx_context_get_ep(ctx, 1) == NULL);
+    ASSERT_EQ(ucg_hash_size(&ctx->eps.hash), 2);
+
+    ucg_planc_ucx_context_cleanup(context);
+}
+
 #ifdef UCG_ENABLE_CHECK_PARAMS
 TEST_F(test_planc_ucx_context, init_invalid_args)
 {
@@ -240,9 +266,6 @@ TEST_F(test_planc_ucx_context, init_fail_malloc)
     stub::mock(stub::CALLOC, result, "planc ucx context");
     ASSERT_NE(ucg_planc_ucx_context_init(&m_params, m_config, &context), UCG_OK);
 
-    stub::mock(stub::CALLOC, result, "ucp eps");
-    ASSERT_NE(ucg_planc_ucx_context_init(&m_params, m_config, &context), UCG_OK);
-
     stub::mock(stub::MALLOC, result, "ucg planc ucx config bundle");
     ASSERT_NE(ucg_planc_ucx_context_init(&m_params, m_config, &context), UCG_OK);
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2023. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
 #include <gtest/gtest.h>
@@ -9,6 +9,7 @@ extern "C" {
 #include "core/ucg_group.h"
 #include "planc/ucx/planc_ucx_context.h"
 #include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_global.h"
 }
 
 using namespace test;
@@ -67,3 +68,99 @@ TEST_F(test_planc_ucx_group, create_fail_malloc)
     ASSERT_NE(ucg_planc_ucx_group_create(m_context, &m_group_params, &planc_group), UCG_OK);
 }
 #endif
+
+class test_planc_ucx_group_prewire : public testing::Test {
+public:
+    static void *get_ucp_worker(void *arg)
+    {
+        return &m_fake_ucp;
+    }
+
+    /* Endpoints are faked by the oob group, the ep of rank i is (i + 1). */
+    static void *get_ucp_ep(void *arg, void *group, int rank)
+    {
+        return (void*)(uintptr_t)(rank + 1);
+    }
+
+    static void SetUpTestSuite()
+    {
+        stub::init();
+
+        ucg_planc_ucx_t *planc_ucx = ucg_planc_ucx_instance();
+        m_oob_resource = planc_ucx->oob_resource;
+        planc_ucx->oob_resource.get_ucp_worker = get_ucp_worker;
+        planc_ucx->oob_resource.get_ucp_context = get_ucp_worker;
+        planc_ucx->oob_resource.get_ucp_ep = get_ucp_ep;
+
+        ucg_planc_params_t params = {&m_ucg_context, UCG_THREAD_MODE_SINGLE};
+        ucg_planc_config_h config;
+        ucg_planc_ucx_config_read(NULL, NULL, &config);
+        ucg_planc_ucx_config_modify(config, "USE_OOB", "yes");
+        ucg_planc_ucx_config_modify(config, "PREWIRE", "lazy");
+        ucg_planc_ucx_context_init(&params, config, &m_context);
+        ucg_planc_ucx_config_release(config);
+
+        m_ucg_group.context = &m_ucg_context;
+        m_ucg_group.id = 1;
+        m_ucg_group.myrank = 0;
+        m_ucg_group.size = 8;
+        m_ucg_group.rank_map.type = UCG_RANK_MAP_TYPE_FULL;
+        m_ucg_group.rank_map.size = 8;
+        m_group_params.group = &m_ucg_group;
+    }
+
+    static void TearDownTestSuite()
+    {
+        ucg_planc_ucx_context_cleanup(m_context);
+        ucg_planc_ucx_instance()->oob_resource = m_oob_resource;
+        stub::cleanup();
+    }
+
+    static int m_fake_ucp;
+    static ucg_planc_ucx_oob_resource_t m_oob_resource;
+    static ucg_group_t m_ucg_group;
+    static ucg_context_t m_ucg_context;
+    static ucg_planc_context_h m_context;
+    static ucg_planc_group_params_t m_group_params;
+};
+int test_planc_ucx_group_prewire::m_fake_ucp;
+ucg_planc_ucx_oob_resource_t test_planc_ucx_group_prewire::m_oob_resource;
+ucg_group_t test_planc_ucx_group_prewire::m_ucg_group;
+ucg_context_t test_planc_ucx_group_prewire::m_ucg_context;
+ucg_planc_context_h test_planc_ucx_group_prewire::m_context = NULL;
+ucg_planc_group_params_t test_planc_ucx_group_prewire::m_group_params = {NULL};
+
+TEST_F(test_planc_ucx_group_prewire, connect_peers)
+{
+    ucg_planc_group_h planc_group;
+    ASSERT_EQ(ucg_planc_ucx_group_create(m_context, &m_group_params, &planc_group), UCG_OK);
+    ucg_planc_ucx_group_t *ucx_group = (ucg_planc_ucx_group_t*)planc_group;
+    ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t*)m_context;
+    ASSERT_EQ(ctx->config.use_oob, UCG_YES);
+
+    /* Talks to every peer, nothing to pre-wire. */
+    ucg_planc_ucx_prewire_add_peers(ucx_group, 0);
+    ASSERT_EQ(ucx_group->prewire_pending, 0);
+
+    ucg_planc_ucx_prewire_add_peers(ucx_group, UCG_PLANC_UCX_PREWIRE_PEERS_RD);
+    ucg_planc_ucx_prewire_add_peers(ucx_group, UCG_PLANC_UCX_PREWIRE_PEERS_RING);
+    ASSERT_EQ(ucx_group->prewire_pending, 1);
+    ASSERT_EQ(ucg_hash_size(&ctx->eps.hash), 0);
+
+    /* Partners of rank 0 in recursive doubling are 1, 2, 4 and ring adds 7. */
+    ucg_planc_ucx_group_prewire(ucx_group);
+    ASSERT_EQ(ucx_group->prewire_pending, 0);
+    ASSERT_EQ(ucg_hash_size(&ctx->eps.hash), 4);
+    ucg_rank_t peers[] = {1, 2, 4, 7};
+    for (ucg_rank_t peer : peers) {
+        ucg_hiter_t iter = ucg_hash_get(ucx_ep, &ctx->eps.hash, peer);
+        ASSERT_NE(iter, ucg_hash_end(&ctx->eps.hash));
+        ASSERT_EQ((uintptr_t)ucg_hash_value(&ctx->eps.hash, iter), (uintptr_t)(peer + 1));
+    }
+
+    /* Done once */
+    ucg_planc_ucx_group_prewire(ucx_group);
+    ASSERT_EQ(ucg_hash_size(&ctx->eps.hash), 4);
+
+    ucg_planc_ucx_group_destroy(planc_group);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+#include "stub.h"
+
+extern "C" {
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_plan.h"
+#include "core/ucg_def.h"
+#include "core/ucg_plan.h"
+#include "core/ucg_group.h"
+#include "util/ucg_malloc.h"
+#include "planc/ucx/reduce_scatter/reduce_scatter.h"
+#include "ucs/datastruct/mpool.h"
+}
+
+using namespace std;
+
+class test_ucx_reduce_scatter : public testing::Test {
+private:
+    static void fill_config()
+    {
+        static ucg_planc_ucx_config_bundle_t config_bundle[UCG_COLL_TYPE_LAST][UCX_MODULE_LAST];
+        for (int i = 0; i < UCG_COLL_TYPE_LAST; ++i) {
+            for (int j = 0; j < UCX_MODULE_LAST; ++j) {
+                config_bundle[i][j].data[0] = '1';
+                m_config.config_bundle[i][j] = &config_bundle[i][j];
+            }
+        }
+        return;
+    }
+public:
+    static void SetUpTestCase()
+    {
+        uint32_t size = 16;
+        ucg_rank_map_t map = {
+            .type = UCG_RANK_MAP_TYPE_FULL,
+            .size = size,
+        };
+        /* 8 nodes with 2 processes on each */
+        static ucg_topo_location_t locations[16];
+        for (int i = 0; i < 16; i++) {
+            locations[i].node_id = i / 2;
+            locations[i].socket_id = i / 2;
+        }
+        static ucg_topo_detail_t detail = {
+            .nnode = 8,
+            .locations = locations,
+        };
+        static ucg_topo_t topo = {
+            .detail = detail,
+            .ppn = 2,
+            .pps = 2,
+        };
+        static ucg_mpool_t meta_mpool;
+        (void)ucg_mpool_init(&meta_mpool, 0, sizeof(ucg_plan_meta_op_t),
+                             0, 64, UCG_ELEMS_PER_CHUNK,
+                             UINT_MAX, NULL, "meta op mpool");
+        static ucg_context_t group_context = {
+            .meta_op_mp = meta_mpool,
+        };
+        static ucg_group_t group = {
+            .context = &group_context,
+            .topo = &topo,
+            .size = size,
+        };
+        fill_config();
+        static ucg_planc_ucx_context_t context = {
+            .config = m_config,
+        };
+
+        m_group.super.super.myrank = 0;
+        m_group.super.super.size = size;
+        m_group.super.super.rank_map = map;
+        m_group.super.super.group = &group;
+        m_group.context = &context;
+
+        static ucg_mpool_t op_mpool;
+        (void)ucg_mpool_init(&op_mpool, 0, sizeof(ucg_plan_meta_op_t),
+                             0, 64, UCG_ELEMS_PER_CHUNK,
+                             UINT_MAX, NULL, "meta op mpool");
+        ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(&m_group.super.super, ucg_planc_ucx_group_t);
+        ucx_group->context->op_mp = op_mpool;
+
+        static int sendbuf[32];
+        static int recvbuf[32];
+        static int counts[16] = {2, 0, 2, 1, 2, 2, 0, 2, 2, 1, 2, 2, 2, 0, 2, 2};
+        static ucg_dt_t dt = {
+            .type = UCG_DT_TYPE_INT32,
+            .flags = (ucg_dt_flag_t)(UCG_DT_FLAG_IS_PREDEFINED | UCG_DT_FLAG_IS_CONTIGUOUS),
+            .size = sizeof(int),
+            .extent = sizeof(int),
+            .true_lb = 0,
+            .true_extent = sizeof(int),
+        };
+        static ucg_op_t op = {
+            .type = UCG_OP_TYPE_SUM,
+            .flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE),
+        };
+        m_args.type = UCG_COLL_TYPE_REDUCE_SCATTER;
+        m_args.reduce_scatter = {
+            .sendbuf = sendbuf,
+            .recvbuf = recvbuf,
+            .recvcounts = counts,
+            .dt = &dt,
+            .op = &op,
+        };
+        m_block_args.type = UCG_COLL_TYPE_REDUCE_SCATTER_BLOCK;
+        m_block_args.reduce_scatter_block = {
+            .sendbuf = sendbuf,
+            .recvbuf = recvbuf,
+            .recvcount = 2,
+            .dt = &dt,
+            .op = &op,
+        };
+        return;
+    }
+
+    static void TearDownTestCase()
+    {
+        return;
+    }
+
+    static void run_op(ucg_plan_op_t *op)
+    {
+        op->super.id = 1;
+        ucg_status_t status = op->trigger(op);
+        EXPECT_EQ(status, UCG_OK);
+        EXPECT_EQ(op->super.status, UCG_OK);
+
+        status = op->discard(op);
+        EXPECT_EQ(status, UCG_OK);
+    }
+
+    static ucg_planc_ucx_config_t m_config;
+    static ucg_planc_ucx_group_t m_group;
+    static ucg_coll_args_t m_args;
+    static ucg_coll_args_t m_block_args;
+};
+ucg_planc_ucx_config_t test_ucx_reduce_scatter::m_config;
+ucg_planc_ucx_group_t test_ucx_reduce_scatter::m_group;
+ucg_coll_args_t test_ucx_reduce_scatter::m_args;
+ucg_coll_args_t test_ucx_reduce_scatter::m_block_args;
+
+TEST_F(test_ucx_reduce_scatter, reduce_scatter_ring)
+{
+    ucg_plan_op_t *op = NULL;
+    ucg_status_t status;
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &m_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &m_block_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+
+    ucg_coll_args_t args = m_args;
+    args.reduce_scatter.sendbuf = UCG_IN_PLACE;
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+
+    // test wrong branch
+    ucg_plan_op_t *wrong_op = NULL;
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(&m_group.super.super, ucg_planc_ucx_group_t);
+    ucx_group->context->config.reduce_consistency = 1;
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &m_args, &wrong_op);
+    ucx_group->context->config.reduce_consistency = 0;
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED);
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &m_args, &wrong_op);
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE);
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    args = m_block_args;
+    args.reduce_scatter_block.recvcount = -1;
+    status = ucg_planc_ucx_reduce_scatter_ring_prepare(&m_group.super.super, &args, &wrong_op);
+    EXPECT_EQ(status, UCG_ERR_INVALID_PARAM);
+}
+
+TEST_F(test_ucx_reduce_scatter, reduce_scatter_rh)
+{
+    ucg_plan_op_t *op = NULL;
+    ucg_status_t status;
+    status = ucg_planc_ucx_reduce_scatter_rh_prepare(&m_group.super.super, &m_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+
+    /* Non-commutative ops are supported, and ranks 0 and 1 fold with 9 ranks. */
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED);
+    m_group.super.super.size = 9;
+    for (ucg_rank_t rank = 0; rank < 3; ++rank) {
+        m_group.super.super.myrank = rank;
+        status = ucg_planc_ucx_reduce_scatter_rh_prepare(&m_group.super.super, &m_block_args, &op);
+        EXPECT_EQ(status, UCG_OK);
+        run_op(op);
+    }
+    m_group.super.super.myrank = 0;
+    m_group.super.super.size = 16;
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE);
+
+    ucg_coll_args_t args = m_args;
+    args.reduce_scatter.sendbuf = UCG_IN_PLACE;
+    status = ucg_planc_ucx_reduce_scatter_rh_prepare(&m_group.super.super, &args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+}
+
+TEST_F(test_ucx_reduce_scatter, reduce_scatter_na)
+{
+    ucg_plan_op_t *op = NULL;
+    ucg_status_t status;
+    /* rank 0 is the leader of node 0 */
+    status = ucg_planc_ucx_reduce_scatter_na_prepare(&m_group.super.super, &m_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+
+    /* rank 1 is a member of node 0 */
+    m_group.super.super.myrank = 1;
+    status = ucg_planc_ucx_reduce_scatter_na_prepare(&m_group.super.super, &m_block_args, &op);
+    EXPECT_EQ(status, UCG_OK);
+    run_op(op);
+    m_group.super.super.myrank = 0;
+
+    // test wrong branch
+    ucg_plan_op_t *wrong_op1 = NULL;
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED);
+    status = ucg_planc_ucx_reduce_scatter_na_prepare(&m_group.super.super, &m_args, &wrong_op1);
+    m_args.reduce_scatter.op->flags = ucg_op_flag_t(UCG_OP_FLAG_IS_PREDEFINED | UCG_OP_FLAG_IS_COMMUTATIVE);
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    ucg_plan_op_t *wrong_op2 = NULL;
+    m_group.super.super.group->topo->ppn = 1;
+    status = ucg_planc_ucx_reduce_scatter_na_prepare(&m_group.super.super, &m_args, &wrong_op2);
+    m_group.super.super.group->topo->ppn = 2;
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+
+    ucg_plan_op_t *wrong_op3 = NULL;
+    m_group.super.super.group->topo->detail.nnode = 1;
+    status = ucg_planc_ucx_reduce_scatter_na_prepare(&m_group.super.super, &m_args, &wrong_op3);
+    m_group.super.super.group->topo->detail.nnode = 8;
+    EXPECT_EQ(status, UCG_ERR_UNSUPPORTED);
+}
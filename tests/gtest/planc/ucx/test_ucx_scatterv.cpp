@@ -70,7 +70,6 @@ public:
         fill_config();
         static ucg_planc_ucx_context_t context = {
             .config = m_config,
-            .eps = NULL,
         };
 
         m_group.super.super.myrank = 0;
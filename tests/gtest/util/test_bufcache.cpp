@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "util/ucg_bufcache.h"
+}
+
+class test_ucg_bufcache : public ::testing::Test {
+public:
+    void SetUp() override
+    {
+        ASSERT_EQ(ucg_bufcache_init(&m_cache, 4096, 2, "test bufcache"), UCG_OK);
+    }
+
+    void TearDown() override
+    {
+        ucg_bufcache_cleanup(&m_cache);
+    }
+
+    ucg_bufcache_t m_cache;
+};
+
+TEST_F(test_ucg_bufcache, reuse)
+{
+    ucg_bufcache_stats_t stats;
+
+    void *buf = ucg_bufcache_get(&m_cache, 100);
+    ASSERT_TRUE(buf != NULL);
+    ASSERT_EQ((uintptr_t)buf % 16, 0);
+    memset(buf, 0xff, 100);
+    ucg_bufcache_put(buf);
+
+    // Same size class, the buffer is reused.
+    void *buf2 = ucg_bufcache_get(&m_cache, 128);
+    ASSERT_EQ(buf2, buf);
+    // The cached one has been taken, allocate a new one.
+    void *buf3 = ucg_bufcache_get(&m_cache, 65);
+    ASSERT_TRUE(buf3 != NULL);
+    ASSERT_NE(buf3, buf2);
+    ucg_bufcache_put(buf2);
+    ucg_bufcache_put(buf3);
+
+    ucg_bufcache_get_stats(&m_cache, &stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.bypasses, 0);
+    ASSERT_EQ(stats.evictions, 0);
+}
+
+TEST_F(test_ucg_bufcache, size_class)
+{
+    ucg_bufcache_stats_t stats;
+
+    // 0 and 64 bytes share the smallest class.
+    void *buf = ucg_bufcache_get(&m_cache, 0);
+    ASSERT_TRUE(buf != NULL);
+    ucg_bufcache_put(buf);
+    ASSERT_EQ(ucg_bufcache_get(&m_cache, 64), buf);
+    ucg_bufcache_put(buf);
+
+    // 65 bytes is in another class.
+    void *buf2 = ucg_bufcache_get(&m_cache, 65);
+    ASSERT_NE(buf2, buf);
+    ucg_bufcache_put(buf2);
+
+    ucg_bufcache_get_stats(&m_cache, &stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+}
+
+TEST_F(test_ucg_bufcache, limits)
+{
+    ucg_bufcache_stats_t stats;
+
+    // Larger than the max size, never cached.
+    void *large = ucg_bufcache_get(&m_cache, 4097);
+    ASSERT_TRUE(large != NULL);
+    memset(large, 0, 4097);
+    ucg_bufcache_put(large);
+
+    // Only 2 buffers are kept in one class.
+    void *bufs[3];
+    for (int i = 0; i < 3; ++i) {
+        bufs[i] = ucg_bufcache_get(&m_cache, 4096);
+        ASSERT_TRUE(bufs[i] != NULL);
+    }
+    for (int i = 0; i < 3; ++i) {
+        ucg_bufcache_put(bufs[i]);
+    }
+
+    ucg_bufcache_get_stats(&m_cache, &stats);
+    ASSERT_EQ(stats.bypasses, 1);
+    ASSERT_EQ(stats.misses, 3);
+    ASSERT_EQ(stats.evictions, 1);
+}
+
+TEST(test_ucg_bufcache_disabled, bypass)
+{
+    ucg_bufcache_t cache;
+    ucg_bufcache_stats_t stats;
+
+    ASSERT_EQ(ucg_bufcache_init(&cache, 4096, 0, "test bufcache"), UCG_OK);
+    void *buf = ucg_bufcache_get(&cache, 64);
+    ASSERT_TRUE(buf != NULL);
+    ucg_bufcache_put(buf);
+
+    ucg_bufcache_get_stats(&cache, &stats);
+    ASSERT_EQ(stats.hits, 0);
+    ASSERT_EQ(stats.bypasses, 1);
+    ucg_bufcache_cleanup(&cache);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "util/ucg_mpsc_queue.h"
+}
+
+typedef struct test_mpsc_item {
+    ucg_mpsc_elem_t elem;
+    int producer;
+    int seq;
+} test_mpsc_item_t;
+
+TEST(test_ucg_mpsc_queue, fifo)
+{
+    ucg_mpsc_queue_t queue;
+    ucg_mpsc_queue_init(&queue);
+    ASSERT_TRUE(ucg_mpsc_queue_is_empty(&queue));
+    ASSERT_TRUE(ucg_mpsc_queue_pull_all(&queue) == NULL);
+
+    test_mpsc_item_t items[4];
+    for (int i = 0; i < 4; ++i) {
+        items[i].seq = i;
+        ucg_mpsc_queue_push(&queue, &items[i].elem);
+    }
+    ASSERT_FALSE(ucg_mpsc_queue_is_empty(&queue));
+
+    // Elements come out in push order.
+    ucg_mpsc_elem_t *elem = ucg_mpsc_queue_pull_all(&queue);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(elem, &items[i].elem);
+        elem = elem->next;
+    }
+    ASSERT_TRUE(elem == NULL);
+    ASSERT_TRUE(ucg_mpsc_queue_is_empty(&queue));
+}
+
+TEST(test_ucg_mpsc_queue, multi_producers)
+{
+    const int num_producers = 4;
+    const int num_items = 10000;
+    ucg_mpsc_queue_t queue;
+    ucg_mpsc_queue_init(&queue);
+
+    std::vector<test_mpsc_item_t> items(num_producers * num_items);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < num_items; ++i) {
+                test_mpsc_item_t *item = &items[p * num_items + i];
+                item->producer = p;
+                item->seq = i;
+                ucg_mpsc_queue_push(&queue, &item->elem);
+            }
+        });
+    }
+
+    // Consume while producing, every producer's items keep their order.
+    std::vector<int> next_seq(num_producers, 0);
+    int count = 0;
+    while (count < num_producers * num_items) {
+        ucg_mpsc_elem_t *elem = ucg_mpsc_queue_pull_all(&queue);
+        while (elem != NULL) {
+            test_mpsc_item_t *item = (test_mpsc_item_t*)elem;
+            elem = elem->next;
+            ASSERT_EQ(item->seq, next_seq[item->producer]);
+            ++next_seq[item->producer];
+            ++count;
+        }
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    ASSERT_TRUE(ucg_mpsc_queue_is_empty(&queue));
+}
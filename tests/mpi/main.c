@@ -1,8 +1,663 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
-int main(int argc, char **argv)
+#include <ucg/api/ucg.h>
+#include "util/ucg_local_cluster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Verify the collective operations on a local cluster. Every topology runs all
+ * the selected collectives with data checks, so plans depending on node, socket
+ * or subnet information can be regression-tested on one host.
+ */
+
+#define UCG_TEST_DEFAULT_COUNT  100
+#define UCG_TEST_MAX_NAME_LEN   32
+
+typedef enum ucg_test_coll {
+    UCG_TEST_COLL_BCAST,
+    UCG_TEST_COLL_ALLREDUCE,
+    UCG_TEST_COLL_BARRIER,
+    UCG_TEST_COLL_SCATTERV,
+    UCG_TEST_COLL_GATHERV,
+    UCG_TEST_COLL_ALLGATHERV,
+    UCG_TEST_COLL_ALLTOALLV,
+    UCG_TEST_COLL_REDUCE_SCATTER,
+    UCG_TEST_COLL_REDUCE_SCATTER_BLOCK,
+    UCG_TEST_COLL_REDUCE,
+    UCG_TEST_COLL_SCAN,
+    UCG_TEST_COLL_EXSCAN,
+    UCG_TEST_COLL_ALLGATHER,
+    UCG_TEST_COLL_LAST,
+} ucg_test_coll_t;
+
+static const char *ucg_test_coll_names[UCG_TEST_COLL_LAST] = {
+    [UCG_TEST_COLL_BCAST] = "bcast",
+    [UCG_TEST_COLL_ALLREDUCE] = "allreduce",
+    [UCG_TEST_COLL_BARRIER] = "barrier",
+    [UCG_TEST_COLL_SCATTERV] = "scatterv",
+    [UCG_TEST_COLL_GATHERV] = "gatherv",
+    [UCG_TEST_COLL_ALLGATHERV] = "allgatherv",
+    [UCG_TEST_COLL_ALLTOALLV] = "alltoallv",
+    [UCG_TEST_COLL_REDUCE_SCATTER] = "reduce_scatter",
+    [UCG_TEST_COLL_REDUCE_SCATTER_BLOCK] = "reduce_scatter_block",
+    [UCG_TEST_COLL_REDUCE] = "reduce",
+    [UCG_TEST_COLL_SCAN] = "scan",
+    [UCG_TEST_COLL_EXSCAN] = "exscan",
+    [UCG_TEST_COLL_ALLGATHER] = "allgather",
+};
+
+static const char *ucg_test_coll_attr_env[UCG_TEST_COLL_LAST][2] = {
+    [UCG_TEST_COLL_BCAST] = {"UCG_PLANC_UCX_BCAST_ATTR", "UCG_PLANC_UCX_IBCAST_ATTR"},
+    [UCG_TEST_COLL_ALLREDUCE] = {"UCG_PLANC_UCX_ALLREDUCE_ATTR", "UCG_PLANC_UCX_IALLREDUCE_ATTR"},
+    [UCG_TEST_COLL_BARRIER] = {"UCG_PLANC_UCX_BARRIER_ATTR", "UCG_PLANC_UCX_IBARRIER_ATTR"},
+    [UCG_TEST_COLL_SCATTERV] = {"UCG_PLANC_UCX_SCATTERV_ATTR", "UCG_PLANC_UCX_ISCATTERV_ATTR"},
+    [UCG_TEST_COLL_GATHERV] = {"UCG_PLANC_UCX_GATHERV_ATTR", "UCG_PLANC_UCX_IGATHERV_ATTR"},
+    [UCG_TEST_COLL_ALLGATHERV] = {"UCG_PLANC_UCX_ALLGATHERV_ATTR", "UCG_PLANC_UCX_IALLGATHERV_ATTR"},
+    [UCG_TEST_COLL_ALLTOALLV] = {"UCG_PLANC_UCX_ALLTOALLV_ATTR", "UCG_PLANC_UCX_IALLTOALLV_ATTR"},
+    [UCG_TEST_COLL_REDUCE_SCATTER] = {"UCG_PLANC_UCX_REDUCE_SCATTER_ATTR",
+                                      "UCG_PLANC_UCX_IREDUCE_SCATTER_ATTR"},
+    [UCG_TEST_COLL_REDUCE_SCATTER_BLOCK] = {"UCG_PLANC_UCX_REDUCE_SCATTER_BLOCK_ATTR",
+                                            "UCG_PLANC_UCX_IREDUCE_SCATTER_BLOCK_ATTR"},
+    [UCG_TEST_COLL_REDUCE] = {"UCG_PLANC_UCX_REDUCE_ATTR", "UCG_PLANC_UCX_IREDUCE_ATTR"},
+    [UCG_TEST_COLL_SCAN] = {"UCG_PLANC_UCX_SCAN_ATTR", "UCG_PLANC_UCX_ISCAN_ATTR"},
+    [UCG_TEST_COLL_EXSCAN] = {"UCG_PLANC_UCX_EXSCAN_ATTR", "UCG_PLANC_UCX_IEXSCAN_ATTR"},
+    [UCG_TEST_COLL_ALLGATHER] = {"UCG_PLANC_UCX_ALLGATHER_ATTR", "UCG_PLANC_UCX_IALLGATHER_ATTR"},
+};
+
+/* Default topologies: uniform, multi-subnet, and irregular last node. */
+static const ucg_lcluster_params_t ucg_test_topos[] = {
+    {.nranks = 8, .ppn = 4, .pps = 2, .nps = 0},
+    {.nranks = 8, .ppn = 2, .pps = 1, .nps = 2},
+    {.nranks = 7, .ppn = 3, .pps = 2, .nps = 0},
+    {.nranks = 4, .ppn = 0, .pps = 0, .nps = 0},
+};
+
+typedef struct ucg_test_params {
+    uint64_t colls;
+    int32_t count;
+    ucg_request_type_t nb;
+} ucg_test_params_t;
+
+typedef struct ucg_test_ctx {
+    ucg_lcluster_rank_t *rank;
+    const ucg_test_params_t *params;
+    ucg_dt_h dt;
+    ucg_op_h op;
+    int32_t *sendbuf;
+    int32_t *recvbuf;
+    int32_t *scounts;
+    int32_t *sdispls;
+    int32_t *rcounts;
+    int32_t *rdispls;
+} ucg_test_ctx_t;
+
+static void usage()
+{
+    printf("Usage: ucg_mpi [options]\n");
+    printf("Verify collectives on a local cluster, no launcher is needed.\n");
+    printf("  -c <colls>      Comma-separated list of collectives, default all\n");
+    printf("                  bcast,allreduce,barrier,scatterv,gatherv,allgatherv,alltoallv,\n");
+    printf("                  reduce_scatter,reduce_scatter_block,reduce,scan,exscan,\n");
+    printf("                  allgather\n");
+    printf("  -n <nranks>     Number of ranks, default runs several built-in topologies\n");
+    printf("  -p <ppn>        Ranks per synthetic node, default all ranks on one node\n");
+    printf("  -s <pps>        Ranks per synthetic socket, default ppn\n");
+    printf("  -S <nps>        Synthetic nodes per subnet, default all nodes in one subnet\n");
+    printf("  -t              Run ranks as threads instead of processes\n");
+    printf("  -C <count>      Base element count, default %d\n", UCG_TEST_DEFAULT_COUNT);
+    printf("  -A <plan id>    Force the plan through UCG_PLANC_UCX_<COLL>_ATTR\n");
+    printf("  -N              Use nonblocking requests\n");
+    printf("  -h              Show this help\n");
+    return;
+}
+
+static inline int32_t ucg_test_value(ucg_rank_t src, ucg_rank_t dst, int32_t i)
+{
+    return src * 1000003 + dst * 1009 + i;
+}
+
+/* Count from rank src to rank dst of the vector collectives. */
+static inline int32_t ucg_test_vcount(const ucg_test_ctx_t *ctx, ucg_rank_t src,
+                                      ucg_rank_t dst, ucg_test_coll_t coll)
+{
+    int32_t count = ctx->params->count;
+    if (coll == UCG_TEST_COLL_ALLTOALLV) {
+        return count + (src + dst) % 3;
+    }
+    /* Reduce_scatter: the count depends on the owner of the block. */
+    if (coll == UCG_TEST_COLL_REDUCE_SCATTER) {
+        return count + dst % 3;
+    }
+    if (coll == UCG_TEST_COLL_REDUCE_SCATTER_BLOCK || coll == UCG_TEST_COLL_ALLGATHER) {
+        return count;
+    }
+    /* Rooted and allgatherv collectives: the count depends on the non-root. */
+    return count + (coll == UCG_TEST_COLL_SCATTERV ? dst : src);
+}
+
+static ucg_status_t ucg_test_request_run(ucg_request_h request)
+{
+    ucg_status_t status = ucg_request_start(request);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    do {
+        status = ucg_request_test(request);
+    } while (status == UCG_INPROGRESS);
+    return status;
+}
+
+static void ucg_test_fill_vector(ucg_test_ctx_t *ctx, ucg_test_coll_t coll, ucg_rank_t root)
+{
+    ucg_rank_t myrank = ctx->rank->myrank;
+    uint32_t size = ctx->rank->size;
+    int32_t sdispl = 0;
+    int32_t rdispl = 0;
+
+    for (ucg_rank_t peer = 0; peer < size; ++peer) {
+        switch (coll) {
+            case UCG_TEST_COLL_SCATTERV:
+                ctx->scounts[peer] = ucg_test_vcount(ctx, root, peer, coll);
+                ctx->rcounts[peer] = 0;
+                break;
+            case UCG_TEST_COLL_GATHERV:
+                ctx->scounts[peer] = 0;
+                ctx->rcounts[peer] = ucg_test_vcount(ctx, peer, root, coll);
+                break;
+            case UCG_TEST_COLL_ALLGATHERV:
+            case UCG_TEST_COLL_ALLGATHER:
+                ctx->scounts[peer] = 0;
+                ctx->rcounts[peer] = ucg_test_vcount(ctx, peer, 0, coll);
+                break;
+            case UCG_TEST_COLL_REDUCE_SCATTER:
+            case UCG_TEST_COLL_REDUCE_SCATTER_BLOCK:
+                ctx->scounts[peer] = 0;
+                ctx->rcounts[peer] = ucg_test_vcount(ctx, 0, peer, coll);
+                break;
+            default:
+                ctx->scounts[peer] = ucg_test_vcount(ctx, myrank, peer, coll);
+                ctx->rcounts[peer] = ucg_test_vcount(ctx, peer, myrank, coll);
+                break;
+        }
+        ctx->sdispls[peer] = sdispl;
+        ctx->rdispls[peer] = rdispl;
+        sdispl += ctx->scounts[peer];
+        rdispl += ctx->rcounts[peer];
+    }
+    return;
+}
+
+static ucg_status_t ucg_test_request_init(ucg_test_ctx_t *ctx, ucg_test_coll_t coll,
+                                          ucg_rank_t root, ucg_request_h *request)
+{
+    ucg_group_h group = ctx->rank->group;
+    ucg_rank_t myrank = ctx->rank->myrank;
+    ucg_request_type_t nb = ctx->params->nb;
+    int32_t count = ctx->params->count;
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+
+    switch (coll) {
+        case UCG_TEST_COLL_BCAST:
+            return ucg_request_bcast_init(ctx->recvbuf, count, ctx->dt, root,
+                                          group, &info, nb, request);
+        case UCG_TEST_COLL_ALLREDUCE:
+            return ucg_request_allreduce_init(ctx->sendbuf, ctx->recvbuf, count,
+                                              ctx->dt, ctx->op, group, &info,
+                                              nb, request);
+        case UCG_TEST_COLL_BARRIER:
+            return ucg_request_barrier_init(group, &info, nb, request);
+        case UCG_TEST_COLL_SCATTERV:
+            return ucg_request_scatterv_init(ctx->sendbuf, ctx->scounts, ctx->sdispls,
+                                             ctx->dt, ctx->recvbuf,
+                                             ucg_test_vcount(ctx, root, myrank, coll),
+                                             ctx->dt, root, group, &info, nb, request);
+        case UCG_TEST_COLL_GATHERV:
+            return ucg_request_gatherv_init(ctx->sendbuf,
+                                            ucg_test_vcount(ctx, myrank, root, coll),
+                                            ctx->dt, ctx->recvbuf, ctx->rcounts,
+                                            ctx->rdispls, ctx->dt, root, group,
+                                            &info, nb, request);
+        case UCG_TEST_COLL_ALLGATHERV:
+            return ucg_request_allgatherv_init(ctx->sendbuf,
+                                               ucg_test_vcount(ctx, myrank, 0, coll),
+                                               ctx->dt, ctx->recvbuf, ctx->rcounts,
+                                               ctx->rdispls, ctx->dt, group, &info,
+                                               nb, request);
+        case UCG_TEST_COLL_ALLGATHER:
+            return ucg_request_allgather_init(ctx->sendbuf, count, ctx->dt, ctx->recvbuf,
+                                              count, ctx->dt, group, &info, nb, request);
+        case UCG_TEST_COLL_ALLTOALLV:
+            return ucg_request_alltoallv_init(ctx->sendbuf, ctx->scounts, ctx->sdispls,
+                                              ctx->dt, ctx->recvbuf, ctx->rcounts,
+                                              ctx->rdispls, ctx->dt, group, &info,
+                                              nb, request);
+        case UCG_TEST_COLL_REDUCE_SCATTER:
+            return ucg_request_reduce_scatter_init(ctx->sendbuf, ctx->recvbuf, ctx->rcounts,
+                                                   ctx->dt, ctx->op, group, &info, nb,
+                                                   request);
+        case UCG_TEST_COLL_REDUCE_SCATTER_BLOCK:
+            return ucg_request_reduce_scatter_block_init(ctx->sendbuf, ctx->recvbuf, count,
+                                                         ctx->dt, ctx->op, group, &info,
+                                                         nb, request);
+        case UCG_TEST_COLL_REDUCE:
+            return ucg_request_reduce_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                           ctx->op, root, group, &info, nb, request);
+        case UCG_TEST_COLL_SCAN:
+            return ucg_request_scan_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                         ctx->op, group, &info, nb, request);
+        case UCG_TEST_COLL_EXSCAN:
+            return ucg_request_exscan_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                           ctx->op, group, &info, nb, request);
+        default:
+            return UCG_ERR_UNSUPPORTED;
+    }
+}
+
+static void ucg_test_fill(ucg_test_ctx_t *ctx, ucg_test_coll_t coll, ucg_rank_t root)
+{
+    ucg_rank_t myrank = ctx->rank->myrank;
+    uint32_t size = ctx->rank->size;
+    int32_t count = ctx->params->count;
+
+    ucg_test_fill_vector(ctx, coll, root);
+    switch (coll) {
+        case UCG_TEST_COLL_BCAST:
+            for (int32_t i = 0; i < count; ++i) {
+                ctx->recvbuf[i] = myrank == root ? ucg_test_value(root, 0, i) : -1;
+            }
+            break;
+        case UCG_TEST_COLL_ALLREDUCE:
+        case UCG_TEST_COLL_REDUCE:
+        case UCG_TEST_COLL_SCAN:
+        case UCG_TEST_COLL_EXSCAN:
+            for (int32_t i = 0; i < count; ++i) {
+                ctx->sendbuf[i] = myrank + i;
+                ctx->recvbuf[i] = -1;
+            }
+            break;
+        case UCG_TEST_COLL_SCATTERV:
+            for (ucg_rank_t peer = 0; peer < size; ++peer) {
+                int32_t *block = ctx->sendbuf + ctx->sdispls[peer];
+                for (int32_t i = 0; i < ctx->scounts[peer]; ++i) {
+                    block[i] = ucg_test_value(root, peer, i);
+                }
+            }
+            memset(ctx->recvbuf, 0xff, ucg_test_vcount(ctx, root, myrank, coll) * sizeof(int32_t));
+            break;
+        case UCG_TEST_COLL_GATHERV:
+        case UCG_TEST_COLL_ALLGATHERV:
+        case UCG_TEST_COLL_ALLGATHER:
+            {
+                ucg_rank_t dst = coll == UCG_TEST_COLL_GATHERV ? root : 0;
+                for (int32_t i = 0; i < ucg_test_vcount(ctx, myrank, dst, coll); ++i) {
+                    ctx->sendbuf[i] = ucg_test_value(myrank, dst, i);
+                }
+                int32_t total = ctx->rdispls[size - 1] + ctx->rcounts[size - 1];
+                memset(ctx->recvbuf, 0xff, total * sizeof(int32_t));
+            }
+            break;
+        case UCG_TEST_COLL_ALLTOALLV:
+            for (ucg_rank_t peer = 0; peer < size; ++peer) {
+                int32_t *block = ctx->sendbuf + ctx->sdispls[peer];
+                for (int32_t i = 0; i < ctx->scounts[peer]; ++i) {
+                    block[i] = ucg_test_value(myrank, peer, i);
+                }
+                memset(ctx->recvbuf + ctx->rdispls[peer], 0xff,
+                       ctx->rcounts[peer] * sizeof(int32_t));
+            }
+            break;
+        case UCG_TEST_COLL_REDUCE_SCATTER:
+        case UCG_TEST_COLL_REDUCE_SCATTER_BLOCK:
+            {
+                int32_t total = ctx->rdispls[size - 1] + ctx->rcounts[size - 1];
+                for (int32_t i = 0; i < total; ++i) {
+                    ctx->sendbuf[i] = myrank + i;
+                }
+                memset(ctx->recvbuf, 0xff, ctx->rcounts[myrank] * sizeof(int32_t));
+            }
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+static int ucg_test_check_block(const int32_t *buf, int32_t count, ucg_rank_t src,
+                                ucg_rank_t dst, ucg_test_ctx_t *ctx, const char *name)
+{
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t expect = ucg_test_value(src, dst, i);
+        if (buf[i] != expect) {
+            fprintf(stderr, "rank %d: %s mismatch, block of rank %d, index %d, "
+                    "expect %d actual %d\n", ctx->rank->myrank, name, src, i,
+                    expect, buf[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int ucg_test_check(ucg_test_ctx_t *ctx, ucg_test_coll_t coll, ucg_rank_t root)
+{
+    const char *name = ucg_test_coll_names[coll];
+    ucg_rank_t myrank = ctx->rank->myrank;
+    uint32_t size = ctx->rank->size;
+    int32_t count = ctx->params->count;
+
+    switch (coll) {
+        case UCG_TEST_COLL_BCAST:
+            return ucg_test_check_block(ctx->recvbuf, count, root, 0, ctx, name);
+        case UCG_TEST_COLL_REDUCE:
+            /* recvbuf is significant only at root */
+            if (myrank != root) {
+                return 0;
+            }
+            /* fall through */
+        case UCG_TEST_COLL_ALLREDUCE:
+            for (int32_t i = 0; i < count; ++i) {
+                int32_t expect = (int32_t)size * i + (int32_t)(size * (size - 1) / 2);
+                if (ctx->recvbuf[i] != expect) {
+                    fprintf(stderr, "rank %d: %s mismatch, index %d, expect %d actual %d\n",
+                            myrank, name, i, expect, ctx->recvbuf[i]);
+                    return -1;
+                }
+            }
+            return 0;
+        case UCG_TEST_COLL_EXSCAN:
+            /* recvbuf of rank 0 is undefined */
+            if (myrank == 0) {
+                return 0;
+            }
+            /* fall through */
+        case UCG_TEST_COLL_SCAN:
+            {
+                /* Reduction of the inputs of ranks [0, nrank) */
+                int32_t nrank = coll == UCG_TEST_COLL_SCAN ? myrank + 1 : myrank;
+                for (int32_t i = 0; i < count; ++i) {
+                    int32_t expect = nrank * i + nrank * (nrank - 1) / 2;
+                    if (ctx->recvbuf[i] != expect) {
+                        fprintf(stderr, "rank %d: %s mismatch, index %d, expect %d actual %d\n",
+                                myrank, name, i, expect, ctx->recvbuf[i]);
+                        return -1;
+                    }
+                }
+            }
+            return 0;
+        case UCG_TEST_COLL_REDUCE_SCATTER:
+        case UCG_TEST_COLL_REDUCE_SCATTER_BLOCK:
+            /* Element i of my block is element rdispls[myrank] + i of the vector. */
+            for (int32_t i = 0; i < ctx->rcounts[myrank]; ++i) {
+                int32_t idx = ctx->rdispls[myrank] + i;
+                int32_t expect = (int32_t)size * idx + (int32_t)(size * (size - 1) / 2);
+                if (ctx->recvbuf[i] != expect) {
+                    fprintf(stderr, "rank %d: %s mismatch, index %d, expect %d actual %d\n",
+                            myrank, name, i, expect, ctx->recvbuf[i]);
+                    return -1;
+                }
+            }
+            return 0;
+        case UCG_TEST_COLL_SCATTERV:
+            return ucg_test_check_block(ctx->recvbuf, ucg_test_vcount(ctx, root, myrank, coll),
+                                        root, myrank, ctx, name);
+        case UCG_TEST_COLL_GATHERV:
+            if (myrank != root) {
+                return 0;
+            }
+            /* fall through */
+        case UCG_TEST_COLL_ALLGATHERV:
+        case UCG_TEST_COLL_ALLGATHER:
+        case UCG_TEST_COLL_ALLTOALLV:
+            for (ucg_rank_t peer = 0; peer < size; ++peer) {
+                ucg_rank_t dst = coll == UCG_TEST_COLL_GATHERV ? root :
+                                 coll == UCG_TEST_COLL_ALLTOALLV ? myrank : 0;
+                if (ucg_test_check_block(ctx->recvbuf + ctx->rdispls[peer],
+                                         ctx->rcounts[peer], peer, dst, ctx, name) != 0) {
+                    return -1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int ucg_test_run_once(ucg_test_ctx_t *ctx, ucg_test_coll_t coll, ucg_rank_t root)
+{
+    ucg_request_h request;
+    ucg_status_t status;
+
+    ucg_test_fill(ctx, coll, root);
+    status = ucg_test_request_init(ctx, coll, root, &request);
+    if (status != UCG_OK) {
+        fprintf(stderr, "rank %d: failed to init %s request, %s\n",
+                ctx->rank->myrank, ucg_test_coll_names[coll], ucg_status_string(status));
+        return -1;
+    }
+
+    /* Start twice to cover the persistent request. */
+    int ret = 0;
+    for (int i = 0; i < 2 && ret == 0; ++i) {
+        status = ucg_test_request_run(request);
+        if (status != UCG_OK) {
+            fprintf(stderr, "rank %d: failed to run %s request, %s\n",
+                    ctx->rank->myrank, ucg_test_coll_names[coll], ucg_status_string(status));
+            ret = -1;
+            break;
+        }
+        ret = ucg_test_check(ctx, coll, root);
+        ucg_test_fill(ctx, coll, root);
+    }
+    ucg_request_cleanup(request);
+    return ret;
+}
+
+static int ucg_test_run_coll(ucg_test_ctx_t *ctx, ucg_test_coll_t coll)
+{
+    ucg_lcluster_rank_t *rank = ctx->rank;
+    ucg_rank_t roots[] = {0, rank->size - 1};
+    int nroots = 1;
+
+    if (coll == UCG_TEST_COLL_BCAST || coll == UCG_TEST_COLL_SCATTERV ||
+        coll == UCG_TEST_COLL_GATHERV || coll == UCG_TEST_COLL_REDUCE) {
+        nroots = rank->size > 1 ? 2 : 1;
+    }
+
+    int failed = 0;
+    for (int i = 0; i < nroots && !failed; ++i) {
+        failed = ucg_test_run_once(ctx, coll, roots[i]) != 0;
+    }
+
+    /* A failed rank still joins the exchange so that nobody waits forever. */
+    int all_failed[rank->size];
+    if (rank->oob_group.allgather(&failed, all_failed, sizeof(int),
+                                  rank->oob_group.group) != UCG_OK) {
+        return -1;
+    }
+    failed = 0;
+    for (uint32_t i = 0; i < rank->size; ++i) {
+        failed |= all_failed[i];
+    }
+    if (rank->myrank == 0) {
+        printf("  %-20s %s\n", ucg_test_coll_names[coll], failed ? "FAIL" : "PASS");
+    }
+    return failed ? -1 : 0;
+}
+
+static int ucg_test_rank_run(ucg_lcluster_rank_t *rank, void *arg)
+{
+    const ucg_test_params_t *params = (const ucg_test_params_t*)arg;
+    int ret = -1;
+    ucg_test_ctx_t ctx = {
+        .rank = rank,
+        .params = params,
+    };
+
+    ucg_dt_params_t dt_params = {
+        .field_mask = UCG_DT_PARAMS_FIELD_TYPE,
+        .type = UCG_DT_TYPE_INT32,
+    };
+    if (ucg_dt_create(&dt_params, &ctx.dt) != UCG_OK) {
+        return ret;
+    }
+
+    ucg_op_params_t op_params = {
+        .field_mask = UCG_OP_PARAMS_FIELD_TYPE,
+        .type = UCG_OP_TYPE_SUM,
+    };
+    if (ucg_op_create(&op_params, &ctx.op) != UCG_OK) {
+        goto err_destroy_dt;
+    }
+
+    /* The largest block is count + size - 1 elements. */
+    size_t buf_len = (size_t)(params->count + rank->size) * rank->size;
+    ctx.sendbuf = malloc(buf_len * sizeof(int32_t));
+    ctx.recvbuf = malloc(buf_len * sizeof(int32_t));
+    ctx.scounts = malloc(rank->size * sizeof(int32_t));
+    ctx.sdispls = malloc(rank->size * sizeof(int32_t));
+    ctx.rcounts = malloc(rank->size * sizeof(int32_t));
+    ctx.rdispls = malloc(rank->size * sizeof(int32_t));
+    if (ctx.sendbuf == NULL || ctx.recvbuf == NULL || ctx.scounts == NULL ||
+        ctx.sdispls == NULL || ctx.rcounts == NULL || ctx.rdispls == NULL) {
+        fprintf(stderr, "rank %d: failed to allocate buffers\n", rank->myrank);
+        goto out_free;
+    }
+
+    ret = 0;
+    for (ucg_test_coll_t coll = 0; coll < UCG_TEST_COLL_LAST; ++coll) {
+        if ((params->colls & UCG_BIT(coll)) && ucg_test_run_coll(&ctx, coll) != 0) {
+            ret = -1;
+        }
+    }
+
+out_free:
+    free(ctx.rdispls);
+    free(ctx.rcounts);
+    free(ctx.sdispls);
+    free(ctx.scounts);
+    free(ctx.recvbuf);
+    free(ctx.sendbuf);
+    ucg_op_destroy(ctx.op);
+err_destroy_dt:
+    ucg_dt_destroy(ctx.dt);
+    return ret;
+}
+
+static int ucg_test_parse_colls(char *str, uint64_t *colls)
 {
+    *colls = 0;
+    for (char *name = strtok(str, ","); name != NULL; name = strtok(NULL, ",")) {
+        ucg_test_coll_t coll;
+        for (coll = 0; coll < UCG_TEST_COLL_LAST; ++coll) {
+            if (!strcmp(name, ucg_test_coll_names[coll])) {
+                *colls |= UCG_BIT(coll);
+                break;
+            }
+        }
+        if (coll == UCG_TEST_COLL_LAST) {
+            fprintf(stderr, "Unknown collective '%s'\n", name);
+            return -1;
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char **argv)
+{
+    ucg_test_params_t params = {
+        .colls = UCG_MASK(UCG_TEST_COLL_LAST),
+        .count = UCG_TEST_DEFAULT_COUNT,
+        .nb = UCG_REQUEST_BLOCKING,
+    };
+    ucg_lcluster_params_t topo = {
+        .mode = UCG_LCLUSTER_MODE_PROCESS,
+    };
+    ucg_lcluster_mode_t mode = UCG_LCLUSTER_MODE_PROCESS;
+    int plan_id = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:p:s:S:tC:A:Nh")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (ucg_test_parse_colls(optarg, &params.colls) != 0) {
+                    usage();
+                    return -1;
+                }
+                break;
+            case 'n':
+                topo.nranks = atoi(optarg);
+                break;
+            case 'p':
+                topo.ppn = atoi(optarg);
+                break;
+            case 's':
+                topo.pps = atoi(optarg);
+                break;
+            case 'S':
+                topo.nps = atoi(optarg);
+                break;
+            case 't':
+                mode = UCG_LCLUSTER_MODE_THREAD;
+                break;
+            case 'C':
+                params.count = atoi(optarg);
+                break;
+            case 'A':
+                plan_id = atoi(optarg);
+                break;
+            case 'N':
+                params.nb = UCG_REQUEST_NONBLOCKING;
+                break;
+            case 'h':
+            default:
+                usage();
+                return -1;
+        }
+    }
+    if (params.count <= 0) {
+        usage();
+        return -1;
+    }
+
+    /* Must be done before launching so that every rank reads the same configuration. */
+    if (plan_id >= 0) {
+        char attr[UCG_TEST_MAX_NAME_LEN];
+        snprintf(attr, sizeof(attr), "I:%d", plan_id);
+        for (ucg_test_coll_t coll = 0; coll < UCG_TEST_COLL_LAST; ++coll) {
+            if (params.colls & UCG_BIT(coll)) {
+                setenv(ucg_test_coll_attr_env[coll][params.nb], attr, 1);
+            }
+        }
+    }
+
+    const ucg_lcluster_params_t *topos = ucg_test_topos;
+    int ntopos = sizeof(ucg_test_topos) / sizeof(ucg_test_topos[0]);
+    if (topo.nranks > 0) {
+        topos = &topo;
+        ntopos = 1;
+    }
+
+    int failed = 0;
+    for (int i = 0; i < ntopos; ++i) {
+        ucg_lcluster_params_t cluster = topos[i];
+        cluster.mode = mode;
+        printf("# %u ranks, %u per node, %u per socket, %u nodes per subnet, %s\n",
+               cluster.nranks, cluster.ppn, cluster.pps, cluster.nps,
+               mode == UCG_LCLUSTER_MODE_THREAD ? "threads" : "processes");
+        fflush(stdout);
+        if (ucg_lcluster_run(&cluster, ucg_test_rank_run, &params) != UCG_OK) {
+            failed = 1;
+        }
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,950 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ucg_perf_coll_info {
+    const char *name;
+    const char *attr_env;
+    const char *iattr_env;
+    ucg_dt_type_t dt_type;
+    uint32_t dt_size;
+} ucg_perf_coll_info_t;
+
+static const ucg_perf_coll_info_t ucg_perf_coll_info[UCG_PERF_COLL_LAST] = {
+    [UCG_PERF_COLL_BCAST] = {
+        "bcast", "UCG_PLANC_UCX_BCAST_ATTR", "UCG_PLANC_UCX_IBCAST_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_ALLREDUCE] = {
+        "allreduce", "UCG_PLANC_UCX_ALLREDUCE_ATTR", "UCG_PLANC_UCX_IALLREDUCE_ATTR",
+        UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_BARRIER] = {
+        "barrier", "UCG_PLANC_UCX_BARRIER_ATTR", "UCG_PLANC_UCX_IBARRIER_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_SCATTERV] = {
+        "scatterv", "UCG_PLANC_UCX_SCATTERV_ATTR", "UCG_PLANC_UCX_ISCATTERV_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_GATHERV] = {
+        "gatherv", "UCG_PLANC_UCX_GATHERV_ATTR", "UCG_PLANC_UCX_IGATHERV_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_ALLGATHERV] = {
+        "allgatherv", "UCG_PLANC_UCX_ALLGATHERV_ATTR", "UCG_PLANC_UCX_IALLGATHERV_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_ALLTOALLV] = {
+        "alltoallv", "UCG_PLANC_UCX_ALLTOALLV_ATTR", "UCG_PLANC_UCX_IALLTOALLV_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+    [UCG_PERF_COLL_REDUCE_SCATTER] = {
+        "reduce_scatter", "UCG_PLANC_UCX_REDUCE_SCATTER_ATTR",
+        "UCG_PLANC_UCX_IREDUCE_SCATTER_ATTR", UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_REDUCE_SCATTER_BLOCK] = {
+        "reduce_scatter_block", "UCG_PLANC_UCX_REDUCE_SCATTER_BLOCK_ATTR",
+        "UCG_PLANC_UCX_IREDUCE_SCATTER_BLOCK_ATTR", UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_REDUCE] = {
+        "reduce", "UCG_PLANC_UCX_REDUCE_ATTR", "UCG_PLANC_UCX_IREDUCE_ATTR",
+        UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_SCAN] = {
+        "scan", "UCG_PLANC_UCX_SCAN_ATTR", "UCG_PLANC_UCX_ISCAN_ATTR",
+        UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_EXSCAN] = {
+        "exscan", "UCG_PLANC_UCX_EXSCAN_ATTR", "UCG_PLANC_UCX_IEXSCAN_ATTR",
+        UCG_DT_TYPE_INT32, 4
+    },
+    [UCG_PERF_COLL_ALLGATHER] = {
+        "allgather", "UCG_PLANC_UCX_ALLGATHER_ATTR", "UCG_PLANC_UCX_IALLGATHER_ATTR",
+        UCG_DT_TYPE_INT8, 1
+    },
+};
+
+/* Statistics of one message size, identical layout on all ranks. */
+typedef struct ucg_perf_stat {
+    double min;
+    double avg;
+    double p99;
+} ucg_perf_stat_t;
+
+/* Overlap of one message size, identical layout on all ranks. */
+typedef struct ucg_perf_overlap {
+    double comm; /* us, the collective alone */
+    double comp; /* us */
+    double total; /* us, the collective overlapped with the computation */
+    double overlap; /* percentage */
+} ucg_perf_overlap_t;
+
+/* Batch of one message size, identical layout on all ranks. */
+typedef struct ucg_perf_batch {
+    double single; /* us, the requests are started and tested one by one */
+    double batched; /* us, ucg_request_startall() and ucg_request_testall() */
+} ucg_perf_batch_t;
+
+/* Shared by the collective threads of one rank. */
+typedef struct ucg_perf_mt {
+    pthread_barrier_t barrier;
+    int failed;
+    /* Local statistics of every thread */
+    ucg_perf_stat_t *stats;
+} ucg_perf_mt_t;
+
+/* Resources shared by all iterations of one collective. */
+typedef struct ucg_perf_coll_ctx {
+    ucg_lcluster_rank_t *rank;
+    const ucg_perf_params_t *params;
+    ucg_perf_coll_t coll;
+    ucg_group_h group;
+    /* NULL if the rank has only one collective thread */
+    ucg_perf_mt_t *mt;
+    int tid;
+    int ret;
+    ucg_dt_h dt;
+    ucg_op_h op;
+    void *sendbuf;
+    void *recvbuf;
+    int32_t *counts;
+    int32_t *displs;
+    /* Latency of every measured iteration */
+    double *lat;
+} ucg_perf_coll_ctx_t;
+
+const char *ucg_perf_coll_name(ucg_perf_coll_t coll)
+{
+    return ucg_perf_coll_info[coll].name;
+}
+
+const char *ucg_perf_coll_attr_env(ucg_perf_coll_t coll, ucg_request_type_t nb)
+{
+    if (nb == UCG_REQUEST_NONBLOCKING) {
+        return ucg_perf_coll_info[coll].iattr_env;
+    }
+    return ucg_perf_coll_info[coll].attr_env;
+}
+
+/* Bytes moved over the busiest link, same convention as nccl-tests. */
+static double ucg_perf_bus_bytes(ucg_perf_coll_t coll, size_t size, uint32_t nranks)
+{
+    switch (coll) {
+        case UCG_PERF_COLL_BCAST:
+        case UCG_PERF_COLL_REDUCE:
+        case UCG_PERF_COLL_SCAN:
+        case UCG_PERF_COLL_EXSCAN:
+            return size;
+        case UCG_PERF_COLL_ALLREDUCE:
+            return 2.0 * size * (nranks - 1) / nranks;
+        case UCG_PERF_COLL_SCATTERV:
+        case UCG_PERF_COLL_GATHERV:
+        case UCG_PERF_COLL_ALLGATHERV:
+        case UCG_PERF_COLL_ALLGATHER:
+        case UCG_PERF_COLL_ALLTOALLV:
+        case UCG_PERF_COLL_REDUCE_SCATTER:
+        case UCG_PERF_COLL_REDUCE_SCATTER_BLOCK:
+            return (double)size * (nranks - 1);
+        default:
+            return 0;
+    }
+}
+
+static ucg_status_t ucg_perf_request_init(ucg_perf_coll_ctx_t *ctx, int32_t count,
+                                          ucg_request_h *request)
+{
+    ucg_group_h group = ctx->group;
+    ucg_rank_t root = ctx->params->root;
+    ucg_request_type_t nb = ctx->params->nb;
+    ucg_request_info_t info = {
+        .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .mem_type = UCG_MEM_TYPE_HOST,
+    };
+
+    for (uint32_t i = 0; i < ctx->rank->size; ++i) {
+        ctx->counts[i] = count;
+        ctx->displs[i] = i * count;
+    }
+
+    switch (ctx->coll) {
+        case UCG_PERF_COLL_BCAST:
+            return ucg_request_bcast_init(ctx->recvbuf, count, ctx->dt, root,
+                                          group, &info, nb, request);
+        case UCG_PERF_COLL_ALLREDUCE:
+            return ucg_request_allreduce_init(ctx->sendbuf, ctx->recvbuf, count,
+                                              ctx->dt, ctx->op, group, &info,
+                                              nb, request);
+        case UCG_PERF_COLL_BARRIER:
+            return ucg_request_barrier_init(group, &info, nb, request);
+        case UCG_PERF_COLL_SCATTERV:
+            return ucg_request_scatterv_init(ctx->sendbuf, ctx->counts, ctx->displs,
+                                             ctx->dt, ctx->recvbuf, count, ctx->dt,
+                                             root, group, &info, nb, request);
+        case UCG_PERF_COLL_GATHERV:
+            return ucg_request_gatherv_init(ctx->sendbuf, count, ctx->dt,
+                                            ctx->recvbuf, ctx->counts, ctx->displs,
+                                            ctx->dt, root, group, &info, nb,
+                                            request);
+        case UCG_PERF_COLL_ALLGATHERV:
+            return ucg_request_allgatherv_init(ctx->sendbuf, count, ctx->dt,
+                                               ctx->recvbuf, ctx->counts,
+                                               ctx->displs, ctx->dt, group,
+                                               &info, nb, request);
+        case UCG_PERF_COLL_ALLGATHER:
+            return ucg_request_allgather_init(ctx->sendbuf, count, ctx->dt, ctx->recvbuf,
+                                              count, ctx->dt, group, &info, nb, request);
+        case UCG_PERF_COLL_ALLTOALLV:
+            return ucg_request_alltoallv_init(ctx->sendbuf, ctx->counts, ctx->displs,
+                                              ctx->dt, ctx->recvbuf, ctx->counts,
+                                              ctx->displs, ctx->dt, group, &info,
+                                              nb, request);
+        case UCG_PERF_COLL_REDUCE_SCATTER:
+            return ucg_request_reduce_scatter_init(ctx->sendbuf, ctx->recvbuf, ctx->counts,
+                                                   ctx->dt, ctx->op, group, &info, nb,
+                                                   request);
+        case UCG_PERF_COLL_REDUCE_SCATTER_BLOCK:
+            return ucg_request_reduce_scatter_block_init(ctx->sendbuf, ctx->recvbuf, count,
+                                                         ctx->dt, ctx->op, group, &info,
+                                                         nb, request);
+        case UCG_PERF_COLL_REDUCE:
+            return ucg_request_reduce_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                           ctx->op, root, group, &info, nb, request);
+        case UCG_PERF_COLL_SCAN:
+            return ucg_request_scan_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                         ctx->op, group, &info, nb, request);
+        case UCG_PERF_COLL_EXSCAN:
+            return ucg_request_exscan_init(ctx->sendbuf, ctx->recvbuf, count, ctx->dt,
+                                           ctx->op, group, &info, nb, request);
+        default:
+            return UCG_ERR_UNSUPPORTED;
+    }
+}
+
+static ucg_status_t ucg_perf_request_wait(ucg_request_h request)
+{
+    ucg_status_t status;
+    do {
+        status = ucg_request_test(request);
+    } while (status == UCG_INPROGRESS);
+    return status;
+}
+
+static ucg_status_t ucg_perf_request_run(ucg_request_h request)
+{
+    ucg_status_t status = ucg_request_start(request);
+    if (status != UCG_OK) {
+        return status;
+    }
+    return ucg_perf_request_wait(request);
+}
+
+/* Busy computing without calling into UCG. */
+static void ucg_perf_compute(double us)
+{
+    double end = ucg_perf_time_us() + us;
+    while (ucg_perf_time_us() < end) {
+    }
+    return;
+}
+
+static ucg_status_t ucg_perf_measure_persistent(ucg_perf_coll_ctx_t *ctx, int32_t count)
+{
+    ucg_request_h request;
+    ucg_status_t status = ucg_perf_request_init(ctx, count, &request);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    int warmup = ctx->params->warmup;
+    int total = warmup + ctx->params->iters;
+    for (int i = 0; i < total; ++i) {
+        double start = ucg_perf_time_us();
+        status = ucg_perf_request_run(request);
+        double end = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            break;
+        }
+        if (i >= warmup) {
+            ctx->lat[i - warmup] = end - start;
+        }
+    }
+
+    ucg_request_cleanup(request);
+    return status;
+}
+
+static ucg_status_t ucg_perf_measure_oneshot(ucg_perf_coll_ctx_t *ctx, int32_t count)
+{
+    ucg_status_t status;
+    ucg_request_h request;
+    int warmup = ctx->params->warmup;
+    int total = warmup + ctx->params->iters;
+
+    for (int i = 0; i < total; ++i) {
+        double start = ucg_perf_time_us();
+        status = ucg_perf_request_init(ctx, count, &request);
+        if (status != UCG_OK) {
+            return status;
+        }
+        status = ucg_perf_request_run(request);
+        ucg_request_cleanup(request);
+        double end = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            return status;
+        }
+        if (i >= warmup) {
+            ctx->lat[i - warmup] = end - start;
+        }
+    }
+    return UCG_OK;
+}
+
+static double ucg_perf_max_of_ranks(ucg_perf_coll_ctx_t *ctx, double value)
+{
+    uint32_t nranks = ctx->rank->size;
+    double all[nranks];
+    ucg_oob_group_t *oob = &ctx->rank->oob_group;
+    oob->allgather(&value, all, sizeof(value), oob->group);
+    for (uint32_t i = 0; i < nranks; ++i) {
+        value = all[i] > value ? all[i] : value;
+    }
+    return value;
+}
+
+/**
+ * Like the OSU benchmarks, the computation takes as long as the collective
+ * alone on the slowest rank, and the overlap is the part of the collective
+ * that doesn't add to the computation.
+ */
+static ucg_status_t ucg_perf_measure_overlap(ucg_perf_coll_ctx_t *ctx, int32_t count,
+                                             ucg_perf_overlap_t *overlap)
+{
+    ucg_request_h request;
+    ucg_status_t status = ucg_perf_request_init(ctx, count, &request);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    int warmup = ctx->params->warmup;
+    int iters = ctx->params->iters;
+    double comm = 0;
+    for (int i = 0; i < warmup + iters; ++i) {
+        double start = ucg_perf_time_us();
+        status = ucg_perf_request_run(request);
+        double end = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            goto out;
+        }
+        if (i >= warmup) {
+            comm += end - start;
+        }
+    }
+    comm /= iters;
+
+    double comp = ucg_perf_max_of_ranks(ctx, comm);
+    double total = 0;
+    for (int i = 0; i < iters; ++i) {
+        double start = ucg_perf_time_us();
+        status = ucg_request_start(request);
+        if (status != UCG_OK) {
+            goto out;
+        }
+        ucg_perf_compute(comp);
+        status = ucg_perf_request_wait(request);
+        double end = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            goto out;
+        }
+        total += end - start;
+    }
+    total /= iters;
+
+    overlap->comm = comm;
+    overlap->comp = comp;
+    overlap->total = total;
+    overlap->overlap = comm > 0 ? 100 * (1 - (total - comp) / comm) : 0;
+    overlap->overlap = overlap->overlap < 0 ? 0 : overlap->overlap;
+    overlap->overlap = overlap->overlap > 100 ? 100 : overlap->overlap;
+
+out:
+    ucg_request_cleanup(request);
+    return status;
+}
+
+static int ucg_perf_double_cmp(const void *a, const void *b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/* The collective is as slow as its slowest rank or thread. */
+static void ucg_perf_merge_stat(const ucg_perf_stat_t *stats, uint32_t count,
+                                ucg_perf_stat_t *stat)
+{
+    *stat = stats[0];
+    stat->avg = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        stat->min = stats[i].min < stat->min ? stats[i].min : stat->min;
+        stat->p99 = stats[i].p99 > stat->p99 ? stats[i].p99 : stat->p99;
+        stat->avg += stats[i].avg;
+    }
+    stat->avg /= count;
+    return;
+}
+
+/* Only one thread of a rank can use the OOB at a time, so it's done by thread 0. */
+static int ucg_perf_sync(ucg_perf_coll_ctx_t *ctx)
+{
+    ucg_perf_mt_t *mt = ctx->mt;
+    if (mt == NULL) {
+        return ucg_lcluster_barrier(ctx->rank) == UCG_OK ? 0 : -1;
+    }
+
+    if (ctx->tid == 0 && ucg_lcluster_barrier(ctx->rank) != UCG_OK) {
+        mt->failed = 1;
+    }
+    pthread_barrier_wait(&mt->barrier);
+    return mt->failed ? -1 : 0;
+}
+
+/* Returns -1 if any thread of the rank has failed. Only thread 0 gets @a stat. */
+static int ucg_perf_reduce_stat(ucg_perf_coll_ctx_t *ctx, ucg_perf_stat_t *stat)
+{
+    int iters = ctx->params->iters;
+    qsort(ctx->lat, iters, sizeof(double), ucg_perf_double_cmp);
+
+    ucg_perf_stat_t local = {
+        .min = ctx->lat[0],
+        .avg = 0,
+        .p99 = ctx->lat[(int)ceil(0.99 * iters) - 1],
+    };
+    for (int i = 0; i < iters; ++i) {
+        local.avg += ctx->lat[i];
+    }
+    local.avg /= iters;
+
+    ucg_perf_mt_t *mt = ctx->mt;
+    if (mt != NULL) {
+        mt->stats[ctx->tid] = local;
+        pthread_barrier_wait(&mt->barrier);
+        if (mt->failed) {
+            return -1;
+        }
+        if (ctx->tid != 0) {
+            return 0;
+        }
+        ucg_perf_merge_stat(mt->stats, ctx->params->threads, &local);
+    }
+
+    uint32_t nranks = ctx->rank->size;
+    ucg_perf_stat_t all[nranks];
+    ucg_oob_group_t *oob = &ctx->rank->oob_group;
+    oob->allgather(&local, all, sizeof(local), oob->group);
+    ucg_perf_merge_stat(all, nranks, stat);
+    return 0;
+}
+
+static void ucg_perf_print_header(ucg_perf_coll_ctx_t *ctx, ucg_perf_mode_t mode)
+{
+    const ucg_perf_params_t *params = ctx->params;
+    char plan[UCG_PERF_MAX_NAME_LEN] = "default";
+
+    if (params->plan_id >= 0) {
+        snprintf(plan, sizeof(plan), "%d", params->plan_id);
+    }
+    const char *mode_name = "persistent";
+    if (mode == UCG_PERF_MODE_ONESHOT) {
+        mode_name = "init+start+cleanup";
+    } else if (mode == UCG_PERF_MODE_OVERLAP) {
+        mode_name = "start+compute+wait";
+    } else if (mode == UCG_PERF_MODE_BATCH) {
+        mode_name = "batch";
+    }
+    printf("#\n");
+    printf("# %s%s, %s, %u ranks, %u per node, %u per socket, %s, plan %s%s\n",
+           params->nb == UCG_REQUEST_NONBLOCKING ? "i" : "",
+           ucg_perf_coll_name(ctx->coll), mode_name,
+           ctx->rank->size, params->cluster.ppn, params->cluster.pps,
+           params->cluster.mode == UCG_LCLUSTER_MODE_THREAD ? "threads" : "processes",
+           plan, params->progress_thread ? ", progress thread" : "");
+    if (params->threads > 1) {
+        printf("# %d collective threads per rank, busbw is the sum of all threads\n",
+               params->threads);
+    }
+    if (mode == UCG_PERF_MODE_BATCH) {
+        printf("# %d groups with one request on each, times of the whole batch on "
+               "the slowest rank\n", params->batch);
+        printf("#%11s %12s %12s %12s\n", "bytes", "single(us)", "batched(us)", "speedup");
+        return;
+    }
+    if (mode == UCG_PERF_MODE_OVERLAP) {
+        printf("# Times are averages of all ranks, overlap is the minimum of all ranks\n");
+        printf("#%11s %12s %12s %12s %12s\n",
+               "bytes", "comm(us)", "comp(us)", "total(us)", "overlap(%)");
+        return;
+    }
+    printf("#%11s %12s %12s %12s %14s\n",
+           "bytes", "min(us)", "avg(us)", "p99(us)", "busbw(GB/s)");
+    return;
+}
+
+static int ucg_perf_run_mode(ucg_perf_coll_ctx_t *ctx, ucg_perf_mode_t mode)
+{
+    const ucg_perf_params_t *params = ctx->params;
+    const ucg_perf_coll_info_t *info = &ucg_perf_coll_info[ctx->coll];
+    ucg_rank_t myrank = ctx->rank->myrank;
+    int printer = myrank == 0 && ctx->tid == 0;
+
+    if (printer) {
+        ucg_perf_print_header(ctx, mode);
+    }
+
+    size_t min_size = params->min_size;
+    size_t max_size = params->max_size;
+    if (ctx->coll == UCG_PERF_COLL_BARRIER) {
+        min_size = max_size = 0;
+    }
+
+    for (size_t size = min_size; size <= max_size;
+         size = (size == 0) ? 1 : size * params->factor) {
+        int32_t count = size / info->dt_size;
+        if (count == 0 && size != 0) {
+            continue;
+        }
+
+        if (ucg_perf_sync(ctx) != 0) {
+            return -1;
+        }
+        ucg_status_t status;
+        if (mode == UCG_PERF_MODE_PERSISTENT) {
+            status = ucg_perf_measure_persistent(ctx, count);
+        } else {
+            status = ucg_perf_measure_oneshot(ctx, count);
+        }
+        if (status != UCG_OK) {
+            fprintf(stderr, "rank %d: %s of %zu bytes failed, %s\n", myrank,
+                    info->name, size, ucg_status_string(status));
+            if (ctx->mt != NULL) {
+                /* Let the other threads leave at ucg_perf_reduce_stat(). */
+                ctx->mt->failed = 1;
+                pthread_barrier_wait(&ctx->mt->barrier);
+            }
+            return -1;
+        }
+
+        ucg_perf_stat_t stat;
+        if (ucg_perf_reduce_stat(ctx, &stat) != 0) {
+            return -1;
+        }
+        if (!printer) {
+            continue;
+        }
+
+        size_t bytes = (size_t)count * info->dt_size;
+        double bus_bytes = ucg_perf_bus_bytes(ctx->coll, bytes, ctx->rank->size);
+        bus_bytes *= params->threads;
+        if (bus_bytes > 0) {
+            printf("%12zu %12.2f %12.2f %12.2f %14.3f\n", bytes, stat.min,
+                   stat.avg, stat.p99, bus_bytes / stat.avg / 1e3);
+        } else {
+            printf("%12zu %12.2f %12.2f %12.2f %14s\n", bytes, stat.min,
+                   stat.avg, stat.p99, "-");
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
+
+static int ucg_perf_run_overlap(ucg_perf_coll_ctx_t *ctx)
+{
+    const ucg_perf_params_t *params = ctx->params;
+    const ucg_perf_coll_info_t *info = &ucg_perf_coll_info[ctx->coll];
+    ucg_rank_t myrank = ctx->rank->myrank;
+    uint32_t nranks = ctx->rank->size;
+
+    if (myrank == 0) {
+        ucg_perf_print_header(ctx, UCG_PERF_MODE_OVERLAP);
+    }
+
+    size_t min_size = params->min_size;
+    size_t max_size = params->max_size;
+    if (ctx->coll == UCG_PERF_COLL_BARRIER) {
+        min_size = max_size = 0;
+    }
+
+    for (size_t size = min_size; size <= max_size;
+         size = (size == 0) ? 1 : size * params->factor) {
+        int32_t count = size / info->dt_size;
+        if (count == 0 && size != 0) {
+            continue;
+        }
+
+        if (ucg_perf_sync(ctx) != 0) {
+            return -1;
+        }
+        ucg_perf_overlap_t local;
+        ucg_status_t status = ucg_perf_measure_overlap(ctx, count, &local);
+        if (status != UCG_OK) {
+            fprintf(stderr, "rank %d: %s of %zu bytes failed, %s\n", myrank,
+                    info->name, size, ucg_status_string(status));
+            return -1;
+        }
+
+        ucg_perf_overlap_t all[nranks];
+        ucg_oob_group_t *oob = &ctx->rank->oob_group;
+        oob->allgather(&local, all, sizeof(local), oob->group);
+        if (myrank != 0) {
+            continue;
+        }
+
+        ucg_perf_overlap_t stat = all[0];
+        for (uint32_t i = 1; i < nranks; ++i) {
+            stat.comm += all[i].comm;
+            stat.total += all[i].total;
+            stat.overlap = all[i].overlap < stat.overlap ? all[i].overlap : stat.overlap;
+        }
+        printf("%12zu %12.2f %12.2f %12.2f %12.1f\n", (size_t)count * info->dt_size,
+               stat.comm / nranks, stat.comp, stat.total / nranks, stat.overlap);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+static int ucg_perf_ctx_alloc(ucg_perf_coll_ctx_t *ctx)
+{
+    const ucg_perf_params_t *params = ctx->params;
+    ucg_lcluster_rank_t *rank = ctx->rank;
+
+    /* Vector collectives use one block of max_size per rank. */
+    size_t buf_size = (params->max_size > 0 ? params->max_size : 1) * rank->size;
+    ctx->sendbuf = malloc(buf_size);
+    ctx->recvbuf = malloc(buf_size);
+    ctx->counts = malloc(rank->size * sizeof(int32_t));
+    ctx->displs = malloc(rank->size * sizeof(int32_t));
+    ctx->lat = malloc(params->iters * sizeof(double));
+    if (ctx->sendbuf == NULL || ctx->recvbuf == NULL || ctx->counts == NULL ||
+        ctx->displs == NULL || ctx->lat == NULL) {
+        fprintf(stderr, "rank %d: failed to allocate buffers\n", rank->myrank);
+        return -1;
+    }
+    memset(ctx->sendbuf, rank->myrank + 1, buf_size);
+    memset(ctx->recvbuf, 0, buf_size);
+    return 0;
+}
+
+static void ucg_perf_ctx_free(ucg_perf_coll_ctx_t *ctx)
+{
+    free(ctx->lat);
+    free(ctx->displs);
+    free(ctx->counts);
+    free(ctx->recvbuf);
+    free(ctx->sendbuf);
+    return;
+}
+
+static ucg_status_t ucg_perf_batch_single(uint32_t num, ucg_request_h *requests)
+{
+    ucg_status_t status;
+    for (uint32_t i = 0; i < num; ++i) {
+        status = ucg_request_start(requests[i]);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+
+    int done;
+    do {
+        done = 1;
+        for (uint32_t i = 0; i < num; ++i) {
+            status = ucg_request_test(requests[i]);
+            if (status == UCG_INPROGRESS) {
+                done = 0;
+            } else if (status != UCG_OK) {
+                return status;
+            }
+        }
+    } while (!done);
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_perf_batch_batched(uint32_t num, ucg_request_h *requests)
+{
+    ucg_status_t status = ucg_request_startall(num, requests);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    do {
+        status = ucg_request_testall(num, requests);
+    } while (status == UCG_INPROGRESS);
+    return status;
+}
+
+/* Every context has its own group, the request on it is persistent. */
+static ucg_status_t ucg_perf_measure_batch(ucg_perf_coll_ctx_t *ctxs, int32_t count,
+                                           ucg_perf_batch_t *batch)
+{
+    ucg_status_t status = UCG_OK;
+    uint32_t num = ctxs[0].params->batch;
+    ucg_request_h requests[num];
+    uint32_t num_requests;
+    for (num_requests = 0; num_requests < num; ++num_requests) {
+        status = ucg_perf_request_init(&ctxs[num_requests], count, &requests[num_requests]);
+        if (status != UCG_OK) {
+            goto out;
+        }
+    }
+
+    int warmup = ctxs[0].params->warmup;
+    int iters = ctxs[0].params->iters;
+    batch->single = 0;
+    batch->batched = 0;
+    for (int i = 0; i < warmup + iters; ++i) {
+        double start = ucg_perf_time_us();
+        status = ucg_perf_batch_single(num, requests);
+        double mid = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            goto out;
+        }
+        status = ucg_perf_batch_batched(num, requests);
+        double end = ucg_perf_time_us();
+        if (status != UCG_OK) {
+            goto out;
+        }
+        if (i >= warmup) {
+            batch->single += mid - start;
+            batch->batched += end - mid;
+        }
+    }
+    batch->single /= iters;
+    batch->batched /= iters;
+
+out:
+    for (uint32_t i = 0; i < num_requests; ++i) {
+        ucg_request_cleanup(requests[i]);
+    }
+    return status;
+}
+
+static int ucg_perf_run_batch(const ucg_perf_coll_ctx_t *base)
+{
+    int ret = -1;
+    const ucg_perf_params_t *params = base->params;
+    const ucg_perf_coll_info_t *info = &ucg_perf_coll_info[base->coll];
+    ucg_lcluster_rank_t *rank = base->rank;
+    int num = params->batch;
+    ucg_perf_coll_ctx_t *ctxs = calloc(num, sizeof(ucg_perf_coll_ctx_t));
+    if (ctxs == NULL) {
+        fprintf(stderr, "rank %d: failed to allocate batch\n", rank->myrank);
+        return ret;
+    }
+
+    int num_ctxs;
+    for (num_ctxs = 0; num_ctxs < num; ++num_ctxs) {
+        ucg_perf_coll_ctx_t *ctx = &ctxs[num_ctxs];
+        *ctx = *base;
+        if (ucg_lcluster_group_create(rank, num_ctxs + 1, &ctx->group) != UCG_OK) {
+            goto out;
+        }
+        if (ucg_perf_ctx_alloc(ctx) != 0) {
+            ucg_perf_ctx_free(ctx);
+            ucg_group_destroy(ctx->group);
+            goto out;
+        }
+    }
+
+    if (rank->myrank == 0) {
+        ucg_perf_print_header(&ctxs[0], UCG_PERF_MODE_BATCH);
+    }
+
+    size_t min_size = params->min_size;
+    size_t max_size = params->max_size;
+    if (base->coll == UCG_PERF_COLL_BARRIER) {
+        min_size = max_size = 0;
+    }
+
+    for (size_t size = min_size; size <= max_size;
+         size = (size == 0) ? 1 : size * params->factor) {
+        int32_t count = size / info->dt_size;
+        if (count == 0 && size != 0) {
+            continue;
+        }
+
+        if (ucg_perf_sync(&ctxs[0]) != 0) {
+            goto out;
+        }
+        ucg_perf_batch_t batch;
+        ucg_status_t status = ucg_perf_measure_batch(ctxs, count, &batch);
+        if (status != UCG_OK) {
+            fprintf(stderr, "rank %d: batch of %s of %zu bytes failed, %s\n",
+                    rank->myrank, info->name, size, ucg_status_string(status));
+            goto out;
+        }
+
+        double single = ucg_perf_max_of_ranks(&ctxs[0], batch.single);
+        double batched = ucg_perf_max_of_ranks(&ctxs[0], batch.batched);
+        if (rank->myrank == 0) {
+            printf("%12zu %12.2f %12.2f %12.2f\n", (size_t)count * info->dt_size,
+                   single, batched, single / batched);
+            fflush(stdout);
+        }
+    }
+    ret = 0;
+
+out:
+    for (int i = 0; i < num_ctxs; ++i) {
+        ucg_perf_ctx_free(&ctxs[i]);
+        ucg_group_destroy(ctxs[i].group);
+    }
+    free(ctxs);
+    return ret;
+}
+
+static int ucg_perf_run_modes(ucg_perf_coll_ctx_t *ctx)
+{
+    const ucg_perf_params_t *params = ctx->params;
+    int ret = 0;
+
+    if (params->modes & UCG_PERF_MODE_PERSISTENT) {
+        ret = ucg_perf_run_mode(ctx, UCG_PERF_MODE_PERSISTENT);
+    }
+    if (ret == 0 && (params->modes & UCG_PERF_MODE_ONESHOT)) {
+        ret = ucg_perf_run_mode(ctx, UCG_PERF_MODE_ONESHOT);
+    }
+    if (ret == 0 && (params->modes & UCG_PERF_MODE_OVERLAP)) {
+        ret = ucg_perf_run_overlap(ctx);
+    }
+    if (ret == 0 && (params->modes & UCG_PERF_MODE_BATCH)) {
+        ret = ucg_perf_run_batch(ctx);
+    }
+    return ret;
+}
+
+static void *ucg_perf_thread_main(void *arg)
+{
+    ucg_perf_coll_ctx_t *ctx = (ucg_perf_coll_ctx_t*)arg;
+    ctx->ret = ucg_perf_run_modes(ctx);
+    return NULL;
+}
+
+/* Every thread runs the collective on its own group at the same time. */
+static int ucg_perf_run_coll_mt(const ucg_perf_coll_ctx_t *base)
+{
+    int ret = -1;
+    int nthreads = base->params->threads;
+    ucg_lcluster_rank_t *rank = base->rank;
+    ucg_perf_mt_t mt = {
+        .failed = 0,
+    };
+    ucg_perf_coll_ctx_t *ctxs = calloc(nthreads, sizeof(ucg_perf_coll_ctx_t));
+    pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+    mt.stats = calloc(nthreads, sizeof(ucg_perf_stat_t));
+    if (ctxs == NULL || threads == NULL || mt.stats == NULL) {
+        fprintf(stderr, "rank %d: failed to allocate threads\n", rank->myrank);
+        goto out_free;
+    }
+    pthread_barrier_init(&mt.barrier, NULL, nthreads);
+
+    /* Groups are created one by one since the OOB can't be used concurrently,
+       the ids are the same on all ranks. */
+    int num_ctxs;
+    for (num_ctxs = 0; num_ctxs < nthreads; ++num_ctxs) {
+        ucg_perf_coll_ctx_t *ctx = &ctxs[num_ctxs];
+        *ctx = *base;
+        ctx->mt = &mt;
+        ctx->tid = num_ctxs;
+        if (ucg_lcluster_group_create(rank, num_ctxs + 1, &ctx->group) != UCG_OK) {
+            goto out_cleanup;
+        }
+        if (ucg_perf_ctx_alloc(ctx) != 0) {
+            ucg_perf_ctx_free(ctx);
+            ucg_group_destroy(ctx->group);
+            goto out_cleanup;
+        }
+    }
+
+    int num_threads;
+    for (num_threads = 1; num_threads < nthreads; ++num_threads) {
+        if (pthread_create(&threads[num_threads], NULL, ucg_perf_thread_main,
+                           &ctxs[num_threads]) != 0) {
+            /* Can't recover from it, the barriers need all threads. */
+            fprintf(stderr, "rank %d: failed to create thread\n", rank->myrank);
+            abort();
+        }
+    }
+    ucg_perf_thread_main(&ctxs[0]);
+    ret = ctxs[0].ret;
+    for (int i = 1; i < num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+        ret = ctxs[i].ret != 0 ? ctxs[i].ret : ret;
+    }
+
+out_cleanup:
+    for (int i = 0; i < num_ctxs; ++i) {
+        ucg_perf_ctx_free(&ctxs[i]);
+        ucg_group_destroy(ctxs[i].group);
+    }
+    pthread_barrier_destroy(&mt.barrier);
+out_free:
+    free(mt.stats);
+    free(threads);
+    free(ctxs);
+    return ret;
+}
+
+int ucg_perf_run_coll(ucg_lcluster_rank_t *rank, const ucg_perf_params_t *params,
+                      ucg_perf_coll_t coll)
+{
+    int ret = -1;
+    ucg_status_t status;
+    ucg_perf_coll_ctx_t ctx = {
+        .rank = rank,
+        .params = params,
+        .coll = coll,
+        .group = rank->group,
+    };
+
+    ucg_dt_params_t dt_params = {
+        .field_mask = UCG_DT_PARAMS_FIELD_TYPE,
+        .type = ucg_perf_coll_info[coll].dt_type,
+    };
+    status = ucg_dt_create(&dt_params, &ctx.dt);
+    if (status != UCG_OK) {
+        return ret;
+    }
+
+    ucg_op_params_t op_params = {
+        .field_mask = UCG_OP_PARAMS_FIELD_TYPE,
+        .type = UCG_OP_TYPE_SUM,
+    };
+    status = ucg_op_create(&op_params, &ctx.op);
+    if (status != UCG_OK) {
+        goto err_destroy_dt;
+    }
+
+    if (params->threads > 1) {
+        ret = ucg_perf_run_coll_mt(&ctx);
+        goto out_destroy_op;
+    }
+
+    if (ucg_perf_ctx_alloc(&ctx) == 0) {
+        ret = ucg_perf_run_modes(&ctx);
+    }
+    ucg_perf_ctx_free(&ctx);
+
+out_destroy_op:
+    ucg_op_destroy(ctx.op);
+err_destroy_dt:
+    ucg_dt_destroy(ctx.dt);
+    return ret;
+}
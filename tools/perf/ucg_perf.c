@@ -1,8 +1,274 @@
 /*
- * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2024. All rights reserved.
  */
 
+#include "ucg_perf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UCG_PERF_DEFAULT_NRANKS     4
+#define UCG_PERF_DEFAULT_MIN_SIZE   1
+#define UCG_PERF_DEFAULT_MAX_SIZE   (4 * 1024 * 1024)
+#define UCG_PERF_DEFAULT_WARMUP     10
+#define UCG_PERF_DEFAULT_ITERS      100
+#define UCG_PERF_DEFAULT_BATCH      8
+
+static void usage()
+{
+    printf("Usage: ucg_perf [options]\n");
+    printf("Run collective benchmarks on local processes or threads, no launcher is needed.\n");
+    printf("  -c <colls>      Comma-separated list of collectives, default all\n");
+    printf("                  bcast,allreduce,barrier,scatterv,gatherv,allgatherv,alltoallv,\n");
+    printf("                  reduce_scatter,reduce_scatter_block,reduce,scan,exscan,\n");
+    printf("                  allgather\n");
+    printf("  -n <nranks>     Number of ranks, default %d\n", UCG_PERF_DEFAULT_NRANKS);
+    printf("  -p <ppn>        Ranks per synthetic node, default all ranks on one node\n");
+    printf("  -s <pps>        Ranks per synthetic socket, default ppn\n");
+    printf("  -S <nps>        Synthetic nodes per subnet, default all nodes in one subnet\n");
+    printf("  -t              Run ranks as threads instead of processes\n");
+    printf("  -T <threads>    Collective threads per rank, each on its own group, default 1\n");
+    printf("  -b <bytes>      Minimum message size, default %d\n", UCG_PERF_DEFAULT_MIN_SIZE);
+    printf("  -e <bytes>      Maximum message size, default %d\n", UCG_PERF_DEFAULT_MAX_SIZE);
+    printf("  -f <factor>     Multiplication factor between sizes, default 2\n");
+    printf("  -w <iters>      Number of warmup iterations, default %d\n", UCG_PERF_DEFAULT_WARMUP);
+    printf("  -i <iters>      Number of measured iterations, default %d\n", UCG_PERF_DEFAULT_ITERS);
+    printf("  -A <plan id>    Force the plan through UCG_PLANC_UCX_<COLL>_ATTR\n");
+    printf("  -m <mode>       persistent, oneshot, overlap, batch or all, default all\n");
+    printf("                  persistent: init once, start+wait per iteration\n");
+    printf("                  oneshot   : init+start+wait+cleanup per iteration\n");
+    printf("                  overlap   : start+compute+wait per iteration, needs -N,\n");
+    printf("                              not included in all\n");
+    printf("                  batch     : one request on each of several groups,\n");
+    printf("                              start+test one by one vs startall+testall,\n");
+    printf("                              not included in all\n");
+    printf("  -B <groups>     Number of groups in batch mode, default %d\n", UCG_PERF_DEFAULT_BATCH);
+    printf("  -r <root>       Root of rooted collectives, default 0\n");
+    printf("  -N              Use nonblocking requests\n");
+    printf("  -P              Enable the progress thread, the core is set by\n");
+    printf("                  UCG_PROGRESS_THREAD_CORE\n");
+    printf("  -h              Show this help\n");
+    printf("Message size is the block size of one rank for the vector collectives.\n");
+    printf("Bus bandwidth follows the nccl-tests convention.\n");
+    printf("Overlap is the part of the collective hidden behind the computation, which\n");
+    printf("takes as long as the collective alone on the slowest rank.\n");
+    return;
+}
+
+static int ucg_perf_parse_colls(char *str, uint64_t *colls)
+{
+    *colls = 0;
+    for (char *name = strtok(str, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (!strcmp(name, "all")) {
+            *colls = UCG_MASK(UCG_PERF_COLL_LAST);
+            continue;
+        }
+        ucg_perf_coll_t coll;
+        for (coll = 0; coll < UCG_PERF_COLL_LAST; ++coll) {
+            if (!strcmp(name, ucg_perf_coll_name(coll))) {
+                *colls |= UCG_BIT(coll);
+                break;
+            }
+        }
+        if (coll == UCG_PERF_COLL_LAST) {
+            fprintf(stderr, "Unknown collective '%s'\n", name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int ucg_perf_parse_mode(const char *str, uint64_t *modes)
+{
+    if (!strcmp(str, "persistent")) {
+        *modes = UCG_PERF_MODE_PERSISTENT;
+    } else if (!strcmp(str, "oneshot")) {
+        *modes = UCG_PERF_MODE_ONESHOT;
+    } else if (!strcmp(str, "overlap")) {
+        *modes = UCG_PERF_MODE_OVERLAP;
+    } else if (!strcmp(str, "batch")) {
+        *modes = UCG_PERF_MODE_BATCH;
+    } else if (!strcmp(str, "all")) {
+        *modes = UCG_PERF_MODE_PERSISTENT | UCG_PERF_MODE_ONESHOT;
+    } else {
+        fprintf(stderr, "Unknown mode '%s'\n", str);
+        return -1;
+    }
+    return 0;
+}
+
+static int ucg_perf_parse_args(int argc, char **argv, ucg_perf_params_t *params)
+{
+    int opt;
+    int nranks = UCG_PERF_DEFAULT_NRANKS;
+    int ppn = 0;
+    int pps = 0;
+    int nps = 0;
+    while ((opt = getopt(argc, argv, "c:n:p:s:S:tT:b:e:f:w:i:A:m:r:NPB:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (ucg_perf_parse_colls(optarg, &params->colls) != 0) {
+                    return -1;
+                }
+                break;
+            case 'n':
+                nranks = atoi(optarg);
+                break;
+            case 'p':
+                ppn = atoi(optarg);
+                break;
+            case 's':
+                pps = atoi(optarg);
+                break;
+            case 'S':
+                nps = atoi(optarg);
+                break;
+            case 't':
+                params->cluster.mode = UCG_LCLUSTER_MODE_THREAD;
+                break;
+            case 'T':
+                params->threads = atoi(optarg);
+                break;
+            case 'b':
+                params->min_size = strtoull(optarg, NULL, 0);
+                break;
+            case 'e':
+                params->max_size = strtoull(optarg, NULL, 0);
+                break;
+            case 'f':
+                params->factor = atoi(optarg);
+                break;
+            case 'w':
+                params->warmup = atoi(optarg);
+                break;
+            case 'i':
+                params->iters = atoi(optarg);
+                break;
+            case 'A':
+                params->plan_id = atoi(optarg);
+                break;
+            case 'm':
+                if (ucg_perf_parse_mode(optarg, &params->modes) != 0) {
+                    return -1;
+                }
+                break;
+            case 'r':
+                params->root = atoi(optarg);
+                break;
+            case 'N':
+                params->nb = UCG_REQUEST_NONBLOCKING;
+                break;
+            case 'P':
+                params->progress_thread = 1;
+                break;
+            case 'B':
+                params->batch = atoi(optarg);
+                break;
+            case 'h':
+            default:
+                return -1;
+        }
+    }
+
+    if (ppn <= 0) {
+        ppn = nranks;
+    }
+    if (pps <= 0) {
+        pps = ppn;
+    }
+    if (nranks <= 0 || nps < 0 || params->iters <= 0 || params->warmup < 0 ||
+        params->factor < 2 || params->min_size > params->max_size ||
+        params->root >= nranks || params->max_size > INT32_MAX ||
+        params->threads <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return -1;
+    }
+    if ((params->modes & UCG_PERF_MODE_OVERLAP) &&
+        (params->nb != UCG_REQUEST_NONBLOCKING || params->threads > 1)) {
+        fprintf(stderr, "Overlap mode needs -N and one collective thread\n");
+        return -1;
+    }
+    if ((params->modes & UCG_PERF_MODE_BATCH) &&
+        (params->batch <= 0 || params->threads > 1)) {
+        fprintf(stderr, "Batch mode needs a positive -B and one collective thread\n");
+        return -1;
+    }
+    params->cluster.nranks = nranks;
+    params->cluster.ppn = ppn;
+    params->cluster.pps = pps;
+    params->cluster.nps = nps;
+    params->cluster.thread_mode = params->threads > 1 ? UCG_THREAD_MODE_MULTI :
+                                                        UCG_THREAD_MODE_SINGLE;
+    return 0;
+}
+
+/* Must be done before launching so that every rank reads the same configuration. */
+static void ucg_perf_setenv(const ucg_perf_params_t *params)
+{
+    char attr[UCG_PERF_MAX_NAME_LEN];
+
+    if (params->progress_thread) {
+        setenv("UCG_PROGRESS_THREAD", "y", 1);
+    }
+    if (params->plan_id < 0) {
+        return;
+    }
+    snprintf(attr, sizeof(attr), "I:%d", params->plan_id);
+    for (ucg_perf_coll_t coll = 0; coll < UCG_PERF_COLL_LAST; ++coll) {
+        if (params->colls & UCG_BIT(coll)) {
+            setenv(ucg_perf_coll_attr_env(coll, params->nb), attr, 1);
+        }
+    }
+    return;
+}
+
+static int ucg_perf_rank_run(ucg_lcluster_rank_t *rank, void *arg)
+{
+    const ucg_perf_params_t *params = (const ucg_perf_params_t*)arg;
+
+    for (ucg_perf_coll_t coll = 0; coll < UCG_PERF_COLL_LAST; ++coll) {
+        if (!(params->colls & UCG_BIT(coll))) {
+            continue;
+        }
+        if (ucg_perf_run_coll(rank, params, coll) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
+    ucg_perf_params_t params = {
+        .colls = UCG_MASK(UCG_PERF_COLL_LAST),
+        .modes = UCG_PERF_MODE_PERSISTENT | UCG_PERF_MODE_ONESHOT,
+        .cluster = {
+            .mode = UCG_LCLUSTER_MODE_PROCESS,
+        },
+        .min_size = UCG_PERF_DEFAULT_MIN_SIZE,
+        .max_size = UCG_PERF_DEFAULT_MAX_SIZE,
+        .factor = 2,
+        .warmup = UCG_PERF_DEFAULT_WARMUP,
+        .iters = UCG_PERF_DEFAULT_ITERS,
+        .plan_id = -1,
+        .root = 0,
+        .nb = UCG_REQUEST_BLOCKING,
+        .threads = 1,
+        .progress_thread = 0,
+        .batch = UCG_PERF_DEFAULT_BATCH,
+    };
+
+    if (ucg_perf_parse_args(argc, argv, &params) != 0) {
+        usage();
+        return -1;
+    }
+
+    ucg_perf_setenv(&params);
+    if (ucg_lcluster_run(&params.cluster, ucg_perf_rank_run, &params) != UCG_OK) {
+        fprintf(stderr, "Benchmark failed\n");
+        return -1;
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
+ */
+
+#ifndef UCG_PERF_H_
+#define UCG_PERF_H_
+
+#include <ucg/api/ucg.h>
+#include "util/ucg_local_cluster.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define UCG_PERF_MAX_NAME_LEN 32
+
+typedef enum ucg_perf_coll {
+    UCG_PERF_COLL_BCAST,
+    UCG_PERF_COLL_ALLREDUCE,
+    UCG_PERF_COLL_BARRIER,
+    UCG_PERF_COLL_SCATTERV,
+    UCG_PERF_COLL_GATHERV,
+    UCG_PERF_COLL_ALLGATHERV,
+    UCG_PERF_COLL_ALLTOALLV,
+    UCG_PERF_COLL_REDUCE_SCATTER,
+    UCG_PERF_COLL_REDUCE_SCATTER_BLOCK,
+    UCG_PERF_COLL_REDUCE,
+    UCG_PERF_COLL_SCAN,
+    UCG_PERF_COLL_EXSCAN,
+    UCG_PERF_COLL_ALLGATHER,
+    UCG_PERF_COLL_LAST,
+} ucg_perf_coll_t;
+
+typedef enum ucg_perf_mode {
+    /** Create the request once, start it many times. */
+    UCG_PERF_MODE_PERSISTENT = UCG_BIT(0),
+    /** Every iteration does init + start + wait + cleanup. */
+    UCG_PERF_MODE_ONESHOT = UCG_BIT(1),
+    /** Start, compute as long as the collective takes, then wait. */
+    UCG_PERF_MODE_OVERLAP = UCG_BIT(2),
+    /** One request on each of several groups, started and tested one by one
+        and then as a batch. */
+    UCG_PERF_MODE_BATCH = UCG_BIT(3),
+} ucg_perf_mode_t;
+
+typedef struct ucg_perf_params {
+    uint64_t colls; /* Bit mask of ucg_perf_coll_t */
+    uint64_t modes; /* Bit mask of ucg_perf_mode_t */
+    ucg_lcluster_params_t cluster;
+    size_t min_size;
+    size_t max_size;
+    int factor;
+    int warmup;
+    int iters;
+    int plan_id; /* Forced plan id, -1 means using the default policy */
+    ucg_rank_t root;
+    ucg_request_type_t nb;
+    int threads; /* Collective threads per rank, each drives its own group */
+    int progress_thread; /* Enable the progress thread of every context */
+    int batch; /* Number of groups in batch mode */
+} ucg_perf_params_t;
+
+/** Benchmark one collective, results are printed by rank 0. */
+int ucg_perf_run_coll(ucg_lcluster_rank_t *rank, const ucg_perf_params_t *params,
+                      ucg_perf_coll_t coll);
+
+const char *ucg_perf_coll_name(ucg_perf_coll_t coll);
+
+/** Environment variable to force the plan of the collective. */
+const char *ucg_perf_coll_attr_env(ucg_perf_coll_t coll, ucg_request_type_t nb);
+
+static inline double ucg_perf_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+#endif